@@ -290,9 +290,12 @@ private:
             floorMesh.draw(floorShader, camera, floorTransform);
 
             // Sort transparent object from farthest to closest to the eye.
+            // Compares the squared distances (no square roots), with `>` since `>=` isn't a strict weak ordering.
             std::sort(transparentPositions.begin(), transparentPositions.end(),
                       [&camera](const glm::vec3& x, const glm::vec3& y) {
-                          return glm::length(camera.getPosition() - x) >= glm::length(camera.getPosition() - y);
+                          const glm::vec3 toX = x - camera.getPosition();
+                          const glm::vec3 toY = y - camera.getPosition();
+                          return glm::dot(toX, toX) > glm::dot(toY, toY);
                       });
 
             // Draw transparent object after all the opaque ones were drawn.
@@ -11,6 +11,9 @@ OBJECT_DIR="build/obj"
 PREBUILT_MODULES_DIR="build/pcm"
 PREBUILT_CACHE_DIR="build/pcm/cache"
 PROGRAM_EXECUTABLE_PATH="build/program"
+TOOLS_SOURCE_DIR="tools"
+TOOLS_OBJECT_DIR="build/obj/tools"
+TOOLS_EXECUTABLE_PATH="build/tools"
 
 # File extensions
 CPP_FILE_EXTENSION=".cpp"
@@ -48,11 +51,29 @@ function compile_cpp_into_object_file {
     clang++ -o $OBJECT_DIR/$1$CPP_FILE_EXTENSION.o -c $SOURCE_DIR/$1$CPP_FILE_EXTENSION $COMMON_FLAGS
 }
 
+# Same as the two functions above, but for the sources of the tools executable
+# (benchmarks and tests, see tools/tools.cpp), which go into $TOOLS_OBJECT_DIR.
+function compile_tools_module_into_pcm_and_object_file {
+    echo "compile_tools_module_into_pcm_and_object_file $1"
+    clang++ -o $PREBUILT_MODULES_DIR/$1.pcm -c $TOOLS_SOURCE_DIR/$1$CPP_MODULE_FILE_EXTENSION -I./$SOURCE_DIR $COMMON_FLAGS $PCM_MODULE_FLAGS
+    clang++ -o $TOOLS_OBJECT_DIR/$1$CPP_MODULE_FILE_EXTENSION.o -c $TOOLS_SOURCE_DIR/$1$CPP_MODULE_FILE_EXTENSION -I./$SOURCE_DIR $COMMON_FLAGS
+}
+
+function compile_tools_cpp_into_object_file {
+    echo "compile_tools_cpp_into_object_file $1"
+    clang++ -o $TOOLS_OBJECT_DIR/$1$CPP_FILE_EXTENSION.o -c $TOOLS_SOURCE_DIR/$1$CPP_FILE_EXTENSION -I./$SOURCE_DIR $COMMON_FLAGS
+}
+
 # Linking the object files and libraries into executable.
 function link_to_executable_routine {
     clang++ -o $PROGRAM_EXECUTABLE_PATH $(find $OBJECT_DIR/*.o) $COMMON_FLAGS $LINKING_FLAGS
 }
 
+# Linking the engine's object files (without the program's main) and the tools' into the tools executable.
+function link_tools_to_executable_routine {
+    clang++ -o $TOOLS_EXECUTABLE_PATH $(find $OBJECT_DIR/*.o ! -name main.cpp.o) $(find $TOOLS_OBJECT_DIR/*.o) $COMMON_FLAGS $LINKING_FLAGS
+}
+
 # Precompiles files that are unlikely to change (standard libraries, vendor libraries).
 # If needed you can run this routine by yourself by running "precomp".
 function precompile_routine {
@@ -69,29 +90,77 @@ function build_routine {
     # none 
     compile_module_into_pcm_and_object_file timer
     compile_module_into_pcm_and_object_file mouse
+    compile_module_into_pcm_and_object_file file_mapping
+    compile_module_into_pcm_and_object_file thread_pool
+    compile_module_into_pcm_and_object_file gl_state
+    compile_module_into_pcm_and_object_file render_queue
+    compile_module_into_pcm_and_object_file camera_uniforms
+    # thread_pool
+    compile_module_into_pcm_and_object_file asset_streamer
+    compile_module_into_pcm_and_object_file shader_program.uniforms
+    # file_mapping
+    compile_module_into_pcm_and_object_file shader_program.binary_cache
+    # file_mapping
+    compile_module_into_pcm_and_object_file shader_program.keywords
+    # file_mapping thread_pool
+    compile_module_into_pcm_and_object_file shader_program.source_library
+    # gl_state camera_uniforms shader_program.uniforms shader_program.binary_cache shader_program.keywords shader_program.source_library
     compile_module_into_pcm_and_object_file shader_program
-    compile_module_into_pcm_and_object_file index_buffer
+    # shader_program
+    compile_module_into_pcm_and_object_file shader_program.variants
     compile_module_into_pcm_and_object_file vertex_buffer.supported_types
+    # gl_state vertex_buffer.supported_types
+    compile_module_into_pcm_and_object_file index_buffer
     compile_module_into_pcm_and_object_file vertex_buffer.layout
     # vertex_buffer.layout
     compile_module_into_pcm_and_object_file vertex_buffer.vertex_struct
+    # none
+    compile_module_into_pcm_and_object_file aabb
+    compile_module_into_pcm_and_object_file bounding_sphere
+    # aabb bounding_sphere
+    compile_module_into_pcm_and_object_file frustum_culling
+    # aabb
+    compile_module_into_pcm_and_object_file ray
+    # aabb ray vertex_buffer.vertex_struct
+    compile_module_into_pcm_and_object_file bvh
+    # aabb vertex_buffer.supported_types vertex_buffer.layout vertex_buffer.vertex_struct
+    compile_module_into_pcm_and_object_file vertex_buffer.packed_vertex
     # vertex_buffer.supported_types vertex_buffer.layout vertex_buffer.vertex_struct
     compile_module_into_pcm_and_object_file vertex_buffer
+    # gl_state vertex_buffer vertex_buffer.packed_vertex
+    compile_module_into_pcm_and_object_file geometry_arena
+    compile_module_into_pcm_and_object_file dynamic_buffer
     # shader_program
     compile_module_into_pcm_and_object_file transformation
-    # shader_program
+    # file_mapping thread_pool
+    compile_module_into_pcm_and_object_file texture.compression
+    # file_mapping texture.compression
+    compile_module_into_pcm_and_object_file texture.cache
+    # gl_state shader_program texture.compression texture.cache
     compile_module_into_pcm_and_object_file texture
-    # shader_program mouse
+    # texture
+    compile_module_into_pcm_and_object_file texture.registry
+    # gl_state texture texture.registry dynamic_buffer
+    compile_module_into_pcm_and_object_file material
+    # mouse ray dynamic_buffer camera_uniforms
     compile_module_into_pcm_and_object_file camera
-    # vertex_buffer index_buffer
+    # gl_state vertex_buffer index_buffer dynamic_buffer
     compile_module_into_pcm_and_object_file vertex_array
-    # vertex_array 
+    # aabb; bounding_sphere; file_mapping; texture; vertex_buffer.vertex_struct
+    compile_module_into_pcm_and_object_file model.mesh_cache
+    # file_mapping; model.mesh_cache; vertex_buffer.vertex_struct
+    compile_module_into_pcm_and_object_file model.mesh_optimizer
+    # aabb; file_mapping; model.mesh_cache; model.mesh_optimizer; vertex_buffer.vertex_struct
+    compile_module_into_pcm_and_object_file model.mesh_simplifier
+    # texture; texture.compression; model.mesh_cache
+    compile_module_into_pcm_and_object_file model.texture_atlas
+    # vertex_array vertex_buffer.packed_vertex aabb texture.registry camera model.mesh_cache model.mesh_simplifier dynamic_buffer
     compile_module_into_pcm_and_object_file mesh
-    # vertex_buffer; vertex_buffer.layout; vertex_array; texture; camera
+    # gl_state; vertex_buffer; vertex_buffer.layout; vertex_array; texture; camera
     compile_module_into_pcm_and_object_file skybox
-    # mesh
+    # mesh; model.mesh_cache; model.mesh_optimizer; model.mesh_simplifier; model.texture_atlas; vertex_buffer.packed_vertex; aabb; bounding_sphere; frustum_culling; texture.registry; thread_pool; asset_streamer; geometry_arena; dynamic_buffer; material
     compile_module_into_pcm_and_object_file model 
-    # texture; shader_program; mesh; vertex_buffer.vertex_struct; vertex_array; index_array; transformation;
+    # gl_state; texture; shader_program; mesh; vertex_buffer.vertex_struct; vertex_array; index_array; transformation;
     compile_module_into_pcm_and_object_file frame_buffer
     # everything
     compile_module_into_pcm_and_object_file application
@@ -101,9 +170,35 @@ function build_routine {
     link_to_executable_routine
 }
 
+# Builds the tools executable, run the build routine first (the tools import the engine's modules).
+# One module per subsystem, all of them only depend on the engine's modules and tools.common.
+function build_tools_routine {
+    # none
+    compile_tools_module_into_pcm_and_object_file tools.common
+    compile_tools_module_into_pcm_and_object_file tools.texture
+    compile_tools_module_into_pcm_and_object_file tools.culling
+    compile_tools_module_into_pcm_and_object_file tools.render_queue
+    compile_tools_module_into_pcm_and_object_file tools.uniforms
+    # tools.common
+    compile_tools_module_into_pcm_and_object_file tools.mesh
+    compile_tools_module_into_pcm_and_object_file tools.bvh
+
+    compile_tools_cpp_into_object_file tools
+
+    link_tools_to_executable_routine
+}
+
+# Runs the tools' checks, exits with a non-zero status if any of them fails.
+function test_routine {
+    local status=0
+    ./$TOOLS_EXECUTABLE_PATH --test-bvh || status=1
+    ./$TOOLS_EXECUTABLE_PATH --test-vertex-packing || status=1
+    return $status
+}
+
 # Setup directories
 function setup_routine {
-	mkdir -p $BUILD_DIR $OBJECT_DIR $PREBUILT_MODULES_DIR $PREBUILT_CACHE_DIR
+	mkdir -p $BUILD_DIR $OBJECT_DIR $TOOLS_OBJECT_DIR $PREBUILT_MODULES_DIR $PREBUILT_CACHE_DIR
 }
 
 # Clean build artifacts
@@ -176,6 +271,21 @@ case "$1" in
         echo "Running the executable."
         run_routine
         ;;
+    "tools" | "t")
+        echo "Building the project and the tools."
+        setup_routine
+        build_routine
+        build_tools_routine
+        ;;
+    "test")
+        echo "Building the project and the tools."
+        setup_routine
+        build_routine
+        build_tools_routine
+        echo "Running the tests."
+        test_routine
+        exit $?
+        ;;
     "precomp")
         echo "Precompiling."
         precompile_routine
@@ -7,9 +7,15 @@ layout(location = 1) in vec3 AV_NormalVec3;
 layout(location = 2) in vec2 AV_TextureCoordinatesVec2;
 layout(location = 3) in vec3 AV_TangentVec3;
 layout(location = 4) in vec3 AV_BitangentVec3;
+// Keywords, defined by the program's variant (see `ShaderKeywords`):
+//   INSTANCED - drawn by Mesh::drawInstanced, the per instance model matrix is applied after U_ModelMat4
+#ifdef INSTANCED
+layout(location = 8) in mat4 AV_InstanceModelMat4; // one per instance, streamed in by Mesh::drawInstanced
+#endif
 
-uniform mat4 U_ModelMat4; // obtained by mesh class in draw function
-uniform mat4 U_CameraProjViewMat4; // obtained by mesh class in draw function
+// Mesh::draw: the whole model matrix, Mesh::drawInstanced: the mesh's local transformation
+uniform mat4 U_ModelMat4;
+#include "./std/camera.glsl"
 
 out vec3 OV_FragmentPositionVec3;
 out vec3 OV_NormalVec3;
@@ -18,8 +24,13 @@ out vec3 OV_TangentVec3;
 out vec3 OV_BitangentVec3;
 
 void main() {
-    OV_FragmentPositionVec3 = vec3(U_ModelMat4 * vec4(AV_PositionVec3, 1.f));
-    OV_NormalVec3 = normalize(transpose(inverse(mat3(U_ModelMat4))) * AV_NormalVec3);
+#ifdef INSTANCED
+    mat4 modelMat = AV_InstanceModelMat4 * U_ModelMat4;
+#else
+    mat4 modelMat = U_ModelMat4;
+#endif
+    OV_FragmentPositionVec3 = vec3(modelMat * vec4(AV_PositionVec3, 1.f));
+    OV_NormalVec3 = normalize(transpose(inverse(mat3(modelMat))) * AV_NormalVec3);
     OV_TextureCoordinatesVec2 = AV_TextureCoordinatesVec2;
     OV_TangentVec3 = AV_TangentVec3;
     OV_BitangentVec3 = AV_BitangentVec3;
@@ -40,7 +51,7 @@ in vec2 OV_TextureCoordinatesVec2;
 in vec3 OV_TangentVec3;
 in vec3 OV_BitangentVec3;
 
-uniform vec3 U_CameraPositionVec3; // obtained by mesh class in draw function
+#include "./std/camera.glsl"
 uniform vec4 U_LightColorVec4; // passed manually
 uniform vec3 U_LightPositionVec3; // passed manually
 
@@ -48,8 +59,20 @@ uniform Material U_Material;
 
 out vec4 OF_FragmentColorVec4;
 
+// Keywords, defined by the program's variant (see `ShaderKeywords`):
+//   ALPHA_TEST - the fragments more transparent than ALPHA_CUTOFF are discarded,
+//                they neither blend nor write their depth
+#ifndef ALPHA_CUTOFF
+#define ALPHA_CUTOFF 0.1
+#endif
+
 void main() {
     OF_FragmentColorVec4 = texture(U_Material.DiffuseMap0, OV_TextureCoordinatesVec2);
+#ifdef ALPHA_TEST
+    if (OF_FragmentColorVec4.a < ALPHA_CUTOFF) {
+        discard;
+    }
+#endif
 
 //    OF_FragmentColorVec4 = pointLight(
 //        1.0f, 0.7f, 33,
@@ -9,7 +9,7 @@ layout(location = 3) in vec3 AV_TangentVec3;
 layout(location = 4) in vec3 AV_BitangentVec3;
 
 uniform mat4 U_ModelMat4; // obtained by mesh class in draw function
-uniform mat4 U_CameraProjViewMat4; // obtained by mesh class in draw function
+#include "./std/camera.glsl"
 
 out VS_OUT {
     vec3 OV_FragmentPositionVec3;
@@ -33,8 +33,7 @@ void main() {
 /// #shader fragment //////////////////////////////////////////////////////////////////////////
 #version 330 core
 
-// #include "./floor_lighting.glsl"
-#include "./std/lighting.glsl"
+#include "./std/scene_lights.glsl"
 #include "./std/material.glsl"
 
 in VS_OUT {
@@ -45,53 +44,36 @@ in VS_OUT {
     vec3 OV_BitangentVec3;
 } In;
 
-uniform vec3 U_CameraPositionVec3; // obtained by mesh class in draw function 
-uniform vec4 U_LightColorVec4; // passed manually
-uniform vec3 U_LightPositionVec3; // passed manually
+#include "./std/camera.glsl"
 uniform Material U_Material; // obtained through draw function
 
 out vec4 OF_FragmentColorVec4;
 
 void main() {
-    OF_FragmentColorVec4 = pointLight(
-        0.0f, 0.0f, 33,
-        U_LightColorVec4,
-        U_LightPositionVec3,
+    vec3 diffuseColor = vec3(texture(U_Material.DiffuseMap0, In.OV_TextureCoordinatesVec2));
+#ifdef HAS_SPECULAR_MAP
+    float specularIntensity = texture(U_Material.SpecularMap0, In.OV_TextureCoordinatesVec2).r;
+#else
+    const float specularIntensity = 0.f;
+#endif
+
+    OF_FragmentColorVec4 = sceneLights(
+        0.0f, 0.0f,
         In.OV_FragmentPositionVec3,
         U_CameraPositionVec3,
         In.OV_NormalVec3,
-        U_Material.DiffuseMap0,
-        U_Material.SpecularMap0,
-        In.OV_TextureCoordinatesVec2
+        diffuseColor,
+        specularIntensity
     );
 
     // OF_FragmentColorVec4 += directionalLight(
     //     vec3(1.f, 1.f, 0.f), 
     //     32,
     //     vec4(1.f, 1.0f, 1.0f, 1.f),
-    //     OV_FragmentPositionVec3,
+    //     In.OV_FragmentPositionVec3,
     //     U_CameraPositionVec3,
-    //     OV_NormalVec3,
-    //     U_Material.DiffuseMap0,
-    //     U_Material.SpecularMap0,
-    //     OV_TextureCoordinatesVec2
+    //     In.OV_NormalVec3,
+    //     diffuseColor,
+    //     specularIntensity
     // );
-
-    OF_FragmentColorVec4 += spotLight(
-        vec3(0.f, -1.f, 1.f), 
-        cos(radians(30.f)),
-        cos(radians(45.f)), 
-        1.0f, 0.7f,
-        33,
-        U_LightColorVec4,
-        U_LightPositionVec3, 
-        In.OV_FragmentPositionVec3,
-        U_CameraPositionVec3,
-        In.OV_NormalVec3,
-        U_Material.DiffuseMap0,
-        U_Material.SpecularMap0,
-        In.OV_TextureCoordinatesVec2
-    );
 }
-
-
@@ -5,7 +5,7 @@
 layout(location = 0) in vec3 AV_PositionVec3; 
 
 uniform mat4 U_ModelMat4; // obtained in CPU draw function
-uniform mat4 U_CameraProjViewMat4; // obtained in CPU draw function
+#include "./std/camera.glsl"
 
 void main() {
     gl_Position = U_CameraProjViewMat4 * U_ModelMat4 * vec4(AV_PositionVec3, 1.f);
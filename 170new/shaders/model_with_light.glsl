@@ -1,37 +1,60 @@
 /// #shader vertex /////////////////////////////////////////////////////////////////////////////
-#version 330 core
+#version 460 core
 
-// obtained automatically by binding VAO
-layout(location = 0) in vec3 AV_PositionVec3; 
-layout(location = 1) in vec3 AV_NormalVec3;
-layout(location = 2) in vec2 AV_TextureCoordinatesVec2;
-layout(location = 3) in vec3 AV_TangentVec3;
-layout(location = 4) in vec3 AV_BitangentVec3;
+#include "./std/vertex_packing.glsl"
 
-uniform mat4 U_ModelMat4; // obtained by mesh class in draw function
-uniform mat4 U_CameraProjViewMat4; // obtained by mesh class in draw function
+// obtained automatically by binding VAO, the mesh's vertices are `PackedVertex`es
+layout(location = 0) in vec4 AV_PackedPositionVec4;
+layout(location = 1) in vec2 AV_OctahedralNormalVec2;
+layout(location = 2) in vec4 AV_PackedTangentFrameVec4;
+layout(location = 3) in vec2 AV_TextureCoordinatesVec2;
+// per instance, streamed in by the model class
+layout(location = 8) in mat4 AV_InstanceModelMat4;
+
+// One per draw of the model's multi draw, see `model::DrawData`.
+struct DrawData {
+    mat4 localMat;
+    vec4 positionBoundsCenter;
+    vec4 positionBoundsExtent;
+    uint materialIndex;
+};
+
+// obtained by model class in draw function
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData B_DrawData[];
+};
+
+#include "./std/camera.glsl"
 
 out vec3 OV_FragmentPositionVec3;
 out vec3 OV_NormalVec3;
 out vec2 OV_TextureCoordinatesVec2;
 out vec3 OV_TangentVec3;
 out vec3 OV_BitangentVec3;
+flat out uint OV_MaterialIndex;
 
 void main() {
-    OV_FragmentPositionVec3 = vec3(U_ModelMat4 * vec4(AV_PositionVec3, 1.f));
-    OV_NormalVec3 = normalize(transpose(inverse(mat3(U_ModelMat4))) * AV_NormalVec3);
+    DrawData drawData = B_DrawData[gl_DrawID];
+    mat4 modelMat = AV_InstanceModelMat4 * drawData.localMat;
+    vec3 position = decodePosition(AV_PackedPositionVec4, drawData.positionBoundsCenter.xyz, drawData.positionBoundsExtent.xyz);
+    vec3 normal = decodeOctahedralNormal(AV_OctahedralNormalVec2);
+    vec3 tangent = decodeTangent(AV_PackedTangentFrameVec4, normal);
+
+    OV_FragmentPositionVec3 = vec3(modelMat * vec4(position, 1.f));
+    OV_NormalVec3 = normalize(transpose(inverse(mat3(modelMat))) * normal);
     OV_TextureCoordinatesVec2 = AV_TextureCoordinatesVec2;
-    OV_TangentVec3 = AV_TangentVec3;
-    OV_BitangentVec3 = AV_BitangentVec3;
+    OV_TangentVec3 = tangent;
+    OV_BitangentVec3 = decodeBitangent(AV_PackedPositionVec4, normal, tangent);
+    OV_MaterialIndex = drawData.materialIndex;
 
     gl_Position = U_CameraProjViewMat4 * vec4(OV_FragmentPositionVec3, 1.f);
 }
 
 /// #shader fragment //////////////////////////////////////////////////////////////////////////
-#version 330 core
+#version 460 core
 
-#include "./std/lighting.glsl"
-#include "./std/material.glsl"
+#include "./std/material_table.glsl"
+#include "./std/scene_lights.glsl"
 #include "./std/depth_testing.glsl"
 
 in vec3 OV_FragmentPositionVec3;
@@ -39,26 +62,28 @@ in vec3 OV_NormalVec3;
 in vec2 OV_TextureCoordinatesVec2;
 in vec3 OV_TangentVec3;
 in vec3 OV_BitangentVec3;
+flat in uint OV_MaterialIndex;
 
-uniform vec3 U_CameraPositionVec3; // obtained by mesh class in draw function 
-uniform vec4 U_LightColorVec4; // passed manually
-uniform vec3 U_LightPositionVec3; // passed manually
-
-uniform Material U_Material;
+#include "./std/camera.glsl"
 
 out vec4 OF_FragmentColorVec4;
 
 void main() {
-    OF_FragmentColorVec4 = pointLight(
-        1.0f, 0.7f, 33,
-        U_LightColorVec4,
-        U_LightPositionVec3,
+    MaterialData material = B_Materials[OV_MaterialIndex];
+    vec3 diffuseColor = vec3(sampleMaterialMap(material.diffuseMap, OV_TextureCoordinatesVec2));
+#ifdef HAS_SPECULAR_MAP
+    float specularIntensity = sampleMaterialMap(material.specularMap, OV_TextureCoordinatesVec2).r;
+#else
+    const float specularIntensity = 0.f;
+#endif
+
+    OF_FragmentColorVec4 = sceneLights(
+        1.0f, 0.7f,
         OV_FragmentPositionVec3,
         U_CameraPositionVec3,
         OV_NormalVec3,
-        U_Material.DiffuseMap0,
-        U_Material.SpecularMap0,
-        OV_TextureCoordinatesVec2
+        diffuseColor,
+        specularIntensity
     );
 
     // OF_FragmentColorVec4 += directionalLight(
@@ -68,26 +93,7 @@ void main() {
     //     OV_FragmentPositionVec3,
     //     U_CameraPositionVec3,
     //     OV_NormalVec3,
-    //     U_Material.DiffuseMap0,
-    //     U_Material.SpecularMap0,
-    //     OV_TextureCoordinatesVec2
+    //     diffuseColor,
+    //     specularIntensity
     // );
-
-    OF_FragmentColorVec4 += spotLight(
-        vec3(0.f, -1.f, 1.f),
-        cos(radians(30.f)),
-        cos(radians(45.f)),
-        1.0f, 0.7f,
-        33,
-        U_LightColorVec4,
-        U_LightPositionVec3,
-        OV_FragmentPositionVec3,
-        U_CameraPositionVec3,
-        OV_NormalVec3,
-        U_Material.DiffuseMap0,
-        U_Material.SpecularMap0,
-        OV_TextureCoordinatesVec2
-    );
 }
-
-
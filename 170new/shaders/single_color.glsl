@@ -1,18 +1,36 @@
 /// #shader vertex /////////////////////////////////////////////////////////////////////////////
-#version 330 core
+#version 460 core
 
-// obtained automatically by binding VAO
-layout(location = 0) in vec3 AV_PositionVec3;
+#include "./std/vertex_packing.glsl"
 
-uniform mat4 U_ModelMat4; // obtained by mesh class in draw function
-uniform mat4 U_CameraProjViewMat4; // obtained by mesh class in draw function
+// obtained automatically by binding VAO, the model's vertices are `PackedVertex`es
+layout(location = 0) in vec4 AV_PackedPositionVec4;
+// per instance, streamed in by the model class
+layout(location = 8) in mat4 AV_InstanceModelMat4;
+
+// One per draw of the model's multi draw, see `model::DrawData`.
+struct DrawData {
+    mat4 localMat;
+    vec4 positionBoundsCenter;
+    vec4 positionBoundsExtent;
+    uint materialIndex;
+};
+
+// obtained by model class in draw function
+layout(std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData B_DrawData[];
+};
+
+#include "./std/camera.glsl"
 
 void main() {
-    gl_Position = U_CameraProjViewMat4 * U_ModelMat4 * vec4(AV_PositionVec3, 1.f);
+    DrawData drawData = B_DrawData[gl_DrawID];
+    vec3 position = decodePosition(AV_PackedPositionVec4, drawData.positionBoundsCenter.xyz, drawData.positionBoundsExtent.xyz);
+    gl_Position = U_CameraProjViewMat4 * AV_InstanceModelMat4 * drawData.localMat * vec4(position, 1.f);
 }
 
 /// #shader fragment //////////////////////////////////////////////////////////////////////////
-#version 330 core
+#version 460 core
 
 out vec4 OF_FragmentColorVec4;
 
@@ -20,4 +38,3 @@ void main() {
     OF_FragmentColorVec4 = vec4(0.04, 0.28, 0.26, 1.0);
 }
 
-
@@ -0,0 +1,12 @@
+// The camera's per-frame data, uploaded once per frame by Camera::onNextFrame.
+// Must match `CameraUniforms` (camera_uniforms.cc), ShaderProgram checks it at link time
+// and binds the block to `camera_uniforms::defaults::bindingPoint`.
+layout(std140) uniform CameraBlock {
+    mat4 U_CameraProjViewMat4;
+    mat4 U_CameraProjectionMat4;
+    mat4 U_CameraViewMat4;
+    vec3 U_CameraPositionVec3;
+    float U_TimeInSeconds;
+    vec2 U_ViewportSizeVec2;
+    float U_DeltaTimeInSeconds;
+};
@@ -1,5 +1,21 @@
 #include "material.glsl"
-#include "branching.glsl"
+
+// Keywords, defined by the program's variant (see `ShaderKeywords`):
+//   HAS_SPECULAR_MAP - the surface has a specular map, without it the specular terms are compiled out
+//   PHONG_SPECULAR - the highlight of Phong (the reflected light direction) instead of Blinn-Phong (the halfway direction)
+
+/// How much of the light's specular highlight the camera sees.
+float specularAmount(vec3 normal, vec3 lightDirection, vec3 viewDirection, int shininess) {
+#if !defined(HAS_SPECULAR_MAP)
+    return 0.f;
+#elif defined(PHONG_SPECULAR)
+    vec3 reflectionDirection = reflect(-lightDirection, normal);
+    return pow(max(dot(viewDirection, reflectionDirection), 0.f), shininess);
+#else
+    vec3 halfwayDirection = normalize(viewDirection + lightDirection);
+    return pow(max(dot(normal, halfwayDirection), 0.f), shininess);
+#endif
+}
 
 /// The light source is so distant that the light rays emitted 
 /// are parallel to one another. It has no dimming/decay of light intensity.
@@ -11,30 +27,26 @@ vec4 directionalLight(
     vec3 currentPositionVec3,
     vec3 cameraPositionVec3,
     vec3 normalVec3,
-    sampler2D diffuseTexture2D,
-    sampler2D specularTexture2D,
-    vec2 textureCoordinatesVec2
+    vec3 diffuseColorVec3, // sampled from the diffuse map
+    float specularIntensity // sampled from the specular map
 ) {
     vec3 normal = normalize(normalVec3);
     vec3 lightDirection = normalize(directionToTheLightSourceVec3);
     vec3 viewDirection = normalize(cameraPositionVec3 - currentPositionVec3);
-    vec3 halfwayDirection = normalize(viewDirection + lightDirection);
-    // vec3 reflectionDirection = reflect(-lightDirection, normal);
 
-    float isVisible = when_gt(dot(normal, viewDirection), 0.0);
+    // Only the side facing the camera gets the diffuse and specular light.
+    float isVisible = float(dot(normal, viewDirection) > 0.f);
 
     float diffuseFactor = max(dot(normal, lightDirection), 0.0f) * isVisible;
 
     float specularStrength = 0.5f;
-    // float specularAmount = pow(max(dot(viewDirection, reflectionDirection), 0.f), shininess);
-    float specularAmount = pow(max(dot(normal, halfwayDirection), 0.f), shininess);
-    float specularFactor = specularAmount * specularStrength * isVisible;
+    float specularFactor = specularAmount(normal, lightDirection, viewDirection, shininess) * specularStrength * isVisible;
 
     const float ambienceFactor = 0.2f;
 
     vec3 outColor;
-    outColor += vec3(texture(diffuseTexture2D, textureCoordinatesVec2)) * (diffuseFactor + ambienceFactor);
-    outColor += vec3(texture(specularTexture2D, textureCoordinatesVec2)).r * (specularFactor);
+    outColor += diffuseColorVec3 * (diffuseFactor + ambienceFactor);
+    outColor += specularIntensity * (specularFactor);
     outColor *= vec3(lightSourceColorVec4 / lightSourceColorVec4.a);
     return vec4(outColor, 1.f);
 }
@@ -57,9 +69,8 @@ vec4 pointLight(
     vec3 currentPositionVec3,
     vec3 cameraPositionVec3,
     vec3 normalVec3,
-    sampler2D diffuseTexture2D,
-    sampler2D specularTexture2D,
-    vec2 textureCoordinatesVec2
+    vec3 diffuseColorVec3, // sampled from the diffuse map
+    float specularIntensity // sampled from the specular map
 ) {
     vec3 lightDirectionNotNormalized = lightSourcePositionVec3 - currentPositionVec3;
     float distanceFromLight = length(lightDirectionNotNormalized);
@@ -69,25 +80,22 @@ vec4 pointLight(
     vec3 normal = normalize(normalVec3);
     vec3 lightDirection = normalize(lightDirectionNotNormalized);
     vec3 viewDirection = normalize(cameraPositionVec3 - currentPositionVec3);
-    vec3 halfwayDirection = normalize(viewDirection + lightDirection);
 
 
-    float isVisible = when_gt(dot(normal, viewDirection), 0.0);
+    // Only the side facing the camera gets the diffuse and specular light.
+    float isVisible = float(dot(normal, viewDirection) > 0.f);
 
     float diffuseFactor = max(dot(normal, lightDirection), 0.0f) * isVisible;
 
     float specularStrength = 0.5f;
-    // vec3 reflectionDirection = reflect(-lightDirection, normal);
-    // float specularAmount = pow(max(dot(viewDirection, reflectionDirection), 0.f), shininess);
-    float specularAmount = pow(max(dot(normal, halfwayDirection), 0.f), shininess);
-    float specularFactor = specularAmount * specularStrength * isVisible;
+    float specularFactor = specularAmount(normal, lightDirection, viewDirection, shininess) * specularStrength * isVisible;
 
 
     const float ambienceFactor = 0.2f;
 
     vec3 outColor;
-    outColor += vec3(texture(diffuseTexture2D, textureCoordinatesVec2)) * (diffuseFactor * lightAttenuation + ambienceFactor);
-    outColor += vec3(texture(specularTexture2D, textureCoordinatesVec2)).r * (specularFactor * lightAttenuation);
+    outColor += diffuseColorVec3 * (diffuseFactor * lightAttenuation + ambienceFactor);
+    outColor += specularIntensity * (specularFactor * lightAttenuation);
     outColor *= vec3(lightSourceColorVec4 / lightSourceColorVec4.a);
     return vec4(outColor, 1.f);
 }
@@ -110,9 +118,8 @@ vec4 spotLight(
     vec3 currentPositionVec3,
     vec3 cameraPositionVec3,
     vec3 normalVec3,
-    sampler2D diffuseTexture2D,
-    sampler2D specularTexture2D,
-    vec2 textureCoordinatesVec2
+    vec3 diffuseColorVec3, // sampled from the diffuse map
+    float specularIntensity // sampled from the specular map
 ) {
     // The inner angle must be smaller than the outer angle.
     // Therefor the cosine of the inner angle must be greater
@@ -132,18 +139,15 @@ vec4 spotLight(
 
     vec3 lightDirection = normalize(lightDirectionNotNormalized);
     vec3 viewDirection = normalize(cameraPositionVec3 - currentPositionVec3);
-    vec3 halfwayDirection = normalize(viewDirection + lightDirection);
-    // vec3 reflectionDirection = reflect(-lightDirection, normal);
 
-    float isVisible = when_gt(dot(normal, viewDirection), 0.0);
+    // Only the side facing the camera gets the diffuse and specular light.
+    float isVisible = float(dot(normal, viewDirection) > 0.f);
 
     float diffuseFactor = max(dot(normal, lightDirection), 0.0f) * isVisible;
 
     float specularStrength = 0.5f;
 
-    // float specularAmount = pow(max(dot(viewDirection, reflectionDirection), 0.f), shininess);
-    float specularAmount = pow(max(dot(normal, halfwayDirection), 0.f), shininess);
-    float specularFactor = specularAmount * specularStrength * isVisible;
+    float specularFactor = specularAmount(normal, lightDirection, viewDirection, shininess) * specularStrength * isVisible;
 
     // angle between the direction of where the spotlight
     // is pointing to (lightPointAtDirection) and the
@@ -155,9 +159,70 @@ vec4 spotLight(
     const float ambienceFactor = 0.2f;
 
     vec3 outColor;
-    outColor += vec3(texture(diffuseTexture2D, textureCoordinatesVec2)) * (diffuseFactor * spotLightIntensity * lightAttenuation + ambienceFactor);
-    outColor += vec3(texture(specularTexture2D, textureCoordinatesVec2)).r * (specularFactor * spotLightIntensity * lightAttenuation);
+    outColor += diffuseColorVec3 * (diffuseFactor * spotLightIntensity * lightAttenuation + ambienceFactor);
+    outColor += specularIntensity * (specularFactor * spotLightIntensity * lightAttenuation);
     outColor *= vec3(lightSourceColorVec4 / lightSourceColorVec4.a);
     return vec4(outColor, 1.f);
 }
 
+// The same lights, with the colors sampled from the maps here.
+
+vec4 directionalLight(
+    vec3 directionToTheLightSourceVec3,
+    int shininess,
+    vec4 lightSourceColorVec4,
+    vec3 currentPositionVec3,
+    vec3 cameraPositionVec3,
+    vec3 normalVec3,
+    sampler2D diffuseTexture2D,
+    sampler2D specularTexture2D,
+    vec2 textureCoordinatesVec2
+) {
+    return directionalLight(
+        directionToTheLightSourceVec3, shininess, lightSourceColorVec4,
+        currentPositionVec3, cameraPositionVec3, normalVec3,
+        vec3(texture(diffuseTexture2D, textureCoordinatesVec2)),
+        texture(specularTexture2D, textureCoordinatesVec2).r);
+}
+
+vec4 pointLight(
+    float a, float b,
+    int shininess,
+    vec4 lightSourceColorVec4,
+    vec3 lightSourcePositionVec3,
+    vec3 currentPositionVec3,
+    vec3 cameraPositionVec3,
+    vec3 normalVec3,
+    sampler2D diffuseTexture2D,
+    sampler2D specularTexture2D,
+    vec2 textureCoordinatesVec2
+) {
+    return pointLight(
+        a, b, shininess, lightSourceColorVec4, lightSourcePositionVec3,
+        currentPositionVec3, cameraPositionVec3, normalVec3,
+        vec3(texture(diffuseTexture2D, textureCoordinatesVec2)),
+        texture(specularTexture2D, textureCoordinatesVec2).r);
+}
+
+vec4 spotLight(
+    vec3 lightSourcePointAtDirectionVec3,
+    float innerConeCosine,
+    float outerConeCosine,
+    float a, float b,
+    int shininess,
+    vec4 lightSourceColorVec4,
+    vec3 lightSourcePositionVec3,
+    vec3 currentPositionVec3,
+    vec3 cameraPositionVec3,
+    vec3 normalVec3,
+    sampler2D diffuseTexture2D,
+    sampler2D specularTexture2D,
+    vec2 textureCoordinatesVec2
+) {
+    return spotLight(
+        lightSourcePointAtDirectionVec3, innerConeCosine, outerConeCosine,
+        a, b, shininess, lightSourceColorVec4, lightSourcePositionVec3,
+        currentPositionVec3, cameraPositionVec3, normalVec3,
+        vec3(texture(diffuseTexture2D, textureCoordinatesVec2)),
+        texture(specularTexture2D, textureCoordinatesVec2).r);
+}
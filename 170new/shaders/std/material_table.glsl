@@ -0,0 +1,37 @@
+// The materials of the model being drawn, see `MaterialTable` (material.cc).
+// Include it first, before anything that isn't a preprocessor directive.
+//
+// The driver defines GL_ARB_bindless_texture when it has the extension, the CPU side
+// (`material::getBackend`) makes the same choice: bindless texture handles if it's there,
+// texture arrays otherwise.
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : require
+#define MATERIAL_BINDLESS 1
+#endif
+
+// One per material, indexed by `DrawData.materialIndex`. See `material::MaterialData`.
+struct MaterialData {
+    // Bindless: the maps' texture handles.
+    // Texture arrays: x is the index into `U_MaterialTextureArrays`, y the layer.
+    uvec2 diffuseMap;
+    uvec2 specularMap;
+};
+
+// bound by the model class in draw function
+layout(std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialData B_Materials[];
+};
+
+#ifndef MATERIAL_BINDLESS
+// bound to the texture units 0 to 15 by the model class in draw function
+layout(binding = 0) uniform sampler2DArray U_MaterialTextureArrays[16];
+#endif
+
+// The index has to be the same for the whole draw (it comes from the draw's data).
+vec4 sampleMaterialMap(uvec2 map, vec2 textureCoordinatesVec2) {
+#ifdef MATERIAL_BINDLESS
+    return texture(sampler2D(map), textureCoordinatesVec2);
+#else
+    return texture(U_MaterialTextureArrays[map.x], vec3(textureCoordinatesVec2, float(map.y)));
+#endif
+}
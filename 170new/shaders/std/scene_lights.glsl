@@ -0,0 +1,58 @@
+#include "lighting.glsl"
+
+// The lights of the scene, the same for every lit object.
+// Keywords, defined by the program's variant (see `ShaderKeywords`):
+//   NUM_POINT_LIGHTS=N - the number of point lights, 1 if it's not defined
+//   SPOT_LIGHTS - every point light also shines a spotlight (down and forward)
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 1
+#endif
+
+#if NUM_POINT_LIGHTS > 0
+uniform vec4 U_LightColorVec4[NUM_POINT_LIGHTS]; // passed manually
+uniform vec3 U_LightPositionVec3[NUM_POINT_LIGHTS]; // passed manually
+#endif
+
+/// Sum of every light of the scene. `a` and `b` are the point lights' attenuation (see `pointLight`).
+vec4 sceneLights(
+    float a, float b,
+    vec3 currentPositionVec3,
+    vec3 cameraPositionVec3,
+    vec3 normalVec3,
+    vec3 diffuseColorVec3, // sampled from the diffuse map
+    float specularIntensity // sampled from the specular map
+) {
+    vec4 outColor = vec4(0.f);
+#if NUM_POINT_LIGHTS > 0
+    // The number of lights is a constant, the compiler unrolls the loop.
+    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
+        outColor += pointLight(
+            a, b, 33,
+            U_LightColorVec4[i],
+            U_LightPositionVec3[i],
+            currentPositionVec3,
+            cameraPositionVec3,
+            normalVec3,
+            diffuseColorVec3,
+            specularIntensity
+        );
+#ifdef SPOT_LIGHTS
+        outColor += spotLight(
+            vec3(0.f, -1.f, 1.f),
+            cos(radians(30.f)),
+            cos(radians(45.f)),
+            1.0f, 0.7f,
+            33,
+            U_LightColorVec4[i],
+            U_LightPositionVec3[i],
+            currentPositionVec3,
+            cameraPositionVec3,
+            normalVec3,
+            diffuseColorVec3,
+            specularIntensity
+        );
+#endif
+    }
+#endif
+    return outColor;
+}
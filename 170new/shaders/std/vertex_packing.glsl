@@ -0,0 +1,47 @@
+// Decoding of the `PackedVertex` attributes (see src/vertex_buffer.packed_vertex.cc).
+
+// +1 or -1, never 0.
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Snorm16 position relative to the mesh's bounds back to model space.
+vec3 decodePosition(vec4 packedPosition, vec3 boundsCenter, vec3 boundsExtent) {
+    return boundsCenter + packedPosition.xyz * boundsExtent;
+}
+
+vec3 decodeOctahedralNormal(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(encoded.yx)) * signNotZero(encoded);
+    }
+    return normalize(normal);
+}
+
+// Smallest three quaternion, xyz are the three smallest components mapped to [0, 1],
+// w is the index of the dropped (largest, positive) component divided by 3.
+vec4 decodeTangentFrameQuaternion(vec4 packedFrame) {
+    vec3 smallest = (packedFrame.xyz * 2.0 - 1.0) * 0.70710678;
+    float largest = sqrt(max(1.0 - dot(smallest, smallest), 0.0));
+    int largestIndex = int(packedFrame.w * 3.0 + 0.5);
+
+    if (largestIndex == 0) return vec4(largest, smallest);
+    if (largestIndex == 1) return vec4(smallest.x, largest, smallest.yz);
+    if (largestIndex == 2) return vec4(smallest.xy, largest, smallest.z);
+    return vec4(smallest, largest);
+}
+
+// Rotates (1, 0, 0) by the quaternion and re-orthogonalizes it against the normal.
+vec3 decodeTangent(vec4 packedFrame, vec3 normal) {
+    vec4 q = decodeTangentFrameQuaternion(packedFrame);
+    vec3 tangent = vec3(
+        1.0 - 2.0 * (q.y * q.y + q.z * q.z),
+        2.0 * (q.x * q.y + q.w * q.z),
+        2.0 * (q.x * q.z - q.w * q.y));
+    return normalize(tangent - normal * dot(normal, tangent));
+}
+
+// The bitangent's handedness is stored in the position's w.
+vec3 decodeBitangent(vec4 packedPosition, vec3 normal, vec3 tangent) {
+    return cross(normal, tangent) * (packedPosition.w < 0.0 ? -1.0 : 1.0);
+}
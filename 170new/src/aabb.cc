@@ -0,0 +1,69 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+
+export module aabb;
+
+/// Axis aligned bounding box. A default constructed box is empty
+/// (min is +infinity, max is -infinity), expanding it by anything makes it valid.
+export struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+    [[nodiscard]] auto isEmpty() const -> bool {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    auto expand(const glm::vec3& point) -> AABB& {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+        return *this;
+    }
+
+    auto expand(const AABB& other) -> AABB& {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+        return *this;
+    }
+
+    [[nodiscard]] auto getCenter() const -> glm::vec3 {
+        return (min + max) * 0.5f;
+    }
+
+    /// Half of the box's size along each axis.
+    [[nodiscard]] auto getExtent() const -> glm::vec3 {
+        return (max - min) * 0.5f;
+    }
+
+    /// Squared distance from the `point` to the closest point of the box, 0 inside it.
+    [[nodiscard]] auto getDistanceSquared(const glm::vec3& point) const -> float {
+        const glm::vec3 offset = point - glm::clamp(point, min, max);
+        return glm::dot(offset, offset);
+    }
+
+    /// Area of the box's six faces, what the surface area heuristic weighs nodes by.
+    [[nodiscard]] auto getSurfaceArea() const -> float {
+        const glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    /// Bounds of this box after the `transformation`, they are only
+    /// as tight as the transformed box allows (not as the original geometry).
+    [[nodiscard]] auto transformed(const glm::mat4& transformation) const -> AABB {
+        if (isEmpty()) {
+            return *this;
+        }
+        // Arvo's method, the transformed extent is the extent projected onto the absolute axes.
+        const glm::vec3 center = glm::vec3(transformation * glm::vec4(getCenter(), 1.0f));
+        const glm::mat3 absolute = glm::mat3(
+            glm::abs(glm::vec3(transformation[0])),
+            glm::abs(glm::vec3(transformation[1])),
+            glm::abs(glm::vec3(transformation[2])));
+        const glm::vec3 extent = absolute * getExtent();
+        return AABB { center - extent, center + extent };
+    }
+};
@@ -15,10 +15,12 @@ module;
 export module application;
 
 import shader_program;
+import shader_program.variants;
 import vertex_array;
 import index_buffer;
 import vertex_buffer;
 import texture;
+import texture.registry;
 import camera;
 import timer;
 import mouse;
@@ -27,6 +29,13 @@ import model;
 import transformation;
 import skybox;
 import frame_buffer;
+import asset_streamer;
+import aabb;
+import bvh;
+import gl_state;
+import render_queue;
+
+using namespace uniform::literals;
 
 auto lightVertices = std::vector<Vertex> {
     Vertex{ {-0.1f, -0.1f,  0.1f} },
@@ -66,6 +75,43 @@ auto floorIndices = std::vector<GLuint> {
 	0, 2, 3,
 };
 
+auto transparentVertices = std::vector<Vertex> {
+    Vertex{ {-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f} },
+	Vertex{ { 0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f} },
+	Vertex{ { 0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f} },
+	Vertex{ {-0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f} },
+};
+
+auto transparentIndices = std::vector<GLuint> {
+    0, 1, 2,
+	0, 2, 3,
+};
+
+auto transparentPositions = std::vector<glm::vec3> {
+    glm::vec3(-1.5f, 0.5f, -0.48f),
+    glm::vec3( 1.5f, 0.5f,  0.51f),
+    glm::vec3( 0.0f, 0.5f,  0.7f),
+    glm::vec3(-0.3f, 0.5f, -2.3f),
+    glm::vec3( 0.5f, 0.5f, -0.6f),
+};
+
+/// What the items of the scene's render queue stand for.
+enum class SceneDraw : std::uint32_t {
+    Light,
+    Floor,
+    Skybox,
+    TransparentWindows,
+};
+
+/// Box around the vertices' positions.
+auto computeBounds(const std::vector<Vertex>& vertices) -> AABB {
+    AABB bounds;
+    for (const auto& vertex : vertices) {
+        bounds.expand(vertex.position);
+    }
+    return bounds;
+}
+
 export class Application
 {
 private:
@@ -140,14 +186,13 @@ private:
             throw std::runtime_error("Failed to initialize GLEW");
         }
 
-        // Enable alpha blending (also how will the blending be done).
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        // Enable depth testing / z-buffer is big as the color buffer.
-        glEnable(GL_DEPTH_TEST);
-        // If the fragment's depth value is less than the stored depth value the fragment's color passes.
-        // By default, this is set to GL_LESS.
-        glDepthFunc(GL_LESS);
+        // The shader programs are compiled by the driver's threads, see `ShaderProgram::isReady`.
+        std::println("Parallel shader compile: {}", ShaderProgram::enableParallelCompile() ? "on" : "off");
+
+        // Enable alpha blending (also how will the blending be done) and depth testing,
+        // the z-buffer is big as the color buffer. If the fragment's depth value is less
+        // than the stored depth value the fragment's color passes.
+        GLState::getInstance().apply(pipeline_state::standard);
 
         // glEnable(GL_CULL_FACE);
         // glCullFace(GL_BACK); // Cull back faces (default)
@@ -169,17 +214,49 @@ private:
         // Create mouse singleton instance.
         Mouse::createInstance(this->window, 0.6f);
 
-        ShaderProgram modelShader("./shaders/model_with_light.glsl");
+        // Every shader file is read (in this order, which fixes the files' IDs) and expanded at once on the thread pool, the programs below
+        // take their sources from the library. The files they share (std/*.glsl) are read only once.
+        const std::vector<std::string> shaderPaths = {
+            "./shaders/model_with_light.glsl",
+            "./shaders/light_cube.glsl",
+            "./shaders/floor.glsl",
+            "./shaders/screen.glsl",
+            "./shaders/blending.glsl",
+            "./shaders/single_color.glsl",
+        };
+        const auto preprocessStart = std::chrono::steady_clock::now();
+        ShaderSourceLibrary::getInstance().preprocessBatch(shaderPaths);
+        std::println("Shader sources: {} programs preprocessed from {} files in {:.1f} ms", shaderPaths.size(),
+            ShaderSourceLibrary::getInstance().getFileCount(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - preprocessStart).count());
+
+        // Every program is only submitted here, the driver compiles them all at once (see `ShaderProgram::isReady`)
+        // and the frames are drawn with the ones already done.
+        const auto programSubmitStart = std::chrono::steady_clock::now();
+        // The lit shaders have a variant for every combination of keywords (see `ShaderKeywords`),
+        // each one is compiled when it's first used.
+        ShaderVariants modelShaders("./shaders/model_with_light.glsl");
         ShaderProgram lightShader("./shaders/light_cube.glsl");
-        ShaderProgram floorShader("./shaders/floor.glsl");
+        ShaderVariants floorShaders("./shaders/floor.glsl");
         ShaderProgram screenShader("./shaders/screen.glsl");
+        ShaderVariants blendingShaders("./shaders/blending.glsl");
+        ShaderProgram outlineShader("./shaders/single_color.glsl");
+
+        // One point light with a spotlight, lighting the model and the floor.
+        const ShaderKeywords sceneLightKeywords = ShaderKeywords().define("NUM_POINT_LIGHTS", 1).define("SPOT_LIGHTS");
+        ShaderProgram& floorShader = floorShaders.get(ShaderKeywords(sceneLightKeywords).define("HAS_SPECULAR_MAP"));
+        // The windows' fully transparent texels are discarded, not blended. All of them are one instanced draw.
+        ShaderProgram& blendingShader = blendingShaders.get(ShaderKeywords().define("ALPHA_TEST").define("INSTANCED"));
+
+        // Loads the models in the background, the main loop doesn't wait for them.
+        AssetStreamer streamer(this->window);
 
         // Create a model from file.
         // auto model = Model("./models/grindstone/scene.gltf");
         // Model model("./models/lingerie_girl/scene.gltf");
         // Model model("./models/the_girl_on_the_floor/scene.gltf");
         // Model model("./models/the_girl_on_the_floor_v2/scene.gltf");
-        Model model("./models/goddess_white_voluptuous/scene.gltf");
+        Model model = Model::loadAsync("./models/goddess_white_voluptuous/scene.gltf", streamer);
         // Model model = Model("./models/girl_in_lingerie/scene.gltf");
         // Model model("./models/alleyana/scene.gltf");
         // auto model = Model("./models/scimitar/scene.gltf"); // doesn't work
@@ -193,31 +270,58 @@ private:
         const auto lightColor = glm::f32vec4(1.0, 1.0, 1.0, 1.0);
    
         // Skybox mesh.
-        Skybox skybox("./textures/skybox"); 
+        Skybox skybox("./textures/skybox");
 
 
         Mesh floorMesh(floorVertices, floorIndices, {
-            Texture("./textures/planks.png", texture::Type::DiffuseMap),
-            Texture("./textures/planksSpec.png", texture::Type::SpecularMap),
+            TextureRegistry::getInstance().acquire("./textures/planks.png", texture::Type::DiffuseMap),
+            TextureRegistry::getInstance().acquire("./textures/planksSpec.png", texture::Type::SpecularMap),
         });
 
+        Mesh transparentWindowMesh(transparentVertices, transparentIndices, {
+            TextureRegistry::getInstance().acquire("./textures/blending_transparent_window.png", texture::Type::DiffuseMap),
+        });
+        // Rebuilt every frame, kept around so its memory is reused.
+        std::vector<glm::mat4> transparentWindowTransforms;
+
+        const Transformation lightTransform( lightPosition, {0, 1, 0}, 0, {0.2, 0.2, 0.2} );
+        const Transformation floorTransform( {0, 0, 0}, {0, 1, 0}, 0, {1, 1, 1} );
+
+        // Every object of the scene by its world space box, for the culling and the picking.
+        BoundingVolumeHierarchy scene;
+        std::unordered_map<BoundingVolumeHierarchy::Handle, std::string> sceneObjectNames;
+        // Empty until the model is streamed in, then moved every frame as it rotates.
+        const auto modelHandle = scene.insert(AABB{});
+        sceneObjectNames[modelHandle] = "model";
+        const auto lightHandle = scene.insert(computeBounds(lightVertices).transformed(lightTransform.getModelMat()));
+        sceneObjectNames[lightHandle] = "light";
+        const auto floorHandle = scene.insert(computeBounds(floorVertices).transformed(floorTransform.getModelMat()));
+        sceneObjectNames[floorHandle] = "floor";
+        // Every window's position with its handle.
+        std::vector<std::pair<glm::vec3, BoundingVolumeHierarchy::Handle>> transparentWindows;
+        for (const auto& position : transparentPositions) {
+            const auto handle = scene.insert(computeBounds(transparentVertices).transformed(glm::translate(glm::mat4(1.0f), position)));
+            sceneObjectNames[handle] = std::format("window at ({}, {}, {})", position.x, position.y, position.z);
+            transparentWindows.emplace_back(position, handle);
+        }
+        std::vector<BoundingVolumeHierarchy::Handle> visibleObjects;
+        std::optional<BoundingVolumeHierarchy::Handle> pickedObject;
+        const auto isVisible = [&visibleObjects](const BoundingVolumeHierarchy::Handle handle) {
+            return std::ranges::find(visibleObjects, handle) != visibleObjects.end();
+        };
 
-        lightShader.bind();
-        lightShader.setUniform4f("U_LightColorVec4", lightColor);
-
-        modelShader.bind();
-        modelShader.setUniform4f("U_LightColorVec4", lightColor);
-        modelShader.setUniform3f("U_LightPositionVec3", lightPosition);
-        
-    	floorShader.bind();
-    	floorShader.setUniform4f("U_LightColorVec4", lightColor);
-    	floorShader.setUniform3f("U_LightPositionVec3", lightPosition);
+        // The draws into the window, sorted by their passes, states and depths. Refilled every frame.
+        RenderQueue sceneQueue;
+        // The visible windows' indices, sorted from the farthest to the nearest.
+        RenderQueue transparentWindowQueue;
 
 
         FrameBuffer FBO(displayDimensions);
 
 
         float rotationInDegrees = 0.f;
+        // Printed once, when the first programs are all done.
+        bool areProgramsReported = false;
 
         while (!glfwWindowShouldClose(this->window)) {
             this->onNextFrame(); // Poll events, handle resizing of the window
@@ -227,19 +331,52 @@ private:
             camera.onNextFrame(this->window, Timer::getInstance().getDeltaTime()); 
             // Resets the mouse after all of its user are done using it. TODO: Observer pattern.
             Mouse::getInstance().resetLastCursorPosition();
-            // clear the main buffers
+            // clear the main buffers, the depth and stencil ones only clear with their writing enabled
+            GLState::getInstance().apply(pipeline_state::standard);
             FrameBuffer::bindToDefault();
             FrameBuffer::clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, 
                                {0.9f, 0.3f, 0.3f, 1.0f});
             
             rotationInDegrees += Timer::getInstance().f32getDeltaTime() * 30.f;
 
+            // The draws whose programs are still being compiled are skipped.
+            const bool isLightShaderReady = lightShader.isReady();
+            const bool isFloorShaderReady = floorShader.isReady();
+            const bool isBlendingShaderReady = blendingShader.isReady();
+            const bool isOutlineShaderReady = outlineShader.isReady();
+            const bool isScreenShaderReady = screenShader.isReady();
+            const bool isSkyboxReady = skybox.isReady();
+            if (!areProgramsReported && ShaderProgram::getPendingCount() == 0) {
+                // The first launch (cold) compiles the programs, the ones after it (warm) load them from the binary cache.
+                const program_binary::Stats& programStats = ShaderProgram::getBinaryCacheStats();
+                std::println("Shader programs: {} loaded from the binary cache in {:.1f} ms, {} compiled with {:.1f} ms of the main thread"
+                    " ({} binaries rejected), all ready {:.1f} ms after they were submitted",
+                    programStats.hits, std::chrono::duration<double, std::milli>(programStats.loadTime).count(),
+                    programStats.compiles, std::chrono::duration<double, std::milli>(programStats.compileTime).count(),
+                    programStats.rejected,
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - programSubmitStart).count());
+                areProgramsReported = true;
+            }
+
             // Update objects in the scene
             this->onUpdate();
 
             const Transformation modelTransform( {0, 0.2, 0}, {0, 1, 0}, rotationInDegrees, glm::vec3(1.0) );
-            const Transformation lightTransform( lightPosition, {0, 1, 0}, 0, {0.2, 0.2, 0.2} );
-            const Transformation floorTransform( {0, 0, 0}, {0, 1, 0}, 0, {1, 1, 1} );
+            const Transformation modelOutlineTransform( {0, 0.2, 0}, {0, 1, 0}, rotationInDegrees, glm::vec3(1.03) );
+
+            scene.move(modelHandle, model.getBounds().transformed(modelTransform.getModelMat()));
+            scene.update();
+            scene.queryFrustum(camera.getFrustumPlanes(), visibleObjects);
+
+            // The object under the cursor, while it's free to move (not looking around).
+            if (!Mouse::getInstance().inMode(mouse::mode::is_sensing_movement)) {
+                const auto hit = scene.raycast(camera.getCursorRay(glm::vec2(Mouse::getInstance().getCursorPosition())));
+                const auto hitObject = hit.has_value() ? std::optional(hit->object) : std::nullopt;
+                if (hitObject != pickedObject && hitObject.has_value()) {
+                    std::println("Under the cursor: {} ({:.2f} units away)", sceneObjectNames[hit->object], hit->distance);
+                }
+                pickedObject = hitObject;
+            }
 
             // Draw to this frame-buffer's color buffer. Filling in the texture
             // with the rendered scene.
@@ -249,23 +386,102 @@ private:
             FrameBuffer::clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
                                {0.0, 1.0, 0.0, 1.0});
             // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glEnable(GL_DEPTH_TEST);
             
 
             // Polygon drawing mode
             // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-            model.draw(modelShader, camera, modelTransform);
+            // The model gets an outline while it's under the cursor. It marks its pixels in the stencil
+            // buffer, then a scaled up copy of it is drawn everywhere around them.
+            const bool isModelOutlined = pickedObject == modelHandle;
+            GLState::getInstance().apply(isModelOutlined ? pipeline_state::stencilOutlined : pipeline_state::standard);
+            if (model.isReady()) {
+                // The model's variant depends on its materials, known once it's loaded.
+                ShaderProgram& modelShader = modelShaders.get(model.hasSpecularMaps()
+                    ? ShaderKeywords(sceneLightKeywords).define("HAS_SPECULAR_MAP")
+                    : sceneLightKeywords);
+                if (modelShader.isReady()) {
+                    modelShader.bind();
+                    // Set every frame, the uploads are skipped while the values are the same.
+                    modelShader.setUniform4f("U_LightColorVec4"_uniform, lightColor);
+                    modelShader.setUniform3f("U_LightPositionVec3"_uniform, lightPosition);
+                    model.draw(modelShader, camera, modelTransform);
+                }
+                if (isModelOutlined && isOutlineShaderReady) {
+                    GLState::getInstance().apply(pipeline_state::stencilOutline);
+                    model.draw(outlineShader, camera, modelOutlineTransform);
+                    GLState::getInstance().apply(pipeline_state::standard);
+                }
+            }
 
             FrameBuffer::bindToDefault();
 
-            lightMesh.draw(lightShader, camera, lightTransform);
-            floorMesh.draw(floorShader, camera, floorTransform);
+            // Transparent objects go last and from the farthest to the nearest,
+            // so the ones behind are already in the color buffer when blending.
+            // Only the ones the scene BVH found in the view.
+            transparentWindowQueue.clear();
+            for (std::uint32_t i = 0; i < transparentWindows.size(); i++) {
+                const auto& [position, handle] = transparentWindows[i];
+                if (isVisible(handle)) {
+                    transparentWindowQueue.submit(render_queue::makeTranslucentKey(
+                        render_queue::Pass::Translucent, 0, 0, camera.getNormalizedDepth(position)), i);
+                }
+            }
+            transparentWindowQueue.sort();
+            transparentWindowTransforms.clear();
+            for (const auto& entry : transparentWindowQueue.getEntries()) {
+                transparentWindowTransforms.push_back(glm::translate(glm::mat4(1.0f), transparentWindows[entry.item].first));
+            }
+
+            // The opaque draws grouped by their shaders and textures and from the nearest to the
+            // farthest (early-Z), then the skybox behind them, then the windows over everything.
+            sceneQueue.clear();
+            if (isVisible(lightHandle) && isLightShaderReady) {
+                sceneQueue.submit(render_queue::makeOpaqueKey(render_queue::Pass::Opaque, lightShader.getID(),
+                    lightMesh.getMaterialID(), camera.getNormalizedDepth(lightPosition)), std::to_underlying(SceneDraw::Light));
+            }
+            if (isVisible(floorHandle) && isFloorShaderReady) {
+                sceneQueue.submit(render_queue::makeOpaqueKey(render_queue::Pass::Opaque, floorShader.getID(),
+                    floorMesh.getMaterialID(), camera.getNormalizedDepth(scene.getBounds(floorHandle).getCenter())),
+                    std::to_underlying(SceneDraw::Floor));
+            }
+            if (isSkyboxReady) {
+                sceneQueue.submit(render_queue::makeOpaqueKey(render_queue::Pass::Skybox, 0, 0, 1.0f),
+                    std::to_underlying(SceneDraw::Skybox));
+            }
+            if (!transparentWindowTransforms.empty() && isBlendingShaderReady) {
+                sceneQueue.submit(render_queue::makeTranslucentKey(render_queue::Pass::Translucent, blendingShader.getID(),
+                    transparentWindowMesh.getMaterialID(), 1.0f), std::to_underlying(SceneDraw::TransparentWindows));
+            }
+            sceneQueue.sort();
+
+            for (const auto& entry : sceneQueue.getEntries()) {
+                switch (static_cast<SceneDraw>(entry.item)) {
+                    case SceneDraw::Light: {
+                        // Set every frame, the uploads are skipped while the values are the same.
+                        lightShader.bind();
+                        lightShader.setUniform4f("U_LightColorVec4"_uniform, lightColor);
+                        lightMesh.draw(lightShader, lightTransform);
+                    } break;
+                    case SceneDraw::Floor: {
+                        floorShader.bind();
+                        floorShader.setUniform4f("U_LightColorVec4"_uniform, lightColor);
+                        floorShader.setUniform3f("U_LightPositionVec3"_uniform, lightPosition);
+                        floorMesh.draw(floorShader, floorTransform);
+                    } break;
+                    case SceneDraw::Skybox: {
+                        skybox.draw(camera, true);
+                        GLState::getInstance().apply(pipeline_state::standard);
+                    } break;
+                    case SceneDraw::TransparentWindows: {
+                        // All the windows in one draw call, instanced in the sorted order.
+                        transparentWindowMesh.drawInstanced(blendingShader, transparentWindowTransforms);
+                    } break;
+                }
+            }
 
             // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-            skybox.draw(camera, true);
-
 
             // Go back to the default framebuffer and draw the color buffer
             // of the previous framebuffer. Disable the depth testing so
@@ -277,7 +493,9 @@ private:
             // glClear(GL_COLOR_BUFFER_BIT);
             // glDisable(GL_DEPTH_TEST);
             
-            FBO.draw(screenShader, Transformation({-0.5, 0, 0}, {0, 1, 0}, 0, glm::vec3(0.2)));
+            if (isScreenShaderReady) {
+                FBO.draw(screenShader, Transformation({-0.5, 0, 0}, {0, 1, 0}, 0, glm::vec3(0.2)));
+            }
 
             // Bind the texture to be drawn out.
             // glActiveTexture(GL_TEXTURE0 + 0);
@@ -292,6 +510,13 @@ private:
             // quadVAO.bind();
             // glDrawElements(GL_TRIANGLES, static_cast<int>(quadIndices.size()), GL_UNSIGNED_INT, nullptr);
             
+            const gl_state::Stats& glStats = GLState::getInstance().getStats();
+            std::println("GL state: {} calls made, {} redundant ones skipped", glStats.issuedCalls, glStats.skippedCalls);
+            GLState::getInstance().resetStats();
+            const uniform::Stats& uniformStats = ShaderProgram::getUniformStats();
+            std::println("Uniforms: {} uploads made, {} redundant ones skipped", uniformStats.uploads, uniformStats.skippedUploads);
+            ShaderProgram::resetUniformStats();
+
             std::cout << "-----------------------------------------------------\n";
             
             // Render the objects to the window
@@ -0,0 +1,100 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+export module asset_streamer;
+
+import thread_pool;
+
+/// Loads assets in the background so the main loop never waits on them.
+///
+/// It runs two threads:
+///  - the loader thread runs CPU jobs (file I/O, parsing, cooking); no OpenGL there,
+///  - the upload thread runs GPU jobs on a hidden window's context that shares
+///    its objects (buffers, textures, sync objects) with the main window's context.
+///
+/// Container objects (VAOs, FBOs) are NOT shared between contexts,
+/// so those still have to be created on the main thread once the upload is done.
+/// GPU jobs should end with a fence (glFenceSync + glFlush) that the main thread
+/// polls with zero timeout before touching the uploaded objects.
+export class AssetStreamer {
+private:
+    GLFWwindow* uploadWindow = nullptr;
+    // An empty job tells the thread to stop.
+    CompletionQueue<std::function<void()>> cpuJobs;
+    CompletionQueue<std::function<void()>> gpuJobs;
+    std::thread loaderThread;
+    std::thread uploadThread;
+public:
+    /// Must be called on the main thread (GLFW creates windows only there)
+    /// after the `mainWindow` and its context were created and GLEW initialized.
+    explicit AssetStreamer(GLFWwindow* mainWindow) {
+        // The shared context has to be created with the same version and profile.
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glfwGetWindowAttrib(mainWindow, GLFW_CONTEXT_VERSION_MAJOR));
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glfwGetWindowAttrib(mainWindow, GLFW_CONTEXT_VERSION_MINOR));
+        glfwWindowHint(GLFW_OPENGL_PROFILE, glfwGetWindowAttrib(mainWindow, GLFW_OPENGL_PROFILE));
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, glfwGetWindowAttrib(mainWindow, GLFW_OPENGL_FORWARD_COMPAT));
+        // The window is never shown, it is there just to own the context.
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        uploadWindow = glfwCreateWindow(1, 1, "asset upload context", nullptr, mainWindow);
+        glfwDefaultWindowHints();
+
+        if (uploadWindow == nullptr) {
+            throw std::runtime_error("Failed to create the shared upload context");
+        }
+
+        loaderThread = std::thread([this] { runJobs(cpuJobs); });
+        uploadThread = std::thread([this] {
+            glfwMakeContextCurrent(uploadWindow);
+            runJobs(gpuJobs);
+            // Make sure everything was submitted before the context goes away.
+            glFinish();
+            glfwMakeContextCurrent(nullptr);
+        });
+    }
+
+    AssetStreamer(const AssetStreamer& other) = delete;
+    AssetStreamer& operator=(const AssetStreamer& other) = delete;
+
+    /// Finishes the queued jobs, joins the threads and destroys the upload context.
+    /// Must be called on the main thread before GLFW is terminated.
+    ~AssetStreamer() {
+        // The loader is stopped first because its jobs queue up GPU jobs.
+        cpuJobs.push({});
+        loaderThread.join();
+        gpuJobs.push({});
+        uploadThread.join();
+        glfwDestroyWindow(uploadWindow);
+    }
+
+    /// Queues a job on the loader thread. The job must not call OpenGL.
+    /// Jobs must catch their own exceptions, an escaping one would terminate the program.
+    auto submitCpuJob(std::function<void()> job) -> void {
+        assert(job && "Empty job would stop the loader thread.");
+        cpuJobs.push(std::move(job));
+    }
+
+    /// Queues a job on the upload thread, where the shared context is current.
+    auto submitGpuJob(std::function<void()> job) -> void {
+        assert(job && "Empty job would stop the upload thread.");
+        gpuJobs.push(std::move(job));
+    }
+
+private:
+    static auto runJobs(CompletionQueue<std::function<void()>>& jobs) -> void {
+        while (true) {
+            const std::function<void()> job = jobs.pop();
+            if (!job) {
+                return;
+            }
+            job();
+        }
+    }
+};
@@ -0,0 +1,55 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+
+export module bounding_sphere;
+
+/// Sphere around some geometry. Cheaper to test against planes than a box
+/// (one dot product per plane) but usually looser. A negative radius means empty.
+export struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = -1.0f;
+
+    [[nodiscard]] auto isEmpty() const -> bool {
+        return radius < 0.0f;
+    }
+
+    /// Smallest sphere centered at `center` that holds every one of the `points`.
+    /// With the center of the points' bounding box it's at most √3 times the optimal radius,
+    /// usually much closer, and needs only one pass.
+    template<std::ranges::input_range Points>
+    [[nodiscard]] static auto enclosing(const glm::vec3& center, Points&& points) -> BoundingSphere {
+        float radiusSquared = -1.0f;
+        for (const glm::vec3& point : points) {
+            const glm::vec3 offset = point - center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        return BoundingSphere { center, radiusSquared < 0.0f ? -1.0f : std::sqrt(radiusSquared) };
+    }
+
+    /// Grows the sphere (keeping its center if it has one) so it holds the `other` sphere too.
+    auto expand(const BoundingSphere& other) -> BoundingSphere& {
+        if (other.isEmpty()) {
+            return *this;
+        }
+        if (isEmpty()) {
+            return *this = other;
+        }
+        radius = std::max(radius, glm::length(other.center - center) + other.radius);
+        return *this;
+    }
+
+    /// Sphere around this one after the `transformation`. Non-uniform scales
+    /// make it as large as the largest scale of the three axes.
+    [[nodiscard]] auto transformed(const glm::mat4& transformation) const -> BoundingSphere {
+        const float scale = std::sqrt(std::max({
+            glm::dot(glm::vec3(transformation[0]), glm::vec3(transformation[0])),
+            glm::dot(glm::vec3(transformation[1]), glm::vec3(transformation[1])),
+            glm::dot(glm::vec3(transformation[2]), glm::vec3(transformation[2])) }));
+        return BoundingSphere { glm::vec3(transformation * glm::vec4(center, 1.0f)), radius * scale };
+    }
+};
@@ -0,0 +1,582 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+export module bvh;
+
+import aabb;
+import ray;
+import vertex_buffer.vertex_struct;
+
+export namespace bvh::defaults {
+    /// Buckets per axis the centroids are sorted into when looking for the cheapest split.
+    constexpr std::size_t binCount = 16;
+    /// Most scene objects a leaf holds.
+    constexpr std::uint32_t maxObjectsPerLeaf = 4;
+    /// Most triangles a leaf of a triangle BVH holds.
+    constexpr std::uint32_t maxTrianglesPerLeaf = 8;
+    /// A tree that is only refitted degrades as its objects move apart. Once its
+    /// SAH cost grows by this factor since the last build, it's rebuilt.
+    constexpr float rebuildCostRatio = 1.5f;
+}
+
+namespace bvh::detail {
+    /// Node of a tree laid out in one array. The children of an inner node are next to each other.
+    /// Every node's subtree covers a contiguous range of the primitive order, the leaves' ranges are their primitives.
+    struct Node {
+        AABB bounds;
+        std::uint32_t leftChild = 0; // 0 for a leaf, the root is never a child.
+        std::uint32_t firstPrimitive = 0;
+        std::uint32_t primitiveCount = 0;
+
+        [[nodiscard]] auto isLeaf() const -> bool {
+            return leftChild == 0;
+        }
+    };
+
+    /// Deeper nodes are made leaves no matter how many primitives they have,
+    /// so the queries' fixed size stacks (one entry per level and one more) never overflow.
+    constexpr std::uint32_t maxDepth = 60;
+    constexpr std::size_t maxStackSize = maxDepth + 4;
+
+    struct Bin {
+        AABB bounds;
+        std::uint32_t count = 0;
+    };
+
+    /// Bin of the centroid along an axis. NaN (a centroid of an empty box) goes into the first one.
+    auto getBin(const float centroid, const float minimum, const float scale) -> std::size_t {
+        const float position = (centroid - minimum) * scale;
+        return position > 0.0f ? std::min(defaults::binCount - 1, static_cast<std::size_t>(position)) : 0;
+    }
+
+    /// Builds the tree over the primitives' boxes with the binned surface area heuristic
+    /// (the expected cost of a ray walking a node is proportional to its surface area).
+    /// `order` gets the primitives' indices in leaf order.
+    auto build(
+        const std::span<const AABB> boxes,
+        const std::uint32_t maxLeafSize,
+        std::vector<Node>& nodes,
+        std::vector<std::uint32_t>& order
+    ) -> void {
+        nodes.clear();
+        order.resize(boxes.size());
+        std::iota(order.begin(), order.end(), 0u);
+        if (boxes.empty()) {
+            return;
+        }
+
+        std::vector<glm::vec3> centroids(boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            centroids[i] = boxes[i].getCenter();
+        }
+
+        nodes.reserve(2 * boxes.size());
+        nodes.push_back(Node { .firstPrimitive = 0, .primitiveCount = static_cast<std::uint32_t>(boxes.size()) });
+        // Nodes with their depth.
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack = { { 0, 0 } };
+
+        while (!stack.empty()) {
+            const auto [nodeIndex, depth] = stack.back();
+            stack.pop_back();
+            const std::uint32_t first = nodes[nodeIndex].firstPrimitive;
+            const std::uint32_t count = nodes[nodeIndex].primitiveCount;
+            const auto range = std::span(order).subspan(first, count);
+
+            AABB bounds;
+            AABB centroidBounds;
+            for (const std::uint32_t primitive : range) {
+                bounds.expand(boxes[primitive]);
+                centroidBounds.expand(centroids[primitive]);
+            }
+            nodes[nodeIndex].bounds = bounds;
+            if (count == 1 || depth >= maxDepth) {
+                continue;
+            }
+
+            // The cheapest split between two bins, over all three axes.
+            float bestCost = std::numeric_limits<float>::infinity();
+            int bestAxis = -1;
+            std::size_t bestSplit = 0; // The last bin on the left.
+            for (int axis = 0; axis < 3; axis++) {
+                const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+                if (!(extent > 0.0f)) {
+                    continue;
+                }
+                const float scale = static_cast<float>(defaults::binCount) / extent;
+
+                std::array<Bin, defaults::binCount> bins{};
+                for (const std::uint32_t primitive : range) {
+                    Bin& bin = bins[getBin(centroids[primitive][axis], centroidBounds.min[axis], scale)];
+                    bin.bounds.expand(boxes[primitive]);
+                    bin.count++;
+                }
+
+                // Sweeps from the right first, then evaluates every split sweeping from the left.
+                std::array<float, defaults::binCount - 1> rightCosts{};
+                std::array<std::uint32_t, defaults::binCount - 1> rightCounts{};
+                AABB right;
+                std::uint32_t rightCount = 0;
+                for (std::size_t split = defaults::binCount - 1; split > 0; split--) {
+                    right.expand(bins[split].bounds);
+                    rightCount += bins[split].count;
+                    rightCounts[split - 1] = rightCount;
+                    rightCosts[split - 1] = rightCount > 0 ? right.getSurfaceArea() * static_cast<float>(rightCount) : 0.0f;
+                }
+                AABB left;
+                std::uint32_t leftCount = 0;
+                for (std::size_t split = 0; split < defaults::binCount - 1; split++) {
+                    left.expand(bins[split].bounds);
+                    leftCount += bins[split].count;
+                    if (leftCount == 0 || rightCounts[split] == 0) {
+                        continue;
+                    }
+                    const float cost = left.getSurfaceArea() * static_cast<float>(leftCount) + rightCosts[split];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = split;
+                    }
+                }
+            }
+
+            std::uint32_t middle = 0;
+            if (bestAxis < 0) {
+                // Every centroid is at the same spot, no plane separates them.
+                if (count <= maxLeafSize) {
+                    continue;
+                }
+                middle = first + count / 2;
+            } else {
+                // Relative to intersecting one primitive, walking a node costs about as much.
+                const float area = bounds.getSurfaceArea();
+                const float splitCost = 1.0f + bestCost / area;
+                if (count <= maxLeafSize && static_cast<float>(count) <= splitCost) {
+                    continue;
+                }
+                const float extent = centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis];
+                const float scale = static_cast<float>(defaults::binCount) / extent;
+                const auto rightHalf = std::partition(range.begin(), range.end(), [&](const std::uint32_t primitive) {
+                    return getBin(centroids[primitive][bestAxis], centroidBounds.min[bestAxis], scale) <= bestSplit;
+                });
+                middle = first + static_cast<std::uint32_t>(rightHalf - range.begin());
+            }
+
+            const auto leftChild = static_cast<std::uint32_t>(nodes.size());
+            nodes[nodeIndex].leftChild = leftChild;
+            nodes.push_back(Node { .firstPrimitive = first, .primitiveCount = middle - first });
+            nodes.push_back(Node { .firstPrimitive = middle, .primitiveCount = first + count - middle });
+            stack.emplace_back(leftChild, depth + 1);
+            stack.emplace_back(leftChild + 1, depth + 1);
+        }
+    }
+
+    /// SAH cost of the tree relative to its root: the expected number of nodes
+    /// walked and primitives tested by a random ray that hits the root.
+    auto computeCost(const std::span<const Node> nodes) -> float {
+        if (nodes.empty()) {
+            return 0.0f;
+        }
+        float cost = 0.0f;
+        for (const Node& node : nodes) {
+            const float area = node.bounds.isEmpty() ? 0.0f : node.bounds.getSurfaceArea();
+            cost += node.isLeaf() ? area * static_cast<float>(node.primitiveCount) : area;
+        }
+        const float rootArea = nodes.front().bounds.getSurfaceArea();
+        return rootArea > 0.0f ? cost / rootArea : 0.0f;
+    }
+
+    /// Walks the nodes the ray passes through, nearer child first, and skips those further than
+    /// the closest hit so far. `testPrimitive(orderIndex, maxT)` returns the t of a hit closer than `maxT`.
+    /// Returns the closest hit's order index and t.
+    template<typename TestPrimitive>
+    auto raycast(
+        const std::span<const Node> nodes,
+        const Ray& ray,
+        float maxT,
+        TestPrimitive&& testPrimitive
+    ) -> std::optional<std::pair<std::uint32_t, float>> {
+        if (nodes.empty()) {
+            return std::nullopt;
+        }
+        const glm::vec3 inverseDirection = ray.getInverseDirection();
+        if (!ray::intersect(ray, inverseDirection, nodes.front().bounds, maxT).has_value()) {
+            return std::nullopt;
+        }
+
+        std::optional<std::pair<std::uint32_t, float>> closest;
+        // Nodes with the t at which the ray enters them.
+        std::array<std::pair<std::uint32_t, float>, maxStackSize> stack;
+        std::size_t stackSize = 0;
+        stack[stackSize++] = { 0, 0.0f };
+
+        while (stackSize > 0) {
+            const auto [nodeIndex, enterT] = stack[--stackSize];
+            if (enterT > maxT) {
+                continue;
+            }
+            const Node& node = nodes[nodeIndex];
+            if (node.isLeaf()) {
+                for (std::uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    if (const std::optional<float> t = testPrimitive(i, maxT); t.has_value() && *t <= maxT) {
+                        maxT = *t;
+                        closest = std::pair(i, *t);
+                    }
+                }
+                continue;
+            }
+
+            std::uint32_t nearChild = node.leftChild;
+            std::uint32_t farChild = node.leftChild + 1;
+            std::optional<float> nearT = ray::intersect(ray, inverseDirection, nodes[nearChild].bounds, maxT);
+            std::optional<float> farT = ray::intersect(ray, inverseDirection, nodes[farChild].bounds, maxT);
+            if (!nearT.has_value() || (farT.has_value() && *farT < *nearT)) {
+                std::swap(nearChild, farChild);
+                std::swap(nearT, farT);
+            }
+            // The near one goes on top.
+            if (farT.has_value()) {
+                stack[stackSize++] = { farChild, *farT };
+            }
+            if (nearT.has_value()) {
+                stack[stackSize++] = { nearChild, *nearT };
+            }
+        }
+        return closest;
+    }
+}
+
+/// Dynamic bounding volume hierarchy over scene objects, each represented by its world space box.
+/// Answers which objects are in the view frustum, which one a ray (e.g. through the cursor) hits
+/// first, and which ones are within a radius of a point, in logarithmic instead of linear time.
+///
+/// Moving an object refits the boxes on its path to the root. Inserting or removing one marks the
+/// tree for a rebuild. `update()` does the rebuild (also once refitting degraded the tree enough)
+/// and must be called after the changes, before the queries.
+export class BoundingVolumeHierarchy {
+public:
+    /// Identifies an inserted object, stable until it's removed. Handles of removed objects are reused.
+    using Handle = std::uint32_t;
+
+    struct RayHit {
+        Handle object;
+        float distance; // In units of the ray direction's length.
+    };
+private:
+    static constexpr std::uint32_t noNode = std::numeric_limits<std::uint32_t>::max();
+
+    std::vector<AABB> objectBounds;
+    std::vector<std::uint8_t> objectAlive;
+    std::vector<Handle> freeHandles;
+
+    std::vector<bvh::detail::Node> nodes;
+    std::vector<Handle> objectOrder; // The objects in leaf order.
+    std::vector<std::uint32_t> parents; // Of every node, `noNode` for the root.
+    std::vector<std::uint32_t> objectLeaves; // The leaf of every object, `noNode` if it isn't in the tree.
+
+    bool structureChanged = false;
+    bool refitted = false;
+    float builtCost = 0.0f;
+public:
+    auto insert(const AABB& bounds) -> Handle {
+        Handle handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            objectBounds[handle] = bounds;
+            objectAlive[handle] = 1;
+        } else {
+            handle = static_cast<Handle>(objectBounds.size());
+            objectBounds.push_back(bounds);
+            objectAlive.push_back(1);
+            objectLeaves.push_back(noNode);
+        }
+        structureChanged = true;
+        return handle;
+    }
+
+    auto remove(const Handle handle) -> void {
+        if (handle >= objectAlive.size() || objectAlive[handle] == 0) {
+            throw std::runtime_error(std::format("Can't remove object {} from the BVH, it isn't in it.", handle));
+        }
+        objectAlive[handle] = 0;
+        objectBounds[handle] = AABB{};
+        freeHandles.push_back(handle);
+        structureChanged = true;
+    }
+
+    /// Sets the object's new bounds and refits the nodes above it.
+    auto move(const Handle handle, const AABB& bounds) -> void {
+        objectBounds[handle] = bounds;
+        if (structureChanged || objectLeaves[handle] == noNode) {
+            return;
+        }
+
+        std::uint32_t nodeIndex = objectLeaves[handle];
+        while (nodeIndex != noNode) {
+            bvh::detail::Node& node = nodes[nodeIndex];
+            node.bounds = AABB{};
+            if (node.isLeaf()) {
+                for (std::uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    node.bounds.expand(objectBounds[objectOrder[i]]);
+                }
+            } else {
+                node.bounds.expand(nodes[node.leftChild].bounds).expand(nodes[node.leftChild + 1].bounds);
+            }
+            nodeIndex = parents[nodeIndex];
+        }
+        refitted = true;
+    }
+
+    /// Rebuilds the tree if objects were inserted or removed, or if the refits made it too slow to walk.
+    auto update() -> void {
+        if (structureChanged) {
+            rebuild();
+            return;
+        }
+        if (refitted) {
+            refitted = false;
+            if (bvh::detail::computeCost(nodes) > bvh::defaults::rebuildCostRatio * builtCost) {
+                rebuild();
+            }
+        }
+    }
+
+    /// Builds the tree from scratch over the objects' current bounds.
+    auto rebuild() -> void {
+        std::vector<Handle> handles;
+        std::vector<AABB> boxes;
+        handles.reserve(objectBounds.size());
+        boxes.reserve(objectBounds.size());
+        for (Handle handle = 0; handle < objectBounds.size(); handle++) {
+            if (objectAlive[handle] != 0) {
+                handles.push_back(handle);
+                boxes.push_back(objectBounds[handle]);
+            }
+        }
+
+        bvh::detail::build(boxes, bvh::defaults::maxObjectsPerLeaf, nodes, objectOrder);
+        for (Handle& object : objectOrder) {
+            object = handles[object];
+        }
+
+        parents.assign(nodes.size(), noNode);
+        std::ranges::fill(objectLeaves, noNode);
+        for (std::uint32_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++) {
+            const bvh::detail::Node& node = nodes[nodeIndex];
+            if (node.isLeaf()) {
+                for (std::uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    objectLeaves[objectOrder[i]] = nodeIndex;
+                }
+            } else {
+                parents[node.leftChild] = parents[node.leftChild + 1] = nodeIndex;
+            }
+        }
+
+        builtCost = bvh::detail::computeCost(nodes);
+        structureChanged = false;
+        refitted = false;
+    }
+
+    /// Replaces `result` with the objects whose boxes are at least partly inside the frustum
+    /// (planes as returned by `Camera::getFrustumPlanes`). Subtrees fully inside are taken whole.
+    auto queryFrustum(const std::array<glm::vec4, 6>& planes, std::vector<Handle>& result) const -> void {
+        result.clear();
+        if (nodes.empty()) {
+            return;
+        }
+
+        std::array<std::uint32_t, bvh::detail::maxStackSize> stack;
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const bvh::detail::Node& node = nodes[stack[--stackSize]];
+            const glm::vec3 center = node.bounds.getCenter();
+            const glm::vec3 extent = node.bounds.getExtent();
+
+            bool outside = node.bounds.isEmpty();
+            bool inside = true;
+            for (std::size_t p = 0; p < planes.size() && !outside; p++) {
+                const float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+                const float radius = glm::dot(glm::abs(glm::vec3(planes[p])), extent);
+                outside = distance + radius < 0.0f;
+                inside = inside && distance - radius >= 0.0f;
+            }
+            if (outside) {
+                continue;
+            }
+            if (inside || node.isLeaf()) {
+                // A leaf's objects are tested one by one, the node's box is looser than theirs.
+                for (std::uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    if (inside || isBoxVisible(planes, objectBounds[objectOrder[i]])) {
+                        result.push_back(objectOrder[i]);
+                    }
+                }
+                continue;
+            }
+            stack[stackSize++] = node.leftChild;
+            stack[stackSize++] = node.leftChild + 1;
+        }
+    }
+
+    /// The object whose box the ray enters first, within `maxDistance`.
+    [[nodiscard]] auto raycast(
+        const Ray& ray,
+        const float maxDistance = std::numeric_limits<float>::infinity()
+    ) const -> std::optional<RayHit> {
+        const glm::vec3 inverseDirection = ray.getInverseDirection();
+        return raycast(ray, maxDistance, [&](const Handle object, const float maxT) {
+            return ray::intersect(ray, inverseDirection, objectBounds[object], maxT);
+        });
+    }
+
+    /// The closest hit within `maxDistance` by a finer test than the objects' boxes, like their
+    /// triangles. `hitTest(object, maxDistance)` is called for the objects whose boxes the ray
+    /// enters and returns the distance of its hit, if any.
+    template<typename HitTest>
+    [[nodiscard]] auto raycast(const Ray& ray, const float maxDistance, HitTest&& hitTest) const -> std::optional<RayHit> {
+        const auto hit = bvh::detail::raycast(nodes, ray, maxDistance, [&](const std::uint32_t i, const float maxT) {
+            return hitTest(objectOrder[i], maxT);
+        });
+        if (!hit.has_value()) {
+            return std::nullopt;
+        }
+        return RayHit { objectOrder[hit->first], hit->second };
+    }
+
+    /// Replaces `result` with the objects whose boxes are within `radius` of the `center`.
+    auto queryRadius(const glm::vec3& center, const float radius, std::vector<Handle>& result) const -> void {
+        result.clear();
+        if (nodes.empty()) {
+            return;
+        }
+
+        const float radiusSquared = radius * radius;
+        std::array<std::uint32_t, bvh::detail::maxStackSize> stack;
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const bvh::detail::Node& node = nodes[stack[--stackSize]];
+            if (node.bounds.isEmpty() || node.bounds.getDistanceSquared(center) > radiusSquared) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                for (std::uint32_t i = node.firstPrimitive; i < node.firstPrimitive + node.primitiveCount; i++) {
+                    const AABB& bounds = objectBounds[objectOrder[i]];
+                    if (!bounds.isEmpty() && bounds.getDistanceSquared(center) <= radiusSquared) {
+                        result.push_back(objectOrder[i]);
+                    }
+                }
+                continue;
+            }
+            stack[stackSize++] = node.leftChild;
+            stack[stackSize++] = node.leftChild + 1;
+        }
+    }
+
+    [[nodiscard]] auto getBounds(const Handle handle) const -> const AABB& {
+        return objectBounds[handle];
+    }
+
+    [[nodiscard]] auto getObjectCount() const -> std::size_t {
+        return objectBounds.size() - freeHandles.size();
+    }
+
+    [[nodiscard]] auto getNodeCount() const -> std::size_t {
+        return nodes.size();
+    }
+
+    /// SAH cost of the current tree, see `bvh::defaults::rebuildCostRatio`.
+    [[nodiscard]] auto getCost() const -> float {
+        return bvh::detail::computeCost(nodes);
+    }
+private:
+    static auto isBoxVisible(const std::array<glm::vec4, 6>& planes, const AABB& box) -> bool {
+        if (box.isEmpty()) {
+            return false;
+        }
+        const glm::vec3 center = box.getCenter();
+        const glm::vec3 extent = box.getExtent();
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w + glm::dot(glm::abs(glm::vec3(plane)), extent) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// Bounding volume hierarchy over the triangles of one mesh, for exact ray casts against it
+/// (picking the triangle under the cursor). Built once, the triangles are copied in leaf order.
+export class TriangleBvh {
+public:
+    struct Hit {
+        std::uint32_t triangle; // Index of the triangle's first index divided by 3.
+        TriangleIntersection intersection;
+    };
+private:
+    std::vector<bvh::detail::Node> nodes;
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    std::vector<std::uint32_t> triangleIndices;
+public:
+    /// `indices` are triangles, three per triangle, into the `vertices`.
+    TriangleBvh(const std::span<const Vertex> vertices, const std::span<const GLuint> indices) {
+        const std::size_t triangleCount = indices.size() / 3;
+        std::vector<AABB> boxes(triangleCount);
+        for (std::size_t t = 0; t < triangleCount; t++) {
+            for (std::size_t corner = 0; corner < 3; corner++) {
+                boxes[t].expand(vertices[indices[t * 3 + corner]].position);
+            }
+        }
+
+        bvh::detail::build(boxes, bvh::defaults::maxTrianglesPerLeaf, nodes, triangleIndices);
+
+        triangles.reserve(triangleCount);
+        for (const std::uint32_t t : triangleIndices) {
+            triangles.push_back({
+                vertices[indices[t * 3 + 0]].position,
+                vertices[indices[t * 3 + 1]].position,
+                vertices[indices[t * 3 + 2]].position,
+            });
+        }
+    }
+
+    /// The triangle the ray hits first within `maxDistance`, in the mesh's space.
+    [[nodiscard]] auto raycast(
+        const Ray& ray,
+        const float maxDistance = std::numeric_limits<float>::infinity()
+    ) const -> std::optional<Hit> {
+        std::optional<TriangleIntersection> closest;
+        const auto hit = bvh::detail::raycast(nodes, ray, maxDistance, [&](const std::uint32_t i, const float maxT) -> std::optional<float> {
+            const auto& [a, b, c] = triangles[i];
+            const std::optional<TriangleIntersection> intersection = ray::intersect(ray, a, b, c, maxT);
+            if (!intersection.has_value()) {
+                return std::nullopt;
+            }
+            closest = intersection;
+            return intersection->t;
+        });
+        if (!hit.has_value()) {
+            return std::nullopt;
+        }
+        return Hit { triangleIndices[hit->first], *closest };
+    }
+
+    /// Box around every triangle, empty if there are none.
+    [[nodiscard]] auto getBounds() const -> AABB {
+        return nodes.empty() ? AABB{} : nodes.front().bounds;
+    }
+
+    [[nodiscard]] auto getTriangleCount() const -> std::size_t {
+        return triangles.size();
+    }
+
+    [[nodiscard]] auto getNodeCount() const -> std::size_t {
+        return nodes.size();
+    }
+};
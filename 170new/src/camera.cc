@@ -12,7 +12,9 @@ module;
 export module camera;
 
 import mouse;
-import shader_program;
+import ray;
+import dynamic_buffer;
+import camera_uniforms;
 
 template<typename T> concept IsNumeric = std::is_integral_v<T> || std::is_floating_point_v<T>;
 
@@ -116,6 +118,10 @@ private:
 
     // Store for the calculated projection-view matrix of the camera.
     glm::mat4 projectionViewMatrix = glm::mat4(1.0f);
+
+    // The per-frame data every shader program reads (`CameraBlock` in the shaders), uploaded once per frame.
+    // Created by the first `onNextFrame`, so a camera can be made without an OpenGL context.
+    std::optional<DynamicBuffer> uniformBuffer;
 public:
     /// Pure constructor. <br>
     /// Must provide `displayDimensions`. (crucial) <br>
@@ -193,27 +199,46 @@ public:
         return position;
     }
 
-    /// Sends the camera's (proj * view) matrix to the shader program's
-    /// uniform variable with name specified by `variableName`.
-    /// NOTE: this function binds the shader, sends the camera's matrix to the GPU shader code and unbinds the shader.
-    auto sendProjectionViewMatToShader(
-        ShaderProgram& shader, 
-        const std::string& uniformVariableName
-    ) const -> void {
-        shader.bind();
-        shader.setUniformMat4f(uniformVariableName, getProjectionViewMatrix());
-        ShaderProgram::unbind();
+    /// The six planes bounding what the camera sees (left, right, bottom, top, near, far), taken
+    /// from the rows of the projection-view matrix (Gribb & Hartmann). Each is (normal, distance)
+    /// with the normal normalized and pointing inside: a point p is inside when dot(normal, p) + distance >= 0.
+    [[nodiscard]] auto getFrustumPlanes() const -> std::array<glm::vec4, 6> {
+        const glm::mat4& m = projectionViewMatrix;
+        const auto row = [&m](const int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+        std::array<glm::vec4, 6> planes = {
+            row(3) + row(0), row(3) - row(0),
+            row(3) + row(1), row(3) - row(1),
+            row(3) + row(2), row(3) - row(2),
+        };
+        for (glm::vec4& plane : planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return planes;
+    }
+
+    /// Ray from the near plane through the point under the cursor, for picking.
+    /// The `cursorPosition` is in pixels from the top left corner (as `Mouse` reports it),
+    /// the direction is normalized so the hits' distances are in world units.
+    [[nodiscard]] auto getCursorRay(const glm::vec2& cursorPosition) const -> Ray {
+        const glm::vec2 ndc = glm::vec2(
+            2.0f * cursorPosition.x / static_cast<float>(displayDimensions.x) - 1.0f,
+            1.0f - 2.0f * cursorPosition.y / static_cast<float>(displayDimensions.y));
+        const glm::mat4 inverseProjectionView = glm::inverse(projectionViewMatrix);
+        const glm::vec4 nearPoint = inverseProjectionView * glm::vec4(ndc, -1.0f, 1.0f);
+        const glm::vec4 farPoint = inverseProjectionView * glm::vec4(ndc, 1.0f, 1.0f);
+        const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        return Ray { origin, glm::normalize(glm::vec3(farPoint) / farPoint.w - origin) };
+    }
+
+    /// How far the `point` is in front of the camera, 0 at the near plane and 1 at the far one (not clamped).
+    [[nodiscard]] auto getNormalizedDepth(const glm::vec3& point) const -> float {
+        return (glm::dot(point - position, front) - near) / (far - near);
     }
 
-    /// Sends the camera's position vec3 to the GPU shader code's uniform vec3
-    /// with the name of `uniformVariableName`
-    auto sendPositionToShader(
-        ShaderProgram& shader, 
-        const std::string& uniformVariableName
-    ) const -> void {
-        shader.bind();
-        shader.setUniform3f(uniformVariableName, this->position);
-        ShaderProgram::unbind();
+    /// How many pixels a world space unit covers on the screen, `distance` away from the camera.
+    /// The projection's vertical scale maps the unit onto [-1, 1], the display's height onto pixels.
+    [[nodiscard]] inline auto getPixelsPerUnit(const float distance) const -> float {
+        return getProjectionMatrix()[1][1] * 0.5f * static_cast<float>(displayDimensions.y) / std::max(distance, near);
     }
 
     /// Sets camera's display dimensions.
@@ -250,6 +275,7 @@ public:
     /// Updates the camera's orientation angles - yaw, pitch.
     /// Updates the camera's position.
     /// Updates camera projection-view matrix.
+    /// Uploads the camera's uniform buffer (see `CameraUniforms`), the shaders read it from there.
     /// Should be called in the main loop on every frame.
     auto onNextFrame(GLFWwindow *window, const double deltaTime) -> void {
         // Process user input 
@@ -267,12 +293,31 @@ public:
         // Update the camera's projection-view matrix after all 
         // orientation vectors and frame dimensions were updated. 
         updateProjectionViewMatrix();
-        
+        uploadUniforms(deltaTime);
+
         // std::cout << "camera pos: " << position.x << ", " << position.y << ", " << position.z << std::endl;
         // std::cout << "camera front: " << front.x << ", " << front.y << ", " << front.z << std::endl;
         // std::cout << "camera yaw pitch: " << yaw << ", " << pitch << std::endl;
     }
 
+    /// Uploads the camera's per-frame data into its uniform buffer, one upload for all the programs.
+    auto uploadUniforms(const double deltaTime) -> void {
+        if (!uniformBuffer.has_value()) {
+            uniformBuffer.emplace(GL_UNIFORM_BUFFER);
+        }
+        const CameraUniforms uniforms {
+            .projectionViewMatrix = projectionViewMatrix,
+            .projectionMatrix = getProjectionMatrix(),
+            .viewMatrix = getViewMatrix(),
+            .position = position,
+            .timeInSeconds = static_cast<float>(glfwGetTime()),
+            .viewportSize = glm::vec2(displayDimensions),
+            .deltaTimeInSeconds = static_cast<float>(deltaTime),
+        };
+        uniformBuffer->upload(std::span<const CameraUniforms>(&uniforms, 1));
+        uniformBuffer->bindBase(camera_uniforms::defaults::bindingPoint);
+    }
+
     /// Processes user keyboard input and updates the camera's position and speed.
     /// Key presses update camera's position.
     auto processKeyboardInput(GLFWwindow* window, const double deltaTime) -> void {
@@ -0,0 +1,88 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <cstddef>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+export module camera_uniforms;
+
+/// The camera's per-frame data, laid out as the std140 uniform block `CameraBlock`
+/// of `shaders/std/camera.glsl`. Uploaded once per frame by `Camera::onNextFrame`
+/// into one uniform buffer which every shader program reads.
+/// The members are ordered so that std140 needs no padding between them
+/// (a vec3 followed by a float shares one vec4 slot).
+export struct CameraUniforms {
+    glm::mat4 projectionViewMatrix = glm::mat4(1.0f);
+    glm::mat4 projectionMatrix = glm::mat4(1.0f);
+    glm::mat4 viewMatrix = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    float timeInSeconds = 0.0f;
+    glm::vec2 viewportSize = glm::vec2(0.0f);
+    float deltaTimeInSeconds = 0.0f;
+    // std140 rounds the block's size up to a multiple of a vec4.
+    float padding = 0.0f;
+};
+
+static_assert(sizeof(CameraUniforms) == 224, "CameraUniforms must match the std140 layout of CameraBlock.");
+
+export namespace camera_uniforms::defaults {
+    /// The uniform buffer binding point of the block, the same in every program.
+    constexpr GLuint bindingPoint = 0;
+    constexpr const char* blockName = "CameraBlock";
+}
+
+namespace camera_uniforms::detail {
+    struct Member {
+        const char* name;
+        std::size_t offset;
+    };
+
+    /// The block's members as they are named in `shaders/std/camera.glsl`, with their offsets on the CPU side.
+    const std::array<Member, 7> members = {
+        Member { "U_CameraProjViewMat4", offsetof(CameraUniforms, projectionViewMatrix) },
+        Member { "U_CameraProjectionMat4", offsetof(CameraUniforms, projectionMatrix) },
+        Member { "U_CameraViewMat4", offsetof(CameraUniforms, viewMatrix) },
+        Member { "U_CameraPositionVec3", offsetof(CameraUniforms, position) },
+        Member { "U_TimeInSeconds", offsetof(CameraUniforms, timeInSeconds) },
+        Member { "U_ViewportSizeVec2", offsetof(CameraUniforms, viewportSize) },
+        Member { "U_DeltaTimeInSeconds", offsetof(CameraUniforms, deltaTimeInSeconds) },
+    };
+}
+
+export namespace camera_uniforms {
+    /// Points the program's `CameraBlock` (if it declares one) at `defaults::bindingPoint`
+    /// and checks the block's layout, as the driver reports it, against `CameraUniforms`.
+    /// Throws if they don't match, the program would read garbage. To be called after linking.
+    auto bindBlock(const GLuint programID, const std::string& programName) -> void {
+        const GLuint blockIndex = glGetUniformBlockIndex(programID, defaults::blockName);
+        if (blockIndex == GL_INVALID_INDEX) {
+            return;
+        }
+        glUniformBlockBinding(programID, blockIndex, defaults::bindingPoint);
+
+        GLint blockSize = 0;
+        glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        if (static_cast<std::size_t>(blockSize) > sizeof(CameraUniforms)) {
+            throw std::runtime_error(std::format("{}: {} is {} bytes, CameraUniforms only {}.",
+                programName, defaults::blockName, blockSize, sizeof(CameraUniforms)));
+        }
+
+        for (const detail::Member& member : detail::members) {
+            GLuint uniformIndex = GL_INVALID_INDEX;
+            glGetUniformIndices(programID, 1, &member.name, &uniformIndex);
+            if (uniformIndex == GL_INVALID_INDEX) {
+                continue;
+            }
+            GLint offset = -1;
+            glGetActiveUniformsiv(programID, 1, &uniformIndex, GL_UNIFORM_OFFSET, &offset);
+            if (static_cast<std::size_t>(offset) != member.offset) {
+                throw std::runtime_error(std::format("{}: {} of {} is at offset {}, CameraUniforms has it at {}.",
+                    programName, member.name, defaults::blockName, offset, member.offset));
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module dynamic_buffer;
+
+/// Buffer whose whole contents are rewritten often (every frame), like the indirect
+/// draw commands or per-draw data in a shader storage buffer. Grows as needed.
+/// Non-owning like the other buffers, `deleteResource` deletes it.
+export class DynamicBuffer {
+private:
+    GLuint bufferID = 0;
+    GLenum target;
+    std::size_t capacityInBytes = 0;
+public:
+    /// `target` is where the buffer gets bound, e.g. GL_DRAW_INDIRECT_BUFFER or GL_SHADER_STORAGE_BUFFER.
+    explicit DynamicBuffer(const GLenum target) : target(target) {
+        glGenBuffers(1, &bufferID);
+    }
+
+    ~DynamicBuffer() = default;
+
+    auto deleteResource() -> void {
+        glDeleteBuffers(1, &bufferID);
+        bufferID = 0;
+        capacityInBytes = 0;
+    }
+
+    /// Replaces the contents with `data`. Leaves the buffer bound to its target.
+    template<typename T>
+    auto upload(const std::span<const T> data) -> void {
+        bind();
+        // The old data store is orphaned (not overwritten) so the GPU can
+        // keep reading it for the draws still in flight, without a stall.
+        capacityInBytes = std::max(capacityInBytes, data.size_bytes());
+        glBufferData(target, static_cast<GLsizeiptr>(capacityInBytes), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, static_cast<GLsizeiptr>(data.size_bytes()), data.data());
+    }
+
+    auto bind() const -> void {
+        glBindBuffer(target, bufferID);
+    }
+
+    auto unbind() const -> void {
+        glBindBuffer(target, 0);
+    }
+
+    /// Binds the buffer to the indexed binding point `index` of its target
+    /// (`layout(binding = index)` in the shader). Only for the indexed targets (SSBO, UBO).
+    auto bindBase(const GLuint index) const -> void {
+        glBindBufferBase(target, index, bufferID);
+    }
+
+    [[nodiscard]] auto getID() const -> GLuint {
+        return bufferID;
+    }
+};
@@ -0,0 +1,143 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+export module file_mapping;
+
+export namespace file_mapping {
+    constexpr std::uint64_t fnvOffsetBasis = 14695981039346656037ull;
+    constexpr std::uint64_t fnvPrime = 1099511628211ull;
+
+    /// 64-bit FNV-1a hash of `size` bytes starting at `data`.
+    /// Hashes can be chained by passing the previous result in as `seed`.
+    auto hashBytes(
+        const void* data,
+        const std::size_t size,
+        const std::uint64_t seed = fnvOffsetBasis
+    ) -> std::uint64_t {
+        const auto bytes = static_cast<const std::uint8_t*>(data);
+        std::uint64_t hash = seed;
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= fnvPrime;
+        }
+        return hash;
+    }
+
+    /// Hashes the trivially copyable `value` byte by byte.
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    auto hashValue(const T& value, const std::uint64_t seed = fnvOffsetBasis) -> std::uint64_t {
+        return hashBytes(&value, sizeof(T), seed);
+    }
+
+    /// Size and last modification time of a file. Cheap to check (a `stat`, the file isn't read),
+    /// so cooked files use them to tell whether their sources changed.
+    struct FileStamp {
+        std::uint64_t size = 0;
+        std::int64_t modifiedTime = 0; // Nanoseconds since the epoch.
+
+        auto operator==(const FileStamp& other) const -> bool = default;
+    };
+
+    /// The stamp of the file at `filePath`, nothing if it doesn't exist.
+    auto getFileStamp(const std::string& filePath) -> std::optional<FileStamp> {
+        struct stat fileStatus{};
+        if (::stat(filePath.c_str(), &fileStatus) != 0) {
+            return std::nullopt;
+        }
+        return FileStamp {
+            .size = static_cast<std::uint64_t>(fileStatus.st_size),
+            .modifiedTime = static_cast<std::int64_t>(fileStatus.st_mtim.tv_sec) * 1'000'000'000
+                + static_cast<std::int64_t>(fileStatus.st_mtim.tv_nsec),
+        };
+    }
+}
+
+/// Read-only memory mapping of a whole file.
+/// Owns the mapping, so it can only be moved, not copied.
+/// The mapping is released when the object is destroyed.
+export class MappedFile {
+private:
+    const std::uint8_t* mData = nullptr;
+    std::size_t mSize = 0;
+public:
+    MappedFile() = default;
+
+    /// Maps the file at `filePath` into memory.
+    /// If the file can't be opened or mapped, the mapping stays empty (check `isOpen`).
+    explicit MappedFile(const std::string& filePath) {
+        const int fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+        if (fileDescriptor == -1) {
+            return;
+        }
+
+        struct stat fileStatus{};
+        if (::fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0) {
+            void* address = ::mmap(nullptr, static_cast<std::size_t>(fileStatus.st_size),
+                                   PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (address != MAP_FAILED) {
+                mData = static_cast<const std::uint8_t*>(address);
+                mSize = static_cast<std::size_t>(fileStatus.st_size);
+            }
+        }
+
+        // The mapping stays valid after the file descriptor is closed.
+        ::close(fileDescriptor);
+    }
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+    : mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0)) {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            mData = std::exchange(other.mData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    [[nodiscard]] auto isOpen() const -> bool {
+        return mData != nullptr;
+    }
+
+    [[nodiscard]] auto data() const -> const std::uint8_t* {
+        return mData;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t {
+        return mSize;
+    }
+
+    /// Returns a pointer to `T` at `byteOffset` or null if `count` elements of `T` wouldn't fit.
+    template<typename T>
+    [[nodiscard]] auto at(const std::size_t byteOffset, const std::size_t count = 1) const -> const T* {
+        if (byteOffset > mSize || count > (mSize - byteOffset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(mData + byteOffset);
+    }
+
+private:
+    auto unmap() -> void {
+        if (mData != nullptr) {
+            ::munmap(const_cast<std::uint8_t*>(mData), mSize);
+        }
+        mData = nullptr;
+        mSize = 0;
+    }
+};
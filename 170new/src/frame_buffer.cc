@@ -9,6 +9,7 @@ module;
 
 export module frame_buffer;
 
+import gl_state;
 import vertex_buffer.vertex_struct;
 import vertex_buffer;
 import index_buffer;
@@ -17,6 +18,8 @@ import texture;
 import shader_program;
 import transformation;
 
+using namespace uniform::literals;
+
 export namespace framebuffer {
     enum Attachment : uint8_t {
         // ColorTexture        = 0b00000001,       // no renderbuffer for color buffer
@@ -78,7 +81,7 @@ public:
     , mVAO(mVBO, Vertex::getLayout(), mIBO)
     { 
         glGenFramebuffers(1, &mFrameBufferID);
-        glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferID);
+        GLState::getInstance().bindFramebuffer(mFrameBufferID);
         
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
                                GL_TEXTURE_2D, mColorTexture.getID(), 0);
@@ -101,13 +104,13 @@ public:
         }
 
         // Unbind it for now (reverting back to the default framebuffer).
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::getInstance().bindFramebuffer(0);
     }
    
     /// Bind back to the default framebuffer.
     static auto bindToDefault() -> void {
         std::cout << "Bound default framebuffer with id: 0\n";
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::getInstance().bindFramebuffer(0);
     }
 
     /// Clears the current framebuffer's buffers (color, depth, stencil).
@@ -124,7 +127,7 @@ public:
     /// Binds this framebuffer to be current.
     auto bind() const -> void {
         std::cout << "Bound framebuffer with id: " << mFrameBufferID << "\n";
-        glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferID);
+        GLState::getInstance().bindFramebuffer(mFrameBufferID);
     }
 
     /// Binds this framebuffer and clears this framebuffer's buffers.
@@ -174,13 +177,13 @@ public:
 
         // Bind the simple shader that only draws out the texture.
         shader.bind();
-        shader.setUniform1i("U_ScreenTexture", textureUnitSlot);
-        shader.setUniformMat4f("U_ModelMat4", transform.getModelMat());
+        shader.setUniform1i("U_ScreenTexture"_uniform, textureUnitSlot);
+        shader.setUniformMat4f("U_ModelMat4"_uniform, transform.getModelMat());
 
         // Draw it.
         mVAO.bind();
         glDrawElements(GL_TRIANGLES, static_cast<int>(mIBO.getElementCount()), 
-                       GL_UNSIGNED_INT, nullptr);
+                       mIBO.getIndexType(), nullptr);
 
 
         // glEnable(GL_DEPTH_TEST);
@@ -0,0 +1,312 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+export module frustum_culling;
+
+import aabb;
+import bounding_sphere;
+
+namespace culling::detail {
+    /// Tests one box (center, extent) against the planes. On a plane's outer side
+    /// the box is outside when even its corner furthest along the normal is.
+    auto isBoxVisible(
+        const std::array<glm::vec4, 6>& planes,
+        const glm::vec3& center,
+        const glm::vec3& extent
+    ) -> bool {
+        for (const glm::vec4& plane : planes) {
+            const glm::vec3 normal = glm::vec3(plane);
+            const float distance = glm::dot(normal, center) + plane.w;
+            const float radius = glm::dot(glm::abs(normal), extent);
+            // Written so a NaN (an empty box) fails it.
+            if (!(distance + radius >= 0.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto isSphereVisible(
+        const std::array<glm::vec4, 6>& planes,
+        const glm::vec3& center,
+        const float radius
+    ) -> bool {
+        for (const glm::vec4& plane : planes) {
+            if (!(glm::dot(glm::vec3(plane), center) + plane.w + radius >= 0.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Appends the index of every set bit of the group's `mask`.
+    auto appendVisible(std::vector<std::uint32_t>& visible, const std::size_t first, unsigned mask) -> void {
+        while (mask != 0) {
+            visible.push_back(static_cast<std::uint32_t>(first + std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+}
+
+export namespace culling {
+    /// The view frustum as six planes (xyz the normal pointing inside, w the distance),
+    /// see `Camera::getFrustumPlanes`.
+    using FrustumPlanes = std::array<glm::vec4, 6>;
+
+    /// Boxes tested with one SIMD instruction at a time.
+#if defined(__AVX__)
+    constexpr std::size_t laneCount = 8;
+#elif defined(__SSE2__)
+    constexpr std::size_t laneCount = 4;
+#else
+    constexpr std::size_t laneCount = 1;
+#endif
+
+    /// How many objects a cull let through and how many it dropped.
+    struct Stats {
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+
+        auto add(const Stats& other) -> void {
+            visible += other.visible;
+            culled += other.culled;
+        }
+    };
+
+    /// World space boxes as a structure of arrays (one array per coordinate),
+    /// so the culler loads the same coordinate of `laneCount` boxes at once.
+    /// Cleared and refilled every frame, the arrays keep their memory.
+    class BoxSet {
+    private:
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+    public:
+        auto clear() -> void {
+            for (auto* coordinates : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+                coordinates->clear();
+            }
+        }
+
+        auto reserve(const std::size_t count) -> void {
+            for (auto* coordinates : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+                coordinates->reserve(count);
+            }
+        }
+
+        /// An empty box is never visible.
+        auto add(const AABB& box) -> void {
+            const glm::vec3 center = box.isEmpty() ? glm::vec3(0.0f) : box.getCenter();
+            const glm::vec3 extent = box.isEmpty() ? glm::vec3(-std::numeric_limits<float>::infinity()) : box.getExtent();
+            centerX.push_back(center.x);
+            centerY.push_back(center.y);
+            centerZ.push_back(center.z);
+            extentX.push_back(extent.x);
+            extentY.push_back(extent.y);
+            extentZ.push_back(extent.z);
+        }
+
+        [[nodiscard]] auto size() const -> std::size_t {
+            return centerX.size();
+        }
+
+        [[nodiscard]] auto getCenter(const std::size_t i) const -> glm::vec3 {
+            return { centerX[i], centerY[i], centerZ[i] };
+        }
+
+        [[nodiscard]] auto getExtent(const std::size_t i) const -> glm::vec3 {
+            return { extentX[i], extentY[i], extentZ[i] };
+        }
+
+        friend auto cullBoxes(const FrustumPlanes&, const BoxSet&, std::vector<std::uint32_t>&) -> Stats;
+    };
+
+    /// World space spheres as a structure of arrays, see `BoxSet`.
+    class SphereSet {
+    private:
+        std::vector<float> centerX, centerY, centerZ, radius;
+    public:
+        auto clear() -> void {
+            for (auto* coordinates : { &centerX, &centerY, &centerZ, &radius }) {
+                coordinates->clear();
+            }
+        }
+
+        auto reserve(const std::size_t count) -> void {
+            for (auto* coordinates : { &centerX, &centerY, &centerZ, &radius }) {
+                coordinates->reserve(count);
+            }
+        }
+
+        /// An empty sphere is never visible.
+        auto add(const BoundingSphere& sphere) -> void {
+            centerX.push_back(sphere.center.x);
+            centerY.push_back(sphere.center.y);
+            centerZ.push_back(sphere.center.z);
+            radius.push_back(sphere.isEmpty() ? -std::numeric_limits<float>::infinity() : sphere.radius);
+        }
+
+        [[nodiscard]] auto size() const -> std::size_t {
+            return centerX.size();
+        }
+
+        friend auto cullSpheres(const FrustumPlanes&, const SphereSet&, std::vector<std::uint32_t>&) -> Stats;
+    };
+
+    /// Replaces `visible` with the indices (ascending) of the boxes that are at least
+    /// partly inside the frustum. Tests `laneCount` boxes at a time. Conservative:
+    /// a large box next to a frustum's corner can pass while being outside.
+    auto cullBoxes(const FrustumPlanes& planes, const BoxSet& boxes, std::vector<std::uint32_t>& visible) -> Stats {
+        visible.clear();
+        const std::size_t count = boxes.size();
+        std::size_t i = 0;
+
+#if defined(__AVX__)
+        // One register per plane and coordinate, broadcast once for all the boxes.
+        __m256 normalX[6], normalY[6], normalZ[6], absNormalX[6], absNormalY[6], absNormalZ[6], distance[6];
+        for (std::size_t p = 0; p < planes.size(); p++) {
+            normalX[p] = _mm256_set1_ps(planes[p].x);
+            normalY[p] = _mm256_set1_ps(planes[p].y);
+            normalZ[p] = _mm256_set1_ps(planes[p].z);
+            absNormalX[p] = _mm256_set1_ps(std::abs(planes[p].x));
+            absNormalY[p] = _mm256_set1_ps(std::abs(planes[p].y));
+            absNormalZ[p] = _mm256_set1_ps(std::abs(planes[p].z));
+            distance[p] = _mm256_set1_ps(planes[p].w);
+        }
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            const __m256 centerX = _mm256_loadu_ps(boxes.centerX.data() + i);
+            const __m256 centerY = _mm256_loadu_ps(boxes.centerY.data() + i);
+            const __m256 centerZ = _mm256_loadu_ps(boxes.centerZ.data() + i);
+            const __m256 extentX = _mm256_loadu_ps(boxes.extentX.data() + i);
+            const __m256 extentY = _mm256_loadu_ps(boxes.extentY.data() + i);
+            const __m256 extentZ = _mm256_loadu_ps(boxes.extentZ.data() + i);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (std::size_t p = 0; p < planes.size(); p++) {
+                const __m256 centerDistance = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(centerX, normalX[p]), _mm256_mul_ps(centerY, normalY[p])),
+                    _mm256_add_ps(_mm256_mul_ps(centerZ, normalZ[p]), distance[p]));
+                const __m256 radius = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(extentX, absNormalX[p]), _mm256_mul_ps(extentY, absNormalY[p])),
+                    _mm256_mul_ps(extentZ, absNormalZ[p]));
+                // Ordered compare, a NaN (an empty box) is outside.
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(centerDistance, radius), zero, _CMP_GE_OQ));
+            }
+            detail::appendVisible(visible, i, static_cast<unsigned>(_mm256_movemask_ps(inside)));
+        }
+#elif defined(__SSE2__)
+        // One register per plane and coordinate, broadcast once for all the boxes.
+        __m128 normalX[6], normalY[6], normalZ[6], absNormalX[6], absNormalY[6], absNormalZ[6], distance[6];
+        for (std::size_t p = 0; p < planes.size(); p++) {
+            normalX[p] = _mm_set1_ps(planes[p].x);
+            normalY[p] = _mm_set1_ps(planes[p].y);
+            normalZ[p] = _mm_set1_ps(planes[p].z);
+            absNormalX[p] = _mm_set1_ps(std::abs(planes[p].x));
+            absNormalY[p] = _mm_set1_ps(std::abs(planes[p].y));
+            absNormalZ[p] = _mm_set1_ps(std::abs(planes[p].z));
+            distance[p] = _mm_set1_ps(planes[p].w);
+        }
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            const __m128 centerX = _mm_loadu_ps(boxes.centerX.data() + i);
+            const __m128 centerY = _mm_loadu_ps(boxes.centerY.data() + i);
+            const __m128 centerZ = _mm_loadu_ps(boxes.centerZ.data() + i);
+            const __m128 extentX = _mm_loadu_ps(boxes.extentX.data() + i);
+            const __m128 extentY = _mm_loadu_ps(boxes.extentY.data() + i);
+            const __m128 extentZ = _mm_loadu_ps(boxes.extentZ.data() + i);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (std::size_t p = 0; p < planes.size(); p++) {
+                const __m128 centerDistance = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(centerX, normalX[p]), _mm_mul_ps(centerY, normalY[p])),
+                    _mm_add_ps(_mm_mul_ps(centerZ, normalZ[p]), distance[p]));
+                const __m128 radius = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(extentX, absNormalX[p]), _mm_mul_ps(extentY, absNormalY[p])),
+                    _mm_mul_ps(extentZ, absNormalZ[p]));
+                // Ordered compare, a NaN (an empty box) is outside.
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(centerDistance, radius), zero));
+            }
+            detail::appendVisible(visible, i, static_cast<unsigned>(_mm_movemask_ps(inside)));
+        }
+#endif
+
+        // The boxes that don't fill a whole group.
+        for (; i < count; i++) {
+            if (detail::isBoxVisible(planes, boxes.getCenter(i), boxes.getExtent(i))) {
+                visible.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+
+        return Stats { .visible = visible.size(), .culled = count - visible.size() };
+    }
+
+    /// Same as `cullBoxes` but one box at a time, the reference the SIMD version is checked and measured against.
+    auto cullBoxesScalar(const FrustumPlanes& planes, const BoxSet& boxes, std::vector<std::uint32_t>& visible) -> Stats {
+        visible.clear();
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            if (detail::isBoxVisible(planes, boxes.getCenter(i), boxes.getExtent(i))) {
+                visible.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+        return Stats { .visible = visible.size(), .culled = boxes.size() - visible.size() };
+    }
+
+    /// Replaces `visible` with the indices (ascending) of the spheres that are at least
+    /// partly inside the frustum. Tests `laneCount` spheres at a time.
+    auto cullSpheres(const FrustumPlanes& planes, const SphereSet& spheres, std::vector<std::uint32_t>& visible) -> Stats {
+        visible.clear();
+        const std::size_t count = spheres.size();
+        std::size_t i = 0;
+
+#if defined(__AVX__)
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            const __m256 centerX = _mm256_loadu_ps(spheres.centerX.data() + i);
+            const __m256 centerY = _mm256_loadu_ps(spheres.centerY.data() + i);
+            const __m256 centerZ = _mm256_loadu_ps(spheres.centerZ.data() + i);
+            const __m256 radius = _mm256_loadu_ps(spheres.radius.data() + i);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4& plane : planes) {
+                const __m256 centerDistance = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+                    _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(centerDistance, radius), zero, _CMP_GE_OQ));
+            }
+            detail::appendVisible(visible, i, static_cast<unsigned>(_mm256_movemask_ps(inside)));
+        }
+#elif defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            const __m128 centerX = _mm_loadu_ps(spheres.centerX.data() + i);
+            const __m128 centerY = _mm_loadu_ps(spheres.centerY.data() + i);
+            const __m128 centerZ = _mm_loadu_ps(spheres.centerZ.data() + i);
+            const __m128 radius = _mm_loadu_ps(spheres.radius.data() + i);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : planes) {
+                const __m128 centerDistance = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(centerDistance, radius), zero));
+            }
+            detail::appendVisible(visible, i, static_cast<unsigned>(_mm_movemask_ps(inside)));
+        }
+#endif
+
+        for (; i < count; i++) {
+            const glm::vec3 center(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]);
+            if (detail::isSphereVisible(planes, center, spheres.radius[i])) {
+                visible.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+
+        return Stats { .visible = visible.size(), .culled = count - visible.size() };
+    }
+}
@@ -0,0 +1,329 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module geometry_arena;
+
+import gl_state;
+import vertex_buffer;
+import vertex_buffer.packed_vertex;
+
+export namespace geometry_arena::defaults {
+    /// Vertices (`PackedVertex`es) the arena has room for before it first grows.
+    constexpr std::size_t initialVertexCount = 1 << 20;
+    /// Indices the arena has room for before it first grows.
+    constexpr std::size_t initialIndexCount = 1 << 22;
+}
+
+namespace geometry_arena::detail {
+    /// First fit allocator of ranges in [0, capacity). Freed ranges are merged with their neighbours.
+    class RangeAllocator {
+    private:
+        std::map<std::size_t, std::size_t> freeRanges; // Offset -> size.
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+    public:
+        /// Returns the offset of `size` free units, nothing if there is no range large enough.
+        auto allocate(const std::size_t size) -> std::optional<std::size_t> {
+            for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+                const auto [offset, freeSize] = *it;
+                if (freeSize < size) {
+                    continue;
+                }
+                freeRanges.erase(it);
+                if (freeSize > size) {
+                    freeRanges.emplace(offset + size, freeSize - size);
+                }
+                used += size;
+                return offset;
+            }
+            return std::nullopt;
+        }
+
+        auto free(const std::size_t offset, std::size_t size) -> void {
+            used -= size;
+            std::size_t start = offset;
+            // Merges with the following range.
+            const auto next = freeRanges.find(offset + size);
+            if (next != freeRanges.end()) {
+                size += next->second;
+                freeRanges.erase(next);
+            }
+            // Merges with the preceding range.
+            const auto following = freeRanges.lower_bound(offset);
+            if (following != freeRanges.begin()) {
+                const auto previous = std::prev(following);
+                if (previous->first + previous->second == offset) {
+                    start = previous->first;
+                    size += previous->second;
+                    freeRanges.erase(previous);
+                }
+            }
+            freeRanges.emplace(start, size);
+        }
+
+        /// Appends the new space at the end as a free range.
+        auto grow(const std::size_t newCapacity) -> void {
+            const std::size_t added = newCapacity - capacity;
+            used += added; // `free` takes it back out.
+            free(capacity, added);
+            capacity = newCapacity;
+        }
+
+        [[nodiscard]] auto getCapacity() const -> std::size_t {
+            return capacity;
+        }
+
+        [[nodiscard]] auto getUsed() const -> std::size_t {
+            return used;
+        }
+    };
+}
+
+/// Place of a mesh's vertices and indices in the arena's buffers.
+/// The indices are relative to the mesh's first vertex, draws pass `baseVertex` along.
+export struct ArenaAllocation {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLuint vertexCount = 0;
+    GLuint indexCount = 0;
+};
+
+/// One draw of `glMultiDrawElementsIndirect`, laid out the way OpenGL reads it from the GL_DRAW_INDIRECT_BUFFER.
+export struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/// Process-wide pair of buffers (one vertex buffer, one index buffer) that static meshes
+/// sub-allocate their `PackedVertex`es and indices from. Since every mesh lives in the same
+/// buffers, any number of them can be drawn with one VAO and one `glMultiDrawElementsIndirect`.
+///
+/// The indices are 32-bit, a single index type has to serve every draw of a multi draw.
+///
+/// Thread-safe. Allocating uploads the data, so it needs a current OpenGL context, the main
+/// one or a shared one. When the buffers are full they are replaced by larger ones, the main
+/// context picks them up (after the copy is done) the next time it binds the arena.
+export class GeometryArena {
+private:
+    std::mutex mutex;
+    GLuint vertexBufferID = 0;
+    GLuint indexBufferID = 0;
+    geometry_arena::detail::RangeAllocator vertexRanges;
+    geometry_arena::detail::RangeAllocator indexRanges;
+    // Bumped every time the buffers are replaced by larger ones.
+    std::uint64_t generation = 0;
+    // Signaled once the copy into the larger buffers is done.
+    GLsync growthFence = nullptr;
+    // Freed ranges wait here until the draws issued before they were freed are done.
+    struct PendingFree {
+        std::vector<ArenaAllocation> allocations;
+        GLsync fence;
+    };
+    std::deque<PendingFree> pendingFrees;
+
+    // Belong to the main context, VAOs can't be shared.
+    GLuint vertexArrayID = 0;
+    std::uint64_t linkedGeneration = std::numeric_limits<std::uint64_t>::max();
+
+    GeometryArena() = default;
+public:
+    GeometryArena(const GeometryArena& other) = delete;
+    GeometryArena& operator=(const GeometryArena& other) = delete;
+
+    /// Returns the singleton instance of this class. Created by the first call,
+    /// from whichever thread that is (the initialization of a local static is thread-safe).
+    static auto getInstance() -> GeometryArena& {
+        static GeometryArena instance;
+        return instance;
+    }
+
+    /// Copies the mesh into the arena, growing it if there is no room.
+    /// The `indices` are relative to the mesh's own vertices.
+    auto allocate(const std::span<const PackedVertex> vertices, const std::span<const GLuint> indices) -> ArenaAllocation {
+        if (vertices.empty() || indices.empty()) {
+            throw std::runtime_error("Can't allocate an empty mesh in the geometry arena.");
+        }
+
+        std::lock_guard lock(mutex);
+        reclaimFreedRanges();
+
+        auto vertexOffset = vertexRanges.allocate(vertices.size());
+        auto indexOffset = indexRanges.allocate(indices.size());
+        if (!vertexOffset.has_value() || !indexOffset.has_value()) {
+            if (vertexOffset.has_value()) {
+                vertexRanges.free(*vertexOffset, vertices.size());
+            }
+            if (indexOffset.has_value()) {
+                indexRanges.free(*indexOffset, indices.size());
+            }
+            grow(vertices.size(), indices.size());
+            vertexOffset = vertexRanges.allocate(vertices.size());
+            indexOffset = indexRanges.allocate(indices.size());
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(*vertexOffset * sizeof(PackedVertex)),
+                        static_cast<GLsizeiptr>(vertices.size_bytes()), vertices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBufferID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(*indexOffset * sizeof(GLuint)),
+                        static_cast<GLsizeiptr>(indices.size_bytes()), indices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        return ArenaAllocation {
+            .baseVertex = static_cast<GLint>(*vertexOffset),
+            .firstIndex = static_cast<GLuint>(*indexOffset),
+            .vertexCount = static_cast<GLuint>(vertices.size()),
+            .indexCount = static_cast<GLuint>(indices.size()),
+        };
+    }
+
+    /// Gives the meshes' ranges back once the GPU is done with the draws issued so far.
+    /// Must be called on the context that drew them (the main one). The allocations happen on
+    /// the upload context, its writes aren't ordered after this context's draws, so the ranges are
+    /// only reused after the fence placed here is signaled (see `reclaimFreedRanges`).
+    auto free(const std::span<const ArenaAllocation> allocations) -> void {
+        if (allocations.empty()) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        pendingFrees.push_back(PendingFree {
+            .allocations = std::vector(allocations.begin(), allocations.end()),
+            .fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+        });
+        // The fence must reach the GPU, the upload context polls it.
+        glFlush();
+    }
+
+    /// Binds the VAO that reads from the arena's buffers. Main context only.
+    auto bind() -> void {
+        std::lock_guard lock(mutex);
+        if (vertexArrayID == 0) {
+            glGenVertexArrays(1, &vertexArrayID);
+        }
+        GLState::getInstance().bindVertexArray(vertexArrayID);
+        if (linkedGeneration == generation) {
+            return;
+        }
+
+        if (growthFence != nullptr) {
+            // The copy into the new buffers may have been issued on the other context.
+            glWaitSync(growthFence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(growthFence);
+            growthFence = nullptr;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+        PackedVertex::getLayout().configure();
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        linkedGeneration = generation;
+    }
+
+    static auto unbind() -> void {
+        GLState::getInstance().bindVertexArray(0);
+    }
+
+    /// The type of the arena's indices, to be passed into the `glDraw*Elements*` calls.
+    [[nodiscard]] static constexpr auto getIndexType() -> GLenum {
+        return GL_UNSIGNED_INT;
+    }
+
+    /// Prints how much of the arena is used. The ranges still waiting to be reclaimed count as used.
+    auto printReport() -> void {
+        std::lock_guard lock(mutex);
+        reclaimFreedRanges();
+        std::println("Geometry arena: {} of {} vertices, {} of {} indices ({:.1f} MiB allocated)",
+            vertexRanges.getUsed(), vertexRanges.getCapacity(), indexRanges.getUsed(), indexRanges.getCapacity(),
+            static_cast<double>(vertexRanges.getCapacity() * sizeof(PackedVertex) + indexRanges.getCapacity() * sizeof(GLuint))
+                / (1024.0 * 1024.0));
+    }
+
+    /// Deletes the buffers and the VAO. Main context only, every allocation becomes invalid.
+    auto deleteResource() -> void {
+        std::lock_guard lock(mutex);
+        GLState::getInstance().forgetVertexArray(vertexArrayID);
+        glDeleteVertexArrays(1, &vertexArrayID);
+        glDeleteBuffers(1, &vertexBufferID);
+        glDeleteBuffers(1, &indexBufferID);
+        if (growthFence != nullptr) {
+            glDeleteSync(growthFence);
+        }
+        for (const PendingFree& pendingFree : pendingFrees) {
+            glDeleteSync(pendingFree.fence);
+        }
+        pendingFrees.clear();
+        vertexArrayID = vertexBufferID = indexBufferID = 0;
+        growthFence = nullptr;
+        vertexRanges = {};
+        indexRanges = {};
+        linkedGeneration = std::numeric_limits<std::uint64_t>::max();
+    }
+
+private:
+    /// Gives the ranges of the frees whose fences are signaled back to the allocators, never waits.
+    /// The fences are signaled in the order they were placed in, the first unsignaled one ends the check.
+    auto reclaimFreedRanges() -> void {
+        while (!pendingFrees.empty()) {
+            const PendingFree& pendingFree = pendingFrees.front();
+            const GLenum status = glClientWaitSync(pendingFree.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                return;
+            }
+            for (const ArenaAllocation& allocation : pendingFree.allocations) {
+                vertexRanges.free(static_cast<std::size_t>(allocation.baseVertex), allocation.vertexCount);
+                indexRanges.free(allocation.firstIndex, allocation.indexCount);
+            }
+            glDeleteSync(pendingFree.fence);
+            pendingFrees.pop_front();
+        }
+    }
+
+    /// Replaces the buffers with ones (at least) twice as large that fit the extra vertices and indices.
+    auto grow(const std::size_t extraVertexCount, const std::size_t extraIndexCount) -> void {
+        const std::size_t vertexCapacity = vertexRanges.getCapacity();
+        const std::size_t indexCapacity = indexRanges.getCapacity();
+        const std::size_t newVertexCapacity = std::max({
+            geometry_arena::defaults::initialVertexCount, vertexCapacity * 2, vertexRanges.getUsed() + extraVertexCount * 2 });
+        const std::size_t newIndexCapacity = std::max({
+            geometry_arena::defaults::initialIndexCount, indexCapacity * 2, indexRanges.getUsed() + extraIndexCount * 2 });
+
+        growBuffer(vertexBufferID, vertexCapacity * sizeof(PackedVertex), newVertexCapacity * sizeof(PackedVertex));
+        growBuffer(indexBufferID, indexCapacity * sizeof(GLuint), newIndexCapacity * sizeof(GLuint));
+        vertexRanges.grow(newVertexCapacity);
+        indexRanges.grow(newIndexCapacity);
+
+        if (growthFence != nullptr) {
+            glDeleteSync(growthFence);
+        }
+        growthFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence must reach the GPU, the main context is going to wait for it.
+        glFlush();
+        generation++;
+
+        std::println("Geometry arena grown to {} vertices and {} indices", newVertexCapacity, newIndexCapacity);
+    }
+
+    /// Creates a buffer of `newSize` bytes with the contents of the old one, and deletes the old one.
+    /// The VAO still reading the old buffer keeps it alive until it's linked to the new one.
+    static auto growBuffer(GLuint& bufferID, const std::size_t oldSize, const std::size_t newSize) -> void {
+        GLuint newBufferID = 0;
+        glGenBuffers(1, &newBufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBufferID);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(newSize), nullptr, GL_STATIC_DRAW);
+        if (bufferID != 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, bufferID);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(oldSize));
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &bufferID);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        bufferID = newBufferID;
+    }
+};
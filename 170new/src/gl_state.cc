@@ -0,0 +1,310 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module gl_state;
+
+export namespace gl_state {
+    /// Depth testing and writing. The defaults are OpenGL's initial state.
+    struct DepthState {
+        bool testEnabled = false;
+        GLenum function = GL_LESS;
+        bool writeEnabled = true;
+
+        auto operator==(const DepthState& other) const -> bool = default;
+    };
+
+    /// Stencil testing, writing and what happens to the stencil value.
+    /// The defaults are OpenGL's initial state (for the 8-bit stencil buffers).
+    struct StencilState {
+        bool testEnabled = false;
+        GLenum function = GL_ALWAYS;
+        GLint reference = 0;
+        GLuint readMask = 0xFF;
+        GLuint writeMask = 0xFF;
+        GLenum stencilFailOperation = GL_KEEP;
+        GLenum depthFailOperation = GL_KEEP;
+        GLenum passOperation = GL_KEEP;
+
+        auto operator==(const StencilState& other) const -> bool = default;
+    };
+
+    /// Blending of the fragments into the color buffer. The defaults are OpenGL's initial state.
+    struct BlendState {
+        bool enabled = false;
+        GLenum sourceFactor = GL_ONE;
+        GLenum destinationFactor = GL_ZERO;
+
+        auto operator==(const BlendState& other) const -> bool = default;
+    };
+
+    /// How many calls `GLState` passed on to OpenGL and how many it skipped
+    /// because they wouldn't change anything.
+    struct Stats {
+        std::size_t issuedCalls = 0;
+        std::size_t skippedCalls = 0;
+    };
+}
+
+export namespace gl_state::defaults {
+    /// Texture units whose bindings are tracked, binds to the units past them always go through.
+    constexpr GLuint trackedTextureUnitCount = 32;
+}
+
+namespace gl_state::detail {
+    /// The cached binding is not known (the object was deleted), the next bind always goes through.
+    constexpr GLuint unknown = std::numeric_limits<GLuint>::max();
+
+    /// Texture targets whose bindings are tracked, each unit has a binding for every one of them.
+    constexpr std::array<GLenum, 5> trackedTextureTargets = {
+        GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY,
+    };
+
+    /// Bumped by every texture deletion, on any thread. Textures are shared between the contexts
+    /// and a deleted texture's ID can come back from `glGenTextures`, so every context's cached
+    /// texture bindings are dropped after one.
+    std::atomic<std::uint64_t> textureDeletionCount = 0;
+}
+
+/// Fixed set of depth, stencil and blend state a pass draws with. Applied by
+/// `GLState::apply`, which only makes the calls that differ from the current state.
+/// Meant to be `constexpr`, like the ones in `pipeline_state`.
+export struct PipelineState {
+    gl_state::DepthState depth;
+    gl_state::StencilState stencil;
+    gl_state::BlendState blend;
+
+    auto operator==(const PipelineState& other) const -> bool = default;
+};
+
+export namespace pipeline_state {
+    /// Alpha blending with depth testing, what most of the scene is drawn with.
+    constexpr PipelineState standard {
+        .depth = { .testEnabled = true },
+        .blend = { .enabled = true, .sourceFactor = GL_SRC_ALPHA, .destinationFactor = GL_ONE_MINUS_SRC_ALPHA },
+    };
+
+    /// Skybox drawn after the opaque objects. It's at the far plane (depth 1.0),
+    /// so it passes only where nothing was drawn.
+    constexpr PipelineState skyboxDrawnLast {
+        .depth = { .testEnabled = true, .function = GL_LEQUAL },
+        .blend = standard.blend,
+    };
+
+    /// Skybox drawn before everything else, it mustn't hide what's drawn after it.
+    constexpr PipelineState skyboxDrawnFirst {
+        .depth = { .testEnabled = true, .writeEnabled = false },
+        .blend = standard.blend,
+    };
+
+    /// Object that gets an outline, it marks the pixels it covers with 1 in the stencil buffer.
+    constexpr PipelineState stencilOutlined {
+        .depth = standard.depth,
+        .stencil = { .testEnabled = true, .function = GL_ALWAYS, .reference = 1, .passOperation = GL_REPLACE },
+        .blend = standard.blend,
+    };
+
+    /// The outline, a scaled up copy of the object drawn only around the pixels it marked.
+    /// On top of everything, and it leaves the stencil buffer as it is.
+    constexpr PipelineState stencilOutline {
+        .depth = { .testEnabled = false },
+        .stencil = { .testEnabled = true, .function = GL_NOTEQUAL, .reference = 1, .writeMask = 0x00 },
+        .blend = standard.blend,
+    };
+}
+
+/// Shadow copy of the OpenGL state the renderer changes: the program, the VAO, the framebuffer,
+/// the textures bound to the units and the depth, stencil and blend state.
+/// A bind of what's already bound is skipped, so the wrappers' `bind` functions are cheap
+/// to call before every use and nothing needs unbinding after a draw.
+///
+/// Everything that binds these must go through here, or the copy goes stale.
+/// One instance per thread, because each thread has its own current context (the main one and the upload one).
+export class GLState {
+private:
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLuint framebuffer = 0;
+    GLuint activeTextureUnit = 0;
+    // [unit][index of the target in `trackedTextureTargets`]
+    std::array<std::array<GLuint, gl_state::detail::trackedTextureTargets.size()>,
+               gl_state::defaults::trackedTextureUnitCount> textures{};
+    std::uint64_t seenTextureDeletionCount = 0;
+    PipelineState pipeline;
+    gl_state::Stats stats;
+
+    static thread_local GLState* singletonInstance;
+
+    GLState() = default;
+public:
+    GLState(const GLState& other) = delete;
+    GLState& operator=(const GLState& other) = delete;
+
+    /// Returns the instance of the calling thread. It starts out with OpenGL's initial
+    /// state, so the thread's context must not have been changed by anything else before.
+    static auto getInstance() -> GLState& {
+        if (singletonInstance == nullptr) {
+            singletonInstance = new GLState();
+        }
+        return *singletonInstance;
+    }
+
+    /// Makes the `programID` current, 0 for none.
+    auto useProgram(const GLuint programID) -> void {
+        if (!track(program, programID)) {
+            return;
+        }
+        glUseProgram(programID);
+    }
+
+    /// Binds the VAO, 0 for none.
+    auto bindVertexArray(const GLuint vertexArrayID) -> void {
+        if (!track(vertexArray, vertexArrayID)) {
+            return;
+        }
+        glBindVertexArray(vertexArrayID);
+    }
+
+    /// Binds the framebuffer for both drawing and reading, 0 for the default one.
+    auto bindFramebuffer(const GLuint framebufferID) -> void {
+        if (!track(framebuffer, framebufferID)) {
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+    }
+
+    /// Binds the `textureID` to the `target` of the texture unit `unit` (a regular number, not GL_TEXTURE0 + n).
+    /// A bind that isn't skipped leaves the unit active, so the texture calls that follow
+    /// the bind of a new texture (its upload) work on it.
+    auto bindTexture(const GLuint unit, const GLenum target, const GLuint textureID) -> void {
+        const std::uint64_t deletionCount = gl_state::detail::textureDeletionCount.load(std::memory_order_acquire);
+        if (deletionCount != seenTextureDeletionCount) {
+            seenTextureDeletionCount = deletionCount;
+            for (auto& unitTextures : textures) {
+                unitTextures.fill(gl_state::detail::unknown);
+            }
+        }
+
+        const auto targetPosition = std::ranges::find(gl_state::detail::trackedTextureTargets, target);
+        const bool isTracked = unit < textures.size() && targetPosition != gl_state::detail::trackedTextureTargets.end();
+        if (isTracked) {
+            const auto targetIndex = std::distance(gl_state::detail::trackedTextureTargets.begin(), targetPosition);
+            if (!track(textures[unit][targetIndex], textureID)) {
+                return;
+            }
+        } else {
+            stats.issuedCalls++;
+        }
+
+        if (track(activeTextureUnit, unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        glBindTexture(target, textureID);
+    }
+
+    /// Changes the depth, stencil and blend state to the `state`, only the parts that differ.
+    auto apply(const PipelineState& state) -> void {
+        setCapability(GL_DEPTH_TEST, pipeline.depth.testEnabled, state.depth.testEnabled);
+        if (track(pipeline.depth.function, state.depth.function)) {
+            glDepthFunc(state.depth.function);
+        }
+        if (track(pipeline.depth.writeEnabled, state.depth.writeEnabled)) {
+            glDepthMask(state.depth.writeEnabled ? GL_TRUE : GL_FALSE);
+        }
+
+        // `|` instead of `||`, every one of the values has to be stored.
+        const gl_state::StencilState& stencil = state.stencil;
+        setCapability(GL_STENCIL_TEST, pipeline.stencil.testEnabled, stencil.testEnabled);
+        if (track(pipeline.stencil.function, stencil.function)
+        | track(pipeline.stencil.reference, stencil.reference)
+        | track(pipeline.stencil.readMask, stencil.readMask)) {
+            glStencilFunc(stencil.function, stencil.reference, stencil.readMask);
+        }
+        if (track(pipeline.stencil.writeMask, stencil.writeMask)) {
+            glStencilMask(stencil.writeMask);
+        }
+        if (track(pipeline.stencil.stencilFailOperation, stencil.stencilFailOperation)
+        | track(pipeline.stencil.depthFailOperation, stencil.depthFailOperation)
+        | track(pipeline.stencil.passOperation, stencil.passOperation)) {
+            glStencilOp(stencil.stencilFailOperation, stencil.depthFailOperation, stencil.passOperation);
+        }
+
+        setCapability(GL_BLEND, pipeline.blend.enabled, state.blend.enabled);
+        if (track(pipeline.blend.sourceFactor, state.blend.sourceFactor)
+        | track(pipeline.blend.destinationFactor, state.blend.destinationFactor)) {
+            glBlendFunc(state.blend.sourceFactor, state.blend.destinationFactor);
+        }
+    }
+
+    /// The depth, stencil and blend state that was applied last.
+    [[nodiscard]] auto getPipelineState() const -> const PipelineState& {
+        return pipeline;
+    }
+
+    /// To be called before deleting the program, its ID can be handed out again.
+    auto forgetProgram(const GLuint programID) -> void {
+        forget(program, programID);
+    }
+
+    /// To be called before deleting the VAO, its ID can be handed out again.
+    auto forgetVertexArray(const GLuint vertexArrayID) -> void {
+        forget(vertexArray, vertexArrayID);
+    }
+
+    /// To be called before deleting the framebuffer, its ID can be handed out again.
+    auto forgetFramebuffer(const GLuint framebufferID) -> void {
+        forget(framebuffer, framebufferID);
+    }
+
+    /// To be called before deleting a texture, on whichever thread. Every thread's
+    /// cached texture bindings are dropped, the texture could be bound in any context.
+    static auto forgetTextures() -> void {
+        gl_state::detail::textureDeletionCount.fetch_add(1, std::memory_order_release);
+    }
+
+    [[nodiscard]] auto getStats() const -> const gl_state::Stats& {
+        return stats;
+    }
+
+    auto resetStats() -> void {
+        stats = {};
+    }
+
+private:
+    /// Stores the `value` into the `cached` one. Returns whether it changed,
+    /// so whether the OpenGL call that sets it has to be made.
+    template<typename T>
+    auto track(T& cached, const T& value) -> bool {
+        if (cached == value) {
+            stats.skippedCalls++;
+            return false;
+        }
+        cached = value;
+        stats.issuedCalls++;
+        return true;
+    }
+
+    auto setCapability(const GLenum capability, bool& cached, const bool enabled) -> void {
+        if (!track(cached, enabled)) {
+            return;
+        }
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+    }
+
+    auto forget(GLuint& cached, const GLuint objectID) const -> void {
+        if (cached == objectID) {
+            cached = gl_state::detail::unknown;
+        }
+    }
+};
+
+// Initialization of the singleton instances to null pointers.
+thread_local GLState* GLState::singletonInstance = nullptr;
@@ -8,40 +8,50 @@ module;
 
 export module index_buffer;
 
+import gl_state;
+import vertex_buffer.supported_types;
+
+/// Index types OpenGL can draw with that are worth using (GL_UNSIGNED_BYTE isn't, it's slow on most hardware).
+export template<typename Index>
+concept IsSupportedIndexType = std::is_same_v<Index, GLushort> || std::is_same_v<Index, GLuint>;
+
 export class IndexBuffer {
 private:
     GLuint elementArrayBufferID = 0;
     GLsizei elementCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, what the draw calls need.
 public:
-    /// Given `indices` and its size in bytes, it will construct a new IBO and copy the data to its data store.
+    /// Given `indices` and their count, it will construct a new IBO and copy the data to its data store.
+    /// The indices are stored as 16-bit if every one of them fits, halving the buffer's size.
     explicit IndexBuffer(const GLuint* indices, const std::uint32_t indicesCount)
-    : elementCount(static_cast<GLsizei>(indicesCount)) {
-        // Generates new buffer object ID and set it to be GL_ELEMENT_ARRAY_BUFFER.
-        glGenBuffers(1, &elementArrayBufferID);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBufferID);
-        // Creates new data store for the ARRAY_BUFFER object and copies the data.
-        // If data is null the data store is created but not initialised.
-        // Any pre-existing data in the buffer object's data store is deleted.
-        const GLsizei indicesSizeInBytes = static_cast<GLsizei>(indicesCount) * sizeof(GLuint);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSizeInBytes, indices, GL_DYNAMIC_DRAW);
-        // Unbind it so no accidental overwrites can happen.
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    }
+    : IndexBuffer(std::span(indices, indicesCount), GL_DYNAMIC_DRAW) {}
 
     explicit IndexBuffer(const std::vector<GLuint>& indices)
+    : IndexBuffer(std::span(indices), GL_STATIC_DRAW) {}
+
+    /// 32-bit `indices` are narrowed to 16-bit when all of them fit, 16-bit ones are stored as they are.
+    template<typename Index> requires IsSupportedIndexType<Index>
+    explicit IndexBuffer(const std::span<const Index> indices, const GLenum usage = GL_STATIC_DRAW)
     : elementCount(static_cast<GLsizei>(indices.size())) {
-        glGenBuffers(1, &elementArrayBufferID);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBufferID);
-        const GLsizei indicesSizeInBytes = static_cast<GLsizei>(indices.size()) * sizeof(GLuint);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSizeInBytes, indices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        if constexpr (std::is_same_v<Index, GLuint>) {
+            // Meshes with less than 65536 vertices fit into 16 bits.
+            const bool fitsShort = std::ranges::all_of(indices, [](const GLuint index) {
+                return index <= std::numeric_limits<GLushort>::max();
+            });
+            if (fitsShort) {
+                const std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+                upload(std::span<const GLushort>(shortIndices), usage);
+                return;
+            }
+        }
+        upload(indices, usage);
     }
 
-    /// Deconstructor that doesn't delete the 
+    /// Deconstructor that doesn't delete the
     /// the element array buffer because that
     /// a resource of OpenGL.
     ~IndexBuffer() = default;
-    
+
     /// Deletes the element array buffer from OpenGL.
     auto deleteResource() -> void {
         glDeleteBuffers(1, &elementArrayBufferID);
@@ -52,6 +62,15 @@ public:
         return elementCount;
     }
 
+    /// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, to be passed into the `glDraw*Elements*` calls.
+    [[nodiscard]] auto getIndexType() const -> GLenum {
+        return indexType;
+    }
+
+    [[nodiscard]] auto getSizeInBytes() const -> std::size_t {
+        return static_cast<std::size_t>(elementCount) * getSizeOfGLTypeFromMacroCode(indexType);
+    }
+
     auto bind() const -> void {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBufferID);
     }
@@ -59,4 +78,21 @@ public:
     static auto unbind() -> void {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
+
+private:
+    template<typename Index>
+    auto upload(const std::span<const Index> indices, const GLenum usage) -> void {
+        indexType = static_cast<GLenum>(getGLTypeMacroCode<Index>());
+        // The element array buffer binding belongs to the bound VAO, whichever draw left it bound.
+        GLState::getInstance().bindVertexArray(0);
+        // Generates new buffer object ID and set it to be GL_ELEMENT_ARRAY_BUFFER.
+        glGenBuffers(1, &elementArrayBufferID);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementArrayBufferID);
+        // Creates new data store for the ELEMENT_ARRAY_BUFFER object and copies the data.
+        // If data is null the data store is created but not initialised.
+        // Any pre-existing data in the buffer object's data store is deleted.
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size_bytes()), indices.data(), usage);
+        // Unbind it so no accidental overwrites can happen.
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
 };
@@ -0,0 +1,364 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module material;
+
+import gl_state;
+import texture;
+import texture.registry;
+import dynamic_buffer;
+
+export namespace material {
+    /// How the shaders get to the materials' textures.
+    enum class Backend {
+        TextureArrays, // Copied into GL_TEXTURE_2D_ARRAYs, one per size and format, bound once per draw.
+        Bindless, // Sampled through ARB_bindless_texture handles, nothing gets bound.
+    };
+
+    /// Bindless texture handles if the driver has them, texture arrays otherwise.
+    /// The shaders make the same choice, see shaders/std/material_table.glsl.
+    [[nodiscard]] auto getBackend() -> Backend {
+        return GLEW_ARB_bindless_texture ? Backend::Bindless : Backend::TextureArrays;
+    }
+
+    auto BackendToString(const Backend backend) -> std::string {
+        switch (backend) {
+            case Backend::TextureArrays: { return "texture arrays"; } break;
+            case Backend::Bindless: { return "bindless textures"; } break;
+            default: throw std::runtime_error("BackendToString: unknown");
+        }
+    }
+
+    /// One material as the shaders read it (`MaterialData` in shaders/std/material_table.glsl, std430 layout).
+    /// A map is either a bindless texture handle, or the texture array's index
+    /// in the low 32 bits and the layer in the high ones.
+    struct MaterialData {
+        std::uint64_t diffuseMap;
+        std::uint64_t specularMap;
+    };
+    static_assert(sizeof(MaterialData) == 16, "MaterialData must match the std430 layout of the shader's struct.");
+}
+
+export namespace material::defaults {
+    /// Shader storage buffer binding of the materials (`layout(binding = ...)` in shaders/std/material_table.glsl).
+    constexpr GLuint materialBinding = 1;
+    /// Length of the shaders' `U_MaterialTextureArrays`, they are bound to the units that follow the first one.
+    constexpr std::size_t maxTextureArrays = 16;
+    constexpr GLuint firstTextureUnit = 0;
+    /// RGBA colors of the maps a material doesn't have: lit as it is, with no specular highlights.
+    constexpr std::array<std::uint8_t, 4> missingDiffuseColor = { 255, 255, 255, 255 };
+    constexpr std::array<std::uint8_t, 4> missingSpecularColor = { 0, 0, 0, 255 };
+}
+
+/// The maps of a mesh the model shader samples. Holds one registry reference per texture.
+export struct Material {
+    std::optional<Texture> diffuseMap;
+    std::optional<Texture> specularMap;
+
+    /// Takes over the registry references of a mesh's `textures`. Keeps the first
+    /// diffuse and the first specular map and releases the rest, nothing samples them.
+    static auto fromMeshTextures(std::vector<Texture>&& textures) -> Material {
+        Material material;
+        for (const Texture& meshTexture : textures) {
+            std::optional<Texture>& map = meshTexture.getType() == texture::Type::DiffuseMap
+                ? material.diffuseMap
+                : material.specularMap;
+            if (map.has_value()) {
+                TextureRegistry::getInstance().release(meshTexture);
+            } else {
+                map = meshTexture;
+            }
+        }
+        textures.clear();
+        return material;
+    }
+};
+
+namespace material::detail {
+    /// The textures that share a texture array have the same size, mip levels and internal format.
+    struct ArrayFormat {
+        GLsizei width;
+        GLsizei height;
+        GLsizei levels;
+        GLenum internalFormat;
+
+        auto operator<=>(const ArrayFormat& other) const = default;
+    };
+
+    /// Reads the format of the 2D texture back from OpenGL, the mip levels are capped by its max level.
+    auto getArrayFormat(const GLuint textureID) -> ArrayFormat {
+        GLint width = 0;
+        GLint height = 0;
+        GLint internalFormat = 0;
+        GLint maxLevel = 0;
+        glGetTextureLevelParameteriv(textureID, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(textureID, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTextureLevelParameteriv(textureID, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTextureParameteriv(textureID, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+        const auto fullChainLevels = static_cast<GLint>(std::bit_width(static_cast<std::uint32_t>(std::max(width, height))));
+        return ArrayFormat {
+            .width = width,
+            .height = height,
+            .levels = std::min(maxLevel + 1, fullChainLevels),
+            .internalFormat = static_cast<GLenum>(internalFormat),
+        };
+    }
+
+    /// 1x1 texture of the `color`, stands in for a map a material doesn't have.
+    auto createSolidTexture(const std::array<std::uint8_t, 4>& color) -> GLuint {
+        GLuint textureID = 0;
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+        glTextureStorage2D(textureID, 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(textureID, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, color.data());
+        return textureID;
+    }
+
+    /// How many tables made each bindless handle resident. The models share textures (through
+    /// the registry), so they share their handles, and a handle must not be made resident twice.
+    /// Main thread only, the handles are resident in its context.
+    std::unordered_map<GLuint64, std::uint32_t> residencyCounts;
+
+    auto makeResident(const GLuint64 handle) -> void {
+        if (residencyCounts[handle]++ == 0) {
+            glMakeTextureHandleResidentARB(handle);
+        }
+    }
+
+    auto makeNonResident(const GLuint64 handle) -> void {
+        const auto it = residencyCounts.find(handle);
+        if (it == residencyCounts.end()) {
+            return;
+        }
+        if (--it->second == 0) {
+            glMakeTextureHandleNonResidentARB(handle);
+            residencyCounts.erase(it);
+        }
+    }
+}
+
+/// The materials of a model, deduplicated. Its meshes are drawn with one multi draw no matter
+/// how many materials they use: each draw's data has the index of its material, and the shader
+/// samples the material's maps through the table (shaders/std/material_table.glsl). Binding
+/// the table (once per draw of the model) is the only texture binding there is.
+///
+/// Materials are added, then the table is built once on the main thread. Non-owning like
+/// the other wrappers, `deleteResource` frees it and releases its textures to the registry.
+export class MaterialTable {
+private:
+    material::Backend backend = material::Backend::TextureArrays;
+    // Every unique texture of the materials, the table holds one registry reference to each.
+    // Released after they are copied into the texture arrays.
+    std::vector<Texture> textures;
+    // Texture IDs of every material's diffuse and specular map, 0 for a missing one.
+    std::vector<std::pair<GLuint, GLuint>> materials;
+    std::map<std::pair<GLuint, GLuint>, std::uint32_t> materialIndices;
+    // Created by `build`.
+    std::optional<DynamicBuffer> materialBuffer;
+    std::vector<GLuint> textureArrays;
+    std::vector<GLuint64> residentHandles;
+    std::vector<GLuint> fallbackTextures;
+public:
+    /// Adds the `material` and returns its index, the same index for the same maps.
+    /// The table takes over the material's texture references.
+    auto add(Material&& material) -> std::uint32_t {
+        const auto key = std::pair(
+            material.diffuseMap.has_value() ? material.diffuseMap->getID() : 0,
+            material.specularMap.has_value() ? material.specularMap->getID() : 0);
+
+        for (const std::optional<Texture>& map : { material.diffuseMap, material.specularMap }) {
+            if (!map.has_value()) {
+                continue;
+            }
+            if (std::ranges::find(textures, map->getID(), &Texture::getID) != textures.end()) {
+                TextureRegistry::getInstance().release(*map);
+            } else {
+                textures.push_back(*map);
+            }
+        }
+
+        const auto [position, inserted] = materialIndices.try_emplace(key, static_cast<std::uint32_t>(materials.size()));
+        if (inserted) {
+            materials.push_back(key);
+        }
+        return position->second;
+    }
+
+    /// Puts the added materials on the GPU with the backend the driver supports.
+    /// Must run on the main thread. Throws if the texture arrays backend can't sample every texture,
+    /// `deleteResource` frees what was created before that.
+    auto build() -> void {
+        backend = material::getBackend();
+        if (materials.empty()) {
+            return;
+        }
+
+        const bool isMapMissing = std::ranges::any_of(materials, [](const auto& maps) {
+            return maps.first == 0 || maps.second == 0;
+        });
+        if (isMapMissing) {
+            fallbackTextures = {
+                material::detail::createSolidTexture(material::defaults::missingDiffuseColor),
+                material::detail::createSolidTexture(material::defaults::missingSpecularColor),
+            };
+        }
+        const GLuint missingDiffuseMapID = isMapMissing ? fallbackTextures[0] : 0;
+        const GLuint missingSpecularMapID = isMapMissing ? fallbackTextures[1] : 0;
+
+        std::vector<GLuint> textureIDs;
+        for (const Texture& texture : textures) {
+            textureIDs.push_back(texture.getID());
+        }
+        textureIDs.insert(textureIDs.end(), fallbackTextures.begin(), fallbackTextures.end());
+
+        // Where the shaders find each texture, see `material::MaterialData`.
+        const std::unordered_map<GLuint, std::uint64_t> mapLocations = backend == material::Backend::Bindless
+            ? makeHandlesResident(textureIDs)
+            : copyIntoTextureArrays(textureIDs);
+
+        if (backend == material::Backend::TextureArrays) {
+            // The arrays have copies of everything.
+            releaseTextures();
+            deleteFallbackTextures();
+        }
+
+        std::vector<material::MaterialData> materialData;
+        materialData.reserve(materials.size());
+        for (const auto& [diffuseMapID, specularMapID] : materials) {
+            materialData.push_back(material::MaterialData {
+                .diffuseMap = mapLocations.at(diffuseMapID != 0 ? diffuseMapID : missingDiffuseMapID),
+                .specularMap = mapLocations.at(specularMapID != 0 ? specularMapID : missingSpecularMapID),
+            });
+        }
+        materialBuffer.emplace(GL_SHADER_STORAGE_BUFFER);
+        materialBuffer->upload(std::span<const material::MaterialData>(materialData));
+        materialBuffer->unbind();
+    }
+
+    /// Binds the materials and their texture arrays for the next draw. The binds of what's
+    /// already bound (drawing the same model again) are skipped by `GLState`.
+    auto bind() const -> void {
+        if (!materialBuffer.has_value()) {
+            return;
+        }
+        materialBuffer->bindBase(material::defaults::materialBinding);
+        for (std::size_t i = 0; i < textureArrays.size(); i++) {
+            GLState::getInstance().bindTexture(material::defaults::firstTextureUnit + static_cast<GLuint>(i),
+                GL_TEXTURE_2D_ARRAY, textureArrays[i]);
+        }
+    }
+
+    auto deleteResource() -> void {
+        for (const GLuint64 handle : residentHandles) {
+            material::detail::makeNonResident(handle);
+        }
+        residentHandles.clear();
+        releaseTextures();
+        deleteFallbackTextures();
+        if (!textureArrays.empty()) {
+            GLState::forgetTextures();
+            glDeleteTextures(static_cast<GLsizei>(textureArrays.size()), textureArrays.data());
+            textureArrays.clear();
+        }
+        if (materialBuffer.has_value()) {
+            materialBuffer->deleteResource();
+            materialBuffer.reset();
+        }
+        materials.clear();
+        materialIndices.clear();
+    }
+
+    [[nodiscard]] auto getBackend() const -> material::Backend {
+        return backend;
+    }
+
+    /// Whether any of the materials has a specular map (the others get a black one).
+    [[nodiscard]] auto hasSpecularMaps() const -> bool {
+        return std::ranges::any_of(materials, [](const auto& maps) { return maps.second != 0; });
+    }
+
+    [[nodiscard]] auto getMaterialCount() const -> std::size_t {
+        return materials.size();
+    }
+
+    [[nodiscard]] auto getTextureArrayCount() const -> std::size_t {
+        return textureArrays.size();
+    }
+
+private:
+    /// Makes a bindless handle of every texture resident. Returns the handles by the texture IDs.
+    auto makeHandlesResident(const std::span<const GLuint> textureIDs) -> std::unordered_map<GLuint, std::uint64_t> {
+        std::unordered_map<GLuint, std::uint64_t> handles;
+        for (const GLuint textureID : textureIDs) {
+            // The texture can't be changed after this (its sampling parameters neither).
+            const GLuint64 handle = glGetTextureHandleARB(textureID);
+            material::detail::makeResident(handle);
+            residentHandles.push_back(handle);
+            handles[textureID] = handle;
+        }
+        return handles;
+    }
+
+    /// Copies the textures, every mip level, into one texture array per size and format.
+    /// Returns each texture's array and layer by the texture IDs. Throws if more
+    /// arrays are needed than the shaders can sample (a streamed model then fails to load and draws nothing).
+    auto copyIntoTextureArrays(const std::span<const GLuint> textureIDs) -> std::unordered_map<GLuint, std::uint64_t> {
+        std::map<material::detail::ArrayFormat, std::vector<GLuint>> texturesByFormat;
+        for (const GLuint textureID : textureIDs) {
+            texturesByFormat[material::detail::getArrayFormat(textureID)].push_back(textureID);
+        }
+        if (texturesByFormat.size() > material::defaults::maxTextureArrays) {
+            throw std::runtime_error(std::format("The materials' textures have {} different sizes and formats, "
+                "the shaders can sample at most {} texture arrays.",
+                texturesByFormat.size(), material::defaults::maxTextureArrays));
+        }
+
+        std::unordered_map<GLuint, std::uint64_t> locations;
+        for (const auto& [format, layerTextureIDs] : texturesByFormat) {
+            const auto arrayIndex = static_cast<std::uint64_t>(textureArrays.size());
+            GLuint arrayID = 0;
+            glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &arrayID);
+            glTextureStorage3D(arrayID, format.levels, format.internalFormat,
+                format.width, format.height, static_cast<GLsizei>(layerTextureIDs.size()));
+            // Sampled the same way as the textures were.
+            glTextureParameteri(arrayID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTextureParameteri(arrayID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTextureParameteri(arrayID, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTextureParameteri(arrayID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            for (std::size_t layer = 0; layer < layerTextureIDs.size(); layer++) {
+                for (GLsizei level = 0; level < format.levels; level++) {
+                    // Copied on the GPU, compressed blocks as they are.
+                    glCopyImageSubData(
+                        layerTextureIDs[layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                        arrayID, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+                        std::max(format.width >> level, 1), std::max(format.height >> level, 1), 1);
+                }
+                locations[layerTextureIDs[layer]] = static_cast<std::uint64_t>(layer) << 32 | arrayIndex;
+            }
+            textureArrays.push_back(arrayID);
+        }
+        return locations;
+    }
+
+    auto releaseTextures() -> void {
+        for (const Texture& texture : textures) {
+            TextureRegistry::getInstance().release(texture);
+        }
+        textures.clear();
+    }
+
+    auto deleteFallbackTextures() -> void {
+        if (fallbackTextures.empty()) {
+            return;
+        }
+        GLState::forgetTextures();
+        glDeleteTextures(static_cast<GLsizei>(fallbackTextures.size()), fallbackTextures.data());
+        fallbackTextures.clear();
+    }
+};
@@ -12,11 +12,97 @@ export module mesh;
 import vertex_array;
 import vertex_buffer;
 import vertex_buffer.vertex_struct;
+import vertex_buffer.packed_vertex;
 import index_buffer;
+import aabb;
 import texture;
+import texture.registry;
 import shader_program;
 import camera;
 import transformation;
+import model.mesh_cache;
+import model.mesh_simplifier;
+import dynamic_buffer;
+
+using namespace uniform::literals;
+
+export namespace mesh::defaults {
+    /// First attribute location of the per instance model matrix (`layout(location = 8) in mat4`,
+    /// it takes up four locations). Past the attributes of every vertex layout.
+    constexpr GLuint instanceTransformLocation = 8;
+}
+
+namespace mesh::detail {
+    /// The samplers of `Material` (shaders/std/material.glsl), resolved at compile time
+    /// instead of building the names' strings for every texture of every draw.
+    constexpr std::array diffuseMapUniforms = {
+        "U_Material.DiffuseMap0"_uniform, "U_Material.DiffuseMap1"_uniform, "U_Material.DiffuseMap2"_uniform,
+    };
+    constexpr std::array specularMapUniforms = {
+        "U_Material.SpecularMap0"_uniform, "U_Material.SpecularMap1"_uniform, "U_Material.SpecularMap2"_uniform,
+    };
+}
+
+export namespace mesh {
+    /// Layout of the per instance attributes of the instanced draws, one model matrix per instance.
+    auto getInstanceLayout() -> VertexBufferLayout {
+        VertexBufferLayout layout;
+        layout.pushAttribute<glm::mat4>(1, "instance model matrix");
+        return layout;
+    }
+
+    /// Binds the `textures` to consecutive texture unit slots and points the shader's
+    /// `U_Material.<type><number>` samplers at them (e.g. the second diffuse map is `U_Material.DiffuseMap1`).
+    /// The maps past the ones `Material` has (see `mesh::detail::diffuseMapUniforms`) are bound but unused.
+    auto bindTextures(ShaderProgram& shader, std::span<Texture> textures) -> void {
+        std::size_t diffuseNumber = 0;
+        std::size_t specularNumber = 0;
+
+        for (std::size_t i = 0; i < textures.size(); i++) {
+            const auto slot = i;
+
+            const bool isDiffuseMap = [&] {
+                switch (textures[i].getType()) {
+                    case texture::Type::DiffuseMap: { return true; }
+                    case texture::Type::SpecularMap: { return false; }
+                    default: throw std::runtime_error("Unknown texture type");
+                }
+            }();
+            const std::size_t number = isDiffuseMap ? diffuseNumber++ : specularNumber++;
+            const auto& uniformNames = isDiffuseMap ? detail::diffuseMapUniforms : detail::specularMapUniforms;
+
+            if (number < uniformNames.size()) {
+                Texture::setSamplerInShader(shader, uniformNames[number], static_cast<GLint>(slot));
+            }
+
+            // textures[i].bindToLast();
+            textures[i].bindToSlot(slot);
+        }
+    }
+
+    /// Picks the coarsest of the `lods` whose error covers at most `maxPixelError` pixels
+    /// on the screen, for a mesh with `positionBounds` drawn with `modelMat`. The error is
+    /// projected at the point of the bounds closest to the camera (roughly, the bounds are treated as a sphere).
+    auto selectLevelOfDetail(
+        const Camera& camera,
+        const glm::mat4& modelMat,
+        const AABB& positionBounds,
+        const std::span<const model::cache::LevelOfDetail> lods,
+        const float maxPixelError = model::simplifier::defaults::maxPixelError
+    ) -> std::size_t {
+        if (lods.size() <= 1) {
+            return 0;
+        }
+
+        const AABB worldBounds = positionBounds.transformed(modelMat);
+        const float distance = glm::length(worldBounds.getCenter() - camera.getPosition()) - glm::length(worldBounds.getExtent());
+        // The errors are in the vertices' units, the largest scale of the transformation is the worst case.
+        const float scale = std::max({
+            glm::length(glm::vec3(modelMat[0])), glm::length(glm::vec3(modelMat[1])), glm::length(glm::vec3(modelMat[2])) });
+
+        return model::simplifier::selectLevelOfDetail(lods, camera.getPixelsPerUnit(distance) * scale, maxPixelError);
+    }
+}
 
 /// Mesh represent one drawable object.
 /// It consists of a VAO and textures.
@@ -24,11 +110,17 @@ import transformation;
 /// in some camera's view coordinates.
 export class Mesh {
 private:
-    std::vector<Vertex> vertices; // This is not needed.
-    std::vector<GLuint> indices; // This is not needed.
     std::vector<Texture> textures;
     VertexArray vertexArray;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
     glm::mat4 localTransformation;
+    // Set when the vertices are `PackedVertex`es, the shader needs them to decode the positions.
+    std::optional<AABB> positionBounds;
+    // Index ranges of the levels of detail, all in the one index buffer. Empty if the mesh has just the one.
+    std::vector<model::cache::LevelOfDetail> lods;
+    // Model matrices of the instances, created by the first instanced draw.
+    std::optional<DynamicBuffer> instanceBuffer;
 public:
     /// The constructor needs the vector of `vertices`, `indices` and `textures`.
     /// But the only vector it actually needs to store is the `textures`
@@ -37,15 +129,57 @@ public:
         const std::vector<GLuint>& indices,
         const std::vector<Texture>& textures,
         const glm::mat4& localTransform = glm::mat4(1.0f)
-    ) : vertices(vertices)
-    , indices(indices)
-    , textures(textures)
+    ) : Mesh(std::span(vertices), std::span(indices), textures, localTransform) {}
+
+    /// Creates the mesh straight from contiguous vertex and index data
+    /// (e.g. memory mapped cooked model). The data is only read during construction.
+    explicit Mesh(
+        const std::span<const Vertex> vertices,
+        const std::span<const GLuint> indices,
+        const std::vector<Texture>& textures,
+        const glm::mat4& localTransform = glm::mat4(1.0f)
+    ) : textures(textures)
+    , indexCount(static_cast<GLsizei>(indices.size()))
     , localTransformation(localTransform) {
-        VertexBuffer vbo(vertices);
-        IndexBuffer ibo(indices);
+        VertexBuffer vbo(vertices.data(), static_cast<std::uint32_t>(vertices.size_bytes()));
+        IndexBuffer ibo(indices.data(), static_cast<std::uint32_t>(indices.size()));
+        indexType = ibo.getIndexType();
         vertexArray.linkVertexBufferAndIndexBuffer(vbo, Vertex::getLayout(), ibo);
     }
 
+    /// Creates the mesh out of already uploaded buffers (e.g. uploaded on the shared
+    /// upload context). Only the VAO is created here, VAOs can't be shared between contexts.
+    explicit Mesh(
+        const VertexBuffer& vertexBuffer,
+        const IndexBuffer& indexBuffer,
+        const std::vector<Texture>& textures,
+        const glm::mat4& localTransform = glm::mat4(1.0f)
+    ) : textures(textures)
+    , indexCount(indexBuffer.getElementCount())
+    , indexType(indexBuffer.getIndexType())
+    , localTransformation(localTransform) {
+        vertexArray.linkVertexBufferAndIndexBuffer(vertexBuffer, Vertex::getLayout(), indexBuffer);
+    }
+
+    /// Creates the mesh out of already uploaded buffers whose vertices are `PackedVertex`es
+    /// quantized against `positionBounds`. Must be drawn with a shader that decodes them.
+    /// The index buffer holds the `lods` back to back, without them it's all one level.
+    explicit Mesh(
+        const VertexBuffer& vertexBuffer,
+        const IndexBuffer& indexBuffer,
+        const AABB& positionBounds,
+        const std::span<const model::cache::LevelOfDetail> lods,
+        const std::vector<Texture>& textures,
+        const glm::mat4& localTransform = glm::mat4(1.0f)
+    ) : textures(textures)
+    , indexCount(indexBuffer.getElementCount())
+    , indexType(indexBuffer.getIndexType())
+    , localTransformation(localTransform)
+    , positionBounds(positionBounds)
+    , lods(lods.begin(), lods.end()) {
+        vertexArray.linkVertexBufferAndIndexBuffer(vertexBuffer, PackedVertex::getLayout(), indexBuffer);
+    }
+
     auto removeTextures() -> void {
         textures.clear();
     }
@@ -56,20 +190,31 @@ public:
 
     ~Mesh() = default;
 
-    /// Deletes its VAO and the textures.
-    /// TODO: The textures can be used by many meshes 
-    /// so I don't know if it should be deleting the textures.
+    /// Deletes its VAO and releases the textures.
+    /// The textures can be used by many meshes, so they are acquired from
+    /// the `TextureRegistry` and it deletes them once nobody uses them.
     auto deleteResource() -> void {
         vertexArray.deleteResource(); 
-        for (auto& texture : textures) {
-            texture.deleteResource();
+        if (instanceBuffer.has_value()) {
+            instanceBuffer->deleteResource();
+            instanceBuffer.reset();
+        }
+        for (const auto& texture : textures) {
+            TextureRegistry::getInstance().release(texture);
         }
+        textures.clear();
     }
 
     auto getVertexArray() -> VertexArray& {
         return vertexArray;         
     }
 
+    /// Identifies the textures the mesh is drawn with (its first texture's ID, 0 without any),
+    /// for sorting the draws so the ones with the same textures go one after another.
+    [[nodiscard]] auto getMaterialID() const -> GLuint {
+        return textures.empty() ? 0 : textures.front().getID();
+    }
+
     /// Sets the local transformation that this mesh goes through
     /// before the external transformation in the draw function 
     /// scales, rotates and translates the mesh.
@@ -77,53 +222,100 @@ public:
         this->localTransformation = transform.getModelMat();
     }
 
-    /// Draws out the mesh using specified shader program 
-    /// with respect to the camera's point of view.
+    [[nodiscard]] auto getLevelOfDetailCount() const -> std::size_t {
+        return std::max<std::size_t>(lods.size(), 1);
+    }
+
+    /// Triangles the level of detail draws.
+    [[nodiscard]] auto getTriangleCount(const std::size_t level) const -> std::size_t {
+        return static_cast<std::size_t>(level < lods.size() ? lods[level].indexCount : indexCount) / 3;
+    }
+
+    /// Picks the coarsest level of detail whose error covers at most `maxPixelError` pixels on the screen.
+    [[nodiscard]] auto selectLevelOfDetail(
+        const Camera& camera,
+        const Transformation& transformation,
+        const float maxPixelError = model::simplifier::defaults::maxPixelError
+    ) const -> std::size_t {
+        if (!positionBounds.has_value()) {
+            return 0;
+        }
+        return mesh::selectLevelOfDetail(camera, transformation.getModelMat() * localTransformation,
+                                         *positionBounds, lods, maxPixelError);
+    }
+
+    /// Draws out the mesh using specified shader program
+    /// with respect to the point of view of the camera in the camera's uniform buffer.
+    /// `level` picks the level of detail, the full mesh is 0.
     auto draw(
         ShaderProgram& shader, 
-        const Camera& camera,
-        const Transformation& transformation
+        const Transformation& transformation,
+        const std::size_t level = 0
     ) -> void {
         std::cout << "Drawing mesh with VAO.id: " << vertexArray.getID() << "\n";
 
-        int diffuseNumber = 0;
-        int specularNumber = 0;
-
-        for (std::size_t i = 0; i < textures.size(); i++) {
-            const auto slot = i;
-
-            const std::string type = texture::TypeToString(textures[i].getType());
+        // transformation.sendModelMatToShader(shader, "U_ModelMat4"_uniform);
+        prepareDraw(shader, transformation.getModelMat() * localTransformation);
 
-            const int number = [&] {
-                switch (textures[i].getType()) {
-                    case texture::Type::DiffuseMap: { return diffuseNumber++; }
-                    case texture::Type::SpecularMap: { return specularNumber++; }
-                    default: throw std::runtime_error("Unknown texture type");
-                }
-            }();
+        // Left bound, the next draw's binds skip whatever it shares with this one.
+        shader.bind();
+        vertexArray.bind();
+        const auto [count, offset] = getIndexRange(level);
+        glDrawElements(GL_TRIANGLES, count, indexType, offset);
+    }
 
-            const std::string uniformName = "U_Material." + type + std::to_string(number);
-            // std::cout << "uniformName = " << uniformName << " = " << slot << "\n";
-            Texture::setSamplerInShader(shader, uniformName, slot);
+    /// Draws a copy of the mesh for each of the `instanceTransforms` with a single draw call.
+    /// The transforms are streamed into a per instance attribute (`mesh::defaults::instanceTransformLocation`),
+    /// `U_ModelMat4` holds the mesh's local transformation which the shader applies first.
+    /// The shader has to read the attribute only in this draw (e.g. behind an `INSTANCED` keyword),
+    /// in `draw` it isn't streamed in and it reads as a degenerate matrix.
+    auto drawInstanced(
+        ShaderProgram& shader,
+        const std::span<const glm::mat4> instanceTransforms,
+        const std::size_t level = 0
+    ) -> void {
+        if (instanceTransforms.empty()) {
+            return;
+        }
 
-            // textures[i].bindToLast();
-            textures[i].bindToSlot(slot);
+        if (!instanceBuffer.has_value()) {
+            instanceBuffer.emplace(GL_ARRAY_BUFFER);
+            vertexArray.linkInstanceBuffer(*instanceBuffer, mesh::getInstanceLayout(), mesh::defaults::instanceTransformLocation);
         }
+        instanceBuffer->upload(instanceTransforms);
+        instanceBuffer->unbind();
+
+        prepareDraw(shader, localTransformation);
 
-        // transformation.sendModelMatToShader(shader, "U_ModelMat4");
-        const glm::mat4 modelMat = transformation.getModelMat() * localTransformation;
         shader.bind();
-        shader.setUniformMat4f("U_ModelMat4", modelMat);
-        ShaderProgram::unbind();
+        vertexArray.bind();
+        const auto [count, offset] = getIndexRange(level);
+        glDrawElementsInstanced(GL_TRIANGLES, count, indexType, offset, static_cast<GLsizei>(instanceTransforms.size()));
+    }
 
-        camera.sendPositionToShader(shader, "U_CameraPositionVec3");
-        camera.sendProjectionViewMatToShader(shader, "U_CameraProjViewMat4");
+private:
+    /// Binds the textures and sends the model matrix to the shader.
+    /// The camera comes from its uniform buffer, uploaded once per frame.
+    auto prepareDraw(ShaderProgram& shader, const glm::mat4& modelMat) -> void {
+        mesh::bindTextures(shader, textures);
 
         shader.bind();
-        vertexArray.bind();
-        glDrawElements(GL_TRIANGLES, static_cast<int>(indices.size()), GL_UNSIGNED_INT, nullptr);
-        VertexArray::unbind();
-        ShaderProgram::unbind();
+        shader.setUniformMat4f("U_ModelMat4"_uniform, modelMat);
+        if (positionBounds.has_value()) {
+            shader.setUniform3f("U_PositionBoundsCenterVec3"_uniform, positionBounds->getCenter());
+            shader.setUniform3f("U_PositionBoundsExtentVec3"_uniform, positionBounds->getExtent());
+        }
+
     }
-};
 
+    /// Index count and byte offset into the index buffer of the level of detail.
+    [[nodiscard]] auto getIndexRange(const std::size_t level) const -> std::pair<GLsizei, const void*> {
+        if (level >= lods.size()) {
+            return { indexCount, nullptr };
+        }
+        // The levels share the vertices, only the range of the index buffer differs.
+        const auto byteOffset = static_cast<std::uintptr_t>(lods[level].firstIndex)
+            * static_cast<std::uintptr_t>(getSizeOfGLTypeFromMacroCode(indexType));
+        return { static_cast<GLsizei>(lods[level].indexCount), reinterpret_cast<const void*>(byteOffset) };
+    }
+};
@@ -5,9 +5,11 @@
 module;
 
 #include "std.h"
+#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <assimp/Importer.hpp>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/material.h>
@@ -16,11 +18,25 @@ module;
 export module model;
 
 import mesh;
+import model.mesh_cache;
+import model.mesh_optimizer;
+import model.mesh_simplifier;
+import model.texture_atlas;
 import vertex_buffer.vertex_struct;
+import vertex_buffer.packed_vertex;
+import aabb;
+import bounding_sphere;
+import frustum_culling;
 import texture;
+import texture.registry;
 import camera;
 import shader_program;
 import transformation;
+import thread_pool;
+import asset_streamer;
+import geometry_arena;
+import dynamic_buffer;
+import material;
 
 export class AssimpGlmHelper {
 public:
@@ -68,51 +84,560 @@ public:
     }
 };
 
+export namespace model::defaults {
+    /// Post-processing steps Assimp runs on import. Part of the cooked mesh cache key.
+    constexpr std::uint32_t importFlags = aiProcess_Triangulate;
+    /// Shader storage buffer binding of the per draw data (`layout(binding = ...)` in the model shader).
+    constexpr GLuint drawDataBinding = 0;
+}
+
+namespace model::detail {
+    /// Assimp's file system that remembers the path of every file the importer opened,
+    /// the files the cooked meshes depend on.
+    class RecordingIOSystem : public Assimp::DefaultIOSystem {
+    private:
+        std::vector<std::string>& openedFiles;
+    public:
+        explicit RecordingIOSystem(std::vector<std::string>& openedFiles) : openedFiles(openedFiles) {}
+
+        auto Open(const char* filePath, const char* mode) -> Assimp::IOStream* override {
+            Assimp::IOStream* const stream = Assimp::DefaultIOSystem::Open(filePath, mode);
+            if (stream != nullptr) {
+                openedFiles.emplace_back(filePath);
+            }
+            return stream;
+        }
+    };
+}
+
+export namespace model {
+    /// CPU side result of loading a model file. Has no OpenGL objects
+    /// so it can be produced on any thread.
+    struct StagedModel {
+        std::optional<MeshCacheFile> cacheFile; // Backs the mesh views on a cache hit.
+        std::vector<cache::MeshData> cookedMeshes; // Backs the mesh views after an import.
+        std::vector<cache::MeshView> meshViews;
+        // Quantized vertices of every mesh view, these are what gets uploaded.
+        std::vector<std::vector<PackedVertex>> packedVertices;
+        std::vector<AABB> positionBounds;
+    };
+
+    /// Geometry (in the arena) and textures of a mesh that are already on the GPU.
+    /// Holds one registry reference per texture, the model takes them over.
+    struct UploadedMesh {
+        ArenaAllocation allocation;
+        AABB positionBounds; // The packed positions are relative to it.
+        BoundingSphere boundingSphere;
+        std::vector<cache::LevelOfDetail> lods; // Ranges of the index buffer.
+        std::vector<Texture> textures;
+        glm::mat4 transform;
+    };
+
+    struct UploadedModel {
+        std::vector<UploadedMesh> meshes;
+    };
+
+    /// Mesh of a model, its vertices and indices live in the `GeometryArena`.
+    struct ArenaMesh {
+        ArenaAllocation allocation;
+        AABB positionBounds;
+        std::vector<cache::LevelOfDetail> lods;
+        std::uint32_t materialIndex; // Into the model's `MaterialTable`.
+        glm::mat4 localTransform;
+    };
+
+    /// Data of one draw of a multi draw, read by the vertex shader (`DrawData` in the model shader,
+    /// std430 layout) at `gl_DrawID`.
+    struct DrawData {
+        glm::mat4 localMat; // The instance's model matrix is applied after it.
+        glm::vec4 positionBoundsCenter; // w unused.
+        glm::vec4 positionBoundsExtent; // w unused.
+        GLuint materialIndex; // Into the model's `MaterialTable`.
+        std::array<GLuint, 3> padding;
+    };
+    static_assert(sizeof(DrawData) == 112, "DrawData must match the std430 layout of the shader's struct.");
+
+    /// What the frustum culling of the last draw let through.
+    struct CullingReport {
+        culling::Stats meshes;
+        culling::Stats instances;
+    };
+
+    /// State of a model streamed in the background. Shared between
+    /// the model (main thread) and the streaming threads.
+    struct PendingLoad {
+        std::mutex mutex;
+        std::optional<UploadedModel> uploaded;
+        GLsync uploadFence = nullptr; // Signaled when the GPU is done with the uploads.
+        std::exception_ptr error;
+
+        auto complete(UploadedModel&& uploadedModel, const GLsync fence) -> void {
+            std::lock_guard lock(mutex);
+            uploaded = std::move(uploadedModel);
+            uploadFence = fence;
+        }
+
+        auto fail(const std::exception_ptr exception) -> void {
+            std::lock_guard lock(mutex);
+            error = exception;
+        }
+    };
+}
+
 export class Model {
 private:
-    std::vector<Mesh> meshes;
+    std::vector<model::ArenaMesh> meshes;
+    // The meshes' textures, deduplicated. Built once the model is on the GPU.
+    MaterialTable materials;
+    // Rewritten every draw, the levels of detail and the transformation change.
+    std::vector<DrawElementsIndirectCommand> drawCommands;
+    std::vector<model::DrawData> drawData;
+    // Object space box and sphere around every mesh of the model, the instances are culled by the sphere.
+    AABB bounds;
+    BoundingSphere boundingSphere;
+    // Rewritten every draw by the frustum culling.
+    culling::SphereSet instanceSpheres;
+    culling::BoxSet meshBoxes;
+    std::vector<std::uint32_t> visibleIndices;
+    std::vector<glm::mat4> visibleTransforms;
+    std::vector<std::uint8_t> meshVisibility;
+    model::CullingReport cullingReport;
+    // Created once the model is on the GPU.
+    std::optional<DynamicBuffer> drawCommandBuffer;
+    std::optional<DynamicBuffer> drawDataBuffer;
+    std::optional<DynamicBuffer> instanceBuffer;
     std::string basePath;
     std::string filePath;
 
-    // Cache for loading in the textures. The textures classes are copied
-    // but not the data which is good because classes are cheap but loading
-    // and duplicating data is expensive.
-    std::unordered_map<std::string, Texture> loadedTexturesCache;
+    // Not null while the model is being streamed in.
+    std::shared_ptr<model::PendingLoad> pendingLoad;
+
+    Model(const std::string& filePath, std::shared_ptr<model::PendingLoad> pendingLoad)
+    : basePath(filePath.substr(0, filePath.find_last_of('/') + 1))
+    , filePath(filePath)
+    , pendingLoad(std::move(pendingLoad)) {}
 public:
     /// Creates a model by loading in a model from a file.
+    /// Blocks until the model is fully on the GPU.
     explicit Model(const std::string& filePath)
-    : basePath(filePath.substr(0, filePath.find_last_of('/') + 1))
-    , filePath(filePath) {
-        loadInModel(filePath);
+    : Model(filePath, nullptr) {
+        finalize(upload(stage(filePath), basePath));
+        TextureRegistry::getInstance().printReport();
+    }
+
+    /// Returns right away with an empty model that draws nothing until it's ready.
+    /// The file is parsed on the streamer's loader thread and uploaded on its
+    /// shared context. `draw` picks up the result once the upload fence is signaled.
+    static auto loadAsync(const std::string& filePath, AssetStreamer& streamer) -> Model {
+        Model streamedModel(filePath, std::make_shared<model::PendingLoad>());
+
+        streamer.submitCpuJob([&streamer, pendingLoad = streamedModel.pendingLoad, filePath,
+                               basePath = streamedModel.basePath] {
+            try {
+                const auto staged = std::make_shared<model::StagedModel>(stage(filePath));
+
+                streamer.submitGpuJob([pendingLoad, staged, basePath] {
+                    try {
+                        model::UploadedModel uploaded = upload(*staged, basePath);
+                        // Signaled once every upload command above was executed by the GPU.
+                        const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                        // The fence must reach the GPU, otherwise the main thread would wait forever.
+                        glFlush();
+                        pendingLoad->complete(std::move(uploaded), fence);
+                    } catch (...) {
+                        pendingLoad->fail(std::current_exception());
+                    }
+                });
+            } catch (...) {
+                pendingLoad->fail(std::current_exception());
+            }
+        });
+
+        return streamedModel;
     }
 
     ~Model() = default;
 
-    /// Deletes the meshes explicitly.
+    /// Deletes the meshes explicitly. Their geometry goes back to the arena
+    /// and their textures are released to the registry.
     auto deleteResource() -> void {
-        for (auto& mesh : meshes) {
-            mesh.deleteResource();
+        std::vector<ArenaAllocation> allocations;
+        allocations.reserve(meshes.size());
+        for (const auto& mesh : meshes) {
+            allocations.push_back(mesh.allocation);
+        }
+        // Reused only after the draws already issued with them are done.
+        GeometryArena::getInstance().free(allocations);
+        meshes.clear();
+        materials.deleteResource();
+        if (drawCommandBuffer.has_value()) {
+            drawCommandBuffer->deleteResource();
+            drawDataBuffer->deleteResource();
+            instanceBuffer->deleteResource();
         }
     }
 
+    /// Returns true when the model is on the GPU and can be drawn.
+    /// Finishes a background load if its upload is done. Never blocks.
+    auto isReady() -> bool {
+        return pollPendingLoad();
+    }
+
+    /// Whether any of the model's materials has a specular map, picks the shader variant it's drawn with.
+    /// False until the model is ready.
+    [[nodiscard]] auto hasSpecularMaps() const -> bool {
+        return materials.hasSpecularMaps();
+    }
+
     /// Draws the model with specified shader with respect to the camera's POV
     /// and the model's scale, rotation and translation vectors.
+    /// Draws nothing while the model is still being streamed in.
     auto draw(
         ShaderProgram& shader, 
         const Camera& camera,
         const Transformation& transformation
     ) -> void {
+        const glm::mat4 modelMat = transformation.getModelMat();
+        drawInstanced(shader, camera, std::span(&modelMat, 1));
+    }
+
+    /// Draws a copy of the model for each of the `instanceTransforms`, with one
+    /// multi draw no matter how many copies or materials there are. The transforms
+    /// are streamed into a per instance attribute. The copies outside the camera's view are
+    /// culled, and so are the meshes of a single copy. The levels of detail are picked
+    /// for the copy closest to the camera. Draws nothing while the model is still being streamed in.
+    auto drawInstanced(
+        ShaderProgram& shader,
+        const Camera& camera,
+        const std::span<const glm::mat4> instanceTransforms
+    ) -> void {
+        if (!pollPendingLoad()) {
+            return;
+        }
+
         std::cout << "drawing model: " << filePath << "\n";
-        for (auto& mesh : meshes) {
-            mesh.draw(shader, camera, transformation);
+        if (meshes.empty() || instanceTransforms.empty()) {
+            return;
+        }
+
+        cull(camera, instanceTransforms);
+        std::println("Culled {} of {} meshes, {} of {} instances", cullingReport.meshes.culled, meshes.size(),
+            cullingReport.instances.culled, instanceTransforms.size());
+        if (visibleTransforms.empty()) {
+            return;
+        }
+
+        const glm::mat4& closestTransform = *std::ranges::min_element(visibleTransforms, std::less{},
+            [&camera](const glm::mat4& transform) {
+                const glm::vec3 toCamera = glm::vec3(transform[3]) - camera.getPosition();
+                return glm::dot(toCamera, toCamera);
+            });
+
+        // One indirect command and one draw data entry per visible mesh, at the mesh's level of detail.
+        drawCommands.clear();
+        drawData.clear();
+        for (std::size_t i = 0; i < meshes.size(); i++) {
+            if (meshVisibility[i] == 0) {
+                continue;
+            }
+            const model::ArenaMesh& arenaMesh = meshes[i];
+            const std::size_t level = mesh::selectLevelOfDetail(
+                camera, closestTransform * arenaMesh.localTransform, arenaMesh.positionBounds, arenaMesh.lods);
+            const model::cache::LevelOfDetail lod = level < arenaMesh.lods.size()
+                ? arenaMesh.lods[level]
+                : model::cache::LevelOfDetail { 0, arenaMesh.allocation.indexCount, 0.0f };
+
+            drawCommands.push_back(DrawElementsIndirectCommand {
+                .count = lod.indexCount,
+                .instanceCount = static_cast<GLuint>(visibleTransforms.size()),
+                .firstIndex = arenaMesh.allocation.firstIndex + lod.firstIndex,
+                .baseVertex = arenaMesh.allocation.baseVertex,
+                // Offsets the per instance attributes, the instances start at the first transform.
+                .baseInstance = 0,
+            });
+            drawData.push_back(model::DrawData {
+                .localMat = arenaMesh.localTransform,
+                .positionBoundsCenter = glm::vec4(arenaMesh.positionBounds.getCenter(), 0.0f),
+                .positionBoundsExtent = glm::vec4(arenaMesh.positionBounds.getExtent(), 0.0f),
+                .materialIndex = arenaMesh.materialIndex,
+            });
+        }
+        if (drawCommands.empty()) {
+            return;
         }
+
+        drawDataBuffer->upload(std::span<const model::DrawData>(drawData));
+        drawDataBuffer->bindBase(model::defaults::drawDataBinding);
+        drawCommandBuffer->upload(std::span<const DrawElementsIndirectCommand>(drawCommands));
+
+        // The arena's VAO is shared by every model, each one points it at its own instance buffer.
+        GeometryArena::getInstance().bind();
+        instanceBuffer->upload(std::span<const glm::mat4>(visibleTransforms));
+        mesh::getInstanceLayout().configure(mesh::defaults::instanceTransformLocation, 1);
+        instanceBuffer->unbind();
+
+        // Every material at once, the shader picks each draw's maps by its material index.
+        materials.bind();
+        shader.bind();
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GeometryArena::getIndexType(), nullptr,
+            static_cast<GLsizei>(drawCommands.size()), 0);
+
+        // The arena's VAO and the shader are left bound, the next draw's binds skip them if it uses them too.
+        drawCommandBuffer->unbind();
+    }
+
+    /// Box around every mesh of the model, before the model's transformation.
+    /// Empty while the model is still being streamed in.
+    [[nodiscard]] auto getBounds() const -> const AABB& {
+        return bounds;
+    }
+
+    /// How many meshes and instances the last draw culled.
+    [[nodiscard]] auto getCullingReport() const -> const model::CullingReport& {
+        return cullingReport;
     }
 private:
-    auto loadInModel(const std::string& path) -> void {
+    /// Tests the instances against the camera's frustum, by the model's bounding sphere,
+    /// and keeps the visible ones in `visibleTransforms`. With one visible instance its
+    /// meshes are tested too, by their boxes. With more, every mesh is drawn for all of
+    /// them, so it could only be dropped if it was outside for every instance; not worth the test.
+    auto cull(const Camera& camera, const std::span<const glm::mat4> instanceTransforms) -> void {
+        const culling::FrustumPlanes planes = camera.getFrustumPlanes();
+
+        instanceSpheres.clear();
+        instanceSpheres.reserve(instanceTransforms.size());
+        for (const glm::mat4& transform : instanceTransforms) {
+            instanceSpheres.add(boundingSphere.transformed(transform));
+        }
+        cullingReport.instances = culling::cullSpheres(planes, instanceSpheres, visibleIndices);
+
+        visibleTransforms.clear();
+        for (const std::uint32_t i : visibleIndices) {
+            visibleTransforms.push_back(instanceTransforms[i]);
+        }
+
+        if (visibleTransforms.size() != 1) {
+            meshVisibility.assign(meshes.size(), visibleTransforms.empty() ? 0 : 1);
+            cullingReport.meshes = visibleTransforms.empty()
+                ? culling::Stats { .visible = 0, .culled = meshes.size() }
+                : culling::Stats { .visible = meshes.size(), .culled = 0 };
+            return;
+        }
+
+        meshBoxes.clear();
+        meshBoxes.reserve(meshes.size());
+        for (const auto& arenaMesh : meshes) {
+            meshBoxes.add(arenaMesh.positionBounds.transformed(visibleTransforms.front() * arenaMesh.localTransform));
+        }
+        cullingReport.meshes = culling::cullBoxes(planes, meshBoxes, visibleIndices);
+
+        meshVisibility.assign(meshes.size(), 0);
+        for (const std::uint32_t i : visibleIndices) {
+            meshVisibility[i] = 1;
+        }
+    }
+
+    /// Loads the meshes from the cooked cache next to the model file if it's
+    /// up to date. Otherwise imports the model with Assimp and cooks the cache.
+    /// Doesn't touch OpenGL, safe to call from any thread.
+    static auto stage(const std::string& path) -> model::StagedModel {
         std::println("Loading in model: {}", path);
 
+        const std::string cachePath = path + std::string(model::cache::fileExtension);
+
+        model::StagedModel staged;
+
+        staged.cacheFile = MeshCacheFile::open(cachePath, model::defaults::importFlags);
+        if (staged.cacheFile.has_value()) {
+            std::println("Loading cooked meshes from: {}", cachePath);
+            staged.meshViews = staged.cacheFile->getMeshes();
+            packVertices(staged);
+            return staged;
+        }
+
+        std::vector<std::string> dependencies;
+        staged.cookedMeshes = importModel(path, &dependencies);
+        // Done once when cooking, the cache stores the optimized meshes.
+        model::optimizer::optimizeMeshes(staged.cookedMeshes);
+        model::simplifier::generateLevelsOfDetail(staged.cookedMeshes);
+        if (model::cache::write(cachePath, model::defaults::importFlags, dependencies, staged.cookedMeshes)) {
+            std::println("Cooked meshes written to: {}", cachePath);
+        }
+
+        staged.meshViews.reserve(staged.cookedMeshes.size());
+        for (const auto& meshData : staged.cookedMeshes) {
+            staged.meshViews.emplace_back(meshData);
+        }
+        packVertices(staged);
+        return staged;
+    }
+
+    /// Quantizes the vertices of every staged mesh into `PackedVertex`es.
+    /// The cache keeps the full vertices, packing them is cheap compared to reading them.
+    static auto packVertices(model::StagedModel& staged) -> void {
+        using Clock = std::chrono::steady_clock;
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        const auto start = Clock::now();
+        std::size_t vertexCount = 0;
+        staged.packedVertices.reserve(staged.meshViews.size());
+        staged.positionBounds.reserve(staged.meshViews.size());
+        for (const auto& meshView : staged.meshViews) {
+            // Computed when the mesh was imported.
+            const AABB& bounds = meshView.bounds;
+            staged.positionBounds.push_back(bounds);
+            staged.packedVertices.push_back(vertex::packing::packVertices(meshView.vertices, bounds));
+            vertexCount += meshView.vertices.size();
+        }
+        const Milliseconds packTime = Clock::now() - start;
+
+        std::println("Packed {} vertices in {:.2f} ms: {:.1f} KiB instead of {:.1f} KiB",
+            vertexCount, packTime.count(),
+            static_cast<double>(vertexCount * sizeof(PackedVertex)) / 1024.0,
+            static_cast<double>(vertexCount * sizeof(Vertex)) / 1024.0);
+    }
+
+    /// Uploads the staged vertex/index data and the textures to the GPU.
+    /// Needs a current OpenGL context, either the main one or the shared upload one.
+    static auto upload(const model::StagedModel& staged, const std::string& basePath) -> model::UploadedModel {
+        TextureRegistry& registry = TextureRegistry::getInstance();
+
+        // Keeps the textures resident until every mesh took its own reference.
+        const std::vector<Texture> loadedTextures = loadTextures(staged.meshViews, basePath);
+
+        model::UploadedModel uploaded;
+        uploaded.meshes.reserve(staged.meshViews.size());
+
+        for (std::size_t i = 0; i < staged.meshViews.size(); i++) {
+            const model::cache::MeshView& meshView = staged.meshViews[i];
+            const std::vector<PackedVertex>& packedVertices = staged.packedVertices[i];
+
+            std::vector<Texture> textures;
+            textures.reserve(meshView.textures.size());
+            for (const auto& textureReference : meshView.textures) {
+                textures.push_back(registry.acquire(basePath + textureReference.path, textureReference.type));
+            }
+
+            uploaded.meshes.push_back(model::UploadedMesh {
+                .allocation = GeometryArena::getInstance().allocate(packedVertices, meshView.indices),
+                .positionBounds = staged.positionBounds[i],
+                .boundingSphere = meshView.boundingSphere,
+                .lods = std::vector(meshView.lods.begin(), meshView.lods.end()),
+                .textures = std::move(textures),
+                .transform = meshView.transform,
+            });
+        }
+
+        for (const auto& texture : loadedTextures) {
+            registry.release(texture);
+        }
+
+        GeometryArena::getInstance().printReport();
+
+        return uploaded;
+    }
+
+    /// Gathers the uploaded meshes' materials into the material table and creates
+    /// the buffers the multi draw reads from. Must run on the main thread.
+    auto finalize(model::UploadedModel&& uploaded) -> void {
+        meshes.reserve(uploaded.meshes.size());
+        for (model::UploadedMesh& uploadedMesh : uploaded.meshes) {
+            meshes.push_back(model::ArenaMesh {
+                .allocation = uploadedMesh.allocation,
+                .positionBounds = uploadedMesh.positionBounds,
+                .lods = std::move(uploadedMesh.lods),
+                .materialIndex = materials.add(Material::fromMeshTextures(std::move(uploadedMesh.textures))),
+                .localTransform = uploadedMesh.transform,
+            });
+        }
+        materials.build();
+
+        for (const auto& arenaMesh : meshes) {
+            bounds.expand(arenaMesh.positionBounds.transformed(arenaMesh.localTransform));
+        }
+        // Centered in the middle of the box, large enough for all the meshes' spheres.
+        if (!bounds.isEmpty()) {
+            boundingSphere = BoundingSphere { bounds.getCenter(), 0.0f };
+            for (const auto& uploadedMesh : uploaded.meshes) {
+                boundingSphere.expand(uploadedMesh.boundingSphere.transformed(uploadedMesh.transform));
+            }
+        }
+
+        drawCommandBuffer.emplace(GL_DRAW_INDIRECT_BUFFER);
+        drawDataBuffer.emplace(GL_SHADER_STORAGE_BUFFER);
+        instanceBuffer.emplace(GL_ARRAY_BUFFER);
+        std::println("{} meshes drawn with one multi draw call, {} materials with {} ({} texture arrays)",
+            meshes.size(), materials.getMaterialCount(), material::BackendToString(materials.getBackend()),
+            materials.getTextureArrayCount());
+    }
+
+    /// Finishes the background load once its upload fence is signaled.
+    /// Returns true if the model is ready to be drawn.
+    auto pollPendingLoad() -> bool {
+        if (pendingLoad == nullptr) {
+            return true;
+        }
+
+        // Keeps the state alive (and its mutex locked) even after the member gets reset below.
+        const std::shared_ptr<model::PendingLoad> load = pendingLoad;
+        std::lock_guard lock(load->mutex);
+
+        if (load->error) {
+            try {
+                std::rethrow_exception(load->error);
+            } catch (const std::exception& error) {
+                std::cerr << "Failed to stream in model '" << filePath << "': " << error.what() << "\n";
+            }
+            // Stays empty, draws nothing.
+            pendingLoad.reset();
+            return true;
+        }
+
+        if (!load->uploaded.has_value()) {
+            return false;
+        }
+
+        // Zero timeout, just asks whether the GPU got through the uploads.
+        const GLenum status = glClientWaitSync(load->uploadFence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        if (status == GL_WAIT_FAILED) {
+            std::cerr << "Waiting on the upload fence of '" << filePath << "' failed.\n";
+        }
+
+        glDeleteSync(load->uploadFence);
+        try {
+            finalize(std::move(*load->uploaded));
+        } catch (const std::exception& error) {
+            // E.g. more texture sizes and formats than the texture arrays backend can sample.
+            std::cerr << "Failed to stream in model '" << filePath << "': " << error.what() << "\n";
+            // Frees what the finalize got to, stays empty and draws nothing.
+            deleteResource();
+            pendingLoad.reset();
+            return true;
+        }
+        std::println("Streamed in model: {}", filePath);
+        TextureRegistry::getInstance().printReport();
+        pendingLoad.reset();
+        return true;
+    }
+
+public:
+    /// Runs the Assimp import and flattens the node hierarchy into a list of meshes
+    /// with their node transformations baked in. The materials' small textures are packed
+    /// into atlases (written next to the model) and the meshes' UVs are remapped into them.
+    /// The meshes are not optimized. Every file the meshes were made from (the model file, the buffers
+    /// and images it references) is added to the `dependencies`, if given.
+    static auto importModel(
+        const std::string& path,
+        std::vector<std::string>* const dependencies = nullptr
+    ) -> std::vector<model::cache::MeshData> {
+        std::vector<std::string> openedFiles;
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+        // The importer owns its IO system, it's deleted with the importer.
+        importer.SetIOHandler(new model::detail::RecordingIOSystem(openedFiles));
+        const aiScene* scene = importer.ReadFile(path, model::defaults::importFlags);
 
         if (scene == nullptr
         || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE
@@ -125,14 +650,133 @@ private:
         glm::mat4 rootTransform = AssimpGlmHelper::convertMatrixToGLM(scene->mRootNode->mTransformation);
         // std::cout << "Root transformation matrix.\n";
         // AssimpGlmHelper::printMat4(rootTransform);
-        traverseNode(scene->mRootNode, scene, glm::mat4(1.0f), 0);
+        const model::atlas::PackedMaterials atlases = packTextureAtlases(scene, path);
+
+        std::vector<model::cache::MeshData> cookedMeshes;
+        traverseNode(scene->mRootNode, scene, glm::mat4(1.0f), 0, atlases.placements, cookedMeshes);
+
+        if (dependencies != nullptr) {
+            // The buffers (e.g. a glTF's `.bin`) are read by the importer, the images only by the atlas packer.
+            // Only the atlased images shape the cooked meshes, but the others are just as cheap to check.
+            const std::string basePath = path.substr(0, path.find_last_of('/') + 1);
+            dependencies->push_back(path);
+            dependencies->insert(dependencies->end(), openedFiles.begin(), openedFiles.end());
+            for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+                for (const model::cache::TextureReference& map : getMaterialMaps(scene->mMaterials[i])) {
+                    if (std::filesystem::exists(basePath + map.path)) {
+                        dependencies->push_back(basePath + map.path);
+                    }
+                }
+            }
+            std::ranges::sort(*dependencies);
+            const auto duplicates = std::ranges::unique(*dependencies);
+            dependencies->erase(duplicates.begin(), duplicates.end());
+        }
+        return cookedMeshes;
     }
 
-    auto traverseNode(
+private:
+    /// Makes every texture the meshes use resident in the texture registry and returns
+    /// one reference to each; the caller has to release them. Textures already resident
+    /// (e.g. shared with another model) are reused, the rest are cooked (mapped from the texture
+    /// cache or decoded) in parallel on the thread pool while this (GL) thread drains
+    /// the finished images and uploads them.
+    static auto loadTextures(
+        const std::span<const model::cache::MeshView> meshViews,
+        const std::string& basePath
+    ) -> std::vector<Texture> {
+        using Clock = std::chrono::steady_clock;
+
+        TextureRegistry& registry = TextureRegistry::getInstance();
+
+        // Every unique texture gets looked up just once.
+        std::map<std::string, texture::Type> usedTextures;
+        for (const auto& meshView : meshViews) {
+            for (const auto& textureReference : meshView.textures) {
+                usedTextures.emplace(basePath + textureReference.path, textureReference.type);
+            }
+        }
+
+        std::vector<Texture> textures;
+        std::map<std::string, texture::Type> pendingTextures;
+        for (const auto& [path, type] : usedTextures) {
+            if (auto resident = registry.tryAcquire(path, type)) {
+                textures.push_back(*resident);
+            } else {
+                pendingTextures.emplace(path, type);
+            }
+        }
+
+        if (pendingTextures.empty()) {
+            return textures;
+        }
+
+        struct CookedTexture {
+            std::string path;
+            texture::Type type;
+            texture::CookedImage image;
+            std::exception_ptr error;
+            Clock::duration cookTime;
+        };
+
+        // Shared with the workers, so it outlives this function if it throws.
+        const auto cookedTextures = std::make_shared<CompletionQueue<CookedTexture>>();
+
+        const auto loadStart = Clock::now();
+
+        for (const auto& [path, type] : pendingTextures) {
+            ThreadPool::getInstance().submit([cookedTextures, path, type] {
+                const auto cookStart = Clock::now();
+                CookedTexture cooked { .path = path, .type = type };
+                try {
+                    cooked.image = texture::cookImage(path, type);
+                } catch (...) {
+                    cooked.error = std::current_exception();
+                }
+                cooked.cookTime = Clock::now() - cookStart;
+                cookedTextures->push(std::move(cooked));
+            });
+        }
+
+        Clock::duration cookTime{};
+        Clock::duration uploadTime{};
+
+        for (std::size_t i = 0; i < pendingTextures.size(); i++) {
+            CookedTexture cooked = cookedTextures->pop();
+            if (cooked.error) {
+                for (const auto& texture : textures) {
+                    registry.release(texture);
+                }
+                std::rethrow_exception(cooked.error);
+            }
+
+            std::cout << "Texture file path: " << cooked.path << "\n";
+
+            const auto uploadStart = Clock::now();
+            textures.push_back(registry.acquire(cooked.path, cooked.image, cooked.type));
+            uploadTime += Clock::now() - uploadStart;
+            cookTime += cooked.cookTime;
+        }
+
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        std::println("Loaded {} textures ({} already resident) in {:.1f} ms: decode/cache {:.1f} ms (summed over {} workers), upload {:.1f} ms",
+            pendingTextures.size(),
+            usedTextures.size() - pendingTextures.size(),
+            Milliseconds(Clock::now() - loadStart).count(),
+            Milliseconds(cookTime).count(),
+            ThreadPool::getInstance().getWorkerCount(),
+            Milliseconds(uploadTime).count());
+
+        return textures;
+    }
+
+    static auto traverseNode(
              const aiNode *node, 
              const aiScene *scene, 
              const glm::mat4& parentTransform, 
-             const int depth
+             const int depth,
+             const std::span<const std::optional<model::atlas::Placement>> atlasPlacements,
+             std::vector<model::cache::MeshData>& cookedMeshes
     ) -> void {
         // TODO: Add transformations relative to parent node to the mesh class.
         // node->mTransformation;
@@ -154,16 +798,26 @@ private:
 
         for (unsigned int i = 0; i < node->mNumMeshes; i++) {
             const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene, computedTransform));
+            cookedMeshes.push_back(processMesh(mesh, scene, computedTransform, atlasPlacements[mesh->mMaterialIndex]));
         }
 
         for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            traverseNode(node->mChildren[i], scene, computedTransform, depth + 1);
+            traverseNode(node->mChildren[i], scene, computedTransform, depth + 1, atlasPlacements, cookedMeshes);
         }
     }
 
-    auto processMesh(const aiMesh* mesh, const aiScene* scene, const glm::mat4& transform) -> Mesh {
-        std::vector<Vertex> vertices;
+    /// Converts the Assimp mesh. With an `atlasPlacement` its material's maps are replaced
+    /// by the atlases and its UVs are remapped into them.
+    static auto processMesh(
+        const aiMesh* mesh,
+        const aiScene* scene,
+        const glm::mat4& transform,
+        const std::optional<model::atlas::Placement>& atlasPlacement
+    ) -> model::cache::MeshData {
+        model::cache::MeshData meshData { .transform = transform };
+
+        std::vector<Vertex>& vertices = meshData.vertices;
+        vertices.reserve(mesh->mNumVertices);
         
         for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
             const aiVector3D p = mesh->mVertices[i];
@@ -177,6 +831,9 @@ private:
             if (mesh->mTextureCoords[0] != nullptr) {
                 const aiVector3D uv = mesh->mTextureCoords[0][i];
                 v.texUV = { uv.x, uv.y };
+                if (atlasPlacement.has_value()) {
+                    v.texUV = atlasPlacement->remap(v.texUV);
+                }
                 
                 if (mesh->HasTangentsAndBitangents()) {
                     const aiVector3D t = mesh->mTangents[i];
@@ -186,14 +843,20 @@ private:
                     v.bitangent = { bt.x, bt.y, bt.z };
                 }
             } else {
-                v.texUV = { 0.f, 0.f };
+                v.texUV = atlasPlacement.has_value() ? atlasPlacement->remap({ 0.f, 0.f }) : glm::vec2(0.f, 0.f);
             }
 
             vertices.push_back(v);
         }
 
+        // Kept in the cache for the frustum culling, the packing reuses the box.
+        meshData.bounds = vertex::packing::computeBounds(vertices);
+        meshData.boundingSphere = BoundingSphere::enclosing(
+            meshData.bounds.getCenter(), std::views::transform(vertices, &Vertex::position));
+
 
-        std::vector<unsigned int> indices;
+        std::vector<GLuint>& indices = meshData.indices;
+        indices.reserve(mesh->mNumFaces * 3);
         for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
             aiFace f = mesh->mFaces[i];
             for (unsigned int j = 0; j < f.mNumIndices; j++) {
@@ -206,37 +869,65 @@ private:
         aiColor3D color;
         material->Get(AI_MATKEY_COLOR_DIFFUSE, color);
 
-        std::vector<Texture> diffuseMaps = getMaterialTextures(material, aiTextureType_DIFFUSE);
-        std::vector<Texture> specularMaps = getMaterialTextures(material, aiTextureType_SPECULAR);
-        std::vector<Texture> metalnessMaps = getMaterialTextures(material, aiTextureType_METALNESS);
+        meshData.textures = atlasPlacement.has_value() ? atlasPlacement->maps : getMaterialMaps(material);
+        
+        return meshData;
+    }
 
-        std::vector<Texture> textures;
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        textures.insert(textures.end(), metalnessMaps.begin(), metalnessMaps.end());
+    /// Every map of the material the meshes use.
+    static auto getMaterialMaps(const aiMaterial* material) -> std::vector<model::cache::TextureReference> {
+        std::vector<model::cache::TextureReference> textures;
+        for (const auto assimpTextureType : { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_METALNESS }) {
+            std::vector<model::cache::TextureReference> maps = getMaterialTextures(material, assimpTextureType);
+            textures.insert(textures.end(), maps.begin(), maps.end());
+        }
+        return textures;
+    }
 
-        
-        return Mesh(vertices, indices, textures, transform);
+    /// Packs the small textures of the materials the scene's meshes use into atlases,
+    /// see `model::atlas::packMaterials`. Returns where each material (by its index in the scene) ended up.
+    static auto packTextureAtlases(const aiScene* scene, const std::string& path) -> model::atlas::PackedMaterials {
+        std::vector<model::atlas::MaterialMaps> materials(scene->mNumMaterials);
+        std::vector<std::uint8_t> isMaterialUsed(scene->mNumMaterials, 0);
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            const aiMesh* mesh = scene->mMeshes[i];
+            isMaterialUsed[mesh->mMaterialIndex] = 1;
+            if (mesh->mTextureCoords[0] == nullptr) {
+                continue;
+            }
+            // A texture that repeats can't be atlased.
+            const bool isInUnitSquare = std::all_of(mesh->mTextureCoords[0], mesh->mTextureCoords[0] + mesh->mNumVertices,
+                [](const aiVector3D& uv) {
+                    constexpr float tolerance = 1.0f / 4096.0f;
+                    return uv.x >= -tolerance && uv.x <= 1.0f + tolerance && uv.y >= -tolerance && uv.y <= 1.0f + tolerance;
+                });
+            materials[mesh->mMaterialIndex].isInUnitSquare &= isInUnitSquare;
+        }
+        for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+            if (isMaterialUsed[i] != 0) {
+                materials[i].maps = getMaterialMaps(scene->mMaterials[i]);
+            }
+        }
+
+        const std::size_t fileNameStart = path.find_last_of('/') + 1;
+        model::atlas::PackedMaterials packed = model::atlas::packMaterials(
+            materials, path.substr(0, fileNameStart), path.substr(fileNameStart));
+
+        const model::atlas::Report& report = packed.report;
+        std::println("Packed {} textures into {} atlases: {} texture objects instead of {}, {:.1f}% of the atlas area wasted",
+            report.atlasedTextureCount, report.atlasCount, report.textureCountAfter, report.textureCountBefore,
+            report.atlasArea == 0 ? 0.0 : 100.0 * static_cast<double>(report.wastedArea) / static_cast<double>(report.atlasArea));
+        return packed;
     }
 
-    auto getMaterialTextures(
+    static auto getMaterialTextures(
         const aiMaterial* material,
         const aiTextureType aiTextureType
-    ) -> std::vector<Texture> {
-        std::vector<Texture> textures;
+    ) -> std::vector<model::cache::TextureReference> {
+        std::vector<model::cache::TextureReference> textures;
         for (unsigned int i = 0; i < material->GetTextureCount(aiTextureType); i++) {
             aiString fileName;
             material->GetTexture(aiTextureType, i, &fileName);
-            
-            const std::string path = basePath + std::string(fileName.C_Str());
-
-            if (loadedTexturesCache.contains(path)) {
-                auto loadedTexture = loadedTexturesCache[path];
-                textures.push_back(loadedTexture);
-                continue;
-            }
-
-            std::cout << "Texture file path: " << path << "\n";
 
             const texture::Type textureType = [&] {
                 switch (aiTextureType) {
@@ -247,13 +938,13 @@ private:
                 }
             }();
 
-            const auto texture = Texture(path, textureType);
-            loadedTexturesCache[path] = texture;
-            textures.push_back(texture);
+            textures.push_back(model::cache::TextureReference {
+                .type = textureType,
+                .path = std::string(fileName.C_Str()),
+            });
         }
 
         return textures;
     }
 
 };
-
@@ -0,0 +1,375 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+export module model.mesh_cache;
+
+import aabb;
+import bounding_sphere;
+import file_mapping;
+import texture;
+import vertex_buffer.vertex_struct;
+
+// Layout of the cooked mesh file (all offsets are from the start of the file):
+//
+//   Header
+//   DependencyEntry[dependencyCount]
+//   MeshEntry[meshCount]
+//   TextureEntry[textureCount]
+//   LevelOfDetail[lodCount]
+//   char stringTable[stringTableSize]
+//   (padding to payloadAlignment) Vertex/GLuint payload of every mesh
+//
+// The payload is written so that the vertex and index arrays can be
+// handed to the GPU directly out of the memory mapped file.
+
+namespace model::cache::detail {
+    constexpr std::array<char, 8> magic = { 'M', 'E', 'S', 'H', 'C', 'O', 'O', 'K' };
+    constexpr std::size_t payloadAlignment = 16;
+
+    struct Header {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t importFlags;
+        std::uint32_t dependencyCount;
+        std::uint32_t meshCount;
+        std::uint32_t textureCount;
+        std::uint32_t stringTableSize;
+        std::uint32_t vertexSize; // Guards against the `Vertex` struct changing without a version bump.
+        std::uint32_t lodCount;
+    };
+
+    /// A file the meshes were cooked from and its stamp at that time.
+    struct DependencyEntry {
+        file_mapping::FileStamp stamp;
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+    };
+
+    struct MeshEntry {
+        glm::mat4 transform;
+        AABB bounds;
+        BoundingSphere boundingSphere;
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t firstTexture;
+        std::uint32_t textureCount;
+        std::uint32_t firstLod;
+        std::uint32_t lodCount;
+    };
+
+    struct TextureEntry {
+        std::uint32_t type;
+        std::uint32_t pathOffset;
+        std::uint32_t pathLength;
+        std::uint32_t reserved;
+    };
+
+    auto alignUp(const std::uint64_t value, const std::uint64_t alignment) -> std::uint64_t {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+export namespace model::cache {
+    /// Bump this whenever the cooked data or the file layout changes.
+    constexpr std::uint32_t version = 6;
+    /// The cooked file is written next to the source file with this extension appended.
+    constexpr std::string_view fileExtension = ".meshcache";
+
+    /// Texture used by a mesh, resolved relative to the model's directory.
+    struct TextureReference {
+        texture::Type type;
+        std::string path;
+    };
+
+    /// Range of a mesh's indices that draws one level of detail, all the levels share the vertices.
+    struct LevelOfDetail {
+        std::uint32_t firstIndex;
+        std::uint32_t indexCount;
+        float error; // Largest distance from the full mesh's surface, in the vertices' units.
+    };
+
+    /// Mesh data produced by the importer. Owns its arrays.
+    /// With levels of detail the indices hold all of them back to back,
+    /// without any (`lods` empty) they are just the full mesh.
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        glm::mat4 transform = glm::mat4(1.0f);
+        AABB bounds; // Of the positions, before the `transform`.
+        BoundingSphere boundingSphere; // Of the positions, before the `transform`.
+        std::vector<TextureReference> textures;
+        std::vector<LevelOfDetail> lods;
+    };
+
+    /// Non-owning view over the mesh data. Either points into `MeshData`
+    /// or straight into a memory mapped cooked file.
+    struct MeshView {
+        std::span<const Vertex> vertices;
+        std::span<const GLuint> indices;
+        glm::mat4 transform = glm::mat4(1.0f);
+        AABB bounds;
+        BoundingSphere boundingSphere;
+        std::vector<TextureReference> textures;
+        std::span<const LevelOfDetail> lods;
+
+        MeshView() = default;
+
+        explicit MeshView(const MeshData& data)
+        : vertices(data.vertices), indices(data.indices), transform(data.transform)
+        , bounds(data.bounds), boundingSphere(data.boundingSphere), textures(data.textures), lods(data.lods) {}
+    };
+
+    /// Writes the cooked meshes to `cachePath`. The `dependencies` are every file the meshes were
+    /// cooked from (the model file, its buffers, the textures packed into atlases), their current
+    /// size and modification time are recorded and changing any of them invalidates the cooked file.
+    /// Failing to write the cache is not fatal, the model just gets imported again next time.
+    auto write(
+        const std::string& cachePath,
+        const std::uint32_t importFlags,
+        const std::span<const std::string> dependencies,
+        const std::vector<MeshData>& meshes
+    ) -> bool {
+        using namespace detail;
+
+        std::vector<DependencyEntry> dependencyEntries;
+        std::vector<MeshEntry> meshEntries;
+        std::vector<TextureEntry> textureEntries;
+        std::vector<LevelOfDetail> lodEntries;
+        std::string stringTable;
+        meshEntries.reserve(meshes.size());
+
+        dependencyEntries.reserve(dependencies.size());
+        for (const std::string& dependency : dependencies) {
+            const std::optional<file_mapping::FileStamp> stamp = file_mapping::getFileStamp(dependency);
+            if (!stamp.has_value()) {
+                std::cerr << "Could not write mesh cache, its source is missing: " << dependency << "\n";
+                return false;
+            }
+            dependencyEntries.push_back(DependencyEntry {
+                .stamp = *stamp,
+                .pathOffset = static_cast<std::uint32_t>(stringTable.size()),
+                .pathLength = static_cast<std::uint32_t>(dependency.size()),
+            });
+            stringTable += dependency;
+        }
+
+        for (const auto& mesh : meshes) {
+            meshEntries.push_back(MeshEntry {
+                .transform = mesh.transform,
+                .bounds = mesh.bounds,
+                .boundingSphere = mesh.boundingSphere,
+                .vertexCount = static_cast<std::uint32_t>(mesh.vertices.size()),
+                .indexCount = static_cast<std::uint32_t>(mesh.indices.size()),
+                .firstTexture = static_cast<std::uint32_t>(textureEntries.size()),
+                .textureCount = static_cast<std::uint32_t>(mesh.textures.size()),
+                .firstLod = static_cast<std::uint32_t>(lodEntries.size()),
+                .lodCount = static_cast<std::uint32_t>(mesh.lods.size()),
+            });
+            lodEntries.insert(lodEntries.end(), mesh.lods.begin(), mesh.lods.end());
+            for (const auto& textureReference : mesh.textures) {
+                textureEntries.push_back(TextureEntry {
+                    .type = static_cast<std::uint32_t>(textureReference.type),
+                    .pathOffset = static_cast<std::uint32_t>(stringTable.size()),
+                    .pathLength = static_cast<std::uint32_t>(textureReference.path.size()),
+                });
+                stringTable += textureReference.path;
+            }
+        }
+
+        // Lay out the payload after the tables.
+        std::uint64_t offset = sizeof(Header)
+            + dependencyEntries.size() * sizeof(DependencyEntry)
+            + meshEntries.size() * sizeof(MeshEntry)
+            + textureEntries.size() * sizeof(TextureEntry)
+            + lodEntries.size() * sizeof(LevelOfDetail)
+            + stringTable.size();
+        const std::uint64_t payloadStart = alignUp(offset, payloadAlignment);
+        offset = payloadStart;
+        for (auto& entry : meshEntries) {
+            entry.vertexOffset = offset;
+            offset = alignUp(offset + entry.vertexCount * sizeof(Vertex), payloadAlignment);
+            entry.indexOffset = offset;
+            offset = alignUp(offset + entry.indexCount * sizeof(GLuint), payloadAlignment);
+        }
+
+        const Header header {
+            .magic = magic,
+            .version = version,
+            .importFlags = importFlags,
+            .dependencyCount = static_cast<std::uint32_t>(dependencyEntries.size()),
+            .meshCount = static_cast<std::uint32_t>(meshEntries.size()),
+            .textureCount = static_cast<std::uint32_t>(textureEntries.size()),
+            .stringTableSize = static_cast<std::uint32_t>(stringTable.size()),
+            .vertexSize = sizeof(Vertex),
+            .lodCount = static_cast<std::uint32_t>(lodEntries.size()),
+        };
+
+        // Write into a temporary file first so a crash mid-write
+        // never leaves a truncated cache with a valid header behind.
+        const std::string temporaryPath = cachePath + ".tmp";
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open()) {
+            std::cerr << "Could not write mesh cache: " << cachePath << "\n";
+            return false;
+        }
+
+        const auto pad = [&](const std::uint64_t to) {
+            static constexpr std::array<char, payloadAlignment> zeros{};
+            const auto position = static_cast<std::uint64_t>(stream.tellp());
+            stream.write(zeros.data(), static_cast<std::streamsize>(to - position));
+        };
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(dependencyEntries.data()),
+                     static_cast<std::streamsize>(dependencyEntries.size() * sizeof(DependencyEntry)));
+        stream.write(reinterpret_cast<const char*>(meshEntries.data()),
+                     static_cast<std::streamsize>(meshEntries.size() * sizeof(MeshEntry)));
+        stream.write(reinterpret_cast<const char*>(textureEntries.data()),
+                     static_cast<std::streamsize>(textureEntries.size() * sizeof(TextureEntry)));
+        stream.write(reinterpret_cast<const char*>(lodEntries.data()),
+                     static_cast<std::streamsize>(lodEntries.size() * sizeof(LevelOfDetail)));
+        stream.write(stringTable.data(), static_cast<std::streamsize>(stringTable.size()));
+
+        for (std::size_t i = 0; i < meshes.size(); i++) {
+            pad(meshEntries[i].vertexOffset);
+            stream.write(reinterpret_cast<const char*>(meshes[i].vertices.data()),
+                         static_cast<std::streamsize>(meshes[i].vertices.size() * sizeof(Vertex)));
+            pad(meshEntries[i].indexOffset);
+            stream.write(reinterpret_cast<const char*>(meshes[i].indices.data()),
+                         static_cast<std::streamsize>(meshes[i].indices.size() * sizeof(GLuint)));
+        }
+        pad(offset);
+        stream.close();
+
+        if (!stream) {
+            std::cerr << "Could not write mesh cache: " << cachePath << "\n";
+            std::filesystem::remove(temporaryPath);
+            return false;
+        }
+
+        std::filesystem::rename(temporaryPath, cachePath);
+        return true;
+    }
+}
+
+/// Memory mapped cooked mesh file. The mesh views it hands out point
+/// straight into the mapping, so they are valid only while this object lives.
+export class MeshCacheFile {
+private:
+    MappedFile mFile;
+    std::vector<model::cache::MeshView> mMeshes;
+
+    explicit MeshCacheFile(MappedFile&& file) : mFile(std::move(file)) {}
+public:
+    /// Maps the cooked file at `cachePath`. Returns nothing if the file is missing, was cooked
+    /// with different flags or by an older version, or if any file it was cooked from changed
+    /// (by its size and modification time, nothing but the cooked file is read).
+    static auto open(
+        const std::string& cachePath,
+        const std::uint32_t importFlags
+    ) -> std::optional<MeshCacheFile> {
+        using namespace model::cache::detail;
+
+        MappedFile file(cachePath);
+        if (!file.isOpen()) {
+            return std::nullopt;
+        }
+
+        const auto header = file.at<Header>(0);
+        if (header == nullptr
+        || header->magic != magic
+        || header->version != model::cache::version
+        || header->vertexSize != sizeof(Vertex)
+        || header->importFlags != importFlags) {
+            std::println("Mesh cache is stale, ignoring it: {}", cachePath);
+            return std::nullopt;
+        }
+
+        std::size_t offset = sizeof(Header);
+        const auto dependencyEntries = file.at<DependencyEntry>(offset, header->dependencyCount);
+        offset += header->dependencyCount * sizeof(DependencyEntry);
+        const auto meshEntries = file.at<MeshEntry>(offset, header->meshCount);
+        offset += header->meshCount * sizeof(MeshEntry);
+        const auto textureEntries = file.at<TextureEntry>(offset, header->textureCount);
+        offset += header->textureCount * sizeof(TextureEntry);
+        const auto lodEntries = file.at<model::cache::LevelOfDetail>(offset, header->lodCount);
+        offset += header->lodCount * sizeof(model::cache::LevelOfDetail);
+        const auto stringTable = file.at<char>(offset, header->stringTableSize);
+
+        if (dependencyEntries == nullptr || meshEntries == nullptr || textureEntries == nullptr
+        || lodEntries == nullptr || stringTable == nullptr) {
+            std::cerr << "Mesh cache is truncated: " << cachePath << "\n";
+            return std::nullopt;
+        }
+
+        for (std::uint32_t i = 0; i < header->dependencyCount; i++) {
+            const DependencyEntry& entry = dependencyEntries[i];
+            if (static_cast<std::uint64_t>(entry.pathOffset) + entry.pathLength > header->stringTableSize) {
+                std::cerr << "Mesh cache is corrupted: " << cachePath << "\n";
+                return std::nullopt;
+            }
+            const std::string dependency(stringTable + entry.pathOffset, entry.pathLength);
+            if (file_mapping::getFileStamp(dependency) != entry.stamp) {
+                std::println("Mesh cache is stale ({} changed), ignoring it: {}", dependency, cachePath);
+                return std::nullopt;
+            }
+        }
+
+        MeshCacheFile cache(std::move(file));
+        cache.mMeshes.reserve(header->meshCount);
+
+        for (std::uint32_t i = 0; i < header->meshCount; i++) {
+            const MeshEntry& entry = meshEntries[i];
+            const auto vertices = cache.mFile.at<Vertex>(entry.vertexOffset, entry.vertexCount);
+            const auto indices = cache.mFile.at<GLuint>(entry.indexOffset, entry.indexCount);
+            if (vertices == nullptr || indices == nullptr
+            || static_cast<std::uint64_t>(entry.firstTexture) + entry.textureCount > header->textureCount
+            || static_cast<std::uint64_t>(entry.firstLod) + entry.lodCount > header->lodCount) {
+                std::cerr << "Mesh cache is corrupted: " << cachePath << "\n";
+                return std::nullopt;
+            }
+
+            model::cache::MeshView view;
+            view.vertices = std::span(vertices, entry.vertexCount);
+            view.indices = std::span(indices, entry.indexCount);
+            view.transform = entry.transform;
+            view.bounds = entry.bounds;
+            view.boundingSphere = entry.boundingSphere;
+            view.lods = std::span(lodEntries + entry.firstLod, entry.lodCount);
+            for (const model::cache::LevelOfDetail& lod : view.lods) {
+                if (static_cast<std::uint64_t>(lod.firstIndex) + lod.indexCount > entry.indexCount) {
+                    std::cerr << "Mesh cache is corrupted: " << cachePath << "\n";
+                    return std::nullopt;
+                }
+            }
+
+            for (std::uint32_t t = 0; t < entry.textureCount; t++) {
+                const TextureEntry& textureEntry = textureEntries[entry.firstTexture + t];
+                if (static_cast<std::uint64_t>(textureEntry.pathOffset) + textureEntry.pathLength > header->stringTableSize) {
+                    std::cerr << "Mesh cache is corrupted: " << cachePath << "\n";
+                    return std::nullopt;
+                }
+                view.textures.push_back(model::cache::TextureReference {
+                    .type = static_cast<texture::Type>(textureEntry.type),
+                    .path = std::string(stringTable + textureEntry.pathOffset, textureEntry.pathLength),
+                });
+            }
+
+            cache.mMeshes.push_back(std::move(view));
+        }
+
+        return cache;
+    }
+
+    [[nodiscard]] auto getMeshes() const -> const std::vector<model::cache::MeshView>& {
+        return mMeshes;
+    }
+};
@@ -0,0 +1,396 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+export module model.mesh_optimizer;
+
+import file_mapping;
+import model.mesh_cache;
+import vertex_buffer.vertex_struct;
+
+export namespace model::optimizer::defaults {
+    /// Size of the simulated post-transform vertex cache (FIFO).
+    /// Real GPUs are around 16 to 32 entries, tuning for the small end works on all of them.
+    constexpr std::uint32_t cacheSize = 16;
+}
+
+export namespace model::optimizer {
+    /// How well the index order uses the post-transform vertex cache.
+    struct CacheStatistics {
+        float acmr = 0.0f; // Average cache misses per triangle. 0.5 is the ideal for big meshes, 3 the worst.
+        float atvr = 0.0f; // Average transformed vertices per referenced vertex. 1 is the ideal.
+        std::size_t misses = 0;
+        std::size_t referencedVertices = 0; // Vertices the indices use, unreferenced ones are never transformed.
+    };
+
+    /// Simulates a FIFO vertex cache of `cacheSize` entries over the index order.
+    auto analyzeVertexCache(
+        const std::span<const GLuint> indices,
+        const std::size_t vertexCount,
+        const std::uint32_t cacheSize = defaults::cacheSize
+    ) -> CacheStatistics {
+        if (indices.empty() || vertexCount == 0) {
+            return {};
+        }
+
+        // A vertex is in the cache if it was inserted less than `cacheSize` insertions ago.
+        std::vector<std::uint64_t> insertedAt(vertexCount, 0);
+        std::vector<bool> isReferenced(vertexCount, false);
+        std::uint64_t insertions = cacheSize + 1;
+        std::size_t misses = 0;
+        std::size_t referencedVertices = 0;
+
+        for (const GLuint index : indices) {
+            if (insertions - insertedAt[index] > cacheSize) {
+                insertedAt[index] = insertions++;
+                misses++;
+            }
+            if (!isReferenced[index]) {
+                isReferenced[index] = true;
+                referencedVertices++;
+            }
+        }
+
+        return CacheStatistics {
+            .acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+            .atvr = static_cast<float>(misses) / static_cast<float>(referencedVertices),
+            .misses = misses,
+            .referencedVertices = referencedVertices,
+        };
+    }
+
+    /// Merges bit-identical vertices and rewrites the indices to the merged ones.
+    /// Returns the number of vertices removed.
+    auto weldVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) -> std::size_t {
+        struct VertexHash {
+            auto operator()(const Vertex& vertex) const -> std::size_t {
+                return file_mapping::hashValue(vertex);
+            }
+        };
+        struct VertexEqual {
+            auto operator()(const Vertex& a, const Vertex& b) const -> bool {
+                return std::ranges::equal(std::as_bytes(std::span(&a, 1)), std::as_bytes(std::span(&b, 1)));
+            }
+        };
+
+        std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual> uniqueVertices;
+        uniqueVertices.reserve(vertices.size());
+
+        std::vector<GLuint> remap(vertices.size());
+        std::vector<Vertex> welded;
+        welded.reserve(vertices.size());
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            const auto [it, inserted] = uniqueVertices.try_emplace(vertices[i], static_cast<GLuint>(welded.size()));
+            if (inserted) {
+                welded.push_back(vertices[i]);
+            }
+            remap[i] = it->second;
+        }
+
+        for (GLuint& index : indices) {
+            index = remap[index];
+        }
+
+        const std::size_t removed = vertices.size() - welded.size();
+        vertices = std::move(welded);
+        return removed;
+    }
+
+    /// Reorders the triangles for the post-transform vertex cache with Tipsify
+    /// (Sander, Nehab, Barczak: "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007).
+    /// Runs in linear time. Fills `clusterStarts` with the index offsets where the algorithm
+    /// had to jump to a far away part of the mesh; those are the clusters the overdraw pass sorts.
+    auto optimizeVertexCache(
+        std::vector<GLuint>& indices,
+        const std::size_t vertexCount,
+        std::vector<std::size_t>& clusterStarts,
+        const std::uint32_t cacheSize = defaults::cacheSize
+    ) -> void {
+        const std::size_t triangleCount = indices.size() / 3;
+        clusterStarts.clear();
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // Triangles around every vertex, in one array (`adjacencyOffsets` as the start of each vertex).
+        std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+        for (const GLuint index : indices) {
+            liveTriangles[index]++;
+        }
+        std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (std::size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+        std::vector<std::uint32_t> adjacency(indices.size());
+        {
+            std::vector<std::size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (std::size_t t = 0; t < triangleCount; t++) {
+                for (std::size_t corner = 0; corner < 3; corner++) {
+                    adjacency[fill[indices[t * 3 + corner]]++] = static_cast<std::uint32_t>(t);
+                }
+            }
+        }
+
+        std::vector<std::uint64_t> cachedAt(vertexCount, 0);
+        std::uint64_t time = cacheSize + 1;
+        std::vector<bool> isEmitted(triangleCount, false);
+        std::vector<GLuint> deadEnds;
+        std::vector<GLuint> candidates;
+        std::vector<GLuint> output;
+        output.reserve(indices.size());
+
+        std::size_t cursor = 0;
+        // Picks the next fanning vertex when the neighborhood has nothing left:
+        // the most recent dead end that still has triangles, or the next vertex in the input order.
+        const auto skipDeadEnd = [&]() -> std::optional<GLuint> {
+            while (!deadEnds.empty()) {
+                const GLuint vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0) {
+                    return vertex;
+                }
+            }
+            for (; cursor < vertexCount; cursor++) {
+                if (liveTriangles[cursor] > 0) {
+                    return static_cast<GLuint>(cursor);
+                }
+            }
+            return std::nullopt;
+        };
+
+        std::optional<GLuint> fanningVertex = skipDeadEnd();
+        clusterStarts.push_back(0);
+
+        while (fanningVertex.has_value()) {
+            candidates.clear();
+            const GLuint fan = *fanningVertex;
+
+            for (std::size_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; a++) {
+                const std::uint32_t triangle = adjacency[a];
+                if (isEmitted[triangle]) {
+                    continue;
+                }
+                for (std::size_t corner = 0; corner < 3; corner++) {
+                    const GLuint vertex = indices[triangle * 3 + corner];
+                    output.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (time - cachedAt[vertex] > cacheSize) {
+                        cachedAt[vertex] = time++;
+                    }
+                }
+                isEmitted[triangle] = true;
+            }
+
+            // The candidate that stays in the cache the longest while all its triangles get emitted.
+            std::optional<GLuint> best;
+            std::int64_t bestPriority = -1;
+            for (const GLuint vertex : candidates) {
+                if (liveTriangles[vertex] == 0) {
+                    continue;
+                }
+                std::int64_t priority = 0;
+                const auto age = static_cast<std::int64_t>(time - cachedAt[vertex]);
+                if (age + 2 * static_cast<std::int64_t>(liveTriangles[vertex]) <= cacheSize) {
+                    priority = age;
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    best = vertex;
+                }
+            }
+
+            if (best.has_value()) {
+                fanningVertex = best;
+            } else {
+                fanningVertex = skipDeadEnd();
+                if (fanningVertex.has_value() && output.size() < indices.size()) {
+                    clusterStarts.push_back(output.size());
+                }
+            }
+        }
+
+        indices = std::move(output);
+    }
+
+    /// Sorts the clusters from `optimizeVertexCache` so the ones facing out of the mesh
+    /// are drawn first and hide the rest behind them with the depth test (less overdraw).
+    /// The order inside the clusters is kept, so the cache locality stays nearly the same.
+    auto optimizeOverdraw(
+        std::vector<GLuint>& indices,
+        const std::span<const Vertex> vertices,
+        const std::span<const std::size_t> clusterStarts
+    ) -> void {
+        if (clusterStarts.size() < 2) {
+            return;
+        }
+
+        struct Cluster {
+            std::size_t begin;
+            std::size_t end;
+            glm::vec3 centroid{0.0f};
+            glm::vec3 normal{0.0f};
+            float area = 0.0f;
+            float sortKey = 0.0f;
+        };
+
+        std::vector<Cluster> clusters;
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+
+        for (std::size_t i = 0; i < clusterStarts.size(); i++) {
+            Cluster cluster {
+                .begin = clusterStarts[i],
+                .end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : indices.size(),
+            };
+
+            for (std::size_t t = cluster.begin; t < cluster.end; t += 3) {
+                const glm::vec3& a = vertices[indices[t]].position;
+                const glm::vec3& b = vertices[indices[t + 1]].position;
+                const glm::vec3& c = vertices[indices[t + 2]].position;
+                // Twice the area, pointing along the face normal.
+                const glm::vec3 areaNormal = glm::cross(b - a, c - a);
+                const float area = glm::length(areaNormal);
+                cluster.centroid += (a + b + c) / 3.0f * area;
+                cluster.normal += areaNormal;
+                cluster.area += area;
+            }
+
+            meshCentroid += cluster.centroid;
+            meshArea += cluster.area;
+            if (cluster.area > 0.0f) {
+                cluster.centroid /= cluster.area;
+            }
+            clusters.push_back(cluster);
+        }
+
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        for (auto& cluster : clusters) {
+            const float normalLength = glm::length(cluster.normal);
+            const glm::vec3 normal = normalLength > 0.0f ? cluster.normal / normalLength : glm::vec3(0.0f);
+            cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, normal);
+        }
+
+        std::ranges::stable_sort(clusters, std::greater{}, &Cluster::sortKey);
+
+        std::vector<GLuint> sorted;
+        sorted.reserve(indices.size());
+        for (const auto& cluster : clusters) {
+            sorted.insert(sorted.end(), indices.begin() + cluster.begin, indices.begin() + cluster.end);
+        }
+        indices = std::move(sorted);
+    }
+
+    /// Reorders the vertices in the order the indices first use them,
+    /// so the vertex fetch reads the vertex buffer mostly sequentially.
+    /// Vertices no triangle uses are dropped.
+    auto optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) -> void {
+        constexpr GLuint unused = std::numeric_limits<GLuint>::max();
+        std::vector<GLuint> remap(vertices.size(), unused);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (GLuint& index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = static_cast<GLuint>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices = std::move(reordered);
+    }
+
+    /// What the optimization did to one or more meshes.
+    struct Report {
+        std::size_t verticesBefore = 0;
+        std::size_t verticesAfter = 0;
+        std::size_t triangles = 0;
+        // Counts rather than ratios so the reports of many meshes can be added up.
+        // The ATVR is over the referenced vertices, before and after alike, the unreferenced
+        // and the duplicate vertices the welding removes would make the ratio before look better.
+        std::size_t missesBefore = 0;
+        std::size_t missesAfter = 0;
+        std::size_t referencedVerticesBefore = 0;
+        std::size_t referencedVerticesAfter = 0;
+
+        auto add(const Report& other) -> void {
+            verticesBefore += other.verticesBefore;
+            verticesAfter += other.verticesAfter;
+            triangles += other.triangles;
+            missesBefore += other.missesBefore;
+            missesAfter += other.missesAfter;
+            referencedVerticesBefore += other.referencedVerticesBefore;
+            referencedVerticesAfter += other.referencedVerticesAfter;
+        }
+
+        [[nodiscard]] auto getAcmrBefore() const -> double {
+            return triangles == 0 ? 0.0 : static_cast<double>(missesBefore) / static_cast<double>(triangles);
+        }
+
+        [[nodiscard]] auto getAcmrAfter() const -> double {
+            return triangles == 0 ? 0.0 : static_cast<double>(missesAfter) / static_cast<double>(triangles);
+        }
+
+        [[nodiscard]] auto getAtvrBefore() const -> double {
+            return referencedVerticesBefore == 0
+                ? 0.0 : static_cast<double>(missesBefore) / static_cast<double>(referencedVerticesBefore);
+        }
+
+        [[nodiscard]] auto getAtvrAfter() const -> double {
+            return referencedVerticesAfter == 0
+                ? 0.0 : static_cast<double>(missesAfter) / static_cast<double>(referencedVerticesAfter);
+        }
+    };
+
+    /// Runs the whole pipeline on the mesh: weld, vertex cache order, overdraw order, vertex fetch order.
+    auto optimizeMesh(cache::MeshData& mesh) -> Report {
+        Report report {
+            .verticesBefore = mesh.vertices.size(),
+            .triangles = mesh.indices.size() / 3,
+        };
+        const CacheStatistics before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        report.missesBefore = before.misses;
+        report.referencedVerticesBefore = before.referencedVertices;
+
+        weldVertices(mesh.vertices, mesh.indices);
+
+        std::vector<std::size_t> clusterStarts;
+        optimizeVertexCache(mesh.indices, mesh.vertices.size(), clusterStarts);
+        optimizeOverdraw(mesh.indices, mesh.vertices, clusterStarts);
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+        report.verticesAfter = mesh.vertices.size();
+        const CacheStatistics after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        report.missesAfter = after.misses;
+        report.referencedVerticesAfter = after.referencedVertices;
+        return report;
+    }
+
+    /// Optimizes every mesh of a model and prints the totals.
+    auto optimizeMeshes(std::vector<cache::MeshData>& meshes) -> Report {
+        using Clock = std::chrono::steady_clock;
+
+        const auto start = Clock::now();
+        Report total;
+        for (auto& mesh : meshes) {
+            total.add(optimizeMesh(mesh));
+        }
+        const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+        std::println("Optimized {} meshes in {:.1f} ms: vertices {} -> {}, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+            meshes.size(), elapsed.count(), total.verticesBefore, total.verticesAfter,
+            total.getAcmrBefore(), total.getAcmrAfter(), total.getAtvrBefore(), total.getAtvrAfter());
+        return total;
+    }
+}
@@ -0,0 +1,529 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+export module model.mesh_simplifier;
+
+import aabb;
+import file_mapping;
+import model.mesh_cache;
+import model.mesh_optimizer;
+import vertex_buffer.vertex_struct;
+
+export namespace model::simplifier::defaults {
+    /// The most levels of detail a mesh gets, the full one included.
+    constexpr std::size_t maxLevelCount = 6;
+    /// Each level aims for this fraction of the previous level's triangles.
+    constexpr float levelReduction = 0.5f;
+    /// Levels with fewer triangles than this aren't simplified any further.
+    constexpr std::size_t minTriangles = 64;
+    /// A level that doesn't remove at least this fraction of the previous one's triangles ends the chain.
+    constexpr float minLevelReduction = 0.2f;
+    /// Largest error a level may have, relative to the mesh's size (its bounds' longest axis).
+    constexpr float maxRelativeError = 0.05f;
+    /// How many pixels a level's error may cover on the screen before a finer level is drawn.
+    constexpr float maxPixelError = 1.0f;
+}
+
+namespace model::simplifier::detail {
+    /// How much harder the open borders resist moving than the surface does.
+    constexpr double borderWeight = 10.0;
+    /// A collapse is rejected if it turns a triangle by more than ~75 degrees, small turns
+    /// add up over the levels and anything close to 90 degrees ends up facing the wrong way.
+    constexpr float flipThreshold = 0.25f;
+
+    /// Sum of squared distances to a set of weighted planes (Garland, Heckbert:
+    /// "Surface Simplification Using Quadric Error Metrics", 1997). Symmetric 4x4, stored as its 10 unique values.
+    struct Quadric {
+        double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        /// Plane `dot(normal, p) + distance = 0`, `normal` must be normalized.
+        static auto fromPlane(const glm::dvec3& normal, const double distance, const double weight) -> Quadric {
+            return Quadric {
+                .a00 = weight * normal.x * normal.x, .a11 = weight * normal.y * normal.y, .a22 = weight * normal.z * normal.z,
+                .a01 = weight * normal.x * normal.y, .a02 = weight * normal.x * normal.z, .a12 = weight * normal.y * normal.z,
+                .b0 = weight * normal.x * distance, .b1 = weight * normal.y * distance, .b2 = weight * normal.z * distance,
+                .c = weight * distance * distance,
+                .weight = weight,
+            };
+        }
+
+        auto operator+=(const Quadric& other) -> Quadric& {
+            a00 += other.a00; a11 += other.a11; a22 += other.a22;
+            a01 += other.a01; a02 += other.a02; a12 += other.a12;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        /// Weighted average of the squared distances of `point` to the planes.
+        [[nodiscard]] auto evaluate(const glm::vec3& point) const -> double {
+            const double x = point.x, y = point.y, z = point.z;
+            const double sum = a00 * x * x + a11 * y * y + a22 * z * z
+                + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2.0 * (b0 * x + b1 * y + b2 * z)
+                + c;
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    enum class VertexKind : std::uint8_t {
+        Manifold, // Can collapse onto any neighbour.
+        Border,   // On an open edge, can only slide along it.
+        Locked,   // On a UV/normal seam or non-manifold, never moves.
+    };
+
+    auto makeEdgeKey(const GLuint from, const GLuint to) -> std::uint64_t {
+        return static_cast<std::uint64_t>(from) << 32 | to;
+    }
+
+    /// Maps every vertex onto the first vertex with the bit-exact same position.
+    /// The copies of a vertex along a seam share the position but not the other attributes.
+    auto buildPositionRemap(const std::span<const Vertex> vertices) -> std::vector<GLuint> {
+        struct PositionHash {
+            auto operator()(const glm::vec3& position) const -> std::size_t {
+                return file_mapping::hashValue(position);
+            }
+        };
+        struct PositionEqual {
+            auto operator()(const glm::vec3& a, const glm::vec3& b) const -> bool {
+                return std::bit_cast<std::array<std::uint32_t, 3>>(a) == std::bit_cast<std::array<std::uint32_t, 3>>(b);
+            }
+        };
+
+        std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> firstWithPosition;
+        firstWithPosition.reserve(vertices.size());
+        std::vector<GLuint> remap(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            remap[i] = firstWithPosition.try_emplace(vertices[i].position, static_cast<GLuint>(i)).first->second;
+        }
+        return remap;
+    }
+
+    /// Triangles using each vertex, in compressed rows (the triangles of vertex `v`
+    /// are `triangles[offsets[v]]` to `triangles[offsets[v + 1]]`).
+    struct Adjacency {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> triangles;
+
+        Adjacency(const std::span<const GLuint> indices, const std::size_t vertexCount)
+        : offsets(vertexCount + 1, 0), triangles(indices.size()) {
+            for (const GLuint index : indices) {
+                offsets[index + 1]++;
+            }
+            for (std::size_t v = 0; v < vertexCount; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+            std::vector<std::uint32_t> filled(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < indices.size(); i++) {
+                triangles[filled[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+            }
+        }
+
+        [[nodiscard]] auto of(const GLuint vertex) const -> std::span<const std::uint32_t> {
+            return std::span(triangles).subspan(offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+        }
+    };
+}
+
+export namespace model::simplifier {
+    struct SimplifiedIndices {
+        std::vector<GLuint> indices;
+        float error = 0.0f; // Largest distance from the original surface, in the vertices' units.
+    };
+}
+
+namespace model::simplifier::detail {
+    /// Edge collapse simplification state of one mesh. Every `simplifyTo` continues from where
+    /// the previous one ended, with the quadrics still measuring against the original surface,
+    /// so a whole chain of levels costs about as much as simplifying to the coarsest one.
+    class Simplifier {
+    private:
+        struct Collapse {
+            GLuint from;
+            GLuint to;
+            double cost; // Squared error.
+        };
+
+        std::span<const Vertex> vertices;
+        std::vector<GLuint> positionRemap;
+        // Of the current `result`, rebuilt whenever a pass of collapses changed it.
+        std::vector<std::uint64_t> halfEdges; // Between the welded positions, sorted.
+        std::vector<VertexKind> kinds;
+        std::vector<Quadric> quadrics; // Per welded position.
+
+        std::vector<GLuint> result;
+        double largestCost = 0.0;
+    public:
+        Simplifier(const std::span<const GLuint> indices, const std::span<const Vertex> vertices)
+        : vertices(vertices)
+        , positionRemap(buildPositionRemap(vertices))
+        , kinds(vertices.size(), VertexKind::Manifold)
+        , quadrics(vertices.size())
+        , result(indices.begin(), indices.end()) {
+            buildTopology();
+            accumulateQuadrics();
+        }
+
+        /// Collapses edges until about `targetIndexCount` indices are left
+        /// or no collapse is cheaper than `maxError`.
+        auto simplifyTo(const std::size_t targetIndexCount, const float maxError) -> SimplifiedIndices {
+            const double maxErrorSquared = static_cast<double>(maxError) * maxError;
+            std::vector<GLuint> remap(vertices.size());
+            std::vector<bool> isLocked(vertices.size());
+
+            // Every pass collapses the cheapest edges that don't touch each other, then compacts the triangles.
+            while (result.size() > targetIndexCount) {
+                const Adjacency adjacency(result, vertices.size());
+                const std::vector<Collapse> collapses = pickCollapses(maxErrorSquared);
+                if (collapses.empty()) {
+                    break;
+                }
+
+                // A collapse removes about two triangles, but many of them get skipped below because
+                // their vertices are already taken. The pass goes a bit over the error of the
+                // collapse that would reach the target if none were skipped, and no further.
+                const std::size_t trianglesToRemove = (result.size() - targetIndexCount) / 3 + 1;
+                const std::size_t collapseGoal = trianglesToRemove / 2;
+                const double passCostLimit = collapseGoal < collapses.size()
+                    ? collapses[collapseGoal].cost * 1.5 * 1.5
+                    : std::numeric_limits<double>::max();
+
+                std::iota(remap.begin(), remap.end(), 0);
+                std::fill(isLocked.begin(), isLocked.end(), false);
+                std::size_t removedTriangles = 0;
+                std::size_t collapseCount = 0;
+
+                for (const Collapse& collapse : collapses) {
+                    if (removedTriangles >= trianglesToRemove || collapse.cost > passCostLimit) {
+                        break;
+                    }
+                    if (isLocked[collapse.from] || isLocked[collapse.to] || flipsTriangle(adjacency, collapse)) {
+                        continue;
+                    }
+
+                    remap[collapse.from] = collapse.to;
+                    quadrics[positionRemap[collapse.to]] += quadrics[positionRemap[collapse.from]];
+                    // Triangles around `from` change, nothing else may touch them during this pass.
+                    for (const std::uint32_t triangle : adjacency.of(collapse.from)) {
+                        bool hasTo = false;
+                        for (std::size_t c = 0; c < 3; c++) {
+                            const GLuint vertex = result[triangle * 3 + c];
+                            isLocked[vertex] = true;
+                            hasTo = hasTo || vertex == collapse.to;
+                        }
+                        removedTriangles += hasTo;
+                    }
+                    largestCost = std::max(largestCost, collapse.cost);
+                    collapseCount++;
+                }
+
+                if (collapseCount == 0) {
+                    break;
+                }
+
+                std::size_t written = 0;
+                for (std::size_t t = 0; t < result.size(); t += 3) {
+                    const GLuint a = remap[result[t]];
+                    const GLuint b = remap[result[t + 1]];
+                    const GLuint c = remap[result[t + 2]];
+                    if (a != b && b != c && a != c) {
+                        result[written++] = a;
+                        result[written++] = b;
+                        result[written++] = c;
+                    }
+                }
+                result.resize(written);
+                // The collapses opened new borders and closed seams, the next pass (or level) classifies by the new triangles.
+                buildTopology();
+            }
+
+            return SimplifiedIndices { result, static_cast<float>(std::sqrt(largestCost)) };
+        }
+
+    private:
+        /// The half edges and the vertex kinds of the current triangles.
+        auto buildTopology() -> void {
+            halfEdges.clear();
+            halfEdges.reserve(result.size());
+            for (std::size_t t = 0; t < result.size(); t += 3) {
+                for (std::size_t e = 0; e < 3; e++) {
+                    halfEdges.push_back(makeEdgeKey(positionRemap[result[t + e]], positionRemap[result[t + (e + 1) % 3]]));
+                }
+            }
+            std::ranges::sort(halfEdges);
+
+            std::ranges::fill(kinds, VertexKind::Manifold);
+            classifyVertices();
+        }
+
+        [[nodiscard]] auto countHalfEdges(const GLuint from, const GLuint to) const -> std::size_t {
+            const auto [first, last] = std::ranges::equal_range(halfEdges, makeEdgeKey(positionRemap[from], positionRemap[to]));
+            return static_cast<std::size_t>(last - first);
+        }
+
+        /// The edge has a triangle only on one of its sides (in either direction).
+        [[nodiscard]] auto isBorderEdge(const GLuint a, const GLuint b) const -> bool {
+            return countHalfEdges(a, b) == 0 || countHalfEdges(b, a) == 0;
+        }
+
+        /// Positions used by more than one vertex are seams, they and non-manifold
+        /// edges are locked. Vertices on an open edge are borders.
+        auto classifyVertices() -> void {
+            std::vector<std::uint32_t> wedgeCount(vertices.size(), 0);
+            std::vector<bool> isReferenced(vertices.size(), false);
+            for (const GLuint index : result) {
+                if (!isReferenced[index]) {
+                    isReferenced[index] = true;
+                    wedgeCount[positionRemap[index]]++;
+                }
+            }
+
+            for (std::size_t v = 0; v < vertices.size(); v++) {
+                if (wedgeCount[positionRemap[v]] > 1) {
+                    kinds[v] = VertexKind::Locked;
+                }
+            }
+
+            for (std::size_t t = 0; t < result.size(); t += 3) {
+                for (std::size_t e = 0; e < 3; e++) {
+                    const GLuint from = result[t + e];
+                    const GLuint to = result[t + (e + 1) % 3];
+                    if (countHalfEdges(from, to) > 1) {
+                        // More than two triangles meet at this edge.
+                        kinds[from] = VertexKind::Locked;
+                        kinds[to] = VertexKind::Locked;
+                    } else if (countHalfEdges(to, from) == 0) {
+                        for (const GLuint vertex : { from, to }) {
+                            if (kinds[vertex] == VertexKind::Manifold) {
+                                kinds[vertex] = VertexKind::Border;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /// Area weighted planes of the triangles around each position, plus planes
+        /// perpendicular to the open edges so the borders keep their shape.
+        auto accumulateQuadrics() -> void {
+            for (std::size_t t = 0; t < result.size(); t += 3) {
+                const std::array<GLuint, 3> triangle = { result[t], result[t + 1], result[t + 2] };
+                const glm::dvec3 a(vertices[triangle[0]].position);
+                const glm::dvec3 b(vertices[triangle[1]].position);
+                const glm::dvec3 c(vertices[triangle[2]].position);
+                const glm::dvec3 areaNormal = glm::cross(b - a, c - a);
+                const double doubleArea = glm::length(areaNormal);
+                if (doubleArea == 0.0) {
+                    continue;
+                }
+
+                const glm::dvec3 normal = areaNormal / doubleArea;
+                const Quadric faceQuadric = Quadric::fromPlane(normal, -glm::dot(normal, a), doubleArea * 0.5);
+                for (const GLuint vertex : triangle) {
+                    quadrics[positionRemap[vertex]] += faceQuadric;
+                }
+
+                for (std::size_t e = 0; e < 3; e++) {
+                    const GLuint from = triangle[e];
+                    const GLuint to = triangle[(e + 1) % 3];
+                    if (countHalfEdges(to, from) != 0) {
+                        continue;
+                    }
+                    const glm::dvec3 p(vertices[from].position);
+                    const glm::dvec3 edge = glm::dvec3(vertices[to].position) - p;
+                    const double edgeLength = glm::length(edge);
+                    if (edgeLength == 0.0) {
+                        continue;
+                    }
+                    const glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+                    const Quadric borderQuadric = Quadric::fromPlane(
+                        borderNormal, -glm::dot(borderNormal, p), edgeLength * edgeLength * borderWeight);
+                    quadrics[positionRemap[from]] += borderQuadric;
+                    quadrics[positionRemap[to]] += borderQuadric;
+                }
+            }
+        }
+
+        /// The cheapest allowed collapse of every vertex, sorted by cost.
+        [[nodiscard]] auto pickCollapses(const double maxErrorSquared) const -> std::vector<Collapse> {
+            constexpr GLuint none = std::numeric_limits<GLuint>::max();
+            std::vector<Collapse> best(vertices.size(), Collapse { none, none, std::numeric_limits<double>::max() });
+
+            const auto consider = [&](const GLuint from, const GLuint to) {
+                if (kinds[from] == VertexKind::Locked
+                || (kinds[from] == VertexKind::Border && !isBorderEdge(from, to))) {
+                    return;
+                }
+                Quadric quadric = quadrics[positionRemap[from]];
+                quadric += quadrics[positionRemap[to]];
+                const double cost = quadric.evaluate(vertices[to].position);
+                if (cost <= maxErrorSquared && cost < best[from].cost) {
+                    best[from] = Collapse { from, to, cost };
+                }
+            };
+            for (std::size_t t = 0; t < result.size(); t += 3) {
+                for (std::size_t e = 0; e < 3; e++) {
+                    const GLuint a = result[t + e];
+                    const GLuint b = result[t + (e + 1) % 3];
+                    consider(a, b);
+                    consider(b, a);
+                }
+            }
+
+            std::vector<Collapse> collapses;
+            for (const Collapse& collapse : best) {
+                if (collapse.from != none) {
+                    collapses.push_back(collapse);
+                }
+            }
+            std::ranges::sort(collapses, std::less{}, &Collapse::cost);
+            return collapses;
+        }
+
+        /// Moving `from` onto `to` must not turn any of its other triangles over.
+        [[nodiscard]] auto flipsTriangle(const Adjacency& adjacency, const Collapse& collapse) const -> bool {
+            for (const std::uint32_t triangle : adjacency.of(collapse.from)) {
+                std::array<glm::vec3, 3> before{};
+                std::array<glm::vec3, 3> after{};
+                bool hasTo = false;
+                for (std::size_t c = 0; c < 3; c++) {
+                    const GLuint vertex = result[triangle * 3 + c];
+                    hasTo = hasTo || vertex == collapse.to;
+                    before[c] = vertices[vertex].position;
+                    after[c] = vertex == collapse.from ? vertices[collapse.to].position : before[c];
+                }
+                if (hasTo) {
+                    continue; // Degenerates and disappears.
+                }
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(normalBefore, normalAfter)
+                    <= flipThreshold * glm::length(normalBefore) * glm::length(normalAfter)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+export namespace model::simplifier {
+    /// Reduces the triangles down to about `targetIndexCount` indices by collapsing edges
+    /// in the order of their quadric error, never exceeding `maxError`. Collapses only move
+    /// vertices onto other existing vertices, so the result indexes the same vertex buffer.
+    /// Seams (vertices sharing a position) are kept in place so the UVs don't tear.
+    auto simplify(
+        const std::span<const GLuint> indices,
+        const std::span<const Vertex> vertices,
+        const std::size_t targetIndexCount,
+        const float maxError
+    ) -> SimplifiedIndices {
+        return detail::Simplifier(indices, vertices).simplifyTo(targetIndexCount, maxError);
+    }
+
+    /// Triangle counts before and after generating the levels of detail.
+    struct Report {
+        std::size_t meshes = 0;
+        std::size_t triangles = 0; // Of the full meshes.
+        std::size_t levels = 0; // Simplified levels generated (the full ones not counted).
+        std::size_t levelTriangles = 0; // Of all the simplified levels.
+        double milliseconds = 0.0;
+
+        auto add(const Report& other) -> void {
+            meshes += other.meshes;
+            triangles += other.triangles;
+            levels += other.levels;
+            levelTriangles += other.levelTriangles;
+            milliseconds += other.milliseconds;
+        }
+
+        /// Input triangles simplified per second, in millions.
+        [[nodiscard]] auto getMegaTrianglesPerSecond() const -> double {
+            return milliseconds > 0.0 ? static_cast<double>(triangles) / 1000.0 / milliseconds : 0.0;
+        }
+    };
+
+    /// Appends the simplified levels of detail after the mesh's indices and fills in `mesh.lods`
+    /// (the first one is the full mesh). The levels come out of one continued simplification,
+    /// so each level's error is measured against the full mesh. Each is ordered for the vertex cache.
+    auto generateLevelsOfDetail(cache::MeshData& mesh) -> Report {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+
+        const std::size_t fullIndexCount = mesh.indices.size();
+        mesh.lods = { cache::LevelOfDetail { 0, static_cast<std::uint32_t>(fullIndexCount), 0.0f } };
+
+        Report report { .meshes = 1, .triangles = fullIndexCount / 3 };
+
+        AABB bounds;
+        for (const Vertex& vertex : mesh.vertices) {
+            bounds.expand(vertex.position);
+        }
+        const glm::vec3 size = bounds.isEmpty() ? glm::vec3(0.0f) : bounds.max - bounds.min;
+        const float maxError = std::max({ size.x, size.y, size.z }) * defaults::maxRelativeError;
+
+        detail::Simplifier simplifier(std::span(mesh.indices).first(fullIndexCount), mesh.vertices);
+        std::size_t previousIndexCount = fullIndexCount;
+        while (mesh.lods.size() < defaults::maxLevelCount && previousIndexCount / 3 >= defaults::minTriangles) {
+            const auto targetIndexCount = static_cast<std::size_t>(previousIndexCount / 3 * defaults::levelReduction) * 3;
+            SimplifiedIndices level = simplifier.simplifyTo(targetIndexCount, maxError);
+
+            if (level.indices.empty()
+            || static_cast<float>(level.indices.size()) > static_cast<float>(previousIndexCount) * (1.0f - defaults::minLevelReduction)) {
+                break;
+            }
+
+            std::vector<std::size_t> clusterStarts;
+            optimizer::optimizeVertexCache(level.indices, mesh.vertices.size(), clusterStarts);
+
+            mesh.lods.push_back(cache::LevelOfDetail {
+                static_cast<std::uint32_t>(mesh.indices.size()), static_cast<std::uint32_t>(level.indices.size()), level.error,
+            });
+            mesh.indices.insert(mesh.indices.end(), level.indices.begin(), level.indices.end());
+
+            report.levels++;
+            report.levelTriangles += level.indices.size() / 3;
+            previousIndexCount = level.indices.size();
+        }
+
+        report.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return report;
+    }
+
+    auto generateLevelsOfDetail(std::vector<cache::MeshData>& meshes) -> Report {
+        Report total;
+        for (auto& mesh : meshes) {
+            total.add(generateLevelsOfDetail(mesh));
+        }
+
+        std::println("Generated {} levels of detail for {} meshes in {:.1f} ms ({:.2f} MTris/s): {} triangles -> {} in the simplified levels",
+            total.levels, total.meshes, total.milliseconds, total.getMegaTrianglesPerSecond(),
+            total.triangles, total.levelTriangles);
+        return total;
+    }
+
+    /// Picks the coarsest level whose error, projected onto the screen, stays under `maxPixelError`.
+    /// `pixelsPerUnit` is how many pixels one unit of the mesh's vertex space covers where the mesh is.
+    /// Without levels (meshes that weren't simplified) it's always the full mesh.
+    auto selectLevelOfDetail(
+        const std::span<const cache::LevelOfDetail> lods,
+        const float pixelsPerUnit,
+        const float maxPixelError = defaults::maxPixelError
+    ) -> std::size_t {
+        std::size_t selected = 0;
+        for (std::size_t i = 1; i < lods.size() && lods[i].error * pixelsPerUnit <= maxPixelError; i++) {
+            selected = i;
+        }
+        return selected;
+    }
+}
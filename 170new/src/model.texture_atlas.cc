@@ -0,0 +1,380 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+
+export module model.texture_atlas;
+
+import texture;
+import texture.compression;
+import model.mesh_cache;
+
+export namespace model::atlas::defaults {
+    /// Textures larger than this (in either direction) are left as they are.
+    constexpr int maxTextureSize = 256;
+    /// Largest atlas, shrunk to what its textures take up. The packed vertices' UVs are half floats,
+    /// at this size they are off by a quarter of a texel at most.
+    constexpr int atlasSize = 1024;
+    /// Texels of every texture's edge repeated around it, so the sampling at the edge
+    /// (and the mips' texels next to it) doesn't pick up the neighbours.
+    constexpr int padding = 8;
+    /// Textures are placed at multiples of this, so a texel of the mip levels up to
+    /// log2(alignment) (0 to 3) never mixes two textures. Coarser mips do, they are blurry anyway.
+    constexpr int alignment = 8;
+    /// The atlases are written next to the model, in a format STB decodes.
+    constexpr std::string_view fileExtension = ".tga";
+}
+
+/// Bottom-left skyline rectangle packer. The skyline is the top edge of everything placed
+/// so far, a rectangle goes where it ends up lowest (then leftmost) on top of it.
+/// The space below the skyline that a placement covers is lost, fine for rectangles of similar sizes.
+export class SkylinePacker {
+private:
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width;
+    int height;
+    // From left to right, covers the whole width.
+    std::vector<Segment> skyline;
+    glm::ivec2 usedSize = glm::ivec2(0);
+public:
+    SkylinePacker(const int width, const int height)
+    : width(width), height(height), skyline{ Segment { 0, 0, width } } {}
+
+    /// Places a rectangle of the size and returns its bottom-left corner, none if it doesn't fit.
+    auto insert(const int rectangleWidth, const int rectangleHeight) -> std::optional<glm::ivec2> {
+        std::optional<std::size_t> bestIndex;
+        glm::ivec2 bestPosition(0);
+        for (std::size_t i = 0; i < skyline.size(); i++) {
+            const std::optional<int> y = fit(i, rectangleWidth, rectangleHeight);
+            if (!y.has_value()) {
+                continue;
+            }
+            if (!bestIndex.has_value() || *y < bestPosition.y) {
+                bestIndex = i;
+                bestPosition = glm::ivec2(skyline[i].x, *y);
+            }
+        }
+        if (!bestIndex.has_value()) {
+            return std::nullopt;
+        }
+
+        // The rectangle's top becomes a new segment, the ones it covers are cut off.
+        const int right = bestPosition.x + rectangleWidth;
+        skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(*bestIndex),
+            Segment { bestPosition.x, bestPosition.y + rectangleHeight, rectangleWidth });
+        for (std::size_t i = *bestIndex + 1; i < skyline.size() && skyline[i].x < right;) {
+            const int cut = right - skyline[i].x;
+            skyline[i].x += cut;
+            skyline[i].width -= cut;
+            if (skyline[i].width <= 0) {
+                skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                break;
+            }
+        }
+        // Neighbours at the same height are one segment.
+        for (std::size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+            } else {
+                i++;
+            }
+        }
+
+        usedSize = glm::max(usedSize, bestPosition + glm::ivec2(rectangleWidth, rectangleHeight));
+        return bestPosition;
+    }
+
+    /// Bounding box of everything placed, from the origin.
+    [[nodiscard]] auto getUsedSize() const -> glm::ivec2 {
+        return usedSize;
+    }
+
+private:
+    /// How high the rectangle would sit with its left edge at the segment `index`, none if it wouldn't fit.
+    [[nodiscard]] auto fit(const std::size_t index, const int rectangleWidth, const int rectangleHeight) const -> std::optional<int> {
+        if (skyline[index].x + rectangleWidth > width) {
+            return std::nullopt;
+        }
+        int y = 0;
+        int remainingWidth = rectangleWidth;
+        for (std::size_t i = index; remainingWidth > 0; i++) {
+            y = std::max(y, skyline[i].y);
+            if (y + rectangleHeight > height) {
+                return std::nullopt;
+            }
+            remainingWidth -= skyline[i].width;
+        }
+        return y;
+    }
+};
+
+export namespace model::atlas {
+    /// The maps of one of the imported model's materials. `isInUnitSquare` tells whether every mesh
+    /// with the material keeps its texture coordinates in [0, 1], an atlased texture can't repeat.
+    struct MaterialMaps {
+        std::vector<cache::TextureReference> maps;
+        bool isInUnitSquare = true;
+    };
+
+    /// Where a material's maps ended up in the atlases.
+    struct Placement {
+        glm::vec2 offset;
+        glm::vec2 scale;
+        std::vector<cache::TextureReference> maps; // The atlases that replace the material's maps.
+
+        /// The texture coordinates of the material's meshes in the atlases.
+        [[nodiscard]] auto remap(const glm::vec2 textureCoordinates) const -> glm::vec2 {
+            return offset + textureCoordinates * scale;
+        }
+    };
+
+    struct Report {
+        std::size_t textureCountBefore = 0; // Texture objects the materials needed.
+        std::size_t textureCountAfter = 0; // With the atlases.
+        std::size_t atlasedTextureCount = 0;
+        std::size_t atlasCount = 0;
+        std::uint64_t atlasArea = 0; // In texels.
+        std::uint64_t wastedArea = 0; // Padding and the space nothing was packed into.
+    };
+
+    struct PackedMaterials {
+        std::vector<std::optional<Placement>> placements; // Per material, none for the ones left as they were.
+        Report report;
+    };
+}
+
+namespace model::atlas::detail {
+    constexpr auto alignUp(const int value) -> int {
+        return (value + defaults::alignment - 1) / defaults::alignment * defaults::alignment;
+    }
+
+    /// Materials whose maps are atlased together. The maps are packed at the same place in
+    /// every atlas of a page, one atlas per map, so the meshes keep one set of texture coordinates.
+    struct Page {
+        SkylinePacker packer { defaults::atlasSize, defaults::atlasSize };
+        std::vector<std::pair<std::size_t, glm::ivec2>> entries; // The material and its cell's corner.
+    };
+
+    /// The maps' types and channel counts, the materials with the same ones can share a page.
+    using PageKey = std::vector<std::pair<texture::Type, int>>;
+
+    /// Writes an uncompressed TGA (grayscale, BGR or BGRA), bottom row first like the `pixels`.
+    auto writeTga(
+        const std::string& filepath,
+        const int width,
+        const int height,
+        const int channels,
+        const std::span<const std::uint8_t> pixels
+    ) -> void {
+        std::array<std::uint8_t, 18> header{};
+        header[2] = channels == 1 ? 3 : 2; // Uncompressed grayscale or true color.
+        header[12] = static_cast<std::uint8_t>(width & 0xFF);
+        header[13] = static_cast<std::uint8_t>(width >> 8);
+        header[14] = static_cast<std::uint8_t>(height & 0xFF);
+        header[15] = static_cast<std::uint8_t>(height >> 8);
+        header[16] = static_cast<std::uint8_t>(channels * 8);
+        header[17] = channels == 4 ? 8 : 0; // Alpha bits, the origin is the bottom-left corner.
+
+        std::vector<std::uint8_t> data(pixels.begin(), pixels.end());
+        if (channels >= 3) {
+            for (std::size_t i = 0; i < data.size(); i += static_cast<std::size_t>(channels)) {
+                std::swap(data[i], data[i + 2]);
+            }
+        }
+
+        std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            throw std::runtime_error("Could not write texture atlas: " + filepath);
+        }
+    }
+
+    /// Copies the `image` into the `atlas` with its bottom-left corner at `position`,
+    /// its edge texels repeated `defaults::padding` texels around it.
+    auto blit(
+        std::vector<std::uint8_t>& atlas,
+        const int atlasWidth,
+        const texture::Image& image,
+        const glm::ivec2 position
+    ) -> void {
+        const auto channels = static_cast<std::size_t>(image.channels);
+        for (int y = -defaults::padding; y < image.height + defaults::padding; y++) {
+            const int sourceY = std::clamp(y, 0, image.height - 1);
+            for (int x = -defaults::padding; x < image.width + defaults::padding; x++) {
+                const int sourceX = std::clamp(x, 0, image.width - 1);
+                const std::size_t source = (static_cast<std::size_t>(sourceY) * image.width + sourceX) * channels;
+                const std::size_t destination =
+                    (static_cast<std::size_t>(position.y + y) * atlasWidth + position.x + x) * channels;
+                std::copy_n(image.pixels.get() + source, channels, atlas.data() + destination);
+            }
+        }
+    }
+}
+
+export namespace model::atlas {
+    /// Packs the small textures of the `materials` into atlases, written next to the model
+    /// (`basePath`) as `<atlasName>.atlas<page>.<map><defaults::fileExtension>`. A material is atlased
+    /// if its texture coordinates stay in [0, 1] and its maps are all the same size, at most
+    /// `defaults::maxTextureSize`, and uncompressed. Pages that would hold one material are dropped.
+    /// Runs when the model is cooked, the mesh cache keeps the atlases' paths.
+    auto packMaterials(
+        const std::span<const MaterialMaps> materials,
+        const std::string& basePath,
+        const std::string& atlasName
+    ) -> PackedMaterials {
+        PackedMaterials packed;
+        packed.placements.resize(materials.size());
+
+        std::set<std::string> texturesBefore;
+        for (const MaterialMaps& material : materials) {
+            for (const auto& map : material.maps) {
+                texturesBefore.insert(map.path);
+            }
+        }
+
+        // Every texture that could be atlased, decoded once.
+        std::map<std::string, texture::Image> images;
+        std::map<detail::PageKey, std::vector<std::size_t>> materialsByKey;
+        // Materials with the same maps share the placement of the first of them.
+        std::map<std::vector<std::string>, std::size_t> firstMaterialByMaps;
+        std::vector<std::size_t> sameMapsAs(materials.size());
+        for (std::size_t i = 0; i < materials.size(); i++) {
+            const MaterialMaps& material = materials[i];
+            sameMapsAs[i] = i;
+            if (!material.isInUnitSquare || material.maps.empty()) {
+                continue;
+            }
+            std::vector<std::string> paths;
+            for (const auto& map : material.maps) {
+                paths.push_back(map.path);
+            }
+            const auto [first, inserted] = firstMaterialByMaps.try_emplace(paths, i);
+            if (!inserted) {
+                sameMapsAs[i] = first->second;
+                continue;
+            }
+
+            detail::PageKey key;
+            std::optional<glm::ivec2> size;
+            bool isAtlasable = true;
+            for (const auto& map : material.maps) {
+                const std::string filepath = basePath + map.path;
+                if (texture::compression::isCompressedFile(filepath)) {
+                    isAtlasable = false;
+                    break;
+                }
+                if (!images.contains(map.path)) {
+                    try {
+                        images.emplace(map.path, texture::decodeImage(filepath));
+                    } catch (const std::runtime_error&) {
+                        // Left to fail where the texture gets loaded.
+                        isAtlasable = false;
+                        break;
+                    }
+                }
+                const texture::Image& image = images.at(map.path);
+                const glm::ivec2 imageSize(image.width, image.height);
+                if (imageSize.x > defaults::maxTextureSize || imageSize.y > defaults::maxTextureSize
+                || (size.has_value() && *size != imageSize)
+                || image.channels == 2) { // TGA has no two channel images.
+                    isAtlasable = false;
+                    break;
+                }
+                size = imageSize;
+                key.emplace_back(map.type, image.channels);
+            }
+            if (isAtlasable) {
+                materialsByKey[key].push_back(i);
+            }
+        }
+
+        std::vector<std::pair<detail::PageKey, detail::Page>> pages;
+        for (auto& [key, materialIndices] : materialsByKey) {
+            // Tallest first, the skyline stays flatter.
+            std::ranges::stable_sort(materialIndices, std::greater{}, [&](const std::size_t i) {
+                return images.at(materials[i].maps.front().path).height;
+            });
+
+            const std::size_t firstPage = pages.size();
+            for (const std::size_t i : materialIndices) {
+                const texture::Image& image = images.at(materials[i].maps.front().path);
+                const int cellWidth = detail::alignUp(image.width + 2 * defaults::padding);
+                const int cellHeight = detail::alignUp(image.height + 2 * defaults::padding);
+
+                std::optional<glm::ivec2> cell;
+                for (std::size_t page = firstPage; page < pages.size() && !cell.has_value(); page++) {
+                    cell = pages[page].second.packer.insert(cellWidth, cellHeight);
+                    if (cell.has_value()) {
+                        pages[page].second.entries.emplace_back(i, *cell);
+                    }
+                }
+                if (!cell.has_value()) {
+                    pages.emplace_back(key, detail::Page{});
+                    cell = pages.back().second.packer.insert(cellWidth, cellHeight);
+                    pages.back().second.entries.emplace_back(i, *cell);
+                }
+            }
+        }
+
+        for (const auto& [key, page] : pages) {
+            if (page.entries.size() < 2) {
+                continue;
+            }
+            const std::size_t pageIndex = packed.report.atlasCount++;
+            const glm::ivec2 atlasSize = page.packer.getUsedSize();
+
+            std::uint64_t usedArea = 0;
+            std::vector<cache::TextureReference> atlasMaps;
+            for (std::size_t mapIndex = 0; mapIndex < key.size(); mapIndex++) {
+                const auto [type, channels] = key[mapIndex];
+                std::vector<std::uint8_t> pixels(static_cast<std::size_t>(atlasSize.x) * atlasSize.y * channels, 0);
+                for (const auto& [i, cell] : page.entries) {
+                    const glm::ivec2 position = cell + glm::ivec2(defaults::padding);
+                    detail::blit(pixels, atlasSize.x, images.at(materials[i].maps[mapIndex].path), position);
+                }
+
+                const std::string atlasPath = std::format("{}.atlas{}.{}{}",
+                    atlasName, pageIndex, mapIndex, defaults::fileExtension);
+                detail::writeTga(basePath + atlasPath, atlasSize.x, atlasSize.y, channels, pixels);
+                atlasMaps.push_back(cache::TextureReference { .type = type, .path = atlasPath });
+            }
+
+            for (const auto& [i, cell] : page.entries) {
+                const texture::Image& image = images.at(materials[i].maps.front().path);
+                const glm::vec2 position = glm::vec2(cell + glm::ivec2(defaults::padding));
+                packed.placements[i] = Placement {
+                    .offset = position / glm::vec2(atlasSize),
+                    .scale = glm::vec2(image.width, image.height) / glm::vec2(atlasSize),
+                    .maps = atlasMaps,
+                };
+                packed.report.atlasedTextureCount += key.size();
+                usedArea += static_cast<std::uint64_t>(image.width) * image.height;
+            }
+            packed.report.atlasArea += static_cast<std::uint64_t>(atlasSize.x) * atlasSize.y;
+            packed.report.wastedArea += static_cast<std::uint64_t>(atlasSize.x) * atlasSize.y - usedArea;
+        }
+
+        std::set<std::string> texturesAfter;
+        for (std::size_t i = 0; i < materials.size(); i++) {
+            packed.placements[i] = packed.placements[sameMapsAs[i]];
+            const auto& maps = packed.placements[i].has_value() ? packed.placements[i]->maps : materials[i].maps;
+            for (const auto& map : maps) {
+                texturesAfter.insert(map.path);
+            }
+        }
+        packed.report.textureCountBefore = texturesBefore.size();
+        packed.report.textureCountAfter = texturesAfter.size();
+        return packed;
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+
+export module ray;
+
+import aabb;
+
+/// Half-line from `origin` along `direction`. The points on it are `origin + t * direction`
+/// for t >= 0, so the distances returned by the intersections are in units of the direction's length.
+export struct Ray {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    [[nodiscard]] auto at(const float t) const -> glm::vec3 {
+        return origin + t * direction;
+    }
+
+    /// Component-wise 1 / direction, what the box intersection needs. Computed once per ray.
+    [[nodiscard]] auto getInverseDirection() const -> glm::vec3 {
+        return 1.0f / direction;
+    }
+};
+
+/// Where a ray hit a triangle: t along the ray and the barycentric coordinates of the
+/// hit point (weights of the second and third corner, the first gets `1 - u - v`).
+export struct TriangleIntersection {
+    float t;
+    float u;
+    float v;
+};
+
+export namespace ray {
+    /// Slab test. Returns the t at which the ray enters the box (0 if it starts inside)
+    /// if it does so before `maxT`. Dividing by a zero direction gives infinities, which the
+    /// min/max handle, except for an origin exactly on a slab's plane (a NaN, counted as a miss).
+    auto intersect(const Ray& ray, const glm::vec3& inverseDirection, const AABB& box, const float maxT) -> std::optional<float> {
+        const glm::vec3 t0 = (box.min - ray.origin) * inverseDirection;
+        const glm::vec3 t1 = (box.max - ray.origin) * inverseDirection;
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+        const float enter = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+        const float exit = std::min({ tFar.x, tFar.y, tFar.z, maxT });
+        if (!(enter <= exit)) {
+            return std::nullopt;
+        }
+        return enter;
+    }
+
+    /// Möller-Trumbore. Both sides of the triangle are hit, degenerate triangles never are.
+    auto intersect(
+        const Ray& ray,
+        const glm::vec3& a,
+        const glm::vec3& b,
+        const glm::vec3& c,
+        const float maxT
+    ) -> std::optional<TriangleIntersection> {
+        constexpr float epsilon = 1e-9f;
+        const glm::vec3 edge1 = b - a;
+        const glm::vec3 edge2 = c - a;
+        const glm::vec3 p = glm::cross(ray.direction, edge2);
+        const float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) < epsilon) {
+            return std::nullopt;
+        }
+        const float inverseDeterminant = 1.0f / determinant;
+        const glm::vec3 s = ray.origin - a;
+        const float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            return std::nullopt;
+        }
+        const glm::vec3 q = glm::cross(s, edge1);
+        const float v = glm::dot(ray.direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            return std::nullopt;
+        }
+        const float t = glm::dot(edge2, q) * inverseDeterminant;
+        if (t < 0.0f || t > maxT) {
+            return std::nullopt;
+        }
+        return TriangleIntersection { t, u, v };
+    }
+}
@@ -0,0 +1,196 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module render_queue;
+
+export namespace render_queue {
+    /// Passes run in this order, the pass is the key's most significant field.
+    enum class Pass : std::uint8_t {
+        Opaque = 0,
+        Skybox = 1, // After the opaque draws, only the pixels they left uncovered run its shader.
+        Translucent = 2, // Blended over everything else.
+        Overlay = 3,
+    };
+
+    /// The draw's 64-bit sort key, from the most significant bits:
+    ///  - opaque:      pass (4) | 0 (1) | shader (12) | material (16) | depth (24) | 0 (7),
+    ///  - translucent: pass (4) | 1 (1) | far-to-near depth (24) | shader (12) | material (16) | 0 (7).
+    /// Opaque draws are grouped by state then drawn front to back (for early-Z), the translucent
+    /// ones are drawn back to front (for correct blending) and grouped by state only at the same depth.
+    using Key = std::uint64_t;
+
+    /// One submitted draw, `item` tells the caller which one (an index into its own draws).
+    struct Entry {
+        Key key = 0;
+        std::uint32_t item = 0;
+    };
+}
+
+export namespace render_queue::defaults {
+    constexpr std::uint32_t passBits = 4;
+    constexpr std::uint32_t shaderBits = 12;
+    constexpr std::uint32_t materialBits = 16;
+    constexpr std::uint32_t depthBits = 24;
+}
+
+namespace render_queue::detail {
+    constexpr std::uint32_t translucencyShift = 64 - defaults::passBits - 1;
+
+    /// The lowest `bits` bits of the `value`, IDs past them wrap around (they only sort worse).
+    constexpr auto field(const std::uint64_t value, const std::uint32_t bits) -> std::uint64_t {
+        return value & ((std::uint64_t(1) << bits) - 1);
+    }
+
+    constexpr auto passField(const Pass pass) -> Key {
+        return field(static_cast<std::uint64_t>(pass), defaults::passBits) << (64 - defaults::passBits);
+    }
+
+    /// Bits per digit of the radix sort, 8 passes over the keys at most.
+    constexpr std::uint32_t radixBits = 8;
+    constexpr std::size_t radixSize = std::size_t(1) << radixBits;
+    constexpr std::uint32_t digitCount = 64 / radixBits;
+}
+
+export namespace render_queue {
+    /// `normalizedDepth` (0 at the near plane, 1 at the far one, clamped) quantized into `defaults::depthBits` bits.
+    [[nodiscard]] constexpr auto quantizeDepth(const float normalizedDepth) -> std::uint32_t {
+        constexpr auto maxDepth = static_cast<float>((std::uint32_t(1) << defaults::depthBits) - 1);
+        return static_cast<std::uint32_t>(std::clamp(normalizedDepth, 0.0f, 1.0f) * maxDepth);
+    }
+
+    /// Key of an opaque draw, sorted by `shader`, then `material`, then front to back.
+    [[nodiscard]] constexpr auto makeOpaqueKey(
+        const Pass pass,
+        const std::uint32_t shader,
+        const std::uint32_t material,
+        const float normalizedDepth
+    ) -> Key {
+        using namespace defaults;
+        constexpr std::uint32_t materialShift = 7 + depthBits;
+        constexpr std::uint32_t shaderShift = materialShift + materialBits;
+        return detail::passField(pass)
+            | detail::field(shader, shaderBits) << shaderShift
+            | detail::field(material, materialBits) << materialShift
+            | detail::field(quantizeDepth(normalizedDepth), depthBits) << 7;
+    }
+
+    /// Key of a translucent draw, sorted back to front, then by `shader` and `material`.
+    [[nodiscard]] constexpr auto makeTranslucentKey(
+        const Pass pass,
+        const std::uint32_t shader,
+        const std::uint32_t material,
+        const float normalizedDepth
+    ) -> Key {
+        using namespace defaults;
+        constexpr std::uint32_t materialShift = 7;
+        constexpr std::uint32_t shaderShift = materialShift + materialBits;
+        constexpr std::uint32_t depthShift = shaderShift + shaderBits;
+        constexpr std::uint32_t maxDepth = (std::uint32_t(1) << depthBits) - 1;
+        return detail::passField(pass)
+            | Key(1) << detail::translucencyShift
+            | detail::field(maxDepth - quantizeDepth(normalizedDepth), depthBits) << depthShift
+            | detail::field(shader, shaderBits) << shaderShift
+            | detail::field(material, materialBits) << materialShift;
+    }
+
+    [[nodiscard]] constexpr auto isTranslucent(const Key key) -> bool {
+        return (key >> detail::translucencyShift & 1) != 0;
+    }
+
+    [[nodiscard]] constexpr auto getPass(const Key key) -> Pass {
+        return static_cast<Pass>(key >> (64 - defaults::passBits));
+    }
+
+    /// Sorts the `entries` by their keys, stable. LSD radix sort, one byte of the keys per pass,
+    /// so it's linear in the number of entries. The bytes that are the same in every key (the unused
+    /// fields, the passes nobody submitted to) are skipped. `scratch` is resized to the entries' size.
+    auto radixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch) -> void {
+        using namespace detail;
+        if (entries.size() <= 1) {
+            return;
+        }
+
+        // Histograms of every digit in one read of the keys.
+        std::array<std::array<std::uint32_t, radixSize>, digitCount> histograms{};
+        for (const Entry& entry : entries) {
+            for (std::uint32_t digit = 0; digit < digitCount; digit++) {
+                histograms[digit][(entry.key >> (digit * radixBits)) & (radixSize - 1)]++;
+            }
+        }
+
+        scratch.resize(entries.size());
+        std::vector<Entry>* source = &entries;
+        std::vector<Entry>* destination = &scratch;
+        for (std::uint32_t digit = 0; digit < digitCount; digit++) {
+            const auto& histogram = histograms[digit];
+            const std::uint64_t firstDigit = ((*source)[0].key >> (digit * radixBits)) & (radixSize - 1);
+            if (histogram[firstDigit] == entries.size()) {
+                continue;
+            }
+
+            // Where each digit's entries start in the destination.
+            std::array<std::uint32_t, radixSize> offsets;
+            std::uint32_t offset = 0;
+            for (std::size_t i = 0; i < radixSize; i++) {
+                offsets[i] = offset;
+                offset += histogram[i];
+            }
+            Entry* const output = destination->data();
+            const std::uint32_t shift = digit * radixBits;
+            for (const Entry& entry : *source) {
+                output[offsets[(entry.key >> shift) & (radixSize - 1)]++] = entry;
+            }
+            std::swap(source, destination);
+        }
+
+        // An odd number of passes ends in the scratch buffer.
+        if (source != &entries) {
+            entries.swap(scratch);
+        }
+    }
+}
+
+/// Draws submitted in any order, executed in the order of their keys (see `render_queue::Key`).
+/// The queue only sorts, the caller keeps its draws and executes them by the sorted entries' `item`s.
+/// Cleared and refilled every frame, its memory is reused.
+export class RenderQueue {
+private:
+    std::vector<render_queue::Entry> entries;
+    // The radix sort's second buffer.
+    std::vector<render_queue::Entry> scratch;
+public:
+    auto clear() -> void {
+        entries.clear();
+    }
+
+    auto reserve(const std::size_t count) -> void {
+        entries.reserve(count);
+        scratch.reserve(count);
+    }
+
+    auto submit(const render_queue::Key key, const std::uint32_t item) -> void {
+        entries.push_back(render_queue::Entry { key, item });
+    }
+
+    /// Sorts the submitted draws into the order they are to be executed in.
+    auto sort() -> void {
+        render_queue::radixSort(entries, scratch);
+    }
+
+    /// The submitted draws, in the order of their keys after `sort`.
+    [[nodiscard]] auto getEntries() const -> std::span<const render_queue::Entry> {
+        return entries;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t {
+        return entries.size();
+    }
+
+    [[nodiscard]] auto empty() const -> bool {
+        return entries.empty();
+    }
+};
@@ -0,0 +1,175 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module shader_program.binary_cache;
+
+import file_mapping;
+
+// Layout of a cached program binary:
+//
+//   Header
+//   std::uint8_t binary[binaryLength] (what glGetProgramBinary returned)
+
+namespace program_binary::detail {
+    constexpr std::array<char, 8> magic = { 'P', 'R', 'O', 'G', 'B', 'I', 'N', '0' };
+
+    struct Header {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t binaryFormat;
+        std::uint64_t key;
+        std::uint64_t binaryLength;
+    };
+
+    /// The driver's identity and the binary formats it accepts. A binary is only good for the driver
+    /// (and the version of it) that made it. Asked for once, every program is made by the same context.
+    auto hashDriver() -> std::uint64_t {
+        static const std::uint64_t driverHash = [] {
+            std::uint64_t hash = file_mapping::fnvOffsetBasis;
+            for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                const auto string = reinterpret_cast<const char*>(glGetString(name));
+                const std::string_view view = string != nullptr ? string : "";
+                hash = file_mapping::hashBytes(view.data(), view.size(), hash);
+                hash = file_mapping::hashValue('\0', hash);
+            }
+            GLint formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            std::vector<GLint> formats(static_cast<std::size_t>(formatCount));
+            glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+            return file_mapping::hashBytes(formats.data(), formats.size() * sizeof(GLint), hash);
+        }();
+        return driverHash;
+    }
+}
+
+export namespace program_binary::defaults {
+    /// The binaries are written here, one file per program.
+    constexpr std::string_view directory = "./.shadercache";
+    constexpr std::string_view fileExtension = ".programbin";
+}
+
+export namespace program_binary {
+    /// Bump this whenever the file layout changes.
+    constexpr std::uint32_t version = 1;
+
+    enum class LoadResult {
+        Hit,
+        Miss, // No binary for the program, or it was written by something else.
+        Rejected, // The driver didn't take the binary (e.g. it was updated), the program has to be compiled.
+    };
+
+    /// How the programs were created, and how long it took. Cold starts compile everything,
+    /// warm ones load everything from the cache.
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t compiles = 0;
+        std::size_t rejected = 0;
+        std::chrono::steady_clock::duration loadTime{};
+        // Spent on the main thread submitting the programs and checking them, the driver
+        // compiles in between (on its own threads with GL_KHR_parallel_shader_compile).
+        std::chrono::steady_clock::duration compileTime{};
+    };
+
+    /// Whether the driver can hand out program binaries at all.
+    [[nodiscard]] auto isSupported() -> bool {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    /// Key of the program linked from the fully expanded `sources` (every stage, includes resolved)
+    /// by the current driver.
+    [[nodiscard]] auto makeKey(const std::span<const std::string_view> sources) -> std::uint64_t {
+        std::uint64_t hash = detail::hashDriver();
+        for (const std::string_view source : sources) {
+            hash = file_mapping::hashValue(source.size(), hash);
+            hash = file_mapping::hashBytes(source.data(), source.size(), hash);
+        }
+        return hash;
+    }
+
+    [[nodiscard]] auto getCachePath(const std::uint64_t key) -> std::string {
+        return std::format("{}/{:016x}{}", defaults::directory, key, defaults::fileExtension);
+    }
+
+    /// Loads the cached binary of the program `key` into the (new, not linked) `programID`.
+    /// A binary the driver rejects is deleted, the program compiled in its place writes a new one.
+    auto load(const GLuint programID, const std::uint64_t key) -> LoadResult {
+        const std::string cachePath = getCachePath(key);
+        const MappedFile file(cachePath);
+        if (!file.isOpen()) {
+            return LoadResult::Miss;
+        }
+
+        const detail::Header* header = file.at<detail::Header>(0);
+        if (header == nullptr
+        || header->magic != detail::magic
+        || header->version != version
+        || header->key != key
+        || file.at<std::uint8_t>(sizeof(detail::Header), header->binaryLength) == nullptr) {
+            return LoadResult::Miss;
+        }
+
+        glProgramBinary(programID, header->binaryFormat, file.data() + sizeof(detail::Header),
+            static_cast<GLsizei>(header->binaryLength));
+        GLint isLinked = GL_FALSE;
+        glGetProgramiv(programID, GL_LINK_STATUS, &isLinked);
+        if (isLinked == GL_FALSE) {
+            std::error_code error;
+            std::filesystem::remove(cachePath, error);
+            return LoadResult::Rejected;
+        }
+        return LoadResult::Hit;
+    }
+
+    /// Writes the binary of the linked `programID` (linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    /// as the program `key`. Returns false if it couldn't, the program still works.
+    auto save(const GLuint programID, const std::uint64_t key) -> bool {
+        GLint binaryLength = 0;
+        glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength <= 0) {
+            return false;
+        }
+        std::vector<std::uint8_t> binary(static_cast<std::size_t>(binaryLength));
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(programID, binaryLength, &binaryLength, &binaryFormat, binary.data());
+
+        const detail::Header header {
+            .magic = detail::magic,
+            .version = version,
+            .binaryFormat = binaryFormat,
+            .key = key,
+            .binaryLength = static_cast<std::uint64_t>(binaryLength),
+        };
+
+        const std::string cachePath = getCachePath(key);
+        std::error_code error;
+        std::filesystem::create_directories(defaults::directory, error);
+
+        // Write into a temporary file first so a crash mid-write
+        // never leaves a truncated binary with a valid header behind.
+        const std::string temporaryPath = cachePath + ".tmp";
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open()) {
+            std::cerr << "Could not write program binary: " << cachePath << "\n";
+            return false;
+        }
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(binary.data()), binaryLength);
+        stream.close();
+
+        if (!stream) {
+            std::cerr << "Could not write program binary: " << cachePath << "\n";
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        std::filesystem::rename(temporaryPath, cachePath, error);
+        return !error;
+    }
+}
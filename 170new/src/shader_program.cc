@@ -10,110 +10,57 @@ module;
 
 export module shader_program;
 
-export struct ShaderProgramSource {
-    std::string vertexSource;
-    std::string fragmentSource;
-};
+import gl_state;
+import camera_uniforms;
+export import shader_program.uniforms;
+export import shader_program.binary_cache;
+export import shader_program.keywords;
+export import shader_program.source_library;
 
 export class ShaderProgram {
     std::string mFilePath;
+    // The keywords of the variant, ` [HAS_SPECULAR_MAP NUM_POINT_LIGHTS=1]`, for the logs. Empty if it has none.
+    std::string mKeywords;
     GLuint shaderProgramID;
-    std::unordered_map<std::string, GLint> uniformLocationsCache;
+    // Resolved once after linking, the setters look the locations up by the hashed names.
+    UniformTable uniformLocations;
+    // Names (hashes) the program was asked for but doesn't have, reported only the first time.
+    std::vector<std::uint64_t> missingUniforms;
+
+    // Uploads of every program (on the main thread, the only one that sets uniforms), reset every frame.
+    static uniform::Stats uniformStats;
+    // How every program was created (loaded from the binary cache or compiled) and how long it took.
+    static program_binary::Stats binaryCacheStats;
     std::unordered_map<std::string, GLint> attributeLocationsCache;
 
-    // Storage of already included files so that
-    // user doesn't have to track included files
-    // in GLSL code.
-    std::set<std::string> includedFiles{};
-
-    /// Recursive parser that can handle `#include` directive with relative paths.
-    auto parseShaderSourceWithIncludes(const std::string& filePath) -> std::string {
-        std::stringstream ss;
-
-        if (includedFiles.contains(filePath)) {
-            return "// This file was already included. Skipping it.\n";
-        }
-
-        includedFiles.insert(filePath);
-
-        std::ifstream stream(filePath);
-        if (!stream.is_open()) {
-            throw std::runtime_error("Could not open file " + filePath);
-        }
-
-        std::string basePath = filePath.substr(0, filePath.find_last_of('/') + 1);
-
-        std::string line;
-        while (std::getline(stream, line)) {
-            if (line.rfind("#include", 0) == 0) {
-                std::string includeFile = line.substr(9);
-                std::string includeFilePath = basePath + includeFile.substr(1, includeFile.size() - 2);
-                ss << "/// Begin include from '" << includeFilePath << "'.\n"
-                    << parseShaderSourceWithIncludes(includeFilePath)
-                    << "/// End include from '" << includeFilePath << "'.\n\n";
-            } else {
-                ss << line << "\n";
-            }
-        }
-        
-        return ss.str();
-    } 
-
-    /// Parses the shader source code containing both vertex and fragment shader sources.
-    auto parseShaderSource(const std::string& filePath) -> ShaderProgramSource {
-        std::ifstream stream(filePath);
-        if (!stream.is_open()) {
-            throw std::runtime_error("Could not open file " + filePath);
-        }
-
-        enum ShaderType { VERTEX = 0, FRAGMENT = 1, NONE = -1 };
-        ShaderType type = NONE;
-        std::stringstream ss[2];
-        std::string line;
-
-        const std::string basePath = filePath.substr(0, filePath.find_last_of('/') + 1);
-
-        while (std::getline(stream, line)) {
-            if (line.find("#shader") != std::string::npos) {
-                if (line.find("vertex") != std::string::npos) {
-                    type = VERTEX;
-                } else if (line.find("fragment") != std::string::npos) {
-                    type = FRAGMENT;
-                }
-            } else if (type != NONE) {
-                if (line.rfind("#include", 0) == 0) {
-                    std::string includeFile = line.substr(9);
-                    std::string includeFilePath = basePath + includeFile.substr(1, includeFile.size() - 2);
-                    ss[static_cast<int>(type)]
-                        << "/// Begin include from '" << includeFilePath << "'.\n"
-                        << parseShaderSourceWithIncludes(includeFilePath)
-                        << "/// End include from '" << includeFilePath << "'.\n\n";
-                } else {
-                    ss[static_cast<int>(type)] << line << "\n";
-                }
-            }
+    // Set from submitting the program until `finishLink` checked how its compile and link went.
+    struct PendingLink {
+        GLuint vertexShaderID;
+        GLuint fragmentShaderID;
+        // For the error message, a failed compile prints the numbered source.
+        ShaderProgramSource sources;
+        bool isCacheSupported;
+        std::uint64_t cacheKey;
+    };
+    std::optional<PendingLink> pendingLink;
+
+    // Whether the driver compiles on threads of its own, see `enableParallelCompile`.
+    static bool isParallelCompileEnabled;
+    // Programs of every instance submitted but not finished yet.
+    static std::size_t pendingCount;
+
+    static auto getShaderTypeString(const GLuint shaderType) -> std::string {
+        switch (shaderType) {
+            case GL_VERTEX_SHADER: { return "vertex"; }
+            case GL_FRAGMENT_SHADER: { return "fragment"; }
+            default: throw std::runtime_error("Unknown shader type."); 
         }
-
-        // std::println("Vertex Shader:\n{}", ss[static_cast<int>(VERTEX)].str());
-        // std::println("Fragment Shader:\n{}", ss[static_cast<int>(FRAGMENT)].str());
-
-        return ShaderProgramSource {
-            .vertexSource = ss[static_cast<int>(VERTEX)].str(),
-            .fragmentSource = ss[static_cast<int>(FRAGMENT)].str(),
-        };
     }
 
-    /// Compiles given shader source code - depends on shader type which can be either `vertex` of `fragment`.
-    auto compileShader(const GLuint shaderType, const std::string& source) const -> GLuint {
-        std::string typeString = [&] {
-            switch (shaderType) {
-                case GL_VERTEX_SHADER: { return "vertex"; }
-                case GL_FRAGMENT_SHADER: { return "fragment"; }
-                default: throw std::runtime_error("Unknown shader type."); 
-            }
-        }();
-
-        std::cout << "Compiling shader source (" << typeString << "): " << mFilePath << "\n";
+    /// Starts compiling given shader source code - depends on shader type which can be either `vertex` of `fragment`.
+    /// Doesn't wait for the result, it's checked only if the program fails to link (see `getCompileError`).
+    auto submitShader(const GLuint shaderType, const std::string& source) const -> GLuint {
+        std::cout << "Compiling shader source (" << getShaderTypeString(shaderType) << "): " << mFilePath << mKeywords << "\n";
 
         // Create new vertex of fragment shader.
         const GLuint shaderID = glCreateShader(shaderType);
@@ -122,80 +69,190 @@ export class ShaderProgram {
         glShaderSource(shaderID, 1, &sourcePointer, nullptr);
         // Compile the shader.
         glCompileShader(shaderID);
+        return shaderID;
+    }
+
+    /// The error message of the shader, none if it compiled.
+    auto getCompileError(const GLuint shaderID, const GLuint shaderType, const std::string& source) const -> std::optional<std::string> {
         // Get the compilation result.
         GLint isCompiled;
         glGetShaderiv(shaderID, GL_COMPILE_STATUS, &isCompiled);
-        
-        // Check for errors.
-        if (isCompiled == GL_FALSE) {
-            int length;
-            glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &length);
-            const auto message = static_cast<char *>(alloca(length * sizeof(char)));
-            glGetShaderInfoLog(shaderID, length, &length, message);
-            glDeleteShader(shaderID);
-
-            // Construct an error message.
-            std::stringstream ss;
-            ss << mFilePath << ": " << "Failed to compile (";
-            ss << typeString << ") shader:\n" << message;
-
-
-            std::stringstream sourceStream(source);
-
-            std::stringstream numberedSourceStream;
-
-            std::string line;
-            int lineNumber = 1;
-            while (std::getline(sourceStream, line)) {
-                numberedSourceStream << std::setw(8);
-                numberedSourceStream << lineNumber << "  " << line << "\n";
-                lineNumber++;
-            }
+        if (isCompiled != GL_FALSE) {
+            return std::nullopt;
+        }
+
+        int length;
+        glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &length);
+        std::string message(length, '\0');
+        glGetShaderInfoLog(shaderID, length, &length, message.data());
 
-            std::cout << numberedSourceStream.str();
+        // Construct an error message. The log's source string numbers are the files' IDs (see the `#line`s).
+        std::stringstream ss;
+        ss << mFilePath << mKeywords << ": " << "Failed to compile (";
+        ss << getShaderTypeString(shaderType) << ") shader:\n" << message;
+        ss << "Source string numbers:\n" << ShaderSourceLibrary::getInstance().describeSourceStrings();
 
-            // and throw that shit.
-            throw std::runtime_error(ss.str() + numberedSourceStream.str());
+
+        std::stringstream sourceStream(source);
+
+        std::stringstream numberedSourceStream;
+
+        std::string line;
+        int lineNumber = 1;
+        while (std::getline(sourceStream, line)) {
+            numberedSourceStream << std::setw(8);
+            numberedSourceStream << lineNumber << "  " << line << "\n";
+            lineNumber++;
         }
 
-        return shaderID;
+        std::cout << numberedSourceStream.str();
+
+        return ss.str() + numberedSourceStream.str();
     }
 
     /// Wraps the vertex shader and the fragment shaders into a shader program.
-    auto createShaderProgramObject(const ShaderProgramSource& shaderSource) const -> GLuint {
+    /// The program is loaded from the binary cache if the same sources were linked by the same driver before,
+    /// else (or if the driver rejects the binary) its shaders are submitted for compiling and linking
+    /// without waiting for them, `finishLink` checks the result and caches the binary.
+    auto submitProgram(const ShaderProgramSource& shaderSource) -> void {
+        const auto start = std::chrono::steady_clock::now();
+        const bool isCacheSupported = program_binary::isSupported();
+        const std::array<std::string_view, 2> sources = { shaderSource.vertexSource, shaderSource.fragmentSource };
+        const std::uint64_t key = isCacheSupported ? program_binary::makeKey(sources) : 0;
+
         // Create a shader program.
-        const GLuint programID = glCreateProgram();
-        // Compile the individual shaders.
-        const GLuint vertexShaderID = compileShader(GL_VERTEX_SHADER, shaderSource.vertexSource);
-        const GLuint fragmentShaderID = compileShader(GL_FRAGMENT_SHADER, shaderSource.fragmentSource);
-        // Attach and link the individual shaders to the shader program.
+        GLuint programID = glCreateProgram();
+        if (isCacheSupported) {
+            switch (program_binary::load(programID, key)) {
+                case program_binary::LoadResult::Hit: {
+                    camera_uniforms::bindBlock(programID, mFilePath);
+                    this->shaderProgramID = programID;
+                    this->uniformLocations = UniformTable::reflect(programID);
+                    binaryCacheStats.hits++;
+                    binaryCacheStats.loadTime += std::chrono::steady_clock::now() - start;
+                    return;
+                }
+                case program_binary::LoadResult::Rejected: {
+                    std::cout << "Program binary rejected by the driver, compiling: " << mFilePath << mKeywords << "\n";
+                    binaryCacheStats.rejected++;
+                    // Start over with a clean program, the failed load left it in a failed link state.
+                    glDeleteProgram(programID);
+                    programID = glCreateProgram();
+                    break;
+                }
+                case program_binary::LoadResult::Miss: {
+                    break;
+                }
+            }
+            glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        // Submit the individual shaders.
+        const GLuint vertexShaderID = submitShader(GL_VERTEX_SHADER, shaderSource.vertexSource);
+        const GLuint fragmentShaderID = submitShader(GL_FRAGMENT_SHADER, shaderSource.fragmentSource);
+        // Attach and link the individual shaders to the shader program. With GL_KHR_parallel_shader_compile
+        // the driver compiles and links in the background, until anything asks for the result.
         glAttachShader(programID, vertexShaderID);
         glAttachShader(programID, fragmentShaderID);
         glLinkProgram(programID);
-        glValidateProgram(programID);
+
+        this->shaderProgramID = programID;
+        this->pendingLink = PendingLink {
+            .vertexShaderID = vertexShaderID,
+            .fragmentShaderID = fragmentShaderID,
+            .sources = shaderSource,
+            .isCacheSupported = isCacheSupported,
+            .cacheKey = key,
+        };
+        pendingCount++;
+        binaryCacheStats.compileTime += std::chrono::steady_clock::now() - start;
+    }
+
+    /// Checks how the submitted program's compile and link went. Without `wait` it returns false
+    /// (never blocking) while the driver is still at it. Throws the compile or the link errors.
+    auto finishLink(const bool wait) -> bool {
+        if (!pendingLink.has_value()) {
+            return true;
+        }
+        if (!wait && isParallelCompileEnabled) {
+            GLint isCompleted = GL_FALSE;
+            glGetProgramiv(shaderProgramID, GL_COMPLETION_STATUS_KHR, &isCompleted);
+            if (isCompleted == GL_FALSE) {
+                return false;
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const PendingLink link = std::move(*pendingLink);
+        pendingLink.reset();
+        pendingCount--;
+
+        // Get the linking result.
+        GLint isLinked;
+        glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &isLinked);
+        std::optional<std::string> error;
+        if (isLinked == GL_FALSE) {
+            // A shader that failed to compile fails the link, its own log says why.
+            error = getCompileError(link.vertexShaderID, GL_VERTEX_SHADER, link.sources.vertexSource);
+            if (!error.has_value()) {
+                error = getCompileError(link.fragmentShaderID, GL_FRAGMENT_SHADER, link.sources.fragmentSource);
+            }
+            if (!error.has_value()) {
+                int length;
+                glGetProgramiv(shaderProgramID, GL_INFO_LOG_LENGTH, &length);
+                std::string message(length, '\0');
+                glGetProgramInfoLog(shaderProgramID, length, &length, message.data());
+                error = mFilePath + mKeywords + ": Failed to link the shader program:\n" + message;
+            }
+        }
         // Now that they are linked, the shaders can be deleted.
-        glDetachShader(programID, vertexShaderID);
-        glDeleteShader(vertexShaderID);
-        glDetachShader(programID, fragmentShaderID);
-        glDeleteShader(fragmentShaderID);
-        // Return the shader program ID.
-        return programID;
+        glDetachShader(shaderProgramID, link.vertexShaderID);
+        glDeleteShader(link.vertexShaderID);
+        glDetachShader(shaderProgramID, link.fragmentShaderID);
+        glDeleteShader(link.fragmentShaderID);
+        if (error.has_value()) {
+            glDeleteProgram(shaderProgramID);
+            shaderProgramID = 0;
+            throw std::runtime_error(*error);
+        }
+
+        // Point the shared uniform blocks at their binding points (checks their layouts).
+        camera_uniforms::bindBlock(shaderProgramID, mFilePath);
+        // Cache the binary for the next launch.
+        if (link.isCacheSupported) {
+            program_binary::save(shaderProgramID, link.cacheKey);
+        }
+        // Resolve the uniforms' locations.
+        this->uniformLocations = UniformTable::reflect(shaderProgramID);
+        binaryCacheStats.compiles++;
+        binaryCacheStats.compileTime += std::chrono::steady_clock::now() - start;
+        return true;
     }
 
 public:
     /// Creates shader program out of provided sources.
+    /// The program is compiled in the background, see `isReady`.
     explicit ShaderProgram(const ShaderProgramSource& sources)
-    : shaderProgramID(createShaderProgramObject(sources)) 
-    {}
+    : shaderProgramID(0) {
+        submitProgram(sources);
+    }
 
     /// Creates shader program out of provided filepath
-    /// to the shader code.
+    /// to the shader code. The file is preprocessed by the `ShaderSourceLibrary` (once per process).
     explicit ShaderProgram(const std::string& shaderFilePath)
-    : mFilePath(shaderFilePath), shaderProgramID(0) {
-        // Parse the source code containing both vertex and fragment shaders.
-        const ShaderProgramSource sources = parseShaderSource(mFilePath);
-        // Create a shader program out of them.
-        this->shaderProgramID = createShaderProgramObject(sources);
+    : ShaderProgram(shaderFilePath, *ShaderSourceLibrary::getInstance().preprocess(shaderFilePath), ShaderKeywords()) {}
+
+    /// Creates the variant of the shader program `shaderFilePath` compiled with the `keywords`,
+    /// out of its already preprocessed `sources` (see `ShaderSourceLibrary::preprocess`).
+    ShaderProgram(const std::string& shaderFilePath, const ShaderProgramSource& sources, const ShaderKeywords& keywords)
+    : mFilePath(shaderFilePath)
+    , mKeywords(keywords.empty() ? "" : std::format(" [{}]", keywords.toString()))
+    , shaderProgramID(0) {
+        // Define the keywords in both stages, then create a shader program out of them.
+        submitProgram(ShaderProgramSource {
+            .vertexSource = keywords.inject(sources.vertexSource),
+            .fragmentSource = keywords.inject(sources.fragmentSource),
+        });
     }
 
     /// Deconstruct that doesn't delete the
@@ -204,6 +261,13 @@ public:
 
     /// Destroy the shader program.
     auto deleteProgram() -> void {
+        if (pendingLink.has_value()) {
+            glDeleteShader(pendingLink->vertexShaderID);
+            glDeleteShader(pendingLink->fragmentShaderID);
+            pendingLink.reset();
+            pendingCount--;
+        }
+        GLState::getInstance().forgetProgram(this->shaderProgramID);
         glDeleteProgram(this->shaderProgramID);
         shaderProgramID = 0;
     }
@@ -212,41 +276,49 @@ public:
         return mFilePath;
     }
 
-    auto bind() const -> void {
-        glUseProgram(this->shaderProgramID);
+    [[nodiscard]] auto getID() const -> GLuint {
+        return shaderProgramID;
+    }
+
+    /// Whether the program is compiled and linked, never blocks with GL_KHR_parallel_shader_compile
+    /// (without it the driver compiles when asked, this waits for it). Draws can be skipped until it is.
+    /// Throws the compile or the link errors.
+    [[nodiscard]] auto isReady() -> bool {
+        return finishLink(false);
+    }
+
+    /// Waits until the program is compiled and linked. Throws the compile or the link errors.
+    auto finish() -> void {
+        finishLink(true);
+    }
+
+    /// Makes the program current, skipped if it already is. Waits for the program if it isn't ready.
+    auto bind() -> void {
+        finish();
+        GLState::getInstance().useProgram(this->shaderProgramID);
     }
 
     static auto unbind() -> void {
-        glUseProgram(0);
+        GLState::getInstance().useProgram(0);
     }
 
-    /// Returns the location ID of a <b>uniform</b> variable in the shader program called `variableName`.
-    /// If this uniform variable is not found, -1 is returned. \n
-    /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto getUniformLocation(const std::string& variableName) -> GLint {
-        // Check if the requested variable name was already requested.
-        if (uniformLocationsCache.contains(variableName)) {
-            // If yes, return the cached lookup result.
-            return uniformLocationsCache[variableName];
-        }
-        // Else look it up in the shader program.
-        const GLint location = glGetUniformLocation(shaderProgramID, variableName.c_str());
-        if (location == -1) {
-            // If it doesn't exist, report it.
-            std::cerr << "Could not get location of uniform variable called '" << variableName
-                      << "' in shader program of ID " << shaderProgramID << " ("<< mFilePath <<")" << "\n";
+    /// Returns the location ID of a <b>uniform</b> variable in the shader program called `variableName`
+    /// (`"U_Name"_uniform`). If this uniform variable is not found, -1 is returned. \n
+    /// The locations were resolved after linking, this is a search over integers, no strings involved.
+    auto getUniformLocation(const UniformName variableName) -> GLint {
+        finish();
+        if (const std::optional<GLint> location = uniformLocations.find(variableName)) {
+            return *location;
         }
-        // Cache the result either way, even if the variable doesn't exist
-        // so that in consecutive queries it won't do the lookup again.
-        uniformLocationsCache[variableName] = location;
-        // Return the variable's location.
-        return location;
+        reportMissingUniform(variableName);
+        return -1;
     }
 
     /// Returns the location ID of an <b>attribute</b> variable in the shader program called `variableName`.
     /// If this attribute variable is not found, -1 is returned. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
     auto getAttributeLocation(const std::string& variableName) -> GLint {
+        finish();
         // Check if the requested variable name was already requested.
         if (attributeLocationsCache.contains(variableName)) {
             // If yes, return the cached lookup result.
@@ -267,30 +339,110 @@ public:
     }
 
     // Uniform variable setters
+    // They compare the value with the uniform's shadow copy first and skip the upload if it's the same.
     /// Sets uniform int `variableName` in the shader program. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto setUniform1i(const std::string& variableName, const GLint value) -> void {
-        glUniform1i(getUniformLocation(variableName), value);
+    auto setUniform1i(const UniformName variableName, const GLint value) -> void {
+        setUniform(variableName, value, [&](const GLint location) { glUniform1i(location, value); });
     }
     /// Sets uniform float `variableName` in the shader program. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto setUniform1f(const std::string& variableName, const GLfloat value) -> void {
-        glUniform1f(getUniformLocation(variableName), value);
+    auto setUniform1f(const UniformName variableName, const GLfloat value) -> void {
+        setUniform(variableName, value, [&](const GLint location) { glUniform1f(location, value); });
     }
     /// Sets uniform vec3 `variableName` (float) in the shader program. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto setUniform3f(const std::string& variableName, const glm::vec3& vector) -> void {
-        glUniform3fv(getUniformLocation(variableName), 1, &vector[0]);
+    auto setUniform3f(const UniformName variableName, const glm::vec3& vector) -> void {
+        setUniform(variableName, vector, [&](const GLint location) { glUniform3fv(location, 1, &vector[0]); });
     }
     /// Sets uniform vec4 `variableName` (float) in the shader program. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto setUniform4f(const std::string& variableName, const glm::vec4& vector) -> void {
-        glUniform4fv(getUniformLocation(variableName), 1, &vector[0]);
+    auto setUniform4f(const UniformName variableName, const glm::vec4& vector) -> void {
+        setUniform(variableName, vector, [&](const GLint location) { glUniform4fv(location, 1, &vector[0]); });
     }
     /// Sets uniform mat4 `variableName` (float) in the shader program. \n
     /// CAUTION: Make sure to <b>bind</b> the shader program first.
-    auto setUniformMat4f(const std::string& variableName, const glm::mat4& matrix) -> void {
-        glUniformMatrix4fv(getUniformLocation(variableName), 1, GL_FALSE, &matrix[0][0]);
+    auto setUniformMat4f(const UniformName variableName, const glm::mat4& matrix) -> void {
+        setUniform(variableName, matrix, [&](const GLint location) { glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]); });
+    }
+
+    /// Uploads made and skipped by every program since the last `resetUniformStats`.
+    [[nodiscard]] static auto getUniformStats() -> const uniform::Stats& {
+        return uniformStats;
+    }
+
+    static auto resetUniformStats() -> void {
+        uniformStats = {};
+    }
+
+    /// Lets the driver compile and link the programs on threads of its own (GL_KHR_parallel_shader_compile,
+    /// or the ARB one), as many as it wants. Returns false if it can't, the programs are then finished one by one.
+    /// Call it once, after the context is made.
+    static auto enableParallelCompile() -> bool {
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            isParallelCompileEnabled = true;
+        } else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            isParallelCompileEnabled = true;
+        }
+        return isParallelCompileEnabled;
+    }
+
+    /// Programs submitted but not checked by `isReady` (or finished otherwise) yet.
+    [[nodiscard]] static auto getPendingCount() -> std::size_t {
+        return pendingCount;
+    }
+
+    /// How the programs created so far were created: from the binary cache or compiled, and how long it took.
+    [[nodiscard]] static auto getBinaryCacheStats() -> const program_binary::Stats& {
+        return binaryCacheStats;
+    }
+
+private:
+    /// Calls `upload` with the uniform's location unless the uniform already has the `value`
+    /// (compared bitwise with its shadow copy). Uniforms the program doesn't have are skipped.
+    template<typename T, typename Upload>
+    auto setUniform(const UniformName variableName, const T& value, const Upload& upload) -> void {
+        finish();
+        const std::optional<uniform::Slot> slot = uniformLocations.findSlot(variableName);
+        if (!slot.has_value()) {
+            reportMissingUniform(variableName);
+            return;
+        }
+
+        // Uniforms without a copy (or set through a setter of a bigger type) are always uploaded.
+        const std::span<const std::byte> bytes = std::as_bytes(std::span(&value, 1));
+        if (bytes.size() <= slot->shadow.size()) {
+            if (std::ranges::equal(bytes, slot->shadow.first(bytes.size()))) {
+                uniformStats.skippedUploads++;
+                return;
+            }
+            std::ranges::copy(bytes, slot->shadow.begin());
+        }
+        uniformStats.uploads++;
+        upload(slot->location);
+    }
+
+    /// Reports that the program doesn't have the uniform, but only the first time it's asked for.
+    auto reportMissingUniform(const UniformName variableName) -> void {
+        if (std::ranges::find(missingUniforms, variableName.hash) != missingUniforms.end()) {
+            return;
+        }
+        missingUniforms.push_back(variableName.hash);
+        if (variableName.name != nullptr) {
+            std::cerr << "Could not get location of uniform variable with name " << variableName.name;
+        } else {
+            std::cerr << "Could not get location of uniform variable with name hash " << std::hex << variableName.hash << std::dec;
+        }
+        std::cerr << " in shader program of ID " << shaderProgramID << " ("<< mFilePath <<")" << "\n";
     }
 };
 
+// Initialization of the upload counters.
+uniform::Stats ShaderProgram::uniformStats{};
+// Initialization of the program creation counters.
+program_binary::Stats ShaderProgram::binaryCacheStats{};
+// Initialization of the parallel compile state.
+bool ShaderProgram::isParallelCompileEnabled = false;
+std::size_t ShaderProgram::pendingCount = 0;
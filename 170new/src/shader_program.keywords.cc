@@ -0,0 +1,119 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module shader_program.keywords;
+
+import file_mapping;
+
+/// The keywords a variant of a shader program is compiled with, e.g. `HAS_SPECULAR_MAP`,
+/// `NUM_POINT_LIGHTS=2` or `ALPHA_TEST`. They are injected into every stage as `#define`s
+/// right after its `#version`, so the shaders pick their code with `#ifdef`s and `#if`s
+/// (branches the GLSL compiler resolves, instead of run time ones).
+/// The keywords are kept sorted by name, the same set makes the same key no matter the order it was defined in.
+export class ShaderKeywords {
+private:
+    // Name and value (empty for a plain keyword), sorted by the name.
+    std::vector<std::pair<std::string, std::string>> defines;
+public:
+    ShaderKeywords() = default;
+
+    /// Defines the keyword `name`, `#define name`.
+    auto define(const std::string_view name) -> ShaderKeywords& {
+        return define(name, "");
+    }
+
+    /// Defines the keyword `name` with the integral `value`, `#define name value`.
+    template<typename T> requires std::integral<T>
+    auto define(const std::string_view name, const T value) -> ShaderKeywords& {
+        return define(name, std::to_string(value));
+    }
+
+    /// Defines the keyword `name` as `value`, replaces the value if the keyword is defined already.
+    auto define(const std::string_view name, const std::string_view value) -> ShaderKeywords& {
+        if (name.empty() || name.find_first_of(" \t\r\n") != std::string_view::npos) {
+            throw std::runtime_error(std::format("Invalid shader keyword '{}'.", name));
+        }
+        const auto position = std::ranges::lower_bound(defines, name, std::less{}, [](const auto& define) {
+            return std::string_view(define.first);
+        });
+        if (position != defines.end() && position->first == name) {
+            position->second = value;
+        } else {
+            defines.emplace(position, std::string(name), std::string(value));
+        }
+        return *this;
+    }
+
+    /// Removes the keyword `name`, if it's defined.
+    auto undefine(const std::string_view name) -> ShaderKeywords& {
+        std::erase_if(defines, [&](const auto& define) { return define.first == name; });
+        return *this;
+    }
+
+    [[nodiscard]] auto isDefined(const std::string_view name) const -> bool {
+        return std::ranges::find(defines, name, [](const auto& define) { return std::string_view(define.first); }) != defines.end();
+    }
+
+    [[nodiscard]] auto empty() const -> bool {
+        return defines.empty();
+    }
+
+    /// Identifies the variant, equal keywords (with equal values) make equal keys.
+    [[nodiscard]] auto getKey() const -> std::uint64_t {
+        std::uint64_t hash = file_mapping::fnvOffsetBasis;
+        for (const auto& [name, value] : defines) {
+            hash = file_mapping::hashBytes(name.data(), name.size(), hash);
+            hash = file_mapping::hashValue('=', hash);
+            hash = file_mapping::hashBytes(value.data(), value.size(), hash);
+            hash = file_mapping::hashValue('\n', hash);
+        }
+        return hash;
+    }
+
+    /// Returns the stage's `source` with the keywords defined after its `#version` line
+    /// (which has to come first in GLSL), or at the top if it has none.
+    [[nodiscard]] auto inject(const std::string_view source) const -> std::string {
+        if (defines.empty()) {
+            return std::string(source);
+        }
+
+        std::size_t insertAt = 0;
+        for (std::size_t lineStart = 0; lineStart < source.size();) {
+            const std::size_t lineEnd = std::min(source.find('\n', lineStart), source.size());
+            const std::string_view line = source.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+            if (line.starts_with("#version")) {
+                insertAt = std::min(lineStart, source.size());
+                break;
+            }
+        }
+
+        std::string result;
+        result.reserve(source.size() + defines.size() * 32);
+        result.append(source.substr(0, insertAt));
+        if (insertAt > 0 && result.back() != '\n') {
+            result += '\n';
+        }
+        for (const auto& [name, value] : defines) {
+            result += value.empty() ? std::format("#define {}\n", name) : std::format("#define {} {}\n", name, value);
+        }
+        result.append(source.substr(insertAt));
+        return result;
+    }
+
+    /// `HAS_SPECULAR_MAP NUM_POINT_LIGHTS=1`, for the logs.
+    [[nodiscard]] auto toString() const -> std::string {
+        std::string result;
+        for (const auto& [name, value] : defines) {
+            if (!result.empty()) {
+                result += ' ';
+            }
+            result += value.empty() ? name : std::format("{}={}", name, value);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,398 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module shader_program.source_library;
+
+import file_mapping;
+import thread_pool;
+
+/// The vertex and the fragment shader sources of a program, every `#include` expanded.
+export struct ShaderProgramSource {
+    std::string vertexSource;
+    std::string fragmentSource;
+};
+
+namespace shader_source::detail {
+    enum class SegmentType {
+        Text,
+        Include, // `#include "file"`, the file is `includePath`.
+        Version, // The `#version` line, nothing but comments can come before it (not even `#line`).
+        VertexStage, // `#shader vertex`, the lines after it belong to the vertex shader.
+        FragmentStage, // `#shader fragment`
+    };
+
+    /// A run of a file's lines, or one of its directives.
+    struct Segment {
+        SegmentType type = SegmentType::Text;
+        std::string_view text; // Into the file's mapping.
+        std::uint32_t firstLine = 1;
+        std::string includePath;
+    };
+
+    /// A file read from the disk and split into segments, once.
+    struct SourceFile {
+        std::uint32_t id = 0;
+        std::string path;
+        MappedFile mapping;
+        std::vector<Segment> segments;
+    };
+
+    /// The key of a file, the same for every spelling of its path (`./shaders/./std/a.glsl`, `shaders/std/a.glsl`).
+    auto normalizePath(const std::string_view path) -> std::string {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    /// The path of the file `#include "includeName"` in the file `filePath` refers to, relative to the including file.
+    auto resolveInclude(const std::string& filePath, const std::string_view includeName) -> std::string {
+        return normalizePath((std::filesystem::path(filePath).parent_path() / includeName).generic_string());
+    }
+
+    /// The file name of `#include "name"`, empty if the line isn't an include.
+    auto parseIncludeName(const std::string_view line) -> std::string_view {
+        if (!line.starts_with("#include")) {
+            return {};
+        }
+        const std::size_t open = line.find('"');
+        const std::size_t close = line.rfind('"');
+        if (open == std::string_view::npos || close <= open) {
+            return {};
+        }
+        return line.substr(open + 1, close - open - 1);
+    }
+}
+
+/// Every shader file of the process, read once (memory mapped) and kept with its `#include`s parsed.
+/// The expanded sources of the programs are cached too, with the files each one depends on,
+/// so a changed file can be invalidated together with just the programs that include it.
+///
+/// The expanded sources carry `#line <line> <file ID>` directives, the driver's compile errors
+/// point into the original files, see `describeSourceStrings` for which ID is which file.
+/// Thread-safe, files are read and expanded outside the lock (see `preprocessBatch`). A file's ID is
+/// given out when it's first read, `preprocessBatch` reads them in a fixed order so the IDs don't change between launches.
+export class ShaderSourceLibrary {
+private:
+    struct CachedProgram {
+        std::shared_ptr<const ShaderProgramSource> source;
+        // IDs of every file the expansion read, the program file included.
+        std::vector<std::uint32_t> dependencies;
+    };
+
+    std::mutex mutex;
+    // Kept by ID (the index), an invalidated file stays null until it's read again.
+    std::vector<std::shared_ptr<const shader_source::detail::SourceFile>> files;
+    std::vector<std::string> filePaths;
+    // A file keeps its ID, it's read again under the same one after an invalidation.
+    std::unordered_map<std::string, std::uint32_t> fileIDs;
+    std::unordered_map<std::string, CachedProgram> programs;
+
+    static ShaderSourceLibrary* singletonInstance;
+
+    ShaderSourceLibrary() = default;
+public:
+    ShaderSourceLibrary(const ShaderSourceLibrary& other) = delete;
+    ShaderSourceLibrary& operator=(const ShaderSourceLibrary& other) = delete;
+
+    /// Returns the singleton instance of this class.
+    static auto getInstance() -> ShaderSourceLibrary& {
+        if (singletonInstance == nullptr) {
+            singletonInstance = new ShaderSourceLibrary();
+        }
+        return *singletonInstance;
+    }
+
+    /// The expanded sources of the program file `programPath` (split into the stages by its `#shader` lines).
+    /// Expanded once, the next calls return the same sources until a file of the program is invalidated.
+    /// Throws if one of the files can't be read.
+    auto preprocess(const std::string& programPath) -> std::shared_ptr<const ShaderProgramSource> {
+        const std::string key = shader_source::detail::normalizePath(programPath);
+        {
+            std::lock_guard lock(mutex);
+            if (const auto position = programs.find(key); position != programs.end()) {
+                return position->second.source;
+            }
+        }
+
+        // Expanded without the lock, two threads expanding the same program make the same sources.
+        CachedProgram program = expandProgram(key);
+        std::lock_guard lock(mutex);
+        return programs.try_emplace(key, std::move(program)).first->second.source;
+    }
+
+    /// Expands every program of `programPaths` on the thread pool, the files they share are read once.
+    /// The files are read first, on the calling thread, so their IDs (the `#line` directives, and with them
+    /// the program binary cache's keys) are the same every launch instead of depending on which task runs first.
+    /// Returns the sources in the same order. Rethrows the first failure after every task is done.
+    auto preprocessBatch(const std::span<const std::string> programPaths) -> std::vector<std::shared_ptr<const ShaderProgramSource>> {
+        std::set<std::string> registeredFiles;
+        for (const std::string& programPath : programPaths) {
+            try {
+                registerFiles(shader_source::detail::normalizePath(programPath), registeredFiles);
+            } catch (...) {
+                // The program's task fails with the same error, after the other programs are expanded.
+            }
+        }
+
+        std::vector<std::shared_ptr<const ShaderProgramSource>> sources(programPaths.size());
+        std::vector<std::exception_ptr> failures(programPaths.size());
+        std::latch done(static_cast<std::ptrdiff_t>(programPaths.size()));
+        for (std::size_t i = 0; i < programPaths.size(); i++) {
+            ThreadPool::getInstance().submit([this, &programPaths, &sources, &failures, &done, i] {
+                try {
+                    sources[i] = preprocess(programPaths[i]);
+                } catch (...) {
+                    failures[i] = std::current_exception();
+                }
+                done.count_down();
+            });
+        }
+        done.wait();
+
+        for (const std::exception_ptr& failure : failures) {
+            if (failure != nullptr) {
+                std::rethrow_exception(failure);
+            }
+        }
+        return sources;
+    }
+
+    /// Paths of every file the program's expansion read, the program file first.
+    /// Empty if the program isn't expanded (or was invalidated).
+    auto getDependencies(const std::string& programPath) -> std::vector<std::string> {
+        std::lock_guard lock(mutex);
+        const auto position = programs.find(shader_source::detail::normalizePath(programPath));
+        if (position == programs.end()) {
+            return {};
+        }
+        std::vector<std::string> paths;
+        for (const std::uint32_t id : position->second.dependencies) {
+            paths.push_back(filePaths[id]);
+        }
+        return paths;
+    }
+
+    /// Forgets the file `filePath` (e.g. it was edited) and the expansions of every program that depends on it,
+    /// the next `preprocess` reads them again. Returns the paths of the invalidated programs.
+    auto invalidate(const std::string& filePath) -> std::vector<std::string> {
+        std::lock_guard lock(mutex);
+        const auto id = fileIDs.find(shader_source::detail::normalizePath(filePath));
+        if (id == fileIDs.end()) {
+            return {};
+        }
+        files[id->second] = nullptr;
+
+        std::vector<std::string> invalidatedPrograms;
+        for (auto position = programs.begin(); position != programs.end();) {
+            if (std::ranges::find(position->second.dependencies, id->second) != position->second.dependencies.end()) {
+                invalidatedPrograms.push_back(position->first);
+                position = programs.erase(position);
+            } else {
+                ++position;
+            }
+        }
+        return invalidatedPrograms;
+    }
+
+    /// `  3: shaders/std/lighting.glsl` for every file read, one per line. The file IDs are
+    /// the source string numbers the driver reports the compile errors with (`3(42) : error ...`).
+    auto describeSourceStrings() -> std::string {
+        std::lock_guard lock(mutex);
+        std::string description;
+        for (std::size_t id = 0; id < filePaths.size(); id++) {
+            description += std::format("{:>4}: {}\n", id, filePaths[id]);
+        }
+        return description;
+    }
+
+    [[nodiscard]] auto getFileCount() -> std::size_t {
+        std::lock_guard lock(mutex);
+        return fileIDs.size();
+    }
+
+private:
+    /// The file, read and parsed if this is the first time it's asked for.
+    auto getFile(const std::string& path) -> std::shared_ptr<const shader_source::detail::SourceFile> {
+        std::uint32_t id = 0;
+        {
+            std::lock_guard lock(mutex);
+            const auto [position, inserted] = fileIDs.try_emplace(path, static_cast<std::uint32_t>(files.size()));
+            id = position->second;
+            if (inserted) {
+                files.emplace_back();
+                filePaths.push_back(path);
+            } else if (files[id] != nullptr) {
+                return files[id];
+            }
+        }
+
+        // Read without the lock, a file read twice at once is kept only once.
+        std::shared_ptr<const shader_source::detail::SourceFile> file = readFile(path, id);
+        std::lock_guard lock(mutex);
+        if (files[id] == nullptr) {
+            files[id] = std::move(file);
+        }
+        return files[id];
+    }
+
+    /// Reads the file and everything it includes (depth first, in the order of the `#include`s),
+    /// which gives the files that are new their IDs in that order.
+    auto registerFiles(const std::string& path, std::set<std::string>& registeredFiles) -> void {
+        if (!registeredFiles.insert(path).second) {
+            return;
+        }
+        for (const shader_source::detail::Segment& segment : getFile(path)->segments) {
+            if (segment.type == shader_source::detail::SegmentType::Include) {
+                registerFiles(segment.includePath, registeredFiles);
+            }
+        }
+    }
+
+    /// Maps the file and splits it into segments.
+    auto readFile(const std::string& path, const std::uint32_t id) -> std::shared_ptr<const shader_source::detail::SourceFile> {
+        using namespace shader_source::detail;
+
+        auto file = std::make_shared<SourceFile>();
+        file->id = id;
+        file->path = path;
+        file->mapping = MappedFile(path);
+        // An empty file can't be mapped, but it's still a file.
+        std::error_code error;
+        if (!file->mapping.isOpen() && std::filesystem::file_size(path, error) != 0) {
+            throw std::runtime_error("Could not open file " + path);
+        }
+        const std::string_view text(reinterpret_cast<const char*>(file->mapping.data()), file->mapping.size());
+
+        // The lines since the last directive, not yet added as a text segment.
+        std::size_t textBegin = 0;
+        std::uint32_t textFirstLine = 1;
+        const auto flushText = [&](const std::size_t textEnd) {
+            if (textEnd > textBegin) {
+                file->segments.push_back(Segment {
+                    .type = SegmentType::Text,
+                    .text = text.substr(textBegin, textEnd - textBegin),
+                    .firstLine = textFirstLine,
+                });
+            }
+        };
+
+        std::uint32_t lineNumber = 1;
+        for (std::size_t lineStart = 0; lineStart < text.size(); lineNumber++) {
+            const std::size_t lineEnd = std::min(text.find('\n', lineStart), text.size());
+            const std::size_t nextLineStart = std::min(lineEnd + 1, text.size());
+            const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+
+            std::optional<Segment> directive;
+            if (const std::string_view includeName = parseIncludeName(line); !includeName.empty()) {
+                directive = Segment { .type = SegmentType::Include, .text = line, .firstLine = lineNumber,
+                    .includePath = resolveInclude(path, includeName) };
+            } else if (line.starts_with("#version")) {
+                directive = Segment { .type = SegmentType::Version, .text = line, .firstLine = lineNumber };
+            } else if (line.find("#shader") != std::string_view::npos) {
+                if (line.find("vertex") != std::string_view::npos) {
+                    directive = Segment { .type = SegmentType::VertexStage, .text = line, .firstLine = lineNumber };
+                } else if (line.find("fragment") != std::string_view::npos) {
+                    directive = Segment { .type = SegmentType::FragmentStage, .text = line, .firstLine = lineNumber };
+                }
+            }
+
+            if (directive.has_value()) {
+                flushText(lineStart);
+                file->segments.push_back(std::move(*directive));
+                textBegin = nextLineStart;
+                textFirstLine = lineNumber + 1;
+            }
+            lineStart = nextLineStart;
+        }
+        flushText(text.size());
+        return file;
+    }
+
+    /// Splits the program file into the stages and expands their includes.
+    auto expandProgram(const std::string& programPath) -> CachedProgram {
+        using namespace shader_source::detail;
+
+        const std::shared_ptr<const SourceFile> programFile = getFile(programPath);
+        CachedProgram program;
+        program.dependencies.push_back(programFile->id);
+
+        ShaderProgramSource source;
+        std::string* stage = nullptr;
+        // Per shader stage, each stage is compiled separately and needs its own copy of the includes.
+        std::set<std::uint32_t> includedFiles;
+        for (const Segment& segment : programFile->segments) {
+            switch (segment.type) {
+                case SegmentType::VertexStage: { stage = &source.vertexSource; includedFiles.clear(); } break;
+                case SegmentType::FragmentStage: { stage = &source.fragmentSource; includedFiles.clear(); } break;
+                default: {
+                    // The lines before the first `#shader` belong to no stage.
+                    if (stage != nullptr) {
+                        appendSegment(*stage, *programFile, segment, includedFiles, program.dependencies);
+                    }
+                } break;
+            }
+        }
+
+        program.source = std::make_shared<const ShaderProgramSource>(std::move(source));
+        return program;
+    }
+
+    /// Appends the whole file, unless the stage already has it.
+    auto appendFile(
+        std::string& out,
+        const shader_source::detail::SourceFile& file,
+        std::set<std::uint32_t>& includedFiles,
+        std::vector<std::uint32_t>& dependencies
+    ) -> void {
+        if (!includedFiles.insert(file.id).second) {
+            out += "// This file was already included. Skipping it.\n";
+            return;
+        }
+        if (std::ranges::find(dependencies, file.id) == dependencies.end()) {
+            dependencies.push_back(file.id);
+        }
+
+        out += std::format("#line 1 {}\n", file.id);
+        for (const shader_source::detail::Segment& segment : file.segments) {
+            appendSegment(out, file, segment, includedFiles, dependencies);
+        }
+    }
+
+    auto appendSegment(
+        std::string& out,
+        const shader_source::detail::SourceFile& file,
+        const shader_source::detail::Segment& segment,
+        std::set<std::uint32_t>& includedFiles,
+        std::vector<std::uint32_t>& dependencies
+    ) -> void {
+        using namespace shader_source::detail;
+
+        switch (segment.type) {
+            case SegmentType::Text: {
+                out += segment.text;
+                if (!segment.text.ends_with('\n')) {
+                    out += '\n';
+                }
+            } break;
+            case SegmentType::Include: {
+                appendFile(out, *getFile(segment.includePath), includedFiles, dependencies);
+                // Back in the including file, at the line after the include.
+                out += std::format("#line {} {}\n", segment.firstLine + 1, file.id);
+            } break;
+            case SegmentType::Version: {
+                out += segment.text;
+                out += '\n';
+                out += std::format("#line {} {}\n", segment.firstLine + 1, file.id);
+            } break;
+            case SegmentType::VertexStage:
+            case SegmentType::FragmentStage: {
+                throw std::runtime_error(std::format("{}:{}: '#shader' in an included file.", file.path, segment.firstLine));
+            }
+        }
+    }
+};
+
+// Initialization of the singleton instance to null pointer.
+ShaderSourceLibrary* ShaderSourceLibrary::singletonInstance = nullptr;
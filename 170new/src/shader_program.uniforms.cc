@@ -0,0 +1,225 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module shader_program.uniforms;
+
+/// Name of a uniform variable, hashed (64-bit FNV-1a). Made from a string literal with
+/// `_uniform` at compile time, so setting a uniform by it never hashes, compares or allocates strings.
+export struct UniformName {
+    std::uint64_t hash = 0;
+    // The literal the name was made from, only for the error messages (null if it was hashed at run time).
+    const char* name = nullptr;
+
+    /// Names are equal when their hashes are.
+    constexpr auto operator==(const UniformName& other) const -> bool {
+        return hash == other.hash;
+    }
+};
+
+export namespace uniform {
+    /// 64-bit FNV-1a of the `name`, the same at compile time and at run time.
+    [[nodiscard]] constexpr auto hashName(const std::string_view name) -> UniformName {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for (const char character : name) {
+            hash ^= static_cast<std::uint8_t>(character);
+            hash *= 0x100000001b3;
+        }
+        return UniformName { hash };
+    }
+
+    /// A uniform's location and the CPU copy of the value it was last set to (see `UniformTable`).
+    struct Slot {
+        GLint location;
+        // Empty for the types whose values aren't copied, they are always uploaded.
+        std::span<std::byte> shadow;
+    };
+
+    /// How many uniform uploads the programs made and how many they skipped
+    /// because the uniform already had the value.
+    struct Stats {
+        std::size_t uploads = 0;
+        std::size_t skippedUploads = 0;
+    };
+}
+
+export namespace uniform::literals {
+    /// `"U_ModelMat4"_uniform`, the uniform's name hashed at compile time.
+    consteval auto operator""_uniform(const char* name, const std::size_t length) -> UniformName {
+        return UniformName { hashName(std::string_view(name, length)).hash, name };
+    }
+}
+
+namespace uniform::detail {
+    struct Entry {
+        std::uint64_t hash;
+        GLint location;
+        // Where the uniform's value is in the table's shadow copies.
+        std::uint32_t shadowOffset;
+        std::uint32_t shadowSize;
+    };
+
+    /// Bytes of one value of the uniform `type`, as the setters pass it. 0 for the types
+    /// no setter sets (doubles, the rarer matrices), those aren't shadowed.
+    constexpr auto getShadowSize(const GLenum type) -> std::uint32_t {
+        switch (type) {
+            case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL:
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_SHADOW: { return 4; }
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: { return 8; }
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: { return 12; }
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_FLOAT_MAT2: { return 16; }
+            case GL_FLOAT_MAT3: { return 36; }
+            case GL_FLOAT_MAT4: { return 64; }
+            default: { return 0; }
+        }
+    }
+
+    /// Which of the `glGetUniform*v` functions reads the value of a uniform of the `type`.
+    enum class ValueKind : std::uint8_t { Float, Int, UnsignedInt };
+
+    constexpr auto getValueKind(const GLenum type) -> ValueKind {
+        switch (type) {
+            case GL_INT: case GL_BOOL: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_SHADOW: { return ValueKind::Int; }
+            case GL_UNSIGNED_INT: { return ValueKind::UnsignedInt; }
+            default: { return ValueKind::Float; }
+        }
+    }
+}
+
+/// Locations of a program's uniforms by their hashed names. Filled once after linking
+/// (see `UniformTable::reflect`), looked up by a binary search over a flat array.
+/// Also keeps a shadow copy of every uniform's value, so setting a uniform
+/// to the value it already has can be skipped (see `ShaderProgram`'s setters).
+export class UniformTable {
+private:
+    // Sorted by the hash.
+    std::vector<uniform::detail::Entry> entries;
+    // The uniforms' values, as they were last set. Read from the program by `reflect`, linking doesn't
+    // leave them all zeroed (initializers, `layout(binding = N)`, a program loaded with glProgramBinary).
+    std::vector<std::byte> shadows;
+public:
+    /// Reads every active uniform of the linked program. Array uniforms are reported as `name[0]`,
+    /// their first element can be found by both `name[0]` and `name`, the others by `name[i]`.
+    /// The members of uniform blocks have no location and are left out. The shadow copies start out as the
+    /// values the program has. Throws if two of the names hash the same.
+    static auto reflect(const GLuint programID) -> UniformTable {
+        UniformTable table;
+        GLint uniformCount = 0;
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        GLint maxNameLength = 0;
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::string name(static_cast<std::size_t>(maxNameLength), '\0');
+        for (GLint i = 0; i < uniformCount; i++) {
+            GLsizei nameLength = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(programID, static_cast<GLuint>(i), maxNameLength, &nameLength, &size, &type, name.data());
+            const std::string_view activeName(name.data(), static_cast<std::size_t>(nameLength));
+            const GLint location = glGetUniformLocation(programID, name.c_str());
+            if (location == -1) {
+                continue;
+            }
+            const std::uint32_t shadowSize = uniform::detail::getShadowSize(type);
+            table.add(activeName, location, shadowSize);
+            table.readShadow(programID, location, type);
+            if (activeName.ends_with("[0]")) {
+                const std::string_view arrayName = activeName.substr(0, activeName.size() - 3);
+                table.add(arrayName, location, shadowSize);
+                // The other elements have locations (and shadow copies) of their own.
+                for (GLint element = 1; element < size; element++) {
+                    const std::string elementName = std::format("{}[{}]", arrayName, element);
+                    const GLint elementLocation = glGetUniformLocation(programID, elementName.c_str());
+                    if (elementLocation != -1) {
+                        table.add(elementName, elementLocation, shadowSize);
+                        table.readShadow(programID, elementLocation, type);
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    /// Adds the uniform `name` at the `location`, with `shadowSize` bytes for the copy of its value
+    /// (0 for none). The aliases of one uniform (the same `location`) share the copy.
+    /// Throws if a different uniform has the same hash.
+    auto add(const std::string_view name, const GLint location, const std::uint32_t shadowSize = 0) -> void {
+        const UniformName hashedName = uniform::hashName(name);
+        const auto position = lowerBound(hashedName);
+        if (position != entries.end() && position->hash == hashedName.hash) {
+            if (position->location != location) {
+                throw std::runtime_error(std::format("Uniform '{}' has the same hash as another uniform.", name));
+            }
+            return;
+        }
+        const auto alias = std::ranges::find(entries, location, &uniform::detail::Entry::location);
+        const auto shadowOffset = alias != entries.end() ? alias->shadowOffset : static_cast<std::uint32_t>(shadows.size());
+        if (alias == entries.end()) {
+            shadows.resize(shadows.size() + shadowSize);
+        }
+        entries.insert(position, uniform::detail::Entry { hashedName.hash, location, shadowOffset, shadowSize });
+    }
+
+    /// The location of the uniform, none if the program has no such (active) uniform.
+    [[nodiscard]] auto find(const UniformName name) const -> std::optional<GLint> {
+        const auto position = lowerBound(name);
+        if (position == entries.end() || position->hash != name.hash) {
+            return std::nullopt;
+        }
+        return position->location;
+    }
+
+    /// The location of the uniform and the copy of its value, none if the program has no such (active) uniform.
+    [[nodiscard]] auto findSlot(const UniformName name) -> std::optional<uniform::Slot> {
+        const auto position = lowerBound(name);
+        if (position == entries.end() || position->hash != name.hash) {
+            return std::nullopt;
+        }
+        return uniform::Slot {
+            position->location,
+            std::span(shadows).subspan(position->shadowOffset, position->shadowSize),
+        };
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t {
+        return entries.size();
+    }
+
+private:
+    /// Copies the current value of the uniform at the `location` of the program into its shadow copy.
+    auto readShadow(const GLuint programID, const GLint location, const GLenum type) -> void {
+        const auto entry = std::ranges::find(entries, location, &uniform::detail::Entry::location);
+        if (entry == entries.end() || entry->shadowSize == 0) {
+            return;
+        }
+        // Big enough for the largest shadowed type (a mat4), and 4 byte components like every shadowed type has.
+        std::array<std::uint32_t, 16> value{};
+        switch (uniform::detail::getValueKind(type)) {
+            case uniform::detail::ValueKind::Float: {
+                glGetUniformfv(programID, location, reinterpret_cast<GLfloat*>(value.data()));
+                break;
+            }
+            case uniform::detail::ValueKind::Int: {
+                glGetUniformiv(programID, location, reinterpret_cast<GLint*>(value.data()));
+                break;
+            }
+            case uniform::detail::ValueKind::UnsignedInt: {
+                glGetUniformuiv(programID, location, value.data());
+                break;
+            }
+        }
+        std::ranges::copy(std::as_bytes(std::span(value)).first(entry->shadowSize),
+            shadows.begin() + entry->shadowOffset);
+    }
+
+    [[nodiscard]] auto lowerBound(const UniformName name) const -> std::vector<uniform::detail::Entry>::const_iterator {
+        return std::ranges::lower_bound(entries, name.hash, std::less{}, &uniform::detail::Entry::hash);
+    }
+};
@@ -0,0 +1,53 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module shader_program.variants;
+
+import shader_program;
+
+/// Every variant of one shader file (its permutations by `ShaderKeywords`). The file is preprocessed once,
+/// each variant is compiled the first time it's asked for and kept by its keywords' key.
+/// Non-owning like the other wrappers, `deleteResource` deletes the compiled programs.
+export class ShaderVariants {
+private:
+    std::string filePath;
+    std::shared_ptr<const ShaderProgramSource> sources;
+    // By `ShaderKeywords::getKey`. A node based map, the references handed out stay valid.
+    std::unordered_map<std::uint64_t, ShaderProgram> programs;
+public:
+    /// Preprocesses the shader file (see `ShaderSourceLibrary`), nothing is compiled yet.
+    explicit ShaderVariants(const std::string& shaderFilePath)
+    : filePath(shaderFilePath)
+    , sources(ShaderSourceLibrary::getInstance().preprocess(shaderFilePath))
+    {}
+
+    /// The variant with the `keywords`, compiled (or loaded from the binary cache) if this is the first time
+    /// it's asked for. Must be called on the main thread.
+    auto get(const ShaderKeywords& keywords) -> ShaderProgram& {
+        const std::uint64_t key = keywords.getKey();
+        if (const auto position = programs.find(key); position != programs.end()) {
+            return position->second;
+        }
+        return programs.try_emplace(key, filePath, *sources, keywords).first->second;
+    }
+
+    [[nodiscard]] auto getVariantCount() const -> std::size_t {
+        return programs.size();
+    }
+
+    [[nodiscard]] auto getSourceFilePath() const -> const std::string& {
+        return filePath;
+    }
+
+    /// Deletes every compiled variant.
+    auto deleteResource() -> void {
+        for (ShaderProgram& program : programs | std::views::values) {
+            program.deleteProgram();
+        }
+        programs.clear();
+    }
+};
@@ -10,6 +10,7 @@ module;
 
 export module skybox;
 
+import gl_state;
 import vertex_buffer;
 import vertex_buffer.layout;
 import index_buffer;
@@ -18,6 +19,8 @@ import texture;
 import camera;
 import shader_program;
 
+using namespace uniform::literals;
+
 const ShaderProgramSource skyboxSources = {
     .vertexSource = R""""(
         /// #shader vertex
@@ -88,25 +91,27 @@ public:
         mVAO(mVBO, VertexBufferLayout().pushAttribute<float>(3, "pos"), mIBO)
     {}
 
+    /// Whether its shader is compiled, never blocks. Drawing it before waits for the shader.
+    [[nodiscard]] auto isReady() -> bool {
+        return mShader.isReady();
+    }
+
     /// Drawing it last is more efficient because the shader doesn't
     /// have to run for pixel. The vertex shader must updated tho.
     /// And also the depth function must be GL_LEQUAL instead of GL_LESS.
+    /// Leaves its pipeline state applied, the next pass applies the one it needs.
     void draw(const Camera& camera, bool isDrawnLast = false) {
         // if the skybox is drawn inbetween disable 
-        // depth testing and make the furthest.
-        if (isDrawnLast) {
-            glDepthFunc(GL_LEQUAL);
-        } else {
-            glDepthMask(GL_FALSE);
-        }
+        // depth writing so it's behind everything drawn after it.
+        GLState::getInstance().apply(isDrawnLast ? pipeline_state::skyboxDrawnLast : pipeline_state::skyboxDrawnFirst);
 
 
         mTexture.bindToSlot(0); // bind to texture unit 0 for the shader to use it
 
         // bind shader and pass
         mShader.bind();
-        mShader.setUniform1i("skybox", 0); // use the texture unit 0 as samplerCube
-        mShader.setUniformMat4f("cameraProjView", 
+        mShader.setUniform1i("skybox"_uniform, 0); // use the texture unit 0 as samplerCube
+        mShader.setUniformMat4f("cameraProjView"_uniform, 
                                             // getting rid of the translation by nulling out 
                                             // the translation in the right most column.
             camera.getProjectionMatrix() * glm::mat4(glm::mat3(camera.getViewMatrix())) 
@@ -114,16 +119,6 @@ public:
 
         mVAO.bind();
 
-        glDrawElements(GL_TRIANGLES, static_cast<int>(skyboxIndices.size()), GL_UNSIGNED_INT, nullptr);
-
-        VertexArray::unbind();
-        ShaderProgram::unbind();
-
-
-        if (isDrawnLast) {
-            glDepthFunc(GL_LESS);
-        } else {
-            glDepthMask(GL_TRUE);
-        }
+        glDrawElements(GL_TRIANGLES, mIBO.getElementCount(), mIBO.getIndexType(), nullptr);
     }
 };
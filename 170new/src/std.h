@@ -14,9 +14,18 @@
 #include <print>
 
 #include <cstdint>
+#include <cmath>
+#include <numbers>
+#include <bit>
+#include <limits>
 #include <string>
 
+#include <array>
 #include <vector>
+#include <list>
+#include <span>
+#include <optional>
+#include <utility>
 #include <set>
 #include <map>
 #include <unordered_map>
@@ -24,6 +33,7 @@
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
+#include <exception>
 #include <assert.h>
 #include <ranges>
 
@@ -32,5 +42,15 @@
 #include <filesystem>
 
 #include <functional>
+#include <chrono>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <latch>
+#include <deque>
+
 #include <algorithm>
+#include <numeric>
 
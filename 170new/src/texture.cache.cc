@@ -0,0 +1,441 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+export module texture.cache;
+
+import file_mapping;
+import texture.compression;
+
+// Layout of the cooked texture file (all offsets are from the start of the file):
+//
+//   Header
+//   LevelEntry[levelCount]
+//   (padding to payloadAlignment) every mip level, as block-compressed data (see `Header::format`)
+//                                  or as tightly packed 8-bit pixels
+//
+// The levels are uploaded straight out of the memory mapped file.
+
+namespace texture::cache::detail {
+    constexpr std::array<char, 8> magic = { 'T', 'E', 'X', 'C', 'O', 'O', 'K', ' ' };
+    constexpr std::size_t payloadAlignment = 16;
+
+    struct Header {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t colorSpace;
+        std::uint64_t sourceHash;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t channels;
+        std::uint32_t levelCount;
+        // The `compression::Format` of the levels, 0 for 8-bit pixels.
+        std::uint32_t format;
+        std::uint32_t reserved;
+    };
+
+    struct LevelEntry {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t width;
+        std::uint32_t height;
+    };
+
+    auto alignUp(const std::uint64_t value, const std::uint64_t alignment) -> std::uint64_t {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /// The format stored in the header, none for 8-bit pixels or a value no format has.
+    auto findFormat(const std::uint32_t format) -> std::optional<texture::compression::Format> {
+        using texture::compression::Format;
+        for (const Format known : { Format::BC1, Format::BC3, Format::BC4, Format::BC5, Format::BC7 }) {
+            if (format == static_cast<std::uint32_t>(known)) {
+                return known;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Resolution of the linear to sRGB table. 8-bit sRGB needs more than 256 linear steps in the darks.
+    constexpr int linearSteps = 4096;
+
+    auto getSrgbToLinearTable() -> const std::array<float, 256>& {
+        static const auto table = [] {
+            std::array<float, 256> values{};
+            for (int i = 0; i < 256; i++) {
+                const float c = static_cast<float>(i) / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+    auto getLinearToSrgbTable() -> const std::array<std::uint8_t, linearSteps>& {
+        static const auto table = [] {
+            std::array<std::uint8_t, linearSteps> values{};
+            for (int i = 0; i < linearSteps; i++) {
+                const float l = static_cast<float>(i) / (linearSteps - 1);
+                const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                values[i] = static_cast<std::uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+            }
+            return values;
+        }();
+        return table;
+    }
+}
+
+export namespace texture::cache {
+    /// Bump this whenever the cooked data or the file layout changes.
+    constexpr std::uint32_t version = 2;
+    /// The cooked file is written next to the source image with this extension appended.
+    constexpr std::string_view fileExtension = ".texcache";
+
+    /// How the 8-bit values are encoded. Colors (diffuse maps) are sRGB,
+    /// data (specular maps, alpha) is linear and filtered as it is.
+    enum class ColorSpace : std::uint32_t {
+        Linear = 0,
+        SRGB = 1,
+    };
+
+    /// One mip level of tightly packed 8-bit pixels, or of compressed blocks.
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::span<const std::uint8_t> pixels;
+    };
+
+    /// Image with its whole mip chain down to 1x1, owns the pixels (or the compressed blocks).
+    struct MipChain {
+        struct Layout {
+            int width;
+            int height;
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        int channels = 0;
+        // None for 8-bit pixels.
+        std::optional<compression::Format> format;
+        std::vector<Layout> layouts;
+        std::vector<std::uint8_t> pixels;
+
+        [[nodiscard]] auto getLevel(const std::size_t level) const -> Level {
+            const Layout& layout = layouts[level];
+            return Level { layout.width, layout.height, std::span(pixels).subspan(layout.offset, layout.size) };
+        }
+    };
+
+    /// Hash of the source image's bytes combined with the settings the mips were built with.
+    auto hashSource(
+        const std::string& sourcePath,
+        const ColorSpace colorSpace,
+        const bool flipped,
+        const bool compressed
+    ) -> std::uint64_t {
+        const MappedFile source(sourcePath);
+        if (!source.isOpen()) {
+            throw std::runtime_error("Could not open texture source for hashing: " + sourcePath);
+        }
+        std::uint64_t hash = file_mapping::hashBytes(source.data(), source.size());
+        hash = file_mapping::hashValue(colorSpace, hash);
+        hash = file_mapping::hashValue(flipped, hash);
+        return file_mapping::hashValue(compressed, hash);
+    }
+
+    /// Halves the `pixels` with a 2x2 box filter into `out`. sRGB channels are averaged
+    /// in linear space so the smaller mips don't get darker. SSE does the filtering arithmetic.
+    auto downsample(
+        const std::uint8_t* pixels,
+        const int width,
+        const int height,
+        const int channels,
+        const ColorSpace colorSpace,
+        std::uint8_t* out
+    ) -> void {
+        const auto& toLinear = detail::getSrgbToLinearTable();
+        const auto& toSrgb = detail::getLinearToSrgbTable();
+
+        // Alpha is never gamma encoded.
+        std::array<bool, 4> isSrgb{};
+        for (int c = 0; c < channels; c++) {
+            const bool isAlpha = (channels == 4 && c == 3) || (channels == 2 && c == 1);
+            isSrgb[c] = colorSpace == ColorSpace::SRGB && !isAlpha;
+        }
+
+        const int outWidth = std::max(width / 2, 1);
+        const int outHeight = std::max(height / 2, 1);
+
+        const auto loadLinear = [&](const int x, const int y, float* linear) {
+            const std::size_t clampedX = std::min(x, width - 1);
+            const std::size_t clampedY = std::min(y, height - 1);
+            const std::uint8_t* texel = pixels + (clampedY * width + clampedX) * channels;
+            for (int c = 0; c < channels; c++) {
+                linear[c] = isSrgb[c] ? toLinear[texel[c]] : static_cast<float>(texel[c]) * (1.0f / 255.0f);
+            }
+        };
+
+#if defined(__SSE2__)
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        const __m128 scale = _mm_setr_ps(
+            isSrgb[0] ? detail::linearSteps - 1 : 255.0f, isSrgb[1] ? detail::linearSteps - 1 : 255.0f,
+            isSrgb[2] ? detail::linearSteps - 1 : 255.0f, isSrgb[3] ? detail::linearSteps - 1 : 255.0f);
+#endif
+
+        for (int y = 0; y < outHeight; y++) {
+            for (int x = 0; x < outWidth; x++) {
+                alignas(16) std::array<std::array<float, 4>, 4> texels{};
+                loadLinear(2 * x, 2 * y, texels[0].data());
+                loadLinear(2 * x + 1, 2 * y, texels[1].data());
+                loadLinear(2 * x, 2 * y + 1, texels[2].data());
+                loadLinear(2 * x + 1, 2 * y + 1, texels[3].data());
+
+                alignas(16) std::array<std::int32_t, 4> steps{};
+#if defined(__SSE2__)
+                const __m128 sum = _mm_add_ps(
+                    _mm_add_ps(_mm_load_ps(texels[0].data()), _mm_load_ps(texels[1].data())),
+                    _mm_add_ps(_mm_load_ps(texels[2].data()), _mm_load_ps(texels[3].data())));
+                // Rounds to the nearest step (the default rounding mode).
+                const __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(sum, quarter), scale));
+                _mm_store_si128(reinterpret_cast<__m128i*>(steps.data()), rounded);
+#else
+                for (int c = 0; c < channels; c++) {
+                    const float average = (texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c]) * 0.25f;
+                    steps[c] = static_cast<std::int32_t>(std::lround(average * (isSrgb[c] ? detail::linearSteps - 1 : 255.0f)));
+                }
+#endif
+
+                for (int c = 0; c < channels; c++) {
+                    *out++ = isSrgb[c]
+                        ? toSrgb[std::clamp(steps[c], 0, detail::linearSteps - 1)]
+                        : static_cast<std::uint8_t>(std::clamp(steps[c], 0, 255));
+                }
+            }
+        }
+    }
+
+    /// Copies the image as level 0 and builds the rest of the chain down to 1x1,
+    /// each level from the previous one.
+    auto buildMipChain(const compression::ImageView& image, const ColorSpace colorSpace) -> MipChain {
+        MipChain chain { .channels = image.channels };
+
+        int width = image.width;
+        int height = image.height;
+        std::size_t totalSize = 0;
+        while (true) {
+            const std::size_t size = static_cast<std::size_t>(width) * height * image.channels;
+            chain.layouts.push_back(MipChain::Layout { width, height, totalSize, size });
+            totalSize += size;
+            if (width == 1 && height == 1) {
+                break;
+            }
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+
+        chain.pixels.resize(totalSize);
+        std::copy_n(image.pixels, chain.layouts[0].size, chain.pixels.data());
+
+        for (std::size_t level = 1; level < chain.layouts.size(); level++) {
+            const auto& previous = chain.layouts[level - 1];
+            downsample(chain.pixels.data() + previous.offset, previous.width, previous.height,
+                       image.channels, colorSpace, chain.pixels.data() + chain.layouts[level].offset);
+        }
+
+        return chain;
+    }
+
+    /// The format the image's levels are compressed into: BC4 and BC5 for one and two channels,
+    /// BC1 for colors without alpha (or with an opaque one) and BC7 for the ones with alpha.
+    auto selectFormat(const compression::ImageView& image) -> compression::Format {
+        using compression::Format;
+        switch (image.channels) {
+            case 1: { return Format::BC4; }
+            case 2: { return Format::BC5; }
+            case 3: { return Format::BC1; }
+            default: {
+                const std::size_t texelCount = static_cast<std::size_t>(image.width) * image.height;
+                for (std::size_t texel = 0; texel < texelCount; texel++) {
+                    if (image.pixels[texel * 4 + 3] != 255) {
+                        return Format::BC7;
+                    }
+                }
+                return Format::BC1;
+            }
+        }
+    }
+
+    /// Compresses every level of the 8-bit chain into the `format`. The levels are encoded one
+    /// by one on the calling thread, so it can run in a thread pool task (like the cooking does).
+    auto compressMipChain(const MipChain& chain, const compression::Format format) -> MipChain {
+        MipChain compressed { .channels = compression::getChannelCount(format), .format = format };
+
+        for (std::size_t level = 0; level < chain.layouts.size(); level++) {
+            const MipChain::Layout& layout = chain.layouts[level];
+            const compression::ImageView view { chain.pixels.data() + layout.offset, layout.width, layout.height, chain.channels };
+            const compression::CompressedImage image = compression::encode(view, format, false, false);
+            compressed.layouts.push_back(MipChain::Layout { layout.width, layout.height, compressed.pixels.size(), image.data.size() });
+            compressed.pixels.insert(compressed.pixels.end(), image.data.begin(), image.data.end());
+        }
+        return compressed;
+    }
+
+    /// Writes the mip chain to `cachePath`. Failing to write the cache
+    /// is not fatal, the image just gets decoded again next time.
+    auto write(
+        const std::string& cachePath,
+        const std::uint64_t sourceHash,
+        const ColorSpace colorSpace,
+        const MipChain& chain
+    ) -> bool {
+        using namespace detail;
+
+        std::vector<LevelEntry> levelEntries;
+        std::uint64_t offset = alignUp(sizeof(Header) + chain.layouts.size() * sizeof(LevelEntry), payloadAlignment);
+        for (const auto& layout : chain.layouts) {
+            levelEntries.push_back(LevelEntry {
+                .offset = offset,
+                .size = layout.size,
+                .width = static_cast<std::uint32_t>(layout.width),
+                .height = static_cast<std::uint32_t>(layout.height),
+            });
+            offset = alignUp(offset + layout.size, payloadAlignment);
+        }
+
+        const Header header {
+            .magic = magic,
+            .version = version,
+            .colorSpace = static_cast<std::uint32_t>(colorSpace),
+            .sourceHash = sourceHash,
+            .width = static_cast<std::uint32_t>(chain.layouts.front().width),
+            .height = static_cast<std::uint32_t>(chain.layouts.front().height),
+            .channels = static_cast<std::uint32_t>(chain.channels),
+            .levelCount = static_cast<std::uint32_t>(chain.layouts.size()),
+            .format = chain.format.has_value() ? static_cast<std::uint32_t>(*chain.format) : 0,
+            .reserved = 0,
+        };
+
+        // Write into a temporary file first so a crash mid-write
+        // never leaves a truncated cache with a valid header behind.
+        const std::string temporaryPath = cachePath + ".tmp";
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open()) {
+            std::cerr << "Could not write texture cache: " << cachePath << "\n";
+            return false;
+        }
+
+        const auto pad = [&](const std::uint64_t to) {
+            static constexpr std::array<char, payloadAlignment> zeros{};
+            const auto position = static_cast<std::uint64_t>(stream.tellp());
+            stream.write(zeros.data(), static_cast<std::streamsize>(to - position));
+        };
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(levelEntries.data()),
+                     static_cast<std::streamsize>(levelEntries.size() * sizeof(LevelEntry)));
+
+        for (std::size_t level = 0; level < chain.layouts.size(); level++) {
+            pad(levelEntries[level].offset);
+            stream.write(reinterpret_cast<const char*>(chain.pixels.data() + chain.layouts[level].offset),
+                         static_cast<std::streamsize>(chain.layouts[level].size));
+        }
+        pad(offset);
+        stream.close();
+
+        if (!stream) {
+            std::cerr << "Could not write texture cache: " << cachePath << "\n";
+            std::filesystem::remove(temporaryPath);
+            return false;
+        }
+
+        std::filesystem::rename(temporaryPath, cachePath);
+        return true;
+    }
+}
+
+/// Memory mapped cooked texture file. The levels it hands out point
+/// straight into the mapping, so they are valid only while this object lives.
+export class TextureCacheFile {
+private:
+    MappedFile mFile;
+    int mChannels = 0;
+    std::optional<texture::compression::Format> mFormat;
+    std::vector<texture::cache::Level> mLevels;
+
+    explicit TextureCacheFile(MappedFile&& file) : mFile(std::move(file)) {}
+public:
+    /// Maps the cooked file at `cachePath`. Returns nothing if the file is missing,
+    /// was cooked from a different source or with different settings, or by an older version.
+    static auto open(
+        const std::string& cachePath,
+        const std::uint64_t sourceHash,
+        const texture::cache::ColorSpace colorSpace
+    ) -> std::optional<TextureCacheFile> {
+        using namespace texture::cache::detail;
+
+        MappedFile file(cachePath);
+        if (!file.isOpen()) {
+            return std::nullopt;
+        }
+
+        const auto header = file.at<Header>(0);
+        if (header == nullptr
+        || header->magic != magic
+        || header->version != texture::cache::version
+        || header->colorSpace != static_cast<std::uint32_t>(colorSpace)
+        || header->sourceHash != sourceHash) {
+            std::println("Texture cache is stale, ignoring it: {}", cachePath);
+            return std::nullopt;
+        }
+
+        const auto levelEntries = file.at<LevelEntry>(sizeof(Header), header->levelCount);
+        const std::optional<texture::compression::Format> format = findFormat(header->format);
+        if (levelEntries == nullptr || header->levelCount == 0 || header->channels < 1 || header->channels > 4
+        || (header->format != 0 && !format.has_value())
+        || (format.has_value() && header->channels != static_cast<std::uint32_t>(texture::compression::getChannelCount(*format)))) {
+            std::cerr << "Texture cache is corrupted: " << cachePath << "\n";
+            return std::nullopt;
+        }
+
+        TextureCacheFile cache(std::move(file));
+        cache.mChannels = static_cast<int>(header->channels);
+        cache.mFormat = format;
+        cache.mLevels.reserve(header->levelCount);
+
+        for (std::uint32_t i = 0; i < header->levelCount; i++) {
+            const LevelEntry& entry = levelEntries[i];
+            const auto pixels = cache.mFile.at<std::uint8_t>(entry.offset, entry.size);
+            const std::uint64_t expectedSize = format.has_value()
+                ? texture::compression::getLevelSize(*format, static_cast<int>(entry.width), static_cast<int>(entry.height))
+                : static_cast<std::uint64_t>(entry.width) * entry.height * header->channels;
+            if (pixels == nullptr || entry.width == 0 || entry.height == 0 || entry.size != expectedSize) {
+                std::cerr << "Texture cache is corrupted: " << cachePath << "\n";
+                return std::nullopt;
+            }
+            cache.mLevels.push_back(texture::cache::Level {
+                static_cast<int>(entry.width), static_cast<int>(entry.height), std::span(pixels, entry.size),
+            });
+        }
+
+        return cache;
+    }
+
+    [[nodiscard]] auto getChannels() const -> int {
+        return mChannels;
+    }
+
+    /// The format the levels are compressed in, none for 8-bit pixels.
+    [[nodiscard]] auto getFormat() const -> std::optional<texture::compression::Format> {
+        return mFormat;
+    }
+
+    [[nodiscard]] auto getLevels() const -> const std::vector<texture::cache::Level>& {
+        return mLevels;
+    }
+};
@@ -11,7 +11,10 @@ module;
 
 export module texture;
 
+import gl_state;
 import shader_program;
+import texture.compression;
+import texture.cache;
 
 export namespace texture {
     enum class Dimension : GLenum {
@@ -68,6 +71,120 @@ export namespace texture {
         }
     }
 
+    /// Image decoded into CPU memory, not yet uploaded to the GPU.
+    /// Owns the pixels and frees them with STB when destroyed.
+    struct Image {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        std::unique_ptr<stbi_uc, void(*)(void*)> pixels{nullptr, stbi_image_free};
+
+        /// View of the pixels for the block compressor.
+        [[nodiscard]] auto getView() const -> compression::ImageView {
+            return compression::ImageView { pixels.get(), width, height, channels };
+        }
+    };
+
+    /// Size of the image and its whole mip chain in GPU memory.
+    auto estimateMipChainBytes(const int width, const int height, const int channels) -> std::size_t {
+        std::size_t bytes = 0;
+        std::size_t levelWidth = std::max(width, 1);
+        std::size_t levelHeight = std::max(height, 1);
+        while (true) {
+            bytes += levelWidth * levelHeight * static_cast<std::size_t>(channels);
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+            levelWidth = std::max<std::size_t>(levelWidth / 2, 1);
+            levelHeight = std::max<std::size_t>(levelHeight / 2, 1);
+        }
+        return bytes;
+    }
+
+    /// Decodes the image file at `filepath` with STB.
+    /// Safe to call from any thread, it doesn't touch OpenGL.
+    /// OpenGL read the data from left to right, bottom up while STB lib reads left to right, top to bottom.
+    /// That's why the image is flipped by default.
+    auto decodeImage(const std::string& filepath, const bool flipVertically = true) -> Image {
+        // The thread variant of the flip flag, so the decoding threads don't race on the global one.
+        stbi_set_flip_vertically_on_load_thread(flipVertically);
+
+        Image image;
+        stbi_uc* imageBytes = stbi_load(filepath.c_str(), &image.width, &image.height, &image.channels, 0);
+        if (imageBytes == nullptr) {
+            throw std::runtime_error("Failed to load texture: " + filepath + " (" + stbi_failure_reason() + ")\n");
+        }
+        image.pixels.reset(imageBytes);
+        return image;
+    }
+
+    /// Colors are stored gamma encoded, the other maps hold linear data.
+    auto getColorSpace(const Type textureType) -> cache::ColorSpace {
+        return textureType == Type::DiffuseMap ? cache::ColorSpace::SRGB : cache::ColorSpace::Linear;
+    }
+
+    /// Image with its whole mip chain, either mapped from the cooked texture cache
+    /// or freshly decoded and cooked.
+    struct CookedImage {
+        std::optional<TextureCacheFile> cacheFile; // Backs the levels on a cache hit.
+        cache::MipChain mipChain; // Backs the levels after cooking.
+        std::vector<cache::Level> levels;
+        int channels = 0;
+        std::optional<compression::Format> format; // The levels' block compression, none for 8-bit pixels.
+    };
+
+    /// Loads the mip chain from the cooked cache next to the image if it's up to date.
+    /// Otherwise decodes the image, builds the mips (in linear space for the sRGB colors),
+    /// block-compresses them when `compress` is set (see `cache::selectFormat`) and writes the cache.
+    /// Safe to call from any thread, it doesn't touch OpenGL.
+    auto cookImage(const std::string& filepath, const Type textureType, const bool compress = true) -> CookedImage {
+        using Clock = std::chrono::steady_clock;
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        const auto start = Clock::now();
+        const std::string cachePath = filepath + std::string(cache::fileExtension);
+        const cache::ColorSpace colorSpace = getColorSpace(textureType);
+        const std::uint64_t sourceHash = cache::hashSource(filepath, colorSpace, true, compress);
+
+        CookedImage cooked;
+
+        cooked.cacheFile = TextureCacheFile::open(cachePath, sourceHash, colorSpace);
+        if (cooked.cacheFile.has_value()) {
+            cooked.levels = cooked.cacheFile->getLevels();
+            cooked.channels = cooked.cacheFile->getChannels();
+            cooked.format = cooked.cacheFile->getFormat();
+            std::println("Texture cache hit in {:.2f} ms: {}", Milliseconds(Clock::now() - start).count(), filepath);
+            return cooked;
+        }
+
+        const Image image = decodeImage(filepath);
+        const auto decodeEnd = Clock::now();
+        cooked.mipChain = cache::buildMipChain(image.getView(), colorSpace);
+        const auto mipsEnd = Clock::now();
+        if (compress) {
+            cooked.mipChain = cache::compressMipChain(cooked.mipChain, cache::selectFormat(image.getView()));
+        }
+        const auto compressEnd = Clock::now();
+        cache::write(cachePath, sourceHash, colorSpace, cooked.mipChain);
+
+        cooked.channels = cooked.mipChain.channels;
+        cooked.format = cooked.mipChain.format;
+        for (std::size_t level = 0; level < cooked.mipChain.layouts.size(); level++) {
+            cooked.levels.push_back(cooked.mipChain.getLevel(level));
+        }
+
+        std::println("Cooked texture in {:.2f} ms (decode {:.2f} ms, {} mips {:.2f} ms, {} {:.2f} ms, write {:.2f} ms): {}",
+            Milliseconds(Clock::now() - start).count(),
+            Milliseconds(decodeEnd - start).count(),
+            cooked.levels.size(),
+            Milliseconds(mipsEnd - decodeEnd).count(),
+            cooked.format.has_value() ? compression::FormatToString(*cooked.format) : "uncompressed",
+            Milliseconds(compressEnd - mipsEnd).count(),
+            Milliseconds(Clock::now() - compressEnd).count(),
+            filepath);
+        return cooked;
+    }
+
 }
 
 using namespace texture;
@@ -88,6 +205,7 @@ private:
     int width = 0; // Width of the texture image in pixels.
     int height = 0; // Height of the texture image in pixels.
     int channels = 0; // Bits per pixel. Usually 3 or 4.
+    std::size_t residentBytes = 0; // Estimated size in GPU memory, mip maps included.
     int lastTextureUnitSlotIndex = 0;  // For correct unbinding of the texture objects.
 public:
     Texture(
@@ -108,11 +226,11 @@ public:
             case DataFormat::RGBA: return 4;
             default: throw std::runtime_error("Unknown texture channel format");
         }; }();
+        residentBytes = estimateMipChainBytes(width, height, channels);
 
         glGenTextures(1, &textureID); 
 
-        glActiveTexture(GL_TEXTURE0 + textureUnitSlot);
-        glBindTexture(static_cast<GLuint>(textureDimension), textureID);
+        GLState::getInstance().bindTexture(textureUnitSlot, static_cast<GLenum>(textureDimension), textureID);
 
         glTexImage2D(static_cast<GLuint>(textureDimension), 0, static_cast<GLint>(dataFormat), 
                      width, height, 0, static_cast<GLint>(dataFormat), GL_UNSIGNED_BYTE, nullptr);
@@ -126,7 +244,7 @@ public:
         glTextureParameteri(static_cast<GLuint>(textureDimension), GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
         glTextureParameteri(static_cast<GLuint>(textureDimension), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-        glBindTexture(static_cast<GLenum>(textureDimension), 0);
+        GLState::getInstance().bindTexture(textureUnitSlot, static_cast<GLenum>(textureDimension), 0);
     }
 
     /// Note that the `textureUnitSlot` is used only for the texture initialisation.
@@ -151,20 +269,68 @@ public:
 
         // this is for everything else
         printf("Loading texture %s\n", this->filepath.c_str());
-        // Creating OpenGL texture object and loading the texture to the CPU.
-        // OpenGL read the data from left to right, bottom up while STB lib reads left to right, top to bottom.
-        // Flipping the default direction is necessary.
-        stbi_set_flip_vertically_on_load(true);
 
-        // Load the image data with the help of the STB library and let the function set out width, height and channels.
-        stbi_uc *imageBytes = stbi_load(this->filepath.c_str(), &width, &height, &channels, 0);
+        // DDS and KTX2 files are already block-compressed, with their mip maps.
+        if (compression::isCompressedFile(this->filepath)) {
+            upload(compression::loadFile(this->filepath), textureUnitSlot);
+            return;
+        }
 
-        stbi_set_flip_vertically_on_load(false);
+        // Load the image data with its mip maps from the texture cache, or decode it with
+        // the help of the STB library and cook it. The upload sets width, height and channels.
+        upload(cookImage(this->filepath, type), textureUnitSlot);
+    }
 
-        // Check if the load was successful.
-        if (imageBytes == nullptr) {
-            throw std::runtime_error("Failed to load texture: " + filepath + "\n");
-        }
+    /// Creates the texture from an already decoded `image` (e.g. decoded on a worker thread).
+    /// The `filepath` is only kept for debugging.
+    Texture(
+        const std::string& filepath,
+        const Image& image,
+        const Type type,
+        const DataFormat format = DataFormat::NotSpecified,
+        const Dimension dimension = Dimension::$2D,
+        const int textureUnitSlot = 0)
+    : filepath(filepath), textureDimension(dimension), dataFormat(format)
+    , lastTextureUnitSlotIndex(textureUnitSlot), textureType(type) {
+        assert(dimension == Dimension::$2D && type != Type::CubeMap);
+        upload(image, textureUnitSlot);
+    }
+
+    /// Creates the texture from an already cooked `image` (e.g. cooked on a worker thread).
+    /// The `filepath` is only kept for debugging.
+    Texture(
+        const std::string& filepath,
+        const CookedImage& image,
+        const Type type,
+        const DataFormat format = DataFormat::NotSpecified,
+        const int textureUnitSlot = 0)
+    : filepath(filepath), textureDimension(Dimension::$2D), dataFormat(format)
+    , lastTextureUnitSlotIndex(textureUnitSlot), textureType(type) {
+        assert(type != Type::CubeMap);
+        upload(image, textureUnitSlot);
+    }
+
+    /// Creates the texture from block-compressed data (loaded from a DDS/KTX2 file or
+    /// compressed with `texture::compression::encode`). All of its mip levels are uploaded
+    /// as they are, none are generated. The `filepath` is only kept for debugging.
+    Texture(
+        const std::string& filepath,
+        const compression::CompressedImage& image,
+        const Type type,
+        const int textureUnitSlot = 0)
+    : filepath(filepath), textureDimension(Dimension::$2D), dataFormat(DataFormat::NotSpecified)
+    , lastTextureUnitSlotIndex(textureUnitSlot), textureType(type) {
+        assert(type != Type::CubeMap);
+        upload(image, textureUnitSlot);
+    }
+
+private:
+    /// Creates the OpenGL texture object and transfers the decoded `image` to the GPU.
+    auto upload(const Image& image, const int textureUnitSlot) -> void {
+        width = image.width;
+        height = image.height;
+        channels = image.channels;
+        residentBytes = estimateMipChainBytes(width, height, channels);
 
         // If the dataFormat was not specified make an assumption
         // that the texture is of formats R, RG, RGB or RGBA
@@ -186,18 +352,14 @@ public:
         // Generate the texture object ID.
         glGenTextures(1, &textureID);
         // Activating texture unit at specified slot and binding the texture to generated it.
-        // Activate the slot where we will put the created texture object.
-        glActiveTexture(GL_TEXTURE0 + textureUnitSlot);
-        // Putting it into the specified slot.
-        glBindTexture(static_cast<GLenum>(textureDimension), textureID);
+        // Activate the slot where we will put the created texture object and put it there.
+        GLState::getInstance().bindTexture(textureUnitSlot, static_cast<GLenum>(textureDimension), textureID);
 
         // Transfer the image data from CPU to the GPU.
         // The color channel is different for PNG and JPG images (JPG doesn't have alpha channel)
         // For PNG images use GL_RGBA and for JPG images use GL_RGB as `internalformat` and `format`
         glTexImage2D(static_cast<GLenum>(textureDimension), 0, static_cast<GLint>(dataFormat),
-            width, height, 0, static_cast<GLenum>(dataFormat), GL_UNSIGNED_BYTE, imageBytes);
-        // Free the image data on the CPU side as it is already been transferred.
-        stbi_image_free(imageBytes);
+            width, height, 0, static_cast<GLenum>(dataFormat), GL_UNSIGNED_BYTE, image.pixels.get());
 
         // Generates the mip maps of the same picture, which are smaller versions of the same image.
         // E.g. The smaller mip map will be used if the image is far away.
@@ -217,14 +379,109 @@ public:
         // glTextureParameterfv(static_cast<GLuint>(textureDimension), GL_TEXTURE_BORDER_COLOR, flatColor);
 
         // Unbind the texture unit slot, just in case.
-        glBindTexture(static_cast<GLenum>(textureDimension), 0);
+        GLState::getInstance().bindTexture(textureUnitSlot, static_cast<GLenum>(textureDimension), 0);
+    }
+
+    /// Creates the OpenGL texture object and transfers every prebuilt mip level of the `image`,
+    /// the compressed ones as they are. No mip maps are generated on the GPU.
+    auto upload(const CookedImage& image, const int textureUnitSlot) -> void {
+        if (image.levels.empty()) {
+            throw std::runtime_error("Cooked texture has no mip levels: " + this->filepath);
+        }
+
+        width = image.levels.front().width;
+        height = image.levels.front().height;
+        channels = image.channels;
+        residentBytes = 0;
+        for (const auto& level : image.levels) {
+            residentBytes += level.pixels.size();
+        }
+
+        if (dataFormat == DataFormat::NotSpecified) {
+            switch (channels) {
+                case 1: { dataFormat = DataFormat::R; } break;
+                case 2: { dataFormat = DataFormat::RG; } break;
+                case 3: { dataFormat = DataFormat::RGB; } break;
+                case 4: { dataFormat = DataFormat::RGBA; } break;
+                default: { throw std::runtime_error(
+                        std::format("Error while loading '{}' because of unsupported number of channels: {}",
+                            this->filepath, channels));
+                }
+            }
+        }
+
+        glGenTextures(1, &textureID);
+        GLState::getInstance().bindTexture(textureUnitSlot, GL_TEXTURE_2D, textureID);
+
+        // The rows are tightly packed, RGB rows of the small mips aren't 4-byte aligned.
+        GLint previousAlignment = 4;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        for (std::size_t level = 0; level < image.levels.size(); level++) {
+            const auto& mipLevel = image.levels[level];
+            if (image.format.has_value()) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLenum>(*image.format),
+                    mipLevel.width, mipLevel.height, 0, static_cast<GLsizei>(mipLevel.pixels.size()), mipLevel.pixels.data());
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(dataFormat),
+                    mipLevel.width, mipLevel.height, 0, static_cast<GLenum>(dataFormat), GL_UNSIGNED_BYTE,
+                    mipLevel.pixels.data());
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        GLState::getInstance().bindTexture(textureUnitSlot, GL_TEXTURE_2D, 0);
+    }
+
+    /// Creates the OpenGL texture object and transfers every mip level of the compressed `image`.
+    auto upload(const compression::CompressedImage& image, const int textureUnitSlot) -> void {
+        if (image.levels.empty()) {
+            throw std::runtime_error("Compressed texture has no mip levels: " + this->filepath);
+        }
+
+        width = image.getWidth();
+        height = image.getHeight();
+        channels = compression::getChannelCount(image.format);
+        residentBytes = image.data.size();
+        dataFormat = [&] { switch (channels) {
+            case 1: return DataFormat::R;
+            case 2: return DataFormat::RG;
+            case 3: return DataFormat::RGB;
+            default: return DataFormat::RGBA;
+        }; }();
+
+        glGenTextures(1, &textureID);
+        GLState::getInstance().bindTexture(textureUnitSlot, GL_TEXTURE_2D, textureID);
+
+        for (std::size_t level = 0; level < image.levels.size(); level++) {
+            const auto& mipLevel = image.levels[level];
+            const auto data = image.getLevelData(level);
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLenum>(image.format),
+                mipLevel.width, mipLevel.height, 0, static_cast<GLsizei>(data.size()), data.data());
+        }
+
+        // Without it the texture would be incomplete if the file doesn't have the whole mip chain.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        GLState::getInstance().bindTexture(textureUnitSlot, GL_TEXTURE_2D, 0);
     }
 
-private:
     void makeCubeMapTexture(Texture& self, const std::string& skyboxTexturesDirectory) {
         // Cube Map texture.
         glGenTextures(1, &self.textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, self.textureID);
+        GLState::getInstance().bindTexture(self.lastTextureUnitSlotIndex, GL_TEXTURE_CUBE_MAP, self.textureID);
 
         std::vector<std::string> textureFacesPaths = {
             "right.jpg",
@@ -235,9 +492,6 @@ private:
             "back.jpg",
         };
 
-        stbi_set_flip_vertically_on_load(false);
-        
-
         for (unsigned int i{}; i < textureFacesPaths.size(); i++) {
             std::stringstream path;
             path << skyboxTexturesDirectory 
@@ -246,20 +500,20 @@ private:
 
             printf("Loading cubemap texture %s\n", path.str().c_str());
 
-            int width, height, nrChannels;
-            unsigned char* data = stbi_load(path.str().c_str(), &width, &height, &nrChannels, 0);
-
-            if (data == nullptr) {
+            // Cube map faces are not flipped.
+            Image face;
+            try {
+                face = decodeImage(path.str(), false);
+            } catch (const std::runtime_error&) {
                 std::cerr << "Cube map texture failed to load: " << path.str() << "\n";
                 continue;
             }
 
             glTexImage2D(
                 GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                0, GL_RGB, width, height, 
-                0, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-            stbi_image_free(data);
+                0, GL_RGB, face.width, face.height, 
+                0, GL_RGB, GL_UNSIGNED_BYTE, face.pixels.get());
+            self.residentBytes += static_cast<std::size_t>(face.width) * face.height * 3;
         }
 
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -295,23 +549,22 @@ public:
     /// This code mustn't be in to deconstruct. That would fuck up the copy semantics.
     auto deleteResource() -> void {
         if (textureID != 0) {
+            GLState::forgetTextures();
             glDeleteTextures(1, &textureID);
         }
         textureID = 0;
     }
 
-    /// Binds texture object to specified texture unit slot.
+    /// Binds texture object to specified texture unit slot, skipped if it's already there.
     /// CAUTION: Expects the texture unit slot to be a regular number and not the OpenGL macro.
     auto bindToSlot(const GLint textureUnitSlotIndex) -> void {
-        glActiveTexture(GL_TEXTURE0 + textureUnitSlotIndex);
-        glBindTexture(static_cast<GLenum>(textureDimension), textureID);
+        GLState::getInstance().bindTexture(textureUnitSlotIndex, getTarget(), textureID);
         lastTextureUnitSlotIndex = textureUnitSlotIndex;
     }
 
     /// Binds to the last slot it was in.
     auto bindToLastSlot() const -> void {
-        glActiveTexture(GL_TEXTURE0 + lastTextureUnitSlotIndex);
-        glBindTexture(static_cast<GLenum>(textureDimension), textureID);
+        GLState::getInstance().bindTexture(lastTextureUnitSlotIndex, getTarget(), textureID);
     }
 
     /// Unbinds texture object from the texture unit slot
@@ -320,8 +573,12 @@ public:
     /// where this texture object was last time put into.
     /// NOTE: Calling this is not really needed.
     auto unbind() const -> void {
-        glActiveTexture(GL_TEXTURE0 + lastTextureUnitSlotIndex);
-        glBindTexture(static_cast<GLenum>(textureDimension), 0);
+        GLState::getInstance().bindTexture(lastTextureUnitSlotIndex, getTarget(), 0);
+    }
+
+    /// Where the texture gets bound, GL_TEXTURE_CUBE_MAP for the cube maps.
+    [[nodiscard]] auto getTarget() const -> GLenum {
+        return textureType == Type::CubeMap ? GL_TEXTURE_CUBE_MAP : static_cast<GLenum>(textureDimension);
     }
 
     [[nodiscard]] auto getType() const -> Type {
@@ -332,6 +589,22 @@ public:
         return filepath;
     }
 
+    [[nodiscard]] auto getWidth() const -> int {
+        return width;
+    }
+
+    [[nodiscard]] auto getHeight() const -> int {
+        return height;
+    }
+
+    [[nodiscard]] auto getChannels() const -> int {
+        return channels;
+    }
+
+    [[nodiscard]] auto getResidentBytes() const -> std::size_t {
+        return residentBytes;
+    }
+
     [[nodiscard("You fuck. You use it if you call it.")]]
     auto getID() const -> GLuint {
         return textureID;
@@ -364,14 +637,13 @@ public:
     /// `textureUnitSlot` is provided by the caller.
     static auto setSamplerInShader(
         ShaderProgram& shader,
-        const std::string& uniformSamplerVariableName,
+        const UniformName uniformSamplerVariableName,
         const GLint textureUnitSlotIndex
     ) -> void {
         // Make sure to bind the shader program first.
-        // Bind the shader to send the texture object to the texture unit
+        // Bind the shader to send the texture object to the texture unit, it's left bound for the draw.
         shader.bind();
         shader.setUniform1i(uniformSamplerVariableName, textureUnitSlotIndex);
-        ShaderProgram::unbind();
     }
 };
 
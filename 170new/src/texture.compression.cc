@@ -0,0 +1,1225 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+export module texture.compression;
+
+import file_mapping;
+import thread_pool;
+
+export namespace texture::compression {
+    /// GPU block-compressed formats. Every format stores 4x4 texel blocks.
+    /// NOTE: The sRGB variants found in files are loaded as the plain UNORM ones,
+    ///       the renderer doesn't sample any texture as sRGB.
+    enum class Format : GLenum {
+        BC1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,   // RGB, 8 bytes per block.
+        BC3 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,  // RGBA, 16 bytes per block.
+        BC4 = GL_COMPRESSED_RED_RGTC1,           // R, 8 bytes per block.
+        BC5 = GL_COMPRESSED_RG_RGTC2,            // RG, 16 bytes per block.
+        BC7 = GL_COMPRESSED_RGBA_BPTC_UNORM,     // RGBA, 16 bytes per block. Encoded as mode 6 only, see `encodeBc7Block`.
+    };
+
+    auto FormatToString(const Format format) -> std::string {
+        switch (format) {
+            case Format::BC1: { return "BC1"; } break;
+            case Format::BC3: { return "BC3"; } break;
+            case Format::BC4: { return "BC4"; } break;
+            case Format::BC5: { return "BC5"; } break;
+            case Format::BC7: { return "BC7"; } break;
+            default: throw std::runtime_error("FormatToString: unknown");
+        }
+    }
+
+    /// Size of one 4x4 block in bytes.
+    constexpr auto getBlockSize(const Format format) -> std::size_t {
+        return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+    }
+
+    /// Number of channels the format stores.
+    constexpr auto getChannelCount(const Format format) -> int {
+        switch (format) {
+            case Format::BC1: return 3;
+            case Format::BC4: return 1;
+            case Format::BC5: return 2;
+            default: return 4;
+        }
+    }
+
+    /// Size in bytes of one mip level with the given size in texels.
+    constexpr auto getLevelSize(const Format format, const int width, const int height) -> std::size_t {
+        const auto blocksX = static_cast<std::size_t>(std::max((width + 3) / 4, 1));
+        const auto blocksY = static_cast<std::size_t>(std::max((height + 3) / 4, 1));
+        return blocksX * blocksY * getBlockSize(format);
+    }
+
+    /// Non-owning view over tightly packed 8-bit pixels with 1 to 4 channels.
+    struct ImageView {
+        const std::uint8_t* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+    };
+
+    struct MipLevel {
+        int width = 0;
+        int height = 0;
+        std::size_t offset = 0; // From the start of `CompressedImage::data`.
+        std::size_t size = 0;
+    };
+
+    /// Block-compressed image with all its mip levels, ready for `glCompressedTexImage2D`.
+    /// The levels go from the largest (level 0) to the smallest.
+    struct CompressedImage {
+        Format format = Format::BC1;
+        std::vector<MipLevel> levels;
+        std::vector<std::uint8_t> data;
+
+        [[nodiscard]] auto getWidth() const -> int {
+            return levels.empty() ? 0 : levels.front().width;
+        }
+
+        [[nodiscard]] auto getHeight() const -> int {
+            return levels.empty() ? 0 : levels.front().height;
+        }
+
+        [[nodiscard]] auto getLevelData(const std::size_t level) const -> std::span<const std::uint8_t> {
+            return std::span(data).subspan(levels[level].offset, levels[level].size);
+        }
+    };
+}
+
+namespace texture::compression::detail {
+    // 16 texels of a 4x4 block as RGBA, row by row.
+    using Block = std::array<std::uint8_t, 64>;
+
+    // Block rows encoded by one thread pool task.
+    constexpr int blockRowsPerTask = 8;
+
+    auto expandTexel(const std::uint8_t* texel, const int channels) -> std::array<std::uint8_t, 4> {
+        switch (channels) {
+            case 1: return { texel[0], texel[0], texel[0], 255 };
+            case 2: return { texel[0], texel[0], texel[0], texel[1] };
+            case 3: return { texel[0], texel[1], texel[2], 255 };
+            default: return { texel[0], texel[1], texel[2], texel[3] };
+        }
+    }
+
+    /// Texel at (x, y) clamped to the image's edge, with the channels in the order
+    /// the format encodes them. BC5 takes the first two channels of the source.
+    auto fetchTexel(const ImageView& image, const Format format, const int x, const int y) -> std::array<std::uint8_t, 4> {
+        const std::size_t clampedX = std::min(x, image.width - 1);
+        const std::size_t clampedY = std::min(y, image.height - 1);
+        const std::uint8_t* texel = image.pixels + (clampedY * image.width + clampedX) * image.channels;
+
+        auto rgba = expandTexel(texel, image.channels);
+        if (format == Format::BC5 && image.channels == 2) {
+            rgba[1] = rgba[3];
+        }
+        return rgba;
+    }
+
+    auto fetchBlock(const ImageView& image, const Format format, const int blockX, const int blockY) -> Block {
+        Block block;
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                const auto texel = fetchTexel(image, format, blockX * 4 + x, blockY * 4 + y);
+                std::ranges::copy(texel, block.begin() + (y * 4 + x) * 4);
+            }
+        }
+        return block;
+    }
+
+    auto to565(const std::array<std::uint8_t, 4>& color) -> std::uint16_t {
+        return static_cast<std::uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+    }
+
+    auto from565(const std::uint16_t color) -> std::array<int, 3> {
+        const int r = (color >> 11) & 31;
+        const int g = (color >> 5) & 63;
+        const int b = color & 31;
+        return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+    }
+
+    auto writeU16(std::uint8_t* out, const std::uint16_t value) -> void {
+        out[0] = static_cast<std::uint8_t>(value);
+        out[1] = static_cast<std::uint8_t>(value >> 8);
+    }
+
+    auto readU16(const std::uint8_t* in) -> std::uint16_t {
+        return static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+    }
+
+    /// Per channel minimum and maximum of the block's texels.
+    auto findColorBounds(const Block& block, std::array<std::uint8_t, 4>& minColor, std::array<std::uint8_t, 4>& maxColor) -> void {
+#if defined(__SSE2__)
+        __m128i low = _mm_set1_epi8(static_cast<char>(0xFF));
+        __m128i high = _mm_setzero_si128();
+        for (int i = 0; i < 4; i++) {
+            const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.data() + 16 * i));
+            low = _mm_min_epu8(low, texels);
+            high = _mm_max_epu8(high, texels);
+        }
+        // Folds the four texels in a register down to one.
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+
+        const auto lowBits = static_cast<std::uint32_t>(_mm_cvtsi128_si32(low));
+        const auto highBits = static_cast<std::uint32_t>(_mm_cvtsi128_si32(high));
+        for (int c = 0; c < 4; c++) {
+            minColor[c] = static_cast<std::uint8_t>(lowBits >> (8 * c));
+            maxColor[c] = static_cast<std::uint8_t>(highBits >> (8 * c));
+        }
+#else
+        minColor = { 255, 255, 255, 255 };
+        maxColor = { 0, 0, 0, 0 };
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+                maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    /// Dot product of every texel's RGB with `axis`.
+    auto dotTexels(const Block& block, const std::array<int, 3>& axis, std::array<int, 16>& dots) -> void {
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i axis16 = _mm_setr_epi16(
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), 0,
+            static_cast<short>(axis[0]), static_cast<short>(axis[1]), static_cast<short>(axis[2]), 0);
+        for (int i = 0; i < 4; i++) {
+            const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.data() + 16 * i));
+            // Each gives [r*x + g*y, b*z, ...] for two texels.
+            const __m128 products01 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(texels, zero), axis16));
+            const __m128 products23 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(texels, zero), axis16));
+            const __m128i redGreen = _mm_castps_si128(_mm_shuffle_ps(products01, products23, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i blue = _mm_castps_si128(_mm_shuffle_ps(products01, products23, _MM_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dots.data() + 4 * i), _mm_add_epi32(redGreen, blue));
+        }
+#else
+        for (int i = 0; i < 16; i++) {
+            dots[i] = block[i * 4] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+        }
+#endif
+    }
+
+    /// Encodes the RGB of the block into an 8 byte BC1 color block (always the 4 color mode).
+    /// The endpoints are the inset bounding box of the colors, the texels are
+    /// assigned to the palette by projecting them onto the line between the endpoints.
+    auto encodeColorBlock(const Block& block, std::uint8_t* out) -> void {
+        std::array<std::uint8_t, 4> minColor{};
+        std::array<std::uint8_t, 4> maxColor{};
+        findColorBounds(block, minColor, maxColor);
+
+        // Insetting by 1/16 of the range lowers the error of the palette's inner colors.
+        for (int c = 0; c < 3; c++) {
+            const int inset = (maxColor[c] - minColor[c]) >> 4;
+            minColor[c] = static_cast<std::uint8_t>(minColor[c] + inset);
+            maxColor[c] = static_cast<std::uint8_t>(maxColor[c] - inset);
+        }
+
+        // Quantizing keeps the order, so color0 >= color1 and equal only for a flat block.
+        const std::uint16_t color0 = to565(maxColor);
+        const std::uint16_t color1 = to565(minColor);
+        writeU16(out, color0);
+        writeU16(out + 2, color1);
+
+        std::uint32_t indices = 0;
+        if (color0 != color1) {
+            const auto endpoint0 = from565(color0);
+            const auto endpoint1 = from565(color1);
+            const std::array<int, 3> axis = {
+                endpoint0[0] - endpoint1[0], endpoint0[1] - endpoint1[1], endpoint0[2] - endpoint1[2],
+            };
+            const int axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            const int origin = endpoint1[0] * axis[0] + endpoint1[1] * axis[1] + endpoint1[2] * axis[2];
+
+            std::array<int, 16> dots{};
+            dotTexels(block, axis, dots);
+
+            // Position on the line (0 = color1 .. 3 = color0) to the BC1 palette index.
+            static constexpr std::array<std::uint32_t, 4> paletteIndex = { 1, 3, 2, 0 };
+            for (int i = 0; i < 16; i++) {
+                const int distance = dots[i] - origin;
+                const int step = distance <= 0
+                    ? 0 : std::min(3, (6 * distance + axisLengthSquared) / (2 * axisLengthSquared));
+                indices |= paletteIndex[step] << (2 * i);
+            }
+        }
+
+        for (int i = 0; i < 4; i++) {
+            out[4 + i] = static_cast<std::uint8_t>(indices >> (8 * i));
+        }
+    }
+
+    /// Encodes one channel of the block into an 8 byte BC4 block (the alpha block of BC3).
+    /// Uses the 8 value mode between the channel's minimum and maximum.
+    auto encodeSingleChannelBlock(const Block& block, const int channel, std::uint8_t* out) -> void {
+        std::array<std::uint8_t, 16> values{};
+        for (int i = 0; i < 16; i++) {
+            values[i] = block[i * 4 + channel];
+        }
+
+#if defined(__SSE2__)
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values.data()));
+        __m128i high = low;
+        // Folds the 16 values down to one.
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 2));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 2));
+        low = _mm_min_epu8(low, _mm_srli_si128(low, 1));
+        high = _mm_max_epu8(high, _mm_srli_si128(high, 1));
+        const auto minValue = static_cast<std::uint8_t>(_mm_cvtsi128_si32(low));
+        const auto maxValue = static_cast<std::uint8_t>(_mm_cvtsi128_si32(high));
+#else
+        const auto [minIt, maxIt] = std::ranges::minmax_element(values);
+        const std::uint8_t minValue = *minIt;
+        const std::uint8_t maxValue = *maxIt;
+#endif
+
+        out[0] = maxValue;
+        out[1] = minValue;
+
+        std::uint64_t indices = 0;
+        if (maxValue != minValue) {
+            const int range = maxValue - minValue;
+            for (int i = 0; i < 16; i++) {
+                // Position between the endpoints (0 = min .. 7 = max) to the BC4 palette index.
+                const int step = ((values[i] - minValue) * 14 + range) / (2 * range);
+                const std::uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+                indices |= index << (3 * i);
+            }
+        }
+
+        for (int i = 0; i < 6; i++) {
+            out[2 + i] = static_cast<std::uint8_t>(indices >> (8 * i));
+        }
+    }
+
+    // BC7, see the "BPTC" section of the Khronos Data Format Specification. A block is a 128-bit
+    // stream read from the lowest bit of the first byte. Only the single subset modes (4, 5 and 6)
+    // are handled on the CPU, the other modes split the block into partitions by shape tables.
+
+    auto getBits(const std::uint8_t* block, const int offset, const int count) -> std::uint32_t {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; i++) {
+            const int bit = offset + i;
+            value |= static_cast<std::uint32_t>((block[bit / 8] >> (bit % 8)) & 1) << i;
+        }
+        return value;
+    }
+
+    auto setBits(std::uint8_t* block, const int offset, const int count, const std::uint32_t value) -> void {
+        for (int i = 0; i < count; i++) {
+            const int bit = offset + i;
+            const auto mask = static_cast<std::uint8_t>(1 << (bit % 8));
+            block[bit / 8] = static_cast<std::uint8_t>(((value >> i) & 1) ? block[bit / 8] | mask : block[bit / 8] & ~mask);
+        }
+    }
+
+    /// The mode is the number of zero bits before the first one, 8 is the reserved (invalid) mode.
+    auto getBc7Mode(const std::uint8_t* block) -> int {
+        return block[0] == 0 ? 8 : std::countr_zero(block[0]);
+    }
+
+    constexpr auto isBc7SingleSubsetMode(const int mode) -> bool {
+        return mode >= 4 && mode <= 6;
+    }
+
+    /// Where the endpoints and the indices of a single subset mode are in the block.
+    /// The endpoints are stored as pairs (R0 R1 G0 G1 B0 B1 A0 A1), each set of indices
+    /// stores its first (anchor) index with one bit less, its top bit is implied zero.
+    struct Bc7Layout {
+        int colorOffset;
+        int colorBits;
+        int alphaOffset;
+        int alphaBits;
+        int colorIndexOffset;
+        int colorIndexBits;
+        int alphaIndexOffset; // Same as the color indices if the mode has only one set.
+        int alphaIndexBits;
+    };
+
+    auto getBc7Layout(const std::uint8_t* block, const int mode) -> Bc7Layout {
+        switch (mode) {
+            case 4: {
+                // The index mode bit picks which set (2 or 3 bits) the colors use.
+                const bool isIndexModeSwapped = getBits(block, 7, 1) != 0;
+                return Bc7Layout {
+                    .colorOffset = 8, .colorBits = 5, .alphaOffset = 38, .alphaBits = 6,
+                    .colorIndexOffset = isIndexModeSwapped ? 81 : 50, .colorIndexBits = isIndexModeSwapped ? 3 : 2,
+                    .alphaIndexOffset = isIndexModeSwapped ? 50 : 81, .alphaIndexBits = isIndexModeSwapped ? 2 : 3,
+                };
+            }
+            case 5: return Bc7Layout {
+                .colorOffset = 8, .colorBits = 7, .alphaOffset = 50, .alphaBits = 8,
+                .colorIndexOffset = 66, .colorIndexBits = 2, .alphaIndexOffset = 97, .alphaIndexBits = 2,
+            };
+            default: return Bc7Layout {
+                .colorOffset = 7, .colorBits = 7, .alphaOffset = 49, .alphaBits = 7,
+                .colorIndexOffset = 65, .colorIndexBits = 4, .alphaIndexOffset = 65, .alphaIndexBits = 4,
+            };
+        }
+    }
+
+    /// Offset of the texel's index, the anchor (texel 0) is one bit shorter.
+    constexpr auto getBc7IndexOffset(const int setOffset, const int bits, const int texel) -> int {
+        return texel == 0 ? setOffset : setOffset + texel * bits - 1;
+    }
+
+    auto getBc7Indices(const std::uint8_t* block, const int setOffset, const int bits) -> std::array<std::uint32_t, 16> {
+        std::array<std::uint32_t, 16> indices{};
+        for (int i = 0; i < 16; i++) {
+            indices[i] = getBits(block, getBc7IndexOffset(setOffset, bits, i), i == 0 ? bits - 1 : bits);
+        }
+        return indices;
+    }
+
+    auto setBc7Indices(std::uint8_t* block, const int setOffset, const int bits, const std::array<std::uint32_t, 16>& indices) -> void {
+        for (int i = 0; i < 16; i++) {
+            setBits(block, getBc7IndexOffset(setOffset, bits, i), i == 0 ? bits - 1 : bits, indices[i]);
+        }
+    }
+
+    // Interpolation weights (out of 64) of the 2, 3 and 4-bit indices.
+    constexpr std::array<int, 4> bc7Weights2 = { 0, 21, 43, 64 };
+    constexpr std::array<int, 8> bc7Weights3 = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr std::array<int, 16> bc7Weights4 = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    auto getBc7Weights(const int bits) -> std::span<const int> {
+        switch (bits) {
+            case 2: return bc7Weights2;
+            case 3: return bc7Weights3;
+            default: return bc7Weights4;
+        }
+    }
+
+    constexpr auto interpolateBc7(const int endpoint0, const int endpoint1, const int weight) -> int {
+        return ((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6;
+    }
+
+    /// Extends an endpoint of `bits` bits to 8 by repeating its top bits.
+    constexpr auto unquantizeBc7(const std::uint32_t value, const int bits) -> int {
+        return bits == 8 ? static_cast<int>(value) : static_cast<int>((value << (8 - bits)) | (value >> (2 * bits - 8)));
+    }
+
+    /// Decodes a single subset block. Throws for the partitioned modes, the reserved mode decodes to zeros.
+    auto decodeBc7Block(const std::uint8_t* in, Block& block) -> void {
+        const int mode = getBc7Mode(in);
+        if (mode == 8) {
+            block.fill(0);
+            return;
+        }
+        if (!isBc7SingleSubsetMode(mode)) {
+            throw std::runtime_error(std::format("BC7 blocks of mode {} (partitioned) can't be decoded on the CPU.", mode));
+        }
+
+        const Bc7Layout layout = getBc7Layout(in, mode);
+        std::array<std::array<int, 4>, 2> endpoints{};
+        for (int e = 0; e < 2; e++) {
+            for (int c = 0; c < 3; c++) {
+                const std::uint32_t value = getBits(in, layout.colorOffset + (2 * c + e) * layout.colorBits, layout.colorBits);
+                endpoints[e][c] = mode == 6
+                    ? static_cast<int>((value << 1) | getBits(in, 63 + e, 1)) : unquantizeBc7(value, layout.colorBits);
+            }
+            const std::uint32_t alpha = getBits(in, layout.alphaOffset + e * layout.alphaBits, layout.alphaBits);
+            endpoints[e][3] = mode == 6 ? static_cast<int>((alpha << 1) | getBits(in, 63 + e, 1)) : unquantizeBc7(alpha, layout.alphaBits);
+        }
+
+        const auto colorIndices = getBc7Indices(in, layout.colorIndexOffset, layout.colorIndexBits);
+        const auto alphaIndices = getBc7Indices(in, layout.alphaIndexOffset, layout.alphaIndexBits);
+        const auto colorWeights = getBc7Weights(layout.colorIndexBits);
+        const auto alphaWeights = getBc7Weights(layout.alphaIndexBits);
+        // Modes 4 and 5 can store the alpha in one of the color channels and that channel in the alpha.
+        const std::uint32_t rotation = mode == 6 ? 0 : getBits(in, mode == 4 ? 5 : 6, 2);
+        for (int i = 0; i < 16; i++) {
+            std::uint8_t* texel = block.data() + i * 4;
+            for (int c = 0; c < 3; c++) {
+                texel[c] = static_cast<std::uint8_t>(interpolateBc7(endpoints[0][c], endpoints[1][c], colorWeights[colorIndices[i]]));
+            }
+            texel[3] = static_cast<std::uint8_t>(interpolateBc7(endpoints[0][3], endpoints[1][3], alphaWeights[alphaIndices[i]]));
+            if (rotation != 0) {
+                std::swap(texel[3], texel[rotation - 1]);
+            }
+        }
+    }
+
+    /// Encodes the block into mode 6 (one subset, RGBA endpoints of 7 bits and a shared bit each, 4-bit indices).
+    /// The endpoints are the inset bounding box of the texels, with its diagonal turned to follow the
+    /// channels that fall as the first one with a range rises. Every texel gets the nearest of the 16 palette colors.
+    auto encodeBc7Block(const Block& block, std::uint8_t* out) -> void {
+        std::array<std::uint8_t, 4> minColor{};
+        std::array<std::uint8_t, 4> maxColor{};
+        findColorBounds(block, minColor, maxColor);
+
+        std::array<int, 4> endpoint0{};
+        std::array<int, 4> endpoint1{};
+        for (int c = 0; c < 4; c++) {
+            const int inset = (maxColor[c] - minColor[c]) >> 4;
+            endpoint0[c] = minColor[c] + inset;
+            endpoint1[c] = maxColor[c] - inset;
+        }
+
+        // A bounding box has several diagonals, the covariance with the widest channel picks the one along the texels.
+        std::array<int, 4> ranges{};
+        for (int c = 0; c < 4; c++) {
+            ranges[c] = maxColor[c] - minColor[c];
+        }
+        const auto widest = static_cast<int>(std::ranges::max_element(ranges) - ranges.begin());
+        std::array<int, 4> mean{}; // Times 16, the sums.
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                mean[c] += block[i * 4 + c];
+            }
+        }
+        for (int c = 0; c < 4; c++) {
+            if (c == widest) {
+                continue;
+            }
+            int covariance = 0;
+            for (int i = 0; i < 16; i++) {
+                covariance += (16 * block[i * 4 + widest] - mean[widest]) * (16 * block[i * 4 + c] - mean[c]);
+            }
+            if (covariance < 0) {
+                std::swap(endpoint0[c], endpoint1[c]);
+            }
+        }
+
+        // Each endpoint picks the shared lowest bit that fits its four channels best.
+        std::array<std::array<std::uint32_t, 4>, 2> quantized{};
+        std::array<std::uint32_t, 2> sharedBits{};
+        std::array<std::array<int, 4>, 2> endpoints{};
+        for (int e = 0; e < 2; e++) {
+            const std::array<int, 4>& endpoint = e == 0 ? endpoint0 : endpoint1;
+            int bestError = std::numeric_limits<int>::max();
+            for (std::uint32_t bit = 0; bit < 2; bit++) {
+                std::array<std::uint32_t, 4> values{};
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    values[c] = static_cast<std::uint32_t>(std::clamp((endpoint[c] - static_cast<int>(bit) + 1) / 2, 0, 127));
+                    const int difference = static_cast<int>((values[c] << 1) | bit) - endpoint[c];
+                    error += difference * difference;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    quantized[e] = values;
+                    sharedBits[e] = bit;
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                endpoints[e][c] = static_cast<int>((quantized[e][c] << 1) | sharedBits[e]);
+            }
+        }
+
+        const auto weights = getBc7Weights(4);
+        std::array<std::array<int, 4>, 16> palette{};
+        for (int p = 0; p < 16; p++) {
+            for (int c = 0; c < 4; c++) {
+                palette[p][c] = interpolateBc7(endpoints[0][c], endpoints[1][c], weights[p]);
+            }
+        }
+
+        std::array<std::uint32_t, 16> indices{};
+        for (int i = 0; i < 16; i++) {
+            int bestError = std::numeric_limits<int>::max();
+            for (std::uint32_t p = 0; p < 16; p++) {
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    const int difference = palette[p][c] - block[i * 4 + c];
+                    error += difference * difference;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    indices[i] = p;
+                }
+            }
+        }
+
+        // The anchor index has no top bit, swapping the endpoints mirrors the indices so it's clear.
+        if (indices[0] >= 8) {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(sharedBits[0], sharedBits[1]);
+            for (std::uint32_t& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::fill_n(out, 16, 0);
+        setBits(out, 0, 7, 1 << 6);
+        for (int c = 0; c < 4; c++) {
+            setBits(out, 7 + c * 14, 7, quantized[0][c]);
+            setBits(out, 7 + c * 14 + 7, 7, quantized[1][c]);
+        }
+        setBits(out, 63, 1, sharedBits[0]);
+        setBits(out, 64, 1, sharedBits[1]);
+        setBc7Indices(out, 65, 4, indices);
+    }
+
+    /// Swaps the texel rows of a single subset block upside down, losslessly. Only the first `rows` rows hold texels.
+    /// Another texel becomes the anchor, if its index has the top bit the set's endpoints are swapped
+    /// and its indices mirrored. The partitioned modes can't be flipped, their shapes aren't symmetric.
+    auto flipBc7Block(std::uint8_t* block, const int rows) -> void {
+        const int mode = getBc7Mode(block);
+        if (mode == 8) {
+            return;
+        }
+        if (!isBc7SingleSubsetMode(mode)) {
+            throw std::runtime_error(std::format("BC7 blocks of mode {} (partitioned) can't be flipped.", mode));
+        }
+
+        const Bc7Layout layout = getBc7Layout(block, mode);
+        const auto swapEndpoints = [block](const int offset, const int bits, const int channels) {
+            for (int c = 0; c < channels; c++) {
+                const int first = offset + 2 * c * bits;
+                const std::uint32_t endpoint0 = getBits(block, first, bits);
+                setBits(block, first, bits, getBits(block, first + bits, bits));
+                setBits(block, first + bits, bits, endpoint0);
+            }
+        };
+        const auto flipIndices = [block, rows](const int setOffset, const int bits) -> bool {
+            const auto indices = getBc7Indices(block, setOffset, bits);
+            std::array<std::uint32_t, 16> flipped = indices;
+            for (int y = 0; y < rows; y++) {
+                std::copy_n(indices.begin() + y * 4, 4, flipped.begin() + (rows - 1 - y) * 4);
+            }
+            const std::uint32_t topBit = 1u << (bits - 1);
+            const bool isMirrored = (flipped[0] & topBit) != 0;
+            if (isMirrored) {
+                for (std::uint32_t& index : flipped) {
+                    index = (2 * topBit - 1) - index;
+                }
+            }
+            setBc7Indices(block, setOffset, bits, flipped);
+            return isMirrored;
+        };
+
+        if (mode == 6) {
+            // One set of indices for all four channels, each endpoint has its own shared bit.
+            if (flipIndices(layout.colorIndexOffset, layout.colorIndexBits)) {
+                swapEndpoints(layout.colorOffset, layout.colorBits, 4);
+                const std::uint32_t sharedBit0 = getBits(block, 63, 1);
+                setBits(block, 63, 1, getBits(block, 64, 1));
+                setBits(block, 64, 1, sharedBit0);
+            }
+            return;
+        }
+        // The color and the alpha indices are flipped (and mirrored) apart.
+        if (flipIndices(layout.colorIndexOffset, layout.colorIndexBits)) {
+            swapEndpoints(layout.colorOffset, layout.colorBits, 3);
+        }
+        if (flipIndices(layout.alphaIndexOffset, layout.alphaIndexBits)) {
+            swapEndpoints(layout.alphaOffset, layout.alphaBits, 1);
+        }
+    }
+
+    auto encodeBlock(const Block& block, const Format format, std::uint8_t* out) -> void {
+        switch (format) {
+            case Format::BC1: {
+                encodeColorBlock(block, out);
+            } break;
+            case Format::BC3: {
+                encodeSingleChannelBlock(block, 3, out);
+                encodeColorBlock(block, out + 8);
+            } break;
+            case Format::BC4: {
+                encodeSingleChannelBlock(block, 0, out);
+            } break;
+            case Format::BC5: {
+                encodeSingleChannelBlock(block, 0, out);
+                encodeSingleChannelBlock(block, 1, out + 8);
+            } break;
+            case Format::BC7: {
+                encodeBc7Block(block, out);
+            } break;
+        }
+    }
+
+    auto decodeColorBlock(const std::uint8_t* in, Block& block) -> void {
+        const std::uint16_t color0 = readU16(in);
+        const std::uint16_t color1 = readU16(in + 2);
+        const auto endpoint0 = from565(color0);
+        const auto endpoint1 = from565(color1);
+
+        std::array<std::array<int, 3>, 4> palette = { endpoint0, endpoint1 };
+        for (int c = 0; c < 3; c++) {
+            if (color0 > color1) {
+                palette[2][c] = (2 * endpoint0[c] + endpoint1[c]) / 3;
+                palette[3][c] = (endpoint0[c] + 2 * endpoint1[c]) / 3;
+            } else {
+                palette[2][c] = (endpoint0[c] + endpoint1[c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+
+        const std::uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<std::uint32_t>(in[7]) << 24);
+        for (int i = 0; i < 16; i++) {
+            const auto& color = palette[(indices >> (2 * i)) & 3];
+            for (int c = 0; c < 3; c++) {
+                block[i * 4 + c] = static_cast<std::uint8_t>(color[c]);
+            }
+        }
+    }
+
+    auto decodeSingleChannelBlock(const std::uint8_t* in, const int channel, Block& block) -> void {
+        const int value0 = in[0];
+        const int value1 = in[1];
+
+        std::array<int, 8> palette = { value0, value1 };
+        if (value0 > value1) {
+            for (int i = 2; i < 8; i++) {
+                palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+            }
+        } else {
+            for (int i = 2; i < 6; i++) {
+                palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 6; i++) {
+            indices |= static_cast<std::uint64_t>(in[2 + i]) << (8 * i);
+        }
+        for (int i = 0; i < 16; i++) {
+            block[i * 4 + channel] = static_cast<std::uint8_t>(palette[(indices >> (3 * i)) & 7]);
+        }
+    }
+
+    /// Swaps the texel rows of the block upside down. Only the first `rows` rows hold texels.
+    auto flipBlock(std::uint8_t* block, const Format format, const int rows) -> void {
+        // BC1 color block: one byte of indices per row.
+        const auto flipColorBlock = [rows](std::uint8_t* colorBlock) {
+            std::reverse(colorBlock + 4, colorBlock + 4 + rows);
+        };
+        // BC4 block: 12 bits of indices per row.
+        const auto flipSingleChannelBlock = [rows](std::uint8_t* channelBlock) {
+            std::uint64_t indices = 0;
+            for (int i = 0; i < 6; i++) {
+                indices |= static_cast<std::uint64_t>(channelBlock[2 + i]) << (8 * i);
+            }
+            std::uint64_t flipped = indices;
+            for (int row = 0; row < rows; row++) {
+                const std::uint64_t rowBits = (indices >> (12 * row)) & 0xFFF;
+                const int target = rows - 1 - row;
+                flipped &= ~(0xFFFull << (12 * target));
+                flipped |= rowBits << (12 * target);
+            }
+            for (int i = 0; i < 6; i++) {
+                channelBlock[2 + i] = static_cast<std::uint8_t>(flipped >> (8 * i));
+            }
+        };
+
+        switch (format) {
+            case Format::BC1: { flipColorBlock(block); } break;
+            case Format::BC3: { flipSingleChannelBlock(block); flipColorBlock(block + 8); } break;
+            case Format::BC4: { flipSingleChannelBlock(block); } break;
+            case Format::BC5: { flipSingleChannelBlock(block); flipSingleChannelBlock(block + 8); } break;
+            case Format::BC7: { flipBc7Block(block, rows); } break;
+        }
+    }
+
+    /// Halves the image with a 2x2 box filter.
+    auto downsample(const ImageView& image) -> std::vector<std::uint8_t> {
+        const int width = std::max(image.width / 2, 1);
+        const int height = std::max(image.height / 2, 1);
+        const auto texelAt = [&](const int x, const int y) {
+            const std::size_t clampedX = std::min(x, image.width - 1);
+            const std::size_t clampedY = std::min(y, image.height - 1);
+            return image.pixels + (clampedY * image.width + clampedX) * image.channels;
+        };
+
+        std::vector<std::uint8_t> pixels(static_cast<std::size_t>(width) * height * image.channels);
+        std::uint8_t* out = pixels.data();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const std::uint8_t* a = texelAt(2 * x, 2 * y);
+                const std::uint8_t* b = texelAt(2 * x + 1, 2 * y);
+                const std::uint8_t* c = texelAt(2 * x, 2 * y + 1);
+                const std::uint8_t* d = texelAt(2 * x + 1, 2 * y + 1);
+                for (int channel = 0; channel < image.channels; channel++) {
+                    *out++ = static_cast<std::uint8_t>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    /// Encodes one mip level into `out`. Splits the block rows into tasks
+    /// on the thread pool and waits for them.
+    auto encodeLevel(const ImageView& image, const Format format, std::uint8_t* out, const bool parallel) -> void {
+        const int blocksX = std::max((image.width + 3) / 4, 1);
+        const int blocksY = std::max((image.height + 3) / 4, 1);
+        const std::size_t blockSize = getBlockSize(format);
+
+        const auto encodeRows = [&image, format, out, blocksX, blockSize](const int firstRow, const int lastRow) {
+            for (int blockY = firstRow; blockY < lastRow; blockY++) {
+                for (int blockX = 0; blockX < blocksX; blockX++) {
+                    const Block block = fetchBlock(image, format, blockX, blockY);
+                    encodeBlock(block, format, out + (static_cast<std::size_t>(blockY) * blocksX + blockX) * blockSize);
+                }
+            }
+        };
+
+        if (!parallel || blocksY <= blockRowsPerTask) {
+            encodeRows(0, blocksY);
+            return;
+        }
+
+        const int taskCount = (blocksY + blockRowsPerTask - 1) / blockRowsPerTask;
+        std::latch done(taskCount);
+        for (int task = 0; task < taskCount; task++) {
+            const int firstRow = task * blockRowsPerTask;
+            const int lastRow = std::min(firstRow + blockRowsPerTask, blocksY);
+            ThreadPool::getInstance().submit([&encodeRows, &done, firstRow, lastRow] {
+                encodeRows(firstRow, lastRow);
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+
+    // DDS file layout, see "Programming Guide for DDS" (DirectX docs).
+
+    constexpr auto makeFourCC(const char a, const char b, const char c, const char d) -> std::uint32_t {
+        return static_cast<std::uint32_t>(a) | (static_cast<std::uint32_t>(b) << 8)
+             | (static_cast<std::uint32_t>(c) << 16) | (static_cast<std::uint32_t>(d) << 24);
+    }
+
+    constexpr std::uint32_t ddsMagic = makeFourCC('D', 'D', 'S', ' ');
+    constexpr std::uint32_t ddsFlagMipMapCount = 0x20000;
+    constexpr std::uint32_t ddsPixelFormatFlagFourCC = 0x4;
+
+    struct DdsPixelFormat {
+        std::uint32_t size;
+        std::uint32_t flags;
+        std::uint32_t fourCC;
+        std::uint32_t rgbBitCount;
+        std::uint32_t redMask;
+        std::uint32_t greenMask;
+        std::uint32_t blueMask;
+        std::uint32_t alphaMask;
+    };
+
+    struct DdsHeader {
+        std::uint32_t size;
+        std::uint32_t flags;
+        std::uint32_t height;
+        std::uint32_t width;
+        std::uint32_t pitchOrLinearSize;
+        std::uint32_t depth;
+        std::uint32_t mipMapCount;
+        std::array<std::uint32_t, 11> reserved1;
+        DdsPixelFormat pixelFormat;
+        std::uint32_t caps;
+        std::uint32_t caps2;
+        std::uint32_t caps3;
+        std::uint32_t caps4;
+        std::uint32_t reserved2;
+    };
+    static_assert(sizeof(DdsHeader) == 124);
+
+    struct DdsHeaderDx10 {
+        std::uint32_t dxgiFormat;
+        std::uint32_t resourceDimension;
+        std::uint32_t miscFlag;
+        std::uint32_t arraySize;
+        std::uint32_t miscFlags2;
+    };
+
+    auto formatFromFourCC(const std::uint32_t fourCC) -> std::optional<Format> {
+        switch (fourCC) {
+            case makeFourCC('D', 'X', 'T', '1'): return Format::BC1;
+            case makeFourCC('D', 'X', 'T', '5'): return Format::BC3;
+            case makeFourCC('A', 'T', 'I', '1'):
+            case makeFourCC('B', 'C', '4', 'U'): return Format::BC4;
+            case makeFourCC('A', 'T', 'I', '2'):
+            case makeFourCC('B', 'C', '5', 'U'): return Format::BC5;
+            default: return std::nullopt;
+        }
+    }
+
+    auto formatFromDxgi(const std::uint32_t dxgiFormat) -> std::optional<Format> {
+        switch (dxgiFormat) {
+            case 70: case 71: case 72: return Format::BC1; // BC1_TYPELESS, BC1_UNORM, BC1_UNORM_SRGB
+            case 76: case 77: case 78: return Format::BC3;
+            case 79: case 80: return Format::BC4;
+            case 82: case 83: return Format::BC5;
+            case 97: case 98: case 99: return Format::BC7;
+            default: return std::nullopt;
+        }
+    }
+
+    // KTX2 file layout, see the KTX File Format Specification 2.0.
+
+    constexpr std::array<std::uint8_t, 12> ktx2Identifier = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n',
+    };
+
+    struct Ktx2Header {
+        std::array<std::uint8_t, 12> identifier;
+        std::uint32_t vkFormat;
+        std::uint32_t typeSize;
+        std::uint32_t pixelWidth;
+        std::uint32_t pixelHeight;
+        std::uint32_t pixelDepth;
+        std::uint32_t layerCount;
+        std::uint32_t faceCount;
+        std::uint32_t levelCount;
+        std::uint32_t supercompressionScheme;
+        std::uint32_t dfdByteOffset;
+        std::uint32_t dfdByteLength;
+        std::uint32_t kvdByteOffset;
+        std::uint32_t kvdByteLength;
+        std::uint64_t sgdByteOffset;
+        std::uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80);
+
+    struct Ktx2LevelIndex {
+        std::uint64_t byteOffset;
+        std::uint64_t byteLength;
+        std::uint64_t uncompressedByteLength;
+    };
+
+    auto formatFromVulkan(const std::uint32_t vkFormat) -> std::optional<Format> {
+        switch (vkFormat) {
+            case 131: case 132: case 133: case 134: return Format::BC1; // BC1_RGB(A)_UNORM/SRGB_BLOCK
+            case 137: case 138: return Format::BC3;
+            case 139: return Format::BC4;
+            case 141: return Format::BC5;
+            case 145: case 146: return Format::BC7;
+            default: return std::nullopt;
+        }
+    }
+
+    /// Copies the mip levels starting at `offsets` out of the mapped file.
+    auto copyLevels(
+        const MappedFile& file,
+        const std::string& filepath,
+        const Format format,
+        const int width,
+        const int height,
+        const std::span<const std::size_t> offsets
+    ) -> CompressedImage {
+        CompressedImage image { .format = format };
+
+        int levelWidth = width;
+        int levelHeight = height;
+        std::size_t totalSize = 0;
+        for (std::size_t level = 0; level < offsets.size(); level++) {
+            const std::size_t size = getLevelSize(format, levelWidth, levelHeight);
+            image.levels.push_back(MipLevel { levelWidth, levelHeight, totalSize, size });
+            totalSize += size;
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+
+        image.data.resize(totalSize);
+        for (std::size_t level = 0; level < offsets.size(); level++) {
+            const MipLevel& mipLevel = image.levels[level];
+            const std::uint8_t* bytes = file.at<std::uint8_t>(offsets[level], mipLevel.size);
+            if (bytes == nullptr) {
+                throw std::runtime_error(std::format("Compressed texture is truncated at mip level {}: {}", level, filepath));
+            }
+            std::copy_n(bytes, mipLevel.size, image.data.data() + mipLevel.offset);
+        }
+        return image;
+    }
+
+    auto loadDDS(const MappedFile& file, const std::string& filepath) -> CompressedImage {
+        const auto magic = file.at<std::uint32_t>(0);
+        const auto header = file.at<DdsHeader>(sizeof(std::uint32_t));
+        if (magic == nullptr || *magic != ddsMagic || header == nullptr || header->size != sizeof(DdsHeader)) {
+            throw std::runtime_error("Not a DDS file: " + filepath);
+        }
+        if ((header->pixelFormat.flags & ddsPixelFormatFlagFourCC) == 0) {
+            throw std::runtime_error("Uncompressed DDS files are not supported: " + filepath);
+        }
+
+        std::size_t offset = sizeof(std::uint32_t) + sizeof(DdsHeader);
+        std::optional<Format> format;
+        if (header->pixelFormat.fourCC == makeFourCC('D', 'X', '1', '0')) {
+            const auto extendedHeader = file.at<DdsHeaderDx10>(offset);
+            if (extendedHeader == nullptr) {
+                throw std::runtime_error("DDS file is truncated: " + filepath);
+            }
+            offset += sizeof(DdsHeaderDx10);
+            format = formatFromDxgi(extendedHeader->dxgiFormat);
+        } else {
+            format = formatFromFourCC(header->pixelFormat.fourCC);
+        }
+        if (!format.has_value()) {
+            throw std::runtime_error("Unsupported DDS pixel format: " + filepath);
+        }
+
+        const std::uint32_t levelCount = (header->flags & ddsFlagMipMapCount) && header->mipMapCount > 0
+            ? header->mipMapCount : 1;
+        const auto width = static_cast<int>(header->width);
+        const auto height = static_cast<int>(header->height);
+
+        // The levels follow each other from the largest one.
+        std::vector<std::size_t> offsets;
+        int levelWidth = width;
+        int levelHeight = height;
+        for (std::uint32_t level = 0; level < levelCount; level++) {
+            offsets.push_back(offset);
+            offset += getLevelSize(*format, levelWidth, levelHeight);
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+
+        return copyLevels(file, filepath, *format, width, height, offsets);
+    }
+
+    auto loadKTX2(const MappedFile& file, const std::string& filepath) -> CompressedImage {
+        const auto header = file.at<Ktx2Header>(0);
+        if (header == nullptr || header->identifier != ktx2Identifier) {
+            throw std::runtime_error("Not a KTX2 file: " + filepath);
+        }
+        if (header->supercompressionScheme != 0) {
+            throw std::runtime_error("Supercompressed KTX2 files (Basis, Zstandard) are not supported: " + filepath);
+        }
+        if (header->pixelDepth > 1 || header->layerCount > 1 || header->faceCount > 1) {
+            throw std::runtime_error("Only 2D KTX2 textures are supported: " + filepath);
+        }
+
+        const auto format = formatFromVulkan(header->vkFormat);
+        if (!format.has_value()) {
+            throw std::runtime_error(std::format("Unsupported KTX2 format {}: {}", header->vkFormat, filepath));
+        }
+
+        // Level count of zero asks the loader to generate the mip maps, only the base level is stored.
+        const std::uint32_t levelCount = std::max(header->levelCount, 1u);
+        const auto levelIndex = file.at<Ktx2LevelIndex>(sizeof(Ktx2Header), levelCount);
+        if (levelIndex == nullptr) {
+            throw std::runtime_error("KTX2 file is truncated: " + filepath);
+        }
+
+        std::vector<std::size_t> offsets;
+        for (std::uint32_t level = 0; level < levelCount; level++) {
+            offsets.push_back(levelIndex[level].byteOffset);
+        }
+
+        return copyLevels(file, filepath, *format,
+            static_cast<int>(header->pixelWidth), static_cast<int>(header->pixelHeight), offsets);
+    }
+}
+
+export namespace texture::compression {
+    /// Returns true for files that hold pre-compressed texture data (.dds, .ktx2).
+    auto isCompressedFile(const std::string& filepath) -> bool {
+        const std::string extension = std::filesystem::path(filepath).extension().string();
+        return extension == ".dds" || extension == ".ktx2";
+    }
+
+    /// Whether `flipVertically` can flip the image. Every format but BC7 can, a BC7 image
+    /// only if all of its blocks use the single subset modes (4, 5, 6), like the ones `encode` makes.
+    auto canFlipVertically(const CompressedImage& image) -> bool {
+        if (image.format != Format::BC7) {
+            return true;
+        }
+        for (std::size_t block = 0; block < image.data.size(); block += getBlockSize(image.format)) {
+            const int mode = detail::getBc7Mode(image.data.data() + block);
+            if (mode != 8 && !detail::isBc7SingleSubsetMode(mode)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Turns the image upside down (blocks and the texel rows inside them), like STB does
+    /// when decoding, because DDS and KTX2 store the top row first. The flip is lossless,
+    /// throws if the image can't be flipped (see `canFlipVertically`).
+    auto flipVertically(CompressedImage& image) -> void {
+        if (!canFlipVertically(image)) {
+            throw std::runtime_error("BC7 texture with partitioned blocks can't be flipped.");
+        }
+
+        const std::size_t blockSize = getBlockSize(image.format);
+        for (const MipLevel& level : image.levels) {
+            if (level.height > 4 && level.height % 4 != 0) {
+                std::cerr << "Texture height " << level.height << " isn't a multiple of 4, the flipped mip level is off by "
+                          << 4 - level.height % 4 << " rows.\n";
+            }
+
+            const std::size_t blocksX = std::max((level.width + 3) / 4, 1);
+            const std::size_t blocksY = std::max((level.height + 3) / 4, 1);
+            const int rows = std::min(level.height, 4);
+            const std::size_t rowSize = blocksX * blockSize;
+            std::uint8_t* data = image.data.data() + level.offset;
+
+            for (std::size_t blockY = 0; blockY < blocksY / 2; blockY++) {
+                std::swap_ranges(data + blockY * rowSize, data + (blockY + 1) * rowSize,
+                                 data + (blocksY - 1 - blockY) * rowSize);
+            }
+            for (std::size_t block = 0; block < blocksX * blocksY; block++) {
+                detail::flipBlock(data + block * blockSize, image.format, rows);
+            }
+        }
+    }
+
+    /// Loads a pre-compressed DDS or KTX2 texture with all its mip levels.
+    /// Safe to call from any thread, it doesn't touch OpenGL.
+    auto loadFile(const std::string& filepath, const bool flip = true) -> CompressedImage {
+        const MappedFile file(filepath);
+        if (!file.isOpen()) {
+            throw std::runtime_error("Failed to open compressed texture: " + filepath);
+        }
+
+        CompressedImage image = std::filesystem::path(filepath).extension() == ".ktx2"
+            ? detail::loadKTX2(file, filepath)
+            : detail::loadDDS(file, filepath);
+
+        if (flip) {
+            // Loading it upside down would show up as wrong texturing, not as an error.
+            if (!canFlipVertically(image)) {
+                throw std::runtime_error(std::format(
+                    "BC7 texture uses partitioned blocks (modes 0-3, 7), which can't be flipped. "
+                    "Encode it with the single subset modes (4-6) or store it bottom row first: {}", filepath));
+            }
+            flipVertically(image);
+        }
+        return image;
+    }
+
+    /// Compresses the image on the CPU, with the whole mip chain when `generateMipmaps` is set.
+    /// The blocks of each level are encoded on the thread pool, unless `parallel` is false.
+    /// NOTE: Must not be called with `parallel` from a thread pool task, it waits on the pool.
+    auto encode(
+        const ImageView& source,
+        const Format format,
+        const bool generateMipmaps = true,
+        const bool parallel = true
+    ) -> CompressedImage {
+        if (source.pixels == nullptr || source.width <= 0 || source.height <= 0
+        || source.channels < 1 || source.channels > 4) {
+            throw std::runtime_error("Cannot compress an empty image.");
+        }
+
+        CompressedImage compressed { .format = format };
+
+        int width = source.width;
+        int height = source.height;
+        std::size_t totalSize = 0;
+        while (true) {
+            const std::size_t size = getLevelSize(format, width, height);
+            compressed.levels.push_back(MipLevel { width, height, totalSize, size });
+            totalSize += size;
+            if (!generateMipmaps || (width == 1 && height == 1)) {
+                break;
+            }
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        compressed.data.resize(totalSize);
+
+        ImageView level = source;
+        std::vector<std::uint8_t> levelPixels;
+        for (std::size_t i = 0; i < compressed.levels.size(); i++) {
+            if (i > 0) {
+                levelPixels = detail::downsample(level);
+                level = ImageView {
+                    levelPixels.data(), compressed.levels[i].width, compressed.levels[i].height, source.channels,
+                };
+            }
+            detail::encodeLevel(level, format, compressed.data.data() + compressed.levels[i].offset, parallel);
+        }
+
+        return compressed;
+    }
+
+    /// Decodes one mip level back to 8-bit pixels with `getChannelCount(format)` channels.
+    /// BC7 only with the single subset modes, throws for the rest.
+    auto decode(const CompressedImage& image, const std::size_t level = 0) -> std::vector<std::uint8_t> {
+        using namespace detail;
+
+        const MipLevel& mipLevel = image.levels.at(level);
+        const int channels = getChannelCount(image.format);
+        const int blocksX = std::max((mipLevel.width + 3) / 4, 1);
+        const int blocksY = std::max((mipLevel.height + 3) / 4, 1);
+        const std::size_t blockSize = getBlockSize(image.format);
+        const std::uint8_t* in = image.data.data() + mipLevel.offset;
+
+        std::vector<std::uint8_t> pixels(static_cast<std::size_t>(mipLevel.width) * mipLevel.height * channels);
+        for (int blockY = 0; blockY < blocksY; blockY++) {
+            for (int blockX = 0; blockX < blocksX; blockX++) {
+                const std::uint8_t* blockData = in + (static_cast<std::size_t>(blockY) * blocksX + blockX) * blockSize;
+                Block block{};
+                switch (image.format) {
+                    case Format::BC1: { decodeColorBlock(blockData, block); } break;
+                    case Format::BC3: { decodeSingleChannelBlock(blockData, 3, block); decodeColorBlock(blockData + 8, block); } break;
+                    case Format::BC4: { decodeSingleChannelBlock(blockData, 0, block); } break;
+                    case Format::BC5: { decodeSingleChannelBlock(blockData, 0, block); decodeSingleChannelBlock(blockData + 8, 1, block); } break;
+                    case Format::BC7: { decodeBc7Block(blockData, block); } break;
+                }
+
+                for (int y = 0; y < 4 && blockY * 4 + y < mipLevel.height; y++) {
+                    for (int x = 0; x < 4 && blockX * 4 + x < mipLevel.width; x++) {
+                        const std::size_t pixel = static_cast<std::size_t>(blockY * 4 + y) * mipLevel.width + blockX * 4 + x;
+                        std::copy_n(block.begin() + (y * 4 + x) * 4, channels, pixels.begin() + pixel * channels);
+                    }
+                }
+            }
+        }
+        return pixels;
+    }
+
+    /// Result of compressing an image once on the CPU and decoding it back.
+    struct Evaluation {
+        Format format;
+        double psnr; // In dB over the channels the format stores. Infinite for a lossless result.
+        double encodeMilliseconds;
+        double megapixelsPerSecond;
+    };
+
+    /// Encodes the base level of `source`, decodes it back and measures the error and the
+    /// encoder's throughput. Needs no OpenGL context, so the encoder can be checked without a GPU.
+    auto evaluate(const ImageView& source, const Format format) -> Evaluation {
+        using Clock = std::chrono::steady_clock;
+
+        const auto start = Clock::now();
+        const CompressedImage compressed = encode(source, format, false);
+        const std::chrono::duration<double, std::milli> encodeTime = Clock::now() - start;
+
+        const std::vector<std::uint8_t> decoded = decode(compressed);
+        const int channels = getChannelCount(format);
+
+        double squaredErrorSum = 0.0;
+        for (int y = 0; y < source.height; y++) {
+            for (int x = 0; x < source.width; x++) {
+                const auto expected = detail::fetchTexel(source, format, x, y);
+                const std::size_t pixel = static_cast<std::size_t>(y) * source.width + x;
+                for (int c = 0; c < channels; c++) {
+                    const double difference = static_cast<double>(expected[c]) - decoded[pixel * channels + c];
+                    squaredErrorSum += difference * difference;
+                }
+            }
+        }
+
+        const double meanSquaredError = squaredErrorSum / (static_cast<double>(source.width) * source.height * channels);
+        const double megapixels = static_cast<double>(source.width) * source.height / 1'000'000.0;
+
+        return Evaluation {
+            .format = format,
+            .psnr = meanSquaredError == 0.0
+                ? std::numeric_limits<double>::infinity()
+                : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError),
+            .encodeMilliseconds = encodeTime.count(),
+            .megapixelsPerSecond = megapixels / (encodeTime.count() / 1000.0),
+        };
+    }
+}
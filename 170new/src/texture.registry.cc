@@ -0,0 +1,212 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+
+export module texture.registry;
+
+import texture;
+
+using namespace texture;
+
+export namespace texture::registry::defaults {
+    /// How much GPU memory the textures may take up before the unused ones get evicted.
+    constexpr std::size_t budgetInBytes = 512ull * 1024 * 1024;
+}
+
+/// Process-wide cache of the loaded textures.
+///
+/// Textures are keyed by their canonical file path and their settings (type, data format),
+/// so the same file is decoded and uploaded only once no matter how many models or meshes use it.
+/// Every `acquire` must be paired with a `release`. A texture nobody references stays
+/// resident (a later `acquire` gets it for free) until the textures go over the GPU memory budget.
+/// Then the least recently used unreferenced textures are deleted first.
+///
+/// Thread-safe. Loading and evicting need a current OpenGL context, the main one or a shared one.
+export class TextureRegistry {
+private:
+    struct Entry {
+        Texture texture;
+        std::size_t residentBytes = 0;
+        std::uint32_t referenceCount = 0;
+        // Position in the list of unreferenced textures, valid only when the reference count is zero.
+        std::list<std::string>::iterator unreferencedPosition;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    // Maps the OpenGL texture ID back to its key so textures can be released by value.
+    std::unordered_map<GLuint, std::string> keysByTextureID;
+    // Unreferenced textures, the least recently used one is at the front.
+    std::list<std::string> unreferencedKeys;
+    std::size_t residentBytes = 0;
+    std::size_t budgetInBytes = texture::registry::defaults::budgetInBytes;
+
+    TextureRegistry() = default;
+public:
+    TextureRegistry(const TextureRegistry& other) = delete;
+    TextureRegistry& operator=(const TextureRegistry& other) = delete;
+
+    /// Returns the singleton instance of this class. Created by the first call,
+    /// from whichever thread that is (the initialization of a local static is thread-safe).
+    static auto getInstance() -> TextureRegistry& {
+        static TextureRegistry instance;
+        return instance;
+    }
+
+    /// Sets the GPU memory budget and evicts unreferenced textures above it.
+    auto setBudget(const std::size_t bytes) -> void {
+        std::lock_guard lock(mutex);
+        budgetInBytes = bytes;
+        evictOverBudget();
+    }
+
+    /// Returns the texture loaded from `filepath` with the given settings
+    /// and takes a reference to it. Decodes and uploads it only if it isn't resident.
+    auto acquire(
+        const std::string& filepath,
+        const Type type,
+        const DataFormat format = DataFormat::NotSpecified
+    ) -> Texture {
+        if (auto texture = tryAcquire(filepath, type, format)) {
+            return *texture;
+        }
+        // Decoded and uploaded without holding the lock.
+        return add(Texture(filepath, type, format), filepath, type, format);
+    }
+
+    /// Same as `acquire` but the image is already decoded or cooked (e.g. on a worker thread).
+    template<typename DecodedImage>
+        requires std::constructible_from<Texture, const std::string&, const DecodedImage&, Type, DataFormat>
+    auto acquire(
+        const std::string& filepath,
+        const DecodedImage& image,
+        const Type type,
+        const DataFormat format = DataFormat::NotSpecified
+    ) -> Texture {
+        if (auto texture = tryAcquire(filepath, type, format)) {
+            return *texture;
+        }
+        return add(Texture(filepath, image, type, format), filepath, type, format);
+    }
+
+    /// Takes a reference to the texture only if it is already resident.
+    auto tryAcquire(
+        const std::string& filepath,
+        const Type type,
+        const DataFormat format = DataFormat::NotSpecified
+    ) -> std::optional<Texture> {
+        const std::string key = makeKey(filepath, type, format);
+
+        std::lock_guard lock(mutex);
+        const auto it = entries.find(key);
+        if (it == entries.end()) {
+            return std::nullopt;
+        }
+        reference(it->second);
+        return it->second.texture;
+    }
+
+    /// Drops a reference taken by `acquire`. The texture stays resident
+    /// until it has to be evicted to get under the budget.
+    auto release(const Texture& texture) -> void {
+        std::lock_guard lock(mutex);
+
+        const auto keyIt = keysByTextureID.find(texture.getID());
+        if (keyIt == keysByTextureID.end()) {
+            std::cerr << "Releasing texture that is not in the registry: " << texture.getFilePath() << "\n";
+            return;
+        }
+
+        Entry& entry = entries.at(keyIt->second);
+        assert(entry.referenceCount > 0 && "Texture released more times than acquired.");
+        if (--entry.referenceCount == 0) {
+            // Most recently used goes to the back.
+            entry.unreferencedPosition = unreferencedKeys.insert(unreferencedKeys.end(), keyIt->second);
+            evictOverBudget();
+        }
+    }
+
+    [[nodiscard]] auto getResidentBytes() -> std::size_t {
+        std::lock_guard lock(mutex);
+        return residentBytes;
+    }
+
+    /// Prints every resident texture with its size in GPU memory and reference count.
+    auto printReport() -> void {
+        std::lock_guard lock(mutex);
+        std::println("Texture registry: {} textures, {:.2f} MiB resident of {:.2f} MiB budget",
+            entries.size(), toMebibytes(residentBytes), toMebibytes(budgetInBytes));
+        for (const auto& [key, entry] : entries) {
+            std::println("    {:>9.2f} MiB  refs: {:>3}  {}",
+                toMebibytes(entry.residentBytes), entry.referenceCount, entry.texture.getFilePath());
+        }
+    }
+
+private:
+    /// Canonical path so that "./a/../b.png" and "b.png" are the same texture.
+    static auto makeKey(const std::string& filepath, const Type type, const DataFormat format) -> std::string {
+        std::error_code error;
+        auto canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+        return std::format("{}|{}|{}",
+            error ? filepath : canonicalPath.string(), TypeToString(type), DataFormatToString(format));
+    }
+
+    static auto toMebibytes(const std::size_t bytes) -> double {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    /// Inserts the freshly created texture with one reference.
+    /// If another thread was faster, its texture wins and this one is deleted.
+    auto add(Texture texture, const std::string& filepath, const Type type, const DataFormat format) -> Texture {
+        const std::string key = makeKey(filepath, type, format);
+
+        std::lock_guard lock(mutex);
+        if (const auto it = entries.find(key); it != entries.end()) {
+            texture.deleteResource();
+            reference(it->second);
+            return it->second.texture;
+        }
+
+        Entry& entry = entries[key];
+        entry.texture = texture;
+        entry.residentBytes = texture.getResidentBytes();
+        entry.referenceCount = 1;
+        keysByTextureID[texture.getID()] = key;
+        residentBytes += entry.residentBytes;
+
+        evictOverBudget();
+        return texture;
+    }
+
+    /// Takes a reference. Must be called with the lock held.
+    auto reference(Entry& entry) -> void {
+        if (entry.referenceCount++ == 0) {
+            unreferencedKeys.erase(entry.unreferencedPosition);
+        }
+    }
+
+    /// Deletes the least recently used unreferenced textures until
+    /// the resident size fits into the budget. Must be called with the lock held.
+    auto evictOverBudget() -> void {
+        while (residentBytes > budgetInBytes && !unreferencedKeys.empty()) {
+            const std::string key = unreferencedKeys.front();
+            unreferencedKeys.pop_front();
+
+            Entry& entry = entries.at(key);
+            std::println("Evicting texture ({:.2f} MiB): {}", toMebibytes(entry.residentBytes), entry.texture.getFilePath());
+            residentBytes -= entry.residentBytes;
+            keysByTextureID.erase(entry.texture.getID());
+            entry.texture.deleteResource();
+            entries.erase(key);
+        }
+
+        if (residentBytes > budgetInBytes) {
+            std::cerr << "Referenced textures alone are over the texture budget ("
+                      << toMebibytes(residentBytes) << " MiB).\n";
+        }
+    }
+};
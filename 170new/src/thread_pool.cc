@@ -0,0 +1,141 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module thread_pool;
+
+/// Blocking queue with many producers and one consumer.
+/// Worker threads push their results into it and the GL thread drains it.
+export template<typename T>
+class CompletionQueue {
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<T> items;
+public:
+    /// Adds the item and wakes up the consumer.
+    auto push(T item) -> void {
+        {
+            std::lock_guard lock(mutex);
+            items.push_back(std::move(item));
+        }
+        condition.notify_one();
+    }
+
+    /// Takes out the oldest item. Blocks until there is one.
+    auto pop() -> T {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this] { return !items.empty(); });
+        T item = std::move(items.front());
+        items.pop_front();
+        return item;
+    }
+
+    /// Takes out the oldest item if there is one. Never blocks.
+    auto tryPop() -> std::optional<T> {
+        std::lock_guard lock(mutex);
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items.front());
+        items.pop_front();
+        return item;
+    }
+};
+
+/// Singleton pool of worker threads for CPU work that doesn't touch OpenGL
+/// (decoding images, parsing files, ...). Tasks are run in the order they were submitted.
+/// NOTE: Tasks must never call OpenGL functions, the context is current only on the main thread.
+export class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool isStopping = false;
+
+    static ThreadPool* singletonInstance;
+    // The instance is created by the first `getInstance`, which the loader, upload and worker threads all call.
+    static std::mutex singletonMutex;
+
+    explicit ThreadPool(const std::size_t workerCount) {
+        workers.reserve(workerCount);
+        for (std::size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+public:
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    /// Finishes the already submitted tasks and joins the workers.
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            isStopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /// Returns the singleton instance of this class.
+    /// One core is left for the main (GL) thread.
+    static auto getInstance() -> ThreadPool& {
+        std::lock_guard lock(singletonMutex);
+        if (singletonInstance == nullptr) {
+            const std::size_t coreCount = std::max(std::thread::hardware_concurrency(), 2u);
+            singletonInstance = new ThreadPool(coreCount - 1);
+        }
+        return *singletonInstance;
+    }
+
+    /// For the proper-proper singleton instance deletion.
+    static auto deleteInstance() -> bool {
+        std::lock_guard lock(singletonMutex);
+        if (singletonInstance == nullptr) {
+            return false;
+        }
+        delete singletonInstance;
+        singletonInstance = nullptr;
+        return true;
+    }
+
+    [[nodiscard]] auto getWorkerCount() const -> std::size_t {
+        return workers.size();
+    }
+
+    /// Queues the task to be run on one of the workers.
+    auto submit(std::function<void()> task) -> void {
+        {
+            std::lock_guard lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+private:
+    auto workerLoop() -> void {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this] { return isStopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+// Initialization of the singleton instance to null pointer.
+ThreadPool* ThreadPool::singletonInstance = nullptr;
+std::mutex ThreadPool::singletonMutex;
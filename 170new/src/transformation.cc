@@ -58,11 +58,10 @@ public:
 
     auto sendModelMatToShader(
         ShaderProgram& shader, 
-        const std::string& uniformModelMatName
+        const UniformName uniformModelMatName
     ) const -> void {
         shader.bind();
         shader.setUniformMat4f(uniformModelMatName, getModelMat());
-        ShaderProgram::unbind();
     }
 };
 
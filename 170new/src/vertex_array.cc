@@ -7,8 +7,10 @@ module;
 
 export module vertex_array;
 
+import gl_state;
 import vertex_buffer;
 import index_buffer;
+import dynamic_buffer;
 
 export class VertexArray {
 private:
@@ -37,6 +39,7 @@ public:
 
     /// Delete the VAO but not its references to the VBO or IBO.
     auto deleteResource() -> void {
+        GLState::getInstance().forgetVertexArray(vertexArrayID);
         glDeleteVertexArrays(1, &vertexArrayID);
         vertexArrayID = 0;
     }
@@ -71,14 +74,24 @@ public:
         VertexBuffer::unbind();
     }
 
-    /// Binds the VAO.
+    /// Links a buffer of per instance attributes (e.g. the instances' model matrices) laid out by `layout`.
+    /// Its attributes start at `firstLocation`, after the vertex attributes, and advance once per instance.
+    auto linkInstanceBuffer(const DynamicBuffer &buffer, const VertexBufferLayout &layout, const GLuint firstLocation) const -> void {
+        bind();
+        buffer.bind();
+        layout.configure(firstLocation, 1);
+        unbind();
+        VertexBuffer::unbind();
+    }
+
+    /// Binds the VAO, skipped if it already is.
     auto bind() const -> void {
-        glBindVertexArray(vertexArrayID);
+        GLState::getInstance().bindVertexArray(vertexArrayID);
     }
 
     /// Unbinds the VAO.
     static auto unbind() -> void {
-        glBindVertexArray(0);
+        GLState::getInstance().bindVertexArray(0);
     }
 
 
@@ -21,10 +21,20 @@ export struct VertexBufferAttribute {
     explicit VertexBufferAttribute(const GLuint dataTypeMacroCode, const GLuint count, const GLuint normalized, std::string name = "")
     : dataTypeMacroCode(dataTypeMacroCode), count(count), normalized(normalized), name(std::move(name)) {
         if (getSizeOfGLTypeFromMacroCode(dataTypeMacroCode) == -1) {
-            throw std::runtime_error("Vertex buffer attribute '" + name
+            throw std::runtime_error("Vertex buffer attribute '" + this->name
                 + "' creation failed because of unsupported data type macro code '"
                 + std::to_string(dataTypeMacroCode) + "'.");
         }
+        // OpenGL only accepts the 2_10_10_10 types with four components.
+        if (isPackedGLTypeMacroCode(dataTypeMacroCode) && count != 4) {
+            throw std::runtime_error("Vertex buffer attribute '" + this->name
+                + "' creation failed because packed data types must have exactly 4 components.");
+        }
+    }
+
+    /// How many bytes this attribute takes up in a vertex.
+    [[nodiscard]] auto getSizeInBytes() const -> GLint {
+        return getAttributeSizeInBytes(dataTypeMacroCode, count);
     }
 };
 
@@ -65,44 +75,64 @@ public:
         //
         // layout (location = 3) in mat4 vertexIn_ModelMat4;
         // 
-        // is taking up:
+        // is taking up (GLM and GLSL matrices are column major):
         //
-        // layout (location = 3) in vec4 vertexIn_ModelMat4_row1;
-        // layout (location = 4) in vec4 vertexIn_ModelMat4_row2;
-        // layout (location = 5) in vec4 vertexIn_ModelMat4_row3;
-        // layout (location = 6) in vec4 vertexIn_ModelMat4_row4;
+        // layout (location = 3) in vec4 vertexIn_ModelMat4_column0;
+        // layout (location = 4) in vec4 vertexIn_ModelMat4_column1;
+        // layout (location = 5) in vec4 vertexIn_ModelMat4_column2;
+        // layout (location = 6) in vec4 vertexIn_ModelMat4_column3;
         //
         // So we mustn't use the locations 4, 5 and 6 and can 
         // start using at 7th location.
         if (dataTypeMacroCode == GL_FLOAT_MAT4) {
-            assert(count == 1 && "Don't know how to handle more than one matrices.");
-            const GLuint floatMacroCode = getGLTypeMacroCode<float>();
-            for (int i = 0; i < 4; i++) {
-                std::string fullAttributeName = attributeName + "_row_" + std::to_string(i);
-                const auto attribute = VertexBufferAttribute(getGLTypeMacroCode<float>(), 4, GL_FALSE, fullAttributeName);
-                attributes.push_back(attribute);
+            for (std::uint32_t matrix = 0; matrix < count; matrix++) {
+                for (int column = 0; column < 4; column++) {
+                    std::string fullAttributeName = attributeName + "_column" + std::to_string(matrix * 4 + column);
+                    const auto attribute = VertexBufferAttribute(getGLTypeMacroCode<float>(), 4, GL_FALSE, fullAttributeName);
+                    attributes.push_back(attribute);
+                    stride += attribute.getSizeInBytes();
+                }
             }
+            return *this;
         }
 
-
         const auto attribute = VertexBufferAttribute(dataTypeMacroCode, count, GL_FALSE, attributeName);
         attributes.push_back(attribute);
-        stride += sizeof(DataType) * count;
+        stride += attribute.getSizeInBytes();
+        return *this;
+    }
+
+    /// Adds new attribute of integer type whose values the shader gets normalized into floats,
+    /// [-1, 1] for signed types and [0, 1] for unsigned ones (e.g. `GLshort` or `PackedInt2101010`).
+    /// Lets the vertex data be quantized while the shader still reads `vec`s.
+    template<typename DataType> auto pushNormalizedAttribute(
+        const std::uint32_t count,
+        const std::string& attributeName = ""
+    ) -> VertexBufferLayout&
+    requires IsSupportedByVertexBuffer<DataType> && (!std::is_same_v<DataType, GLfloat>) && (!std::is_same_v<DataType, HalfFloat>)
+    {
+        const auto attribute = VertexBufferAttribute(getGLTypeMacroCode<DataType>(), count, GL_TRUE, attributeName);
+        attributes.push_back(attribute);
+        stride += attribute.getSizeInBytes();
         return *this;
     }
 
-    /// Configures every attribute in the layout.
+    /// Configures every attribute in the layout, the first one at `firstLocation`
+    /// and the rest at the following locations. A non-zero `divisor` makes them per instance
+    /// attributes, they advance once every `divisor` instances instead of every vertex.
     /// Make sure to call binds of VAO and VBO properly before calling this function.
-    auto configure() const -> void {
+    auto configure(const GLuint firstLocation = 0, const GLuint divisor = 0) const -> void {
         // Prepare the offset accumulator.
         std::uint32_t offset = 0;
-        for (int index = 0; index < attributes.size(); ++index) {
+        for (GLuint index = 0; index < attributes.size(); ++index) {
             const auto& attribute = attributes[index];
-            // Enable configuring of the attribute variable at the index-th location.
-            glEnableVertexAttribArray(index);
-            // Configure the attribute variable at the index-th location.
+            const GLuint location = firstLocation + index;
+            // Enable configuring of the attribute variable at the location.
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, divisor);
+            // Configure the attribute variable at the location.
             glVertexAttribPointer(
-                index,
+                location,
                 static_cast<GLsizei>(attribute.count),
                 attribute.dataTypeMacroCode,
                 attribute.normalized,
@@ -110,7 +140,7 @@ public:
                 reinterpret_cast<const void *>(offset)
             );
             // Move the offset by the size of the attribute in bytes.
-            offset += attribute.count * getSizeOfGLTypeFromMacroCode(attribute.dataTypeMacroCode);
+            offset += attribute.getSizeInBytes();
         }
 
         assert(offset == stride);
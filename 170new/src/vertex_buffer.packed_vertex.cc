@@ -0,0 +1,487 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+export module vertex_buffer.packed_vertex;
+
+import aabb;
+import vertex_buffer.supported_types;
+import vertex_buffer.layout;
+import vertex_buffer.vertex_struct;
+
+/// Compact, quantized version of `Vertex` (20 bytes instead of 56).
+/// Decoded by the vertex shader (see shaders/std/vertex_packing.glsl).
+///
+///   position      3 x snorm16 relative to the mesh's bounds (`AABB`), w is the bitangent's handedness
+///   normal        2 x snorm16 octahedral encoding
+///   tangentFrame  quaternion rotating (1, 0, 0) onto the tangent, smallest three in 10 bits each,
+///                 the 2 bits index the dropped (largest) component
+///   texUV         2 x half float
+export struct PackedVertex {
+    std::array<GLshort, 4> position;
+    std::array<GLshort, 2> normal;
+    PackedUnsignedInt2101010 tangentFrame;
+    std::array<HalfFloat, 2> texUV;
+
+    [[nodiscard]] static auto getLayout() -> VertexBufferLayout {
+        return VertexBufferLayout()
+            .pushNormalizedAttribute<GLshort>(4, "Position")
+            .pushNormalizedAttribute<GLshort>(2, "OctahedralNormal")
+            .pushNormalizedAttribute<PackedUnsignedInt2101010>(4, "TangentFrame")
+            .pushAttribute<HalfFloat>(2, "TexUV");
+    }
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed.");
+
+namespace vertex::packing::detail {
+    constexpr float snorm16Max = 32767.0f;
+    constexpr float unorm10Max = 1023.0f;
+    // The three smallest components of a unit quaternion are within [-1/sqrt(2), 1/sqrt(2)].
+    constexpr float smallestThreeRange = 0.70710678f;
+
+    /// Rounds to nearest even like the SSE conversion does.
+    auto encodeSnorm16(const float value) -> GLshort {
+        return static_cast<GLshort>(std::nearbyint(std::clamp(value, -1.0f, 1.0f) * snorm16Max));
+    }
+
+    /// OpenGL 4.2+ conversion of normalized signed integers (older versions are off by half a step).
+    auto decodeSnorm16(const GLshort value) -> float {
+        return std::max(static_cast<float>(value) / snorm16Max, -1.0f);
+    }
+
+    /// +1 or -1 by the sign bit, so -0 folds to the same side as in the SSE version.
+    auto signNotZero(const float value) -> float {
+        return std::copysign(1.0f, value);
+    }
+
+    /// Scale that maps a position relative to the bounds' center into [-1, 1].
+    /// Flat axes (zero extent) quantize to 0.
+    auto getPositionScale(const AABB& bounds) -> glm::vec3 {
+        const glm::vec3 extent = bounds.getExtent();
+        return glm::vec3(
+            extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+            extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+            extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+    }
+
+    /// Round to nearest even, overflows to infinity, keeps subnormals.
+    auto floatToHalf(const float value) -> std::uint16_t {
+        const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+        const std::uint32_t sign = (bits >> 16) & 0x8000u;
+        const std::uint32_t absolute = bits & 0x7FFFFFFFu;
+
+        if (absolute >= 0x7F800000u) { // Infinity or NaN.
+            return static_cast<std::uint16_t>(sign | 0x7C00u | (absolute > 0x7F800000u ? 0x200u : 0u));
+        }
+        if (absolute >= 0x477FF000u) { // Rounds to more than 65504.
+            return static_cast<std::uint16_t>(sign | 0x7C00u);
+        }
+        if (absolute < 0x38800000u) { // Below 2^-14, becomes a subnormal half (multiple of 2^-24).
+            const float scaled = std::bit_cast<float>(absolute) * 16777216.0f;
+            return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(std::nearbyint(scaled)));
+        }
+
+        // Rebias the exponent from 127 to 15 and round the mantissa from 23 to 10 bits.
+        std::uint32_t half = (absolute - 0x38000000u) >> 13;
+        const std::uint32_t remainder = absolute & 0x1FFFu;
+        if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u) != 0)) {
+            half++;
+        }
+        return static_cast<std::uint16_t>(sign | half);
+    }
+
+    auto halfToFloat(const std::uint16_t half) -> float {
+        const std::uint32_t sign = (static_cast<std::uint32_t>(half) & 0x8000u) << 16;
+        const std::uint32_t exponent = (half >> 10) & 0x1Fu;
+        const std::uint32_t mantissa = half & 0x3FFu;
+
+        if (exponent == 0) {
+            const float value = std::ldexp(static_cast<float>(mantissa), -24);
+            return sign != 0 ? -value : value;
+        }
+        if (exponent == 31) {
+            return std::bit_cast<float>(sign | 0x7F800000u | (mantissa << 13));
+        }
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+    auto encodeOctahedral(const glm::vec3& normal) -> std::array<GLshort, 2> {
+        const float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (l1 == 0.0f) {
+            return { 0, 0 }; // Decodes to (0, 0, 1).
+        }
+        const float inverseL1 = 1.0f / l1;
+        float x = normal.x * inverseL1;
+        float y = normal.y * inverseL1;
+        if (normal.z < 0.0f) {
+            const float foldedX = (1.0f - std::abs(y)) * signNotZero(x);
+            const float foldedY = (1.0f - std::abs(x)) * signNotZero(y);
+            x = foldedX;
+            y = foldedY;
+        }
+        return { encodeSnorm16(x), encodeSnorm16(y) };
+    }
+
+    auto decodeOctahedral(const std::array<GLshort, 2>& encoded) -> glm::vec3 {
+        const float x = decodeSnorm16(encoded[0]);
+        const float y = decodeSnorm16(encoded[1]);
+        glm::vec3 normal(x, y, 1.0f - std::abs(x) - std::abs(y));
+        if (normal.z < 0.0f) {
+            normal.x = (1.0f - std::abs(y)) * signNotZero(x);
+            normal.y = (1.0f - std::abs(x)) * signNotZero(y);
+        }
+        return glm::normalize(normal);
+    }
+
+    /// Any unit vector perpendicular to `normal`.
+    auto getPerpendicular(const glm::vec3& normal) -> glm::vec3 {
+        const glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::normalize(glm::cross(normal, axis));
+    }
+
+    /// Orthonormal tangent frame of the vertex (tangent, normal x tangent, normal)
+    /// and the sign the bitangent needs to get flipped by (mirrored UVs).
+    struct TangentFrame {
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+        glm::vec3 normal;
+        float handedness;
+    };
+
+    auto buildTangentFrame(const Vertex& vertex) -> TangentFrame {
+        const float normalLength = glm::length(vertex.normal);
+        const glm::vec3 normal = normalLength > 0.0f ? vertex.normal / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+        // Gram-Schmidt, the imported tangents aren't exactly perpendicular to the normal.
+        glm::vec3 tangent = vertex.tangent - normal * glm::dot(normal, vertex.tangent);
+        const float tangentLength = glm::length(tangent);
+        tangent = tangentLength > 1e-6f ? tangent / tangentLength : getPerpendicular(normal);
+
+        const glm::vec3 bitangent = glm::cross(normal, tangent);
+        const float handedness = glm::dot(bitangent, vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+        return TangentFrame { tangent, bitangent, normal, handedness };
+    }
+
+    /// Quaternion (x, y, z, w) of the rotation whose matrix columns are the frame's axes.
+    auto frameToQuaternion(const TangentFrame& frame) -> std::array<float, 4> {
+        const glm::vec3& c0 = frame.tangent;
+        const glm::vec3& c1 = frame.bitangent;
+        const glm::vec3& c2 = frame.normal;
+        const float trace = c0.x + c1.y + c2.z;
+
+        std::array<float, 4> q{};
+        if (trace > 0.0f) {
+            const float s = std::sqrt(trace + 1.0f) * 2.0f;
+            q = { (c1.z - c2.y) / s, (c2.x - c0.z) / s, (c0.y - c1.x) / s, 0.25f * s };
+        } else if (c0.x > c1.y && c0.x > c2.z) {
+            const float s = std::sqrt(1.0f + c0.x - c1.y - c2.z) * 2.0f;
+            q = { 0.25f * s, (c1.x + c0.y) / s, (c2.x + c0.z) / s, (c1.z - c2.y) / s };
+        } else if (c1.y > c2.z) {
+            const float s = std::sqrt(1.0f + c1.y - c0.x - c2.z) * 2.0f;
+            q = { (c1.x + c0.y) / s, 0.25f * s, (c2.y + c1.z) / s, (c2.x - c0.z) / s };
+        } else {
+            const float s = std::sqrt(1.0f + c2.z - c0.x - c1.y) * 2.0f;
+            q = { (c2.x + c0.z) / s, (c2.y + c1.z) / s, 0.25f * s, (c0.y - c1.x) / s };
+        }
+
+        const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (float& component : q) {
+            component /= length;
+        }
+        return q;
+    }
+
+    /// Drops the largest component (recomputed from the unit length when decoding)
+    /// and stores the other three in 10 bits each, over their reduced range.
+    auto encodeQuaternion(std::array<float, 4> q) -> PackedUnsignedInt2101010 {
+        std::uint32_t largest = 0;
+        for (std::uint32_t i = 1; i < 4; i++) {
+            if (std::abs(q[i]) > std::abs(q[largest])) {
+                largest = i;
+            }
+        }
+        // q and -q are the same rotation, the dropped component is always positive.
+        if (q[largest] < 0.0f) {
+            for (float& component : q) {
+                component = -component;
+            }
+        }
+
+        std::uint32_t bits = largest << 30;
+        std::uint32_t shift = 0;
+        for (std::uint32_t i = 0; i < 4; i++) {
+            if (i == largest) {
+                continue;
+            }
+            const float normalized = std::clamp(q[i] / smallestThreeRange * 0.5f + 0.5f, 0.0f, 1.0f);
+            bits |= static_cast<std::uint32_t>(std::lround(normalized * unorm10Max)) << shift;
+            shift += 10;
+        }
+        return PackedUnsignedInt2101010 { bits };
+    }
+
+    auto decodeQuaternion(const PackedUnsignedInt2101010 packed) -> std::array<float, 4> {
+        const std::uint32_t largest = packed.bits >> 30;
+        std::array<float, 3> smallest{};
+        for (std::uint32_t i = 0; i < 3; i++) {
+            const float normalized = static_cast<float>((packed.bits >> (10 * i)) & 0x3FFu) / unorm10Max;
+            smallest[i] = (normalized * 2.0f - 1.0f) * smallestThreeRange;
+        }
+
+        const float squaredSum = smallest[0] * smallest[0] + smallest[1] * smallest[1] + smallest[2] * smallest[2];
+        std::array<float, 4> q{};
+        std::uint32_t next = 0;
+        for (std::uint32_t i = 0; i < 4; i++) {
+            q[i] = i == largest ? std::sqrt(std::max(1.0f - squaredSum, 0.0f)) : smallest[next++];
+        }
+        return q;
+    }
+
+    /// First column of the quaternion's rotation matrix.
+    auto rotateTangent(const std::array<float, 4>& q) -> glm::vec3 {
+        const auto [x, y, z, w] = q;
+        return glm::vec3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+    }
+
+    /// Packs everything of the vertex but its position.
+    auto packAttributes(const Vertex& vertex, PackedVertex& packed) -> void {
+        const TangentFrame frame = buildTangentFrame(vertex);
+        packed.normal = encodeOctahedral(vertex.normal);
+        packed.tangentFrame = encodeQuaternion(frameToQuaternion(frame));
+        packed.position[3] = encodeSnorm16(frame.handedness);
+        packed.texUV = { HalfFloat { floatToHalf(vertex.texUV.x) }, HalfFloat { floatToHalf(vertex.texUV.y) } };
+    }
+
+    /// Scalar version of the whole vertex (same bits as the SSE one), for the leftover vertices and CPUs without SSE.
+    auto packVertex(const Vertex& vertex, const glm::vec3& center, const glm::vec3& scale) -> PackedVertex {
+        PackedVertex packed{};
+        const glm::vec3 relative = (vertex.position - center) * scale;
+        packed.position = { encodeSnorm16(relative.x), encodeSnorm16(relative.y), encodeSnorm16(relative.z), 0 };
+        packAttributes(vertex, packed);
+        return packed;
+    }
+
+#if defined(__SSE2__)
+    /// Packs four vertices at once. Positions are quantized one vertex per register,
+    /// normals are transposed so each register holds one axis of all four,
+    /// UVs go through F16C if the CPU target has it.
+    auto packFourVertices(const Vertex* vertices, const __m128 center, const __m128 scale, PackedVertex* packed) -> void {
+        const __m128 snormMax = _mm_set1_ps(snorm16Max);
+
+        for (int i = 0; i < 4; i++) {
+            // Loads position and the normal's x (fourth lane, ignored).
+            const __m128 position = _mm_loadu_ps(&vertices[i].position.x);
+            const __m128 relative = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(position, center), scale), snormMax);
+            // Rounds to nearest, `packs` saturates to the 16-bit range.
+            const __m128i quantized = _mm_cvtps_epi32(relative);
+            alignas(16) std::array<GLshort, 8> shorts{};
+            _mm_store_si128(reinterpret_cast<__m128i*>(shorts.data()), _mm_packs_epi32(quantized, quantized));
+            std::copy_n(shorts.data(), 3, packed[i].position.data());
+        }
+
+        // Octahedral normals, in structure of arrays form. The fourth row holds the UVs' x and is ignored.
+        __m128 x = _mm_loadu_ps(&vertices[0].normal.x);
+        __m128 y = _mm_loadu_ps(&vertices[1].normal.x);
+        __m128 z = _mm_loadu_ps(&vertices[2].normal.x);
+        __m128 ignored = _mm_loadu_ps(&vertices[3].normal.x);
+        _MM_TRANSPOSE4_PS(x, y, z, ignored);
+
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const auto absolute = [&](const __m128 value) { return _mm_andnot_ps(signMask, value); };
+        // +1 or -1, never 0, so the fold never collapses onto an axis.
+        const auto signNotZero = [&](const __m128 value) { return _mm_or_ps(_mm_and_ps(value, signMask), one); };
+
+        const __m128 l1 = _mm_add_ps(_mm_add_ps(absolute(x), absolute(y)), absolute(z));
+        // Zero normals become (0, 0), which decodes to (0, 0, 1) like the scalar version.
+        const __m128 isZero = _mm_cmpeq_ps(l1, _mm_setzero_ps());
+        const __m128 inverseL1 = _mm_andnot_ps(isZero, _mm_div_ps(one, _mm_or_ps(l1, _mm_and_ps(isZero, one))));
+        const __m128 octX = _mm_mul_ps(x, inverseL1);
+        const __m128 octY = _mm_mul_ps(y, inverseL1);
+
+        const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, absolute(octY)), signNotZero(octX));
+        const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, absolute(octX)), signNotZero(octY));
+        const __m128 isLowerHemisphere = _mm_cmplt_ps(z, _mm_setzero_ps());
+        const __m128 encodedX = _mm_or_ps(_mm_and_ps(isLowerHemisphere, foldedX), _mm_andnot_ps(isLowerHemisphere, octX));
+        const __m128 encodedY = _mm_or_ps(_mm_and_ps(isLowerHemisphere, foldedY), _mm_andnot_ps(isLowerHemisphere, octY));
+
+        const __m128i quantizedX = _mm_cvtps_epi32(_mm_mul_ps(encodedX, snormMax));
+        const __m128i quantizedY = _mm_cvtps_epi32(_mm_mul_ps(encodedY, snormMax));
+        // x0 y0 x1 y1 x2 y2 x3 y3
+        alignas(16) std::array<GLshort, 8> normals{};
+        _mm_store_si128(reinterpret_cast<__m128i*>(normals.data()),
+            _mm_unpacklo_epi16(_mm_packs_epi32(quantizedX, quantizedX), _mm_packs_epi32(quantizedY, quantizedY)));
+
+        for (int i = 0; i < 4; i++) {
+            packed[i].normal = { normals[2 * i], normals[2 * i + 1] };
+            const TangentFrame frame = buildTangentFrame(vertices[i]);
+            packed[i].tangentFrame = encodeQuaternion(frameToQuaternion(frame));
+            packed[i].position[3] = encodeSnorm16(frame.handedness);
+        }
+
+#if defined(__F16C__)
+        const __m128 uv01 = _mm_setr_ps(vertices[0].texUV.x, vertices[0].texUV.y, vertices[1].texUV.x, vertices[1].texUV.y);
+        const __m128 uv23 = _mm_setr_ps(vertices[2].texUV.x, vertices[2].texUV.y, vertices[3].texUV.x, vertices[3].texUV.y);
+        alignas(16) std::array<std::uint16_t, 8> halves{};
+        _mm_store_si128(reinterpret_cast<__m128i*>(halves.data()), _mm_unpacklo_epi64(
+            _mm_cvtps_ph(uv01, _MM_FROUND_TO_NEAREST_INT), _mm_cvtps_ph(uv23, _MM_FROUND_TO_NEAREST_INT)));
+        for (int i = 0; i < 4; i++) {
+            packed[i].texUV = { HalfFloat { halves[2 * i] }, HalfFloat { halves[2 * i + 1] } };
+        }
+#else
+        for (int i = 0; i < 4; i++) {
+            packed[i].texUV = { HalfFloat { floatToHalf(vertices[i].texUV.x) }, HalfFloat { floatToHalf(vertices[i].texUV.y) } };
+        }
+#endif
+    }
+#endif
+}
+
+export namespace vertex::packing {
+    /// Tightest box around the vertices' positions.
+    auto computeBounds(const std::span<const Vertex> vertices) -> AABB {
+        AABB bounds;
+#if defined(__SSE2__)
+        if (vertices.empty()) {
+            return bounds;
+        }
+        __m128 minimum = _mm_set1_ps(std::numeric_limits<float>::infinity());
+        __m128 maximum = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+        for (const Vertex& vertex : vertices) {
+            // The fourth lane is the normal's x, it's dropped below.
+            const __m128 position = _mm_loadu_ps(&vertex.position.x);
+            minimum = _mm_min_ps(minimum, position);
+            maximum = _mm_max_ps(maximum, position);
+        }
+        alignas(16) std::array<float, 4> lanes{};
+        _mm_store_ps(lanes.data(), minimum);
+        bounds.min = glm::vec3(lanes[0], lanes[1], lanes[2]);
+        _mm_store_ps(lanes.data(), maximum);
+        bounds.max = glm::vec3(lanes[0], lanes[1], lanes[2]);
+#else
+        for (const Vertex& vertex : vertices) {
+            bounds.expand(vertex.position);
+        }
+#endif
+        return bounds;
+    }
+
+    /// Quantizes the vertices into `PackedVertex`es, positions relative to the `bounds`
+    /// (the shader needs the same bounds to decode them). Four vertices at a time with SSE.
+    auto packVertices(const std::span<const Vertex> vertices, const AABB& bounds) -> std::vector<PackedVertex> {
+        std::vector<PackedVertex> packed(vertices.size());
+        const glm::vec3 center = bounds.getCenter();
+        const glm::vec3 scale = detail::getPositionScale(bounds);
+
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        const __m128 centerLanes = _mm_setr_ps(center.x, center.y, center.z, 0.0f);
+        const __m128 scaleLanes = _mm_setr_ps(scale.x, scale.y, scale.z, 0.0f);
+        for (; i + 4 <= vertices.size(); i += 4) {
+            detail::packFourVertices(vertices.data() + i, centerLanes, scaleLanes, packed.data() + i);
+        }
+#endif
+        for (; i < vertices.size(); i++) {
+            packed[i] = detail::packVertex(vertices[i], center, scale);
+        }
+        return packed;
+    }
+
+    /// Decodes the vertex the same way shaders/std/vertex_packing.glsl does.
+    /// The bitangent is rebuilt from the normal and the tangent.
+    auto unpackVertex(const PackedVertex& packed, const AABB& bounds) -> Vertex {
+        using namespace detail;
+
+        const glm::vec3 relative(decodeSnorm16(packed.position[0]), decodeSnorm16(packed.position[1]),
+                                 decodeSnorm16(packed.position[2]));
+        const float handedness = decodeSnorm16(packed.position[3]) < 0.0f ? -1.0f : 1.0f;
+        const glm::vec3 normal = decodeOctahedral(packed.normal);
+        // Re-orthogonalized against the (more precise) normal.
+        glm::vec3 tangent = rotateTangent(decodeQuaternion(packed.tangentFrame));
+        tangent = glm::normalize(tangent - normal * glm::dot(normal, tangent));
+
+        return Vertex::create(
+            bounds.getCenter() + relative * bounds.getExtent(),
+            normal,
+            glm::vec2(halfToFloat(packed.texUV[0].bits), halfToFloat(packed.texUV[1].bits)),
+            tangent,
+            glm::cross(normal, tangent) * handedness
+        );
+    }
+
+    /// Largest differences between the original vertices and their packed round trip.
+    struct RoundTripError {
+        float position = 0.0f; // In model units.
+        float positionRelative = 0.0f; // Relative to the size of the bounds' longest axis.
+        float normalDegrees = 0.0f;
+        float tangentDegrees = 0.0f;
+        float texUVRelative = 0.0f; // Relative to the coordinate's magnitude (at least 1).
+        std::size_t handednessFlips = 0; // Bitangents that ended up on the other side.
+
+        /// Whether the errors are what the format's precision allows: half a snorm16 step per axis,
+        /// a few hundredths of a degree for the 16-bit normal, a fraction of a degree for the 10-bit
+        /// quaternion and half a half float step for the UVs.
+        [[nodiscard]] auto isWithinTolerance() const -> bool {
+            return positionRelative <= 1.0f / detail::snorm16Max
+                && normalDegrees <= 0.02f
+                && tangentDegrees <= 0.5f
+                && texUVRelative <= 1.0f / 2048.0f
+                && handednessFlips == 0;
+        }
+    };
+
+    /// Packs and unpacks the vertices and measures what got lost. Vertices without
+    /// a normal (or tangent) are skipped for the normal (or tangent) error.
+    auto measureRoundTripError(const std::span<const Vertex> vertices) -> RoundTripError {
+        const AABB bounds = computeBounds(vertices);
+        const std::vector<PackedVertex> packed = packVertices(vertices, bounds);
+
+        // atan2 stays precise for tiny angles, acos of a float doesn't.
+        const auto angleBetween = [](const glm::vec3& a, const glm::vec3& b) {
+            return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)) * 180.0f / std::numbers::pi_v<float>;
+        };
+
+        RoundTripError error;
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            const Vertex& original = vertices[i];
+            const Vertex decoded = unpackVertex(packed[i], bounds);
+
+            error.position = std::max(error.position, glm::length(decoded.position - original.position));
+            error.texUVRelative = std::max({ error.texUVRelative,
+                std::abs(decoded.texUV.x - original.texUV.x) / std::max(std::abs(original.texUV.x), 1.0f),
+                std::abs(decoded.texUV.y - original.texUV.y) / std::max(std::abs(original.texUV.y), 1.0f) });
+
+            if (glm::length(original.normal) == 0.0f) {
+                continue;
+            }
+            const detail::TangentFrame frame = detail::buildTangentFrame(original);
+            error.normalDegrees = std::max(error.normalDegrees, angleBetween(frame.normal, decoded.normal));
+
+            if (glm::length(original.tangent) == 0.0f) {
+                continue;
+            }
+            error.tangentDegrees = std::max(error.tangentDegrees, angleBetween(frame.tangent, decoded.tangent));
+            if (glm::dot(original.bitangent, decoded.bitangent) < 0.0f) {
+                error.handednessFlips++;
+            }
+        }
+
+        const glm::vec3 size = bounds.max - bounds.min;
+        const float longestAxis = std::max({ size.x, size.y, size.z });
+        error.positionRelative = longestAxis > 0.0f ? error.position / longestAxis : 0.0f;
+        return error;
+    }
+}
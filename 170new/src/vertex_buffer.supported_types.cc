@@ -12,6 +12,23 @@ export module vertex_buffer.supported_types;
 // WARN: If you decide to add a new supported data type, 
 // you must add it to both mapping functions.
 
+/// 16-bit IEEE half float (GL_HALF_FLOAT). It's its own type
+/// because `GLhalf` is only a typedef of an unsigned short.
+export struct HalfFloat {
+    std::uint16_t bits;
+};
+
+/// Four signed components packed into 32 bits, x, y and z have 10 bits,
+/// w has 2 bits (GL_INT_2_10_10_10_REV). Always pushed with a count of 4.
+export struct PackedInt2101010 {
+    std::uint32_t bits;
+};
+
+/// Unsigned version of `PackedInt2101010` (GL_UNSIGNED_INT_2_10_10_10_REV).
+export struct PackedUnsignedInt2101010 {
+    std::uint32_t bits;
+};
+
 /// Compile-time OpenGL data type mapping to OpenGL data type macro codes.
 /// Only maps supported data types, if they are not supported, static assertion is raised.
 export template<typename DataType>
@@ -19,6 +36,11 @@ auto getGLTypeMacroCode() -> int {
     if constexpr (std::is_same_v<DataType, GLfloat>) return GL_FLOAT;
     if constexpr (std::is_same_v<DataType, GLint>) return GL_INT;
     if constexpr (std::is_same_v<DataType, GLuint>) return GL_UNSIGNED_INT;
+    if constexpr (std::is_same_v<DataType, GLshort>) return GL_SHORT;
+    if constexpr (std::is_same_v<DataType, GLushort>) return GL_UNSIGNED_SHORT;
+    if constexpr (std::is_same_v<DataType, HalfFloat>) return GL_HALF_FLOAT;
+    if constexpr (std::is_same_v<DataType, PackedInt2101010>) return GL_INT_2_10_10_10_REV;
+    if constexpr (std::is_same_v<DataType, PackedUnsignedInt2101010>) return GL_UNSIGNED_INT_2_10_10_10_REV;
     if constexpr (std::is_same_v<DataType, GLubyte>) return GL_UNSIGNED_BYTE;
     if constexpr (std::is_same_v<DataType, glm::mat4>) return GL_FLOAT_MAT4;
 
@@ -27,16 +49,35 @@ auto getGLTypeMacroCode() -> int {
 
 /// Returns the sizeof OpenGL data type given its macro code.
 /// Only maps supported data types, if they are not supported, -1 is returned.
+/// The packed types return the size of all four components together.
 export auto getSizeOfGLTypeFromMacroCode(const GLuint openGLMacroCode) -> GLint {
     switch (openGLMacroCode) {
         case GL_FLOAT: return sizeof(GLfloat);
         case GL_INT: return sizeof(GLint);
         case GL_UNSIGNED_INT: return sizeof(GLuint);
+        case GL_SHORT: return sizeof(GLshort);
+        case GL_UNSIGNED_SHORT: return sizeof(GLushort);
         case GL_UNSIGNED_BYTE: return sizeof(GLubyte);
+        case GL_HALF_FLOAT: return sizeof(HalfFloat);
+        case GL_INT_2_10_10_10_REV: return sizeof(PackedInt2101010);
+        case GL_UNSIGNED_INT_2_10_10_10_REV: return sizeof(PackedUnsignedInt2101010);
         default: return -1;
     }
 }
 
+/// True for the types that pack all of the attribute's components into one value.
+export auto isPackedGLTypeMacroCode(const GLuint openGLMacroCode) -> bool {
+    return openGLMacroCode == GL_INT_2_10_10_10_REV || openGLMacroCode == GL_UNSIGNED_INT_2_10_10_10_REV;
+}
+
+/// How many bytes an attribute of `count` components of the given type takes up in a vertex.
+export auto getAttributeSizeInBytes(const GLuint openGLMacroCode, const GLuint count) -> GLint {
+    if (isPackedGLTypeMacroCode(openGLMacroCode)) {
+        return getSizeOfGLTypeFromMacroCode(openGLMacroCode);
+    }
+    return static_cast<GLint>(count) * getSizeOfGLTypeFromMacroCode(openGLMacroCode);
+}
+
 /// Concept that check if VertexBuffer supports the given data type.
 export template <typename DataType>
 concept IsSupportedByVertexBuffer = requires() {
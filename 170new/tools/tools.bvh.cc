@@ -0,0 +1,304 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+#include <random>
+
+export module tools.bvh;
+
+import tools.common;
+import model;
+import model.mesh_cache;
+import camera;
+import aabb;
+import ray;
+import bvh;
+import vertex_buffer.vertex_struct;
+
+/// Random boxes scattered in a cube of `size` units around the origin.
+auto generateRandomBoxes(std::mt19937& random, const std::size_t count, const float size) -> std::vector<AABB> {
+    std::uniform_real_distribution<float> position(-size * 0.5f, size * 0.5f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+    std::vector<AABB> boxes;
+    boxes.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        const glm::vec3 center(position(random), position(random), position(random));
+        const glm::vec3 halfSize(extent(random), extent(random), extent(random));
+        boxes.push_back(AABB { center - halfSize, center + halfSize });
+    }
+    return boxes;
+}
+
+/// Random ray starting within the cube of `size` units around the origin.
+auto generateRandomRay(std::mt19937& random, const float size) -> Ray {
+    std::uniform_real_distribution<float> position(-size * 0.5f, size * 0.5f);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    return Ray {
+        glm::vec3(position(random), position(random), position(random)),
+        glm::normalize(glm::vec3(direction(random), direction(random), direction(random) + 0.001f)),
+    };
+}
+
+/// Checks every query of the scene BVH against testing every box, after building it, after moving
+/// objects around (refits) and after removing and inserting some. Then checks the triangle BVH of a
+/// sphere against testing every triangle. Returns 1 if anything differs. Doesn't open a window, no GPU needed.
+export auto testBvh() -> int {
+    constexpr std::size_t objectCount = 20'000;
+    constexpr float sceneSize = 200.0f;
+    std::mt19937 random(7);
+    int failures = 0;
+    const auto check = [&failures](const bool passed, const std::string_view what) {
+        if (!passed) {
+            std::println("    FAILED: {}", what);
+            failures++;
+        }
+    };
+
+    std::vector<AABB> boxes = generateRandomBoxes(random, objectCount, sceneSize);
+    BoundingVolumeHierarchy tree;
+    for (const auto& box : boxes) {
+        tree.insert(box);
+    }
+
+    Camera camera(glm::i32vec2(1920, 1080), camera::defaults::movementSpeed, glm::vec3(0.0f, 0.0f, 50.0f));
+    camera.updateProjectionViewMatrix();
+    const auto planes = camera.getFrustumPlanes();
+
+    const auto checkQueries = [&](const std::string_view stage) {
+        tree.update();
+        std::println("{}: {} objects, {} nodes, SAH cost {:.1f}", stage, tree.getObjectCount(), tree.getNodeCount(), tree.getCost());
+
+        std::vector<BoundingVolumeHierarchy::Handle> found;
+        std::vector<BoundingVolumeHierarchy::Handle> expected;
+        tree.queryFrustum(planes, found);
+        for (BoundingVolumeHierarchy::Handle handle = 0; handle < boxes.size(); handle++) {
+            const AABB& box = boxes[handle];
+            const bool visible = !box.isEmpty() && std::ranges::all_of(planes, [&](const glm::vec4& plane) {
+                return glm::dot(glm::vec3(plane), box.getCenter()) + plane.w + glm::dot(glm::abs(glm::vec3(plane)), box.getExtent()) >= 0.0f;
+            });
+            if (visible) {
+                expected.push_back(handle);
+            }
+        }
+        std::ranges::sort(found);
+        check(found == expected, std::format("{}: frustum query found {} objects instead of {}", stage, found.size(), expected.size()));
+
+        for (int i = 0; i < 500; i++) {
+            const Ray ray = generateRandomRay(random, sceneSize);
+            const auto hit = tree.raycast(ray);
+            float closest = std::numeric_limits<float>::infinity();
+            for (const auto& box : boxes) {
+                if (box.isEmpty()) {
+                    continue;
+                }
+                if (const auto t = ray::intersect(ray, ray.getInverseDirection(), box, closest)) {
+                    closest = *t;
+                }
+            }
+            if (hit.has_value() != (closest < std::numeric_limits<float>::infinity())
+            || (hit.has_value() && std::abs(hit->distance - closest) > 1e-4f)) {
+                check(false, std::format("{}: ray cast hit at {} instead of {}", stage, hit.has_value() ? hit->distance : -1.0f, closest));
+                break;
+            }
+        }
+
+        for (int i = 0; i < 100; i++) {
+            const glm::vec3 center = generateRandomRay(random, sceneSize).origin;
+            constexpr float radius = 10.0f;
+            tree.queryRadius(center, radius, found);
+            expected.clear();
+            for (BoundingVolumeHierarchy::Handle handle = 0; handle < boxes.size(); handle++) {
+                if (!boxes[handle].isEmpty() && boxes[handle].getDistanceSquared(center) <= radius * radius) {
+                    expected.push_back(handle);
+                }
+            }
+            std::ranges::sort(found);
+            if (found != expected) {
+                check(false, std::format("{}: radius query found {} objects instead of {}", stage, found.size(), expected.size()));
+                break;
+            }
+        }
+    };
+
+    checkQueries("built");
+
+    std::uniform_int_distribution<std::size_t> anyObject(0, objectCount - 1);
+    std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+    for (int frame = 0; frame < 30; frame++) {
+        for (std::size_t i = 0; i < objectCount / 10; i++) {
+            const std::size_t handle = anyObject(random);
+            const glm::vec3 offset(step(random), step(random), step(random));
+            boxes[handle] = AABB { boxes[handle].min + offset, boxes[handle].max + offset };
+            tree.move(static_cast<BoundingVolumeHierarchy::Handle>(handle), boxes[handle]);
+        }
+        tree.update();
+    }
+    checkQueries("moved");
+
+    for (int i = 0; i < 1000; i++) {
+        const std::size_t handle = anyObject(random);
+        if (!boxes[handle].isEmpty()) {
+            tree.remove(static_cast<BoundingVolumeHierarchy::Handle>(handle));
+            boxes[handle] = AABB{};
+        }
+    }
+    for (const auto& box : generateRandomBoxes(random, 500, sceneSize)) {
+        const auto handle = tree.insert(box);
+        if (handle >= boxes.size()) {
+            boxes.resize(handle + 1);
+        }
+        boxes[handle] = box;
+    }
+    checkQueries("removed and inserted");
+
+    // UV sphere, rays from around it.
+    constexpr int rings = 60;
+    constexpr int segments = 120;
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    for (int ring = 0; ring <= rings; ring++) {
+        for (int segment = 0; segment <= segments; segment++) {
+            const float theta = std::numbers::pi_v<float> * static_cast<float>(ring) / rings;
+            const float phi = 2.0f * std::numbers::pi_v<float> * static_cast<float>(segment) / segments;
+            vertices.push_back(Vertex { .position = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) } });
+        }
+    }
+    for (GLuint ring = 0; ring < rings; ring++) {
+        for (GLuint segment = 0; segment < segments; segment++) {
+            const GLuint corner = ring * (segments + 1) + segment;
+            indices.insert(indices.end(), { corner, corner + segments + 1, corner + 1, corner + 1, corner + segments + 1, corner + segments + 2 });
+        }
+    }
+    const TriangleBvh triangleBvh(vertices, indices);
+    std::println("sphere: {} triangles, {} nodes", triangleBvh.getTriangleCount(), triangleBvh.getNodeCount());
+    for (int i = 0; i < 1000; i++) {
+        const Ray ray = generateRandomRay(random, 3.0f);
+        const auto hit = triangleBvh.raycast(ray);
+        float closest = std::numeric_limits<float>::infinity();
+        for (std::size_t t = 0; t < indices.size(); t += 3) {
+            const auto intersection = ray::intersect(ray, vertices[indices[t]].position,
+                vertices[indices[t + 1]].position, vertices[indices[t + 2]].position, closest);
+            if (intersection.has_value()) {
+                closest = intersection->t;
+            }
+        }
+        if (hit.has_value() != (closest < std::numeric_limits<float>::infinity())
+        || (hit.has_value() && std::abs(hit->intersection.t - closest) > 1e-5f)) {
+            check(false, "sphere: triangle ray cast doesn't match testing every triangle");
+            break;
+        }
+    }
+
+    std::println("{}", failures == 0 ? "All BVH checks passed" : std::format("{} BVH checks failed", failures));
+    return failures == 0 ? 0 : 1;
+}
+
+/// Times building the scene BVH over 100k random boxes, refitting it and its queries, then building
+/// a triangle BVH over every mesh of the models and casting rays at them. Doesn't open a window, no GPU needed.
+/// Without arguments it goes through all the bundled models.
+export auto benchmarkBvh(std::vector<std::string> modelPaths) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    constexpr std::size_t objectCount = 100'000;
+    constexpr std::size_t queryCount = 100'000;
+    constexpr float sceneSize = 200.0f;
+
+    std::mt19937 random(42);
+    const std::vector<AABB> boxes = generateRandomBoxes(random, objectCount, sceneSize);
+    BoundingVolumeHierarchy tree;
+    for (const auto& box : boxes) {
+        tree.insert(box);
+    }
+    auto start = Clock::now();
+    tree.update();
+    const Milliseconds buildTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (BoundingVolumeHierarchy::Handle handle = 0; handle < objectCount / 10; handle++) {
+        tree.move(handle * 10, boxes[handle * 10]);
+    }
+    const Milliseconds refitTime = Clock::now() - start;
+
+    Camera camera(glm::i32vec2(1920, 1080), camera::defaults::movementSpeed, glm::vec3(0.0f, 0.0f, 50.0f));
+    camera.updateProjectionViewMatrix();
+    std::vector<BoundingVolumeHierarchy::Handle> found;
+    start = Clock::now();
+    for (int i = 0; i < 100; i++) {
+        tree.queryFrustum(camera.getFrustumPlanes(), found);
+    }
+    const Milliseconds frustumTime = (Clock::now() - start) / 100;
+
+    std::vector<Ray> rays;
+    for (std::size_t i = 0; i < queryCount; i++) {
+        rays.push_back(generateRandomRay(random, sceneSize));
+    }
+    std::size_t hits = 0;
+    start = Clock::now();
+    for (const Ray& ray : rays) {
+        hits += tree.raycast(ray).has_value() ? 1 : 0;
+    }
+    const Milliseconds rayTime = Clock::now() - start;
+
+    std::size_t foundCount = 0;
+    start = Clock::now();
+    for (const Ray& ray : rays) {
+        tree.queryRadius(ray.origin, 5.0f, found);
+        foundCount += found.size();
+    }
+    const Milliseconds radiusTime = Clock::now() - start;
+
+    const auto perSecond = [](const std::size_t count, const Milliseconds time) {
+        return static_cast<double>(count) / 1'000'000.0 / (time.count() / 1000.0);
+    };
+    std::println("Scene BVH, {} boxes: built in {:.1f} ms ({} nodes, SAH cost {:.1f}), {} moves refitted in {:.2f} ms",
+        objectCount, buildTime.count(), tree.getNodeCount(), tree.getCost(), objectCount / 10, refitTime.count());
+    std::println("    frustum query: {:.3f} ms ({} visible)", frustumTime.count(), found.size());
+    std::println("    ray casts:     {:.2f} M/s ({} hits)", perSecond(queryCount, rayTime), hits);
+    std::println("    radius 5:      {:.2f} M/s ({:.1f} objects each)", perSecond(queryCount, radiusTime),
+        static_cast<double>(foundCount) / static_cast<double>(queryCount));
+
+    modelPaths = collectModelPaths(std::move(modelPaths));
+    for (const auto& modelPath : modelPaths) {
+        const std::vector<model::cache::MeshData> meshes = Model::importModel(modelPath);
+
+        std::size_t triangleCount = 0;
+        Milliseconds triangleBuildTime{};
+        Milliseconds triangleRayTime{};
+        std::size_t triangleRays = 0;
+        std::size_t triangleHits = 0;
+        for (const auto& mesh : meshes) {
+            start = Clock::now();
+            const TriangleBvh triangleBvh(mesh.vertices, mesh.indices);
+            triangleBuildTime += Clock::now() - start;
+            triangleCount += triangleBvh.getTriangleCount();
+
+            // Rays from around the mesh towards random points in its box.
+            const AABB bounds = triangleBvh.getBounds();
+            if (bounds.isEmpty()) {
+                continue;
+            }
+            const float reach = glm::length(bounds.getExtent()) * 2.0f;
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            std::vector<Ray> meshRays;
+            for (int i = 0; i < 1000; i++) {
+                const glm::vec3 target = bounds.getCenter() + bounds.getExtent() * glm::vec3(unit(random), unit(random), unit(random));
+                const glm::vec3 origin = bounds.getCenter() + reach * glm::normalize(glm::vec3(unit(random), unit(random), unit(random) + 0.001f));
+                meshRays.push_back(Ray { origin, glm::normalize(target - origin) });
+            }
+            start = Clock::now();
+            for (const Ray& ray : meshRays) {
+                triangleHits += triangleBvh.raycast(ray).has_value() ? 1 : 0;
+            }
+            triangleRayTime += Clock::now() - start;
+            triangleRays += meshRays.size();
+        }
+
+        std::println("{}: {} meshes, {} triangles, triangle BVHs built in {:.1f} ms, {:.2f} M rays/s ({} of {} hit)",
+            modelPath, meshes.size(), triangleCount, triangleBuildTime.count(),
+            perSecond(triangleRays, triangleRayTime), triangleHits, triangleRays);
+    }
+    return 0;
+}
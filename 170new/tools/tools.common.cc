@@ -0,0 +1,21 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module tools.common;
+
+/// Returns the given model paths, or all the bundled models (./models/*/scene.gltf) if there are none.
+export auto collectModelPaths(std::vector<std::string> modelPaths) -> std::vector<std::string> {
+    if (modelPaths.empty() && std::filesystem::is_directory("./models")) {
+        for (const auto& entry : std::filesystem::directory_iterator("./models")) {
+            if (std::filesystem::exists(entry.path() / "scene.gltf")) {
+                modelPaths.push_back((entry.path() / "scene.gltf").string());
+            }
+        }
+        std::ranges::sort(modelPaths);
+    }
+    return modelPaths;
+}
@@ -0,0 +1,64 @@
+#include "std.h"
+
+import tools.texture;
+import tools.mesh;
+import tools.culling;
+import tools.render_queue;
+import tools.uniforms;
+import tools.bvh;
+
+/// Benchmarks and checks of the engine's subsystems, none of them open a window or need a GPU.
+/// Returns non-zero when a check fails, so `./build.sh test` and `ctest` can run them.
+auto main(int argc, char *argv[]) -> int {
+    // ./tools --evaluate-compression <image>
+    if (argc == 3 && std::string_view(argv[1]) == "--evaluate-compression") {
+        return evaluateCompression(argv[2]);
+    }
+    // ./tools --benchmark-texture-cache <image>
+    if (argc == 3 && std::string_view(argv[1]) == "--benchmark-texture-cache") {
+        return benchmarkTextureCache(argv[2]);
+    }
+    // ./tools --benchmark-mesh-optimizer [model...]
+    if (argc >= 2 && std::string_view(argv[1]) == "--benchmark-mesh-optimizer") {
+        return benchmarkMeshOptimizer(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    // ./tools --evaluate-vertex-packing [model...]
+    if (argc >= 2 && std::string_view(argv[1]) == "--evaluate-vertex-packing") {
+        return evaluateVertexPacking(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    // ./tools --test-vertex-packing
+    if (argc == 2 && std::string_view(argv[1]) == "--test-vertex-packing") {
+        return testVertexPacking();
+    }
+    // ./tools --benchmark-mesh-simplifier [model...]
+    if (argc >= 2 && std::string_view(argv[1]) == "--benchmark-mesh-simplifier") {
+        return benchmarkMeshSimplifier(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    // ./tools --benchmark-frustum-culling [object count]
+    if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark-frustum-culling") {
+        return benchmarkFrustumCulling(argc == 3 ? std::stoul(argv[2]) : 100'000);
+    }
+    // ./tools --benchmark-render-queue [draw count]
+    if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark-render-queue") {
+        return benchmarkRenderQueue(argc == 3 ? std::stoul(argv[2]) : 100'000);
+    }
+    // ./tools --benchmark-uniform-lookup [draw count]
+    if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark-uniform-lookup") {
+        return benchmarkUniformLookup(argc == 3 ? std::stoul(argv[2]) : 1'000'000);
+    }
+    // ./tools --test-bvh
+    if (argc == 2 && std::string_view(argv[1]) == "--test-bvh") {
+        return testBvh();
+    }
+    // ./tools --benchmark-bvh [model...]
+    if (argc >= 2 && std::string_view(argv[1]) == "--benchmark-bvh") {
+        return benchmarkBvh(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    // ./tools --pack-texture-atlases [model...]
+    if (argc >= 2 && std::string_view(argv[1]) == "--pack-texture-atlases") {
+        return packTextureAtlases(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    std::println("Unknown tool, see the comments in tools/tools.cpp for the usage.");
+    return 1;
+}
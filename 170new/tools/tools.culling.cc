@@ -0,0 +1,72 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+#include <random>
+
+export module tools.culling;
+
+import camera;
+import aabb;
+import bounding_sphere;
+import frustum_culling;
+
+/// Culls `objectCount` random boxes (and their bounding spheres) scattered around a 1080p camera,
+/// with the SIMD culler and one box at a time, and prints the throughput of both. Fails (returns 1)
+/// if the SIMD culler doesn't agree with the scalar one. Doesn't open a window, no GPU needed.
+export auto benchmarkFrustumCulling(const std::size_t objectCount) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    constexpr int runs = 100;
+
+    Camera camera(glm::i32vec2(1920, 1080));
+    camera.updateProjectionViewMatrix();
+    const culling::FrustumPlanes planes = camera.getFrustumPlanes();
+
+    // Fixed seed, every run culls the same scene.
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+    culling::BoxSet boxes;
+    culling::SphereSet spheres;
+    boxes.reserve(objectCount);
+    spheres.reserve(objectCount);
+    for (std::size_t i = 0; i < objectCount; i++) {
+        const glm::vec3 center(position(random), position(random), position(random));
+        const glm::vec3 halfSize(extent(random), extent(random), extent(random));
+        boxes.add(AABB { center - halfSize, center + halfSize });
+        spheres.add(BoundingSphere { center, glm::length(halfSize) });
+    }
+
+    std::vector<std::uint32_t> visible;
+    std::vector<std::uint32_t> visibleScalar;
+    const auto measure = [&](const auto& cull) {
+        const auto start = Clock::now();
+        culling::Stats stats;
+        for (int run = 0; run < runs; run++) {
+            stats = cull();
+        }
+        const Milliseconds time = (Clock::now() - start) / runs;
+        return std::pair(stats, time);
+    };
+
+    const auto [boxStats, boxTime] = measure([&] { return culling::cullBoxes(planes, boxes, visible); });
+    const auto [scalarStats, scalarTime] = measure([&] { return culling::cullBoxesScalar(planes, boxes, visibleScalar); });
+    const bool agrees = visible == visibleScalar;
+    const auto [sphereStats, sphereTime] = measure([&] { return culling::cullSpheres(planes, spheres, visible); });
+
+    const auto throughput = [objectCount](const Milliseconds time) {
+        return static_cast<double>(objectCount) / 1'000'000.0 / (time.count() / 1000.0);
+    };
+    std::println("{} objects, {} lanes (average of {} runs):", objectCount, culling::laneCount, runs);
+    std::println("    boxes (SIMD):    {:8.3f} ms ({:7.1f} M/s), {} visible, {} culled",
+        boxTime.count(), throughput(boxTime), boxStats.visible, boxStats.culled);
+    std::println("    boxes (scalar):  {:8.3f} ms ({:7.1f} M/s), {} visible, {} culled: {}",
+        scalarTime.count(), throughput(scalarTime), scalarStats.visible, scalarStats.culled, agrees ? "OK" : "MISMATCH");
+    std::println("    spheres (SIMD):  {:8.3f} ms ({:7.1f} M/s), {} visible, {} culled",
+        sphereTime.count(), throughput(sphereTime), sphereStats.visible, sphereStats.culled);
+    return agrees ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <glm/glm.hpp>
+
+export module tools.mesh;
+
+import tools.common;
+import model;
+import model.mesh_cache;
+import model.mesh_optimizer;
+import model.mesh_simplifier;
+import camera;
+import aabb;
+import vertex_buffer.vertex_struct;
+import vertex_buffer.packed_vertex;
+
+/// Imports every model and times the mesh optimizer on it, printing the
+/// vertex counts, ACMR and ATVR before and after. Doesn't open a window, no GPU needed.
+/// Without arguments it goes through all the bundled models.
+export auto benchmarkMeshOptimizer(std::vector<std::string> modelPaths) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    modelPaths = collectModelPaths(std::move(modelPaths));
+
+    model::optimizer::Report total;
+    Milliseconds totalTime{};
+
+    for (const auto& modelPath : modelPaths) {
+        std::vector<model::cache::MeshData> meshes = Model::importModel(modelPath);
+        std::println("{}:", modelPath);
+
+        const auto start = Clock::now();
+        total.add(model::optimizer::optimizeMeshes(meshes));
+        totalTime += Clock::now() - start;
+    }
+
+    std::println("{} models, {} triangles optimized in {:.1f} ms ({:.2f} MTris/s): ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+        modelPaths.size(), total.triangles, totalTime.count(),
+        static_cast<double>(total.triangles) / 1'000'000.0 / (totalTime.count() / 1000.0),
+        total.getAcmrBefore(), total.getAcmrAfter(), total.getAtvrBefore(), total.getAtvrAfter());
+    return 0;
+}
+
+/// Packs the vertices of every mesh into `PackedVertex`es, unpacks them again and prints
+/// the largest errors and the packing throughput. Fails (returns 1) if any mesh loses more
+/// than the format's precision allows, or if there are no models. Doesn't open a window, no GPU needed.
+/// Without arguments it goes through all the bundled models, see `testVertexPacking` for the check that needs none.
+export auto evaluateVertexPacking(std::vector<std::string> modelPaths) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    modelPaths = collectModelPaths(std::move(modelPaths));
+    if (modelPaths.empty()) {
+        std::println("No models to evaluate the vertex packing on.");
+        return 1;
+    }
+
+    bool allWithinTolerance = true;
+    for (const auto& modelPath : modelPaths) {
+        const std::vector<model::cache::MeshData> meshes = Model::importModel(modelPath);
+
+        std::size_t vertexCount = 0;
+        Milliseconds packTime{};
+        vertex::packing::RoundTripError worst;
+        for (const auto& mesh : meshes) {
+            const auto start = Clock::now();
+            const auto packed = vertex::packing::packVertices(mesh.vertices, vertex::packing::computeBounds(mesh.vertices));
+            packTime += Clock::now() - start;
+            vertexCount += packed.size();
+
+            const auto error = vertex::packing::measureRoundTripError(mesh.vertices);
+            worst.position = std::max(worst.position, error.position);
+            worst.positionRelative = std::max(worst.positionRelative, error.positionRelative);
+            worst.normalDegrees = std::max(worst.normalDegrees, error.normalDegrees);
+            worst.tangentDegrees = std::max(worst.tangentDegrees, error.tangentDegrees);
+            worst.texUVRelative = std::max(worst.texUVRelative, error.texUVRelative);
+            worst.handednessFlips += error.handednessFlips;
+        }
+
+        const bool withinTolerance = worst.isWithinTolerance();
+        allWithinTolerance = allWithinTolerance && withinTolerance;
+
+        std::println("{}: {} vertices, {} -> {} bytes each, packed in {:.2f} ms ({:.1f} MVerts/s)",
+            modelPath, vertexCount, sizeof(Vertex), sizeof(PackedVertex), packTime.count(),
+            static_cast<double>(vertexCount) / 1'000'000.0 / (packTime.count() / 1000.0));
+        std::println("    position {:.6f} ({:.2e} of the bounds), normal {:.4f} deg, tangent {:.4f} deg, "
+                     "UV {:.2e}, {} handedness flips: {}",
+            worst.position, worst.positionRelative, worst.normalDegrees, worst.tangentDegrees,
+            worst.texUVRelative, worst.handednessFlips, withinTolerance ? "OK" : "TOO LOSSY");
+    }
+    return allWithinTolerance ? 0 : 1;
+}
+
+/// Packs and unpacks vertices made up to hit the format's edge cases: normals along the axes (with both signs
+/// of zero in the other components), on the octants' diagonals and on the octahedron's folds, zero normals and
+/// tangents, tangents along the normal, both handednesses, mirrored and negative UVs, and bounds with a flat axis.
+/// Checks that the SSE path packs every vertex to the same bits as the scalar one, that everything decodes to
+/// finite values, that the flat axis decodes exactly and that the errors are within the format's precision.
+/// Returns 1 if anything fails. Needs no models, doesn't open a window, no GPU needed.
+export auto testVertexPacking() -> int {
+    int failures = 0;
+    const auto check = [&failures](const bool passed, const std::string_view what) {
+        if (!passed) {
+            std::println("    FAILED: {}", what);
+            failures++;
+        }
+    };
+
+    std::vector<glm::vec3> normals = { glm::vec3(0.0f, 0.0f, 0.0f) };
+    for (const float sign : { 1.0f, -1.0f }) {
+        for (const float zero : { 0.0f, -0.0f }) {
+            normals.emplace_back(sign, zero, zero);
+            normals.emplace_back(zero, sign, zero);
+            normals.emplace_back(zero, zero, sign);
+        }
+    }
+    for (const float x : { 1.0f, -1.0f }) {
+        for (const float y : { 1.0f, -1.0f }) {
+            for (const float z : { 1.0f, -1.0f }) {
+                // The diagonal, right on the fold (z of either sign of zero) and just off it.
+                normals.push_back(glm::normalize(glm::vec3(x, y, z)));
+                normals.push_back(glm::normalize(glm::vec3(x, y, z > 0.0f ? 0.0f : -0.0f)));
+                normals.push_back(glm::normalize(glm::vec3(x, y, z * 1e-4f)));
+                // On the fold's edges, where one of the folded coordinates is 0.
+                normals.push_back(glm::normalize(glm::vec3(x > 0.0f ? 0.0f : -0.0f, y, z)));
+                normals.push_back(glm::normalize(glm::vec3(x, y > 0.0f ? 0.0f : -0.0f, z)));
+            }
+        }
+    }
+    constexpr std::array<glm::vec2, 6> texUVs = {
+        glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-0.5f, 1.5f),
+        glm::vec2(-1.0f, -1.0f), glm::vec2(0.999f, -0.001f), glm::vec2(-100.25f, 37.5f),
+    };
+
+    // Every y is the same, the bounds are flat along it.
+    constexpr float flatY = 2.0f;
+    std::vector<Vertex> vertices;
+    for (const glm::vec3& normal : normals) {
+        const glm::vec3 unitNormal = glm::length(normal) > 0.0f ? normal : glm::vec3(0.0f, 0.0f, 1.0f);
+        const glm::vec3 axis = std::abs(unitNormal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        const glm::vec3 perpendicular = glm::normalize(glm::cross(unitNormal, axis));
+        // A proper tangent, none, and one along the normal (both have to fall back to some perpendicular).
+        for (const glm::vec3& tangent : { perpendicular, glm::vec3(0.0f), unitNormal }) {
+            for (const float handedness : { 1.0f, -1.0f }) {
+                const std::size_t i = vertices.size();
+                vertices.push_back(Vertex::create(
+                    glm::vec3(static_cast<float>(i % 7) - 3.0f, flatY, static_cast<float>(i % 5) * 0.5f - 1.0f),
+                    normal,
+                    texUVs[i % texUVs.size()],
+                    tangent,
+                    glm::cross(unitNormal, perpendicular) * handedness
+                ));
+            }
+        }
+    }
+    // Leaves three vertices for the scalar tail of `packVertices`.
+    while (vertices.size() % 4 != 3) {
+        vertices.push_back(vertices[vertices.size() % 4]);
+    }
+
+    const AABB bounds = vertex::packing::computeBounds(vertices);
+    check(bounds.getExtent().y == 0.0f, "the bounds aren't flat along y");
+    const std::vector<PackedVertex> packed = vertex::packing::packVertices(vertices, bounds);
+    // Shifted by three, the vertices the first call left to the scalar tail go through the SSE path.
+    const std::vector<PackedVertex> shifted = vertex::packing::packVertices(std::span(vertices).subspan(3), bounds);
+
+    std::size_t mismatches = 0;
+    std::size_t nonFinite = 0;
+    std::size_t flatAxisErrors = 0;
+    const auto bytes = [](const PackedVertex& vertex) { return std::as_bytes(std::span(&vertex, 1)); };
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        // Fewer than four vertices are all packed by the scalar version.
+        const PackedVertex scalar = vertex::packing::packVertices(std::span(&vertices[i], 1), bounds).front();
+        if (!std::ranges::equal(bytes(scalar), bytes(packed[i])) || (i >= 3 && !std::ranges::equal(bytes(scalar), bytes(shifted[i - 3])))) {
+            mismatches++;
+        }
+
+        const Vertex decoded = vertex::packing::unpackVertex(packed[i], bounds);
+        const std::array<float, 14> values = {
+            decoded.position.x, decoded.position.y, decoded.position.z,
+            decoded.normal.x, decoded.normal.y, decoded.normal.z, decoded.texUV.x, decoded.texUV.y,
+            decoded.tangent.x, decoded.tangent.y, decoded.tangent.z,
+            decoded.bitangent.x, decoded.bitangent.y, decoded.bitangent.z,
+        };
+        nonFinite += std::ranges::all_of(values, [](const float value) { return std::isfinite(value); }) ? 0 : 1;
+        flatAxisErrors += decoded.position.y == flatY ? 0 : 1;
+    }
+    const vertex::packing::RoundTripError error = vertex::packing::measureRoundTripError(vertices);
+
+    std::println("{} vertices: position {:.6f} ({:.2e} of the bounds), normal {:.4f} deg, tangent {:.4f} deg, "
+                 "UV {:.2e}, {} handedness flips",
+        vertices.size(), error.position, error.positionRelative, error.normalDegrees, error.tangentDegrees,
+        error.texUVRelative, error.handednessFlips);
+    check(mismatches == 0, std::format("{} vertices packed differently by the SSE and the scalar version", mismatches));
+    check(nonFinite == 0, std::format("{} vertices decoded to infinities or NaNs", nonFinite));
+    check(flatAxisErrors == 0, std::format("{} vertices moved along the flat axis", flatAxisErrors));
+    check(error.isWithinTolerance(), "the round trip lost more than the format's precision allows");
+
+    std::println("{}", failures == 0 ? "All vertex packing checks passed" : std::format("{} vertex packing checks failed", failures));
+    return failures == 0 ? 0 : 1;
+}
+
+/// Imports and optimizes every model, times the level of detail generation on it and prints
+/// the levels' triangle counts and errors, then how many triangles the model would draw at
+/// increasing distances from a 1080p camera. Doesn't open a window, no GPU needed.
+/// Without arguments it goes through all the bundled models.
+export auto benchmarkMeshSimplifier(std::vector<std::string> modelPaths) -> int {
+    constexpr std::array<float, 8> distances = { 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f, 64.0f, 128.0f };
+
+    modelPaths = collectModelPaths(std::move(modelPaths));
+    const Camera camera(glm::i32vec2(1920, 1080));
+
+    model::simplifier::Report total;
+    for (const auto& modelPath : modelPaths) {
+        std::vector<model::cache::MeshData> meshes = Model::importModel(modelPath);
+        model::optimizer::optimizeMeshes(meshes);
+
+        std::println("{}:", modelPath);
+        const model::simplifier::Report report = model::simplifier::generateLevelsOfDetail(meshes);
+        total.add(report);
+
+        // Triangles and the largest error of each level, over all the meshes that have it.
+        std::vector<std::size_t> levelTriangles(model::simplifier::defaults::maxLevelCount, 0);
+        std::vector<float> levelErrors(model::simplifier::defaults::maxLevelCount, 0.0f);
+        for (const auto& mesh : meshes) {
+            for (std::size_t level = 0; level < mesh.lods.size(); level++) {
+                levelTriangles[level] += mesh.lods[level].indexCount / 3;
+                levelErrors[level] = std::max(levelErrors[level], mesh.lods[level].error);
+            }
+        }
+        for (std::size_t level = 0; level < levelTriangles.size() && levelTriangles[level] > 0; level++) {
+            std::println("    LOD {}: {:8} triangles, error {:.5f}", level, levelTriangles[level], levelErrors[level]);
+        }
+
+        // Every mesh is placed `distance` away from the camera (to its nearest point), scaled by its transform.
+        for (const float distance : distances) {
+            std::size_t drawnTriangles = 0;
+            for (const auto& mesh : meshes) {
+                const float scale = std::max({ glm::length(glm::vec3(mesh.transform[0])),
+                    glm::length(glm::vec3(mesh.transform[1])), glm::length(glm::vec3(mesh.transform[2])) });
+                const std::size_t level = model::simplifier::selectLevelOfDetail(mesh.lods, camera.getPixelsPerUnit(distance) * scale);
+                drawnTriangles += mesh.lods.empty() ? mesh.indices.size() / 3 : mesh.lods[level].indexCount / 3;
+            }
+            std::println("    at {:5.0f} units: {:8} triangles ({:5.1f}%)", distance, drawnTriangles,
+                100.0 * static_cast<double>(drawnTriangles) / static_cast<double>(std::max<std::size_t>(report.triangles, 1)));
+        }
+    }
+
+    std::println("{} models, {} triangles simplified into {} levels in {:.1f} ms ({:.2f} MTris/s)",
+        modelPaths.size(), total.triangles, total.levels, total.milliseconds, total.getMegaTrianglesPerSecond());
+    return 0;
+}
+
+/// Imports every model, which packs the small textures of its materials into atlases next to it
+/// and prints how many texture objects that saves and how much of the atlases' area is wasted.
+/// Doesn't open a window, no GPU needed. Without arguments it goes through all the bundled models.
+export auto packTextureAtlases(std::vector<std::string> modelPaths) -> int {
+    modelPaths = collectModelPaths(std::move(modelPaths));
+    for (const auto& modelPath : modelPaths) {
+        std::println("{}:", modelPath);
+        const std::vector<model::cache::MeshData> meshes = Model::importModel(modelPath);
+    }
+    return 0;
+}
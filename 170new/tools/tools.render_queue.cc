@@ -0,0 +1,77 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+#include <random>
+
+export module tools.render_queue;
+
+import render_queue;
+
+/// Sorts a queue of `drawCount` random draws (mostly opaque ones over 32 shaders and 512 materials,
+/// a tenth translucent) with the render queue's radix sort and with `std::stable_sort`, and prints how
+/// long both take. Fails (returns 1) if they don't agree. Doesn't open a window, no GPU needed.
+export auto benchmarkRenderQueue(const std::size_t drawCount) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    constexpr int runs = 100;
+
+    // Fixed seed, every run sorts the same draws.
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::uint32_t> shader(1, 32);
+    std::uniform_int_distribution<std::uint32_t> material(1, 512);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<render_queue::Entry> draws;
+    draws.reserve(drawCount);
+    for (std::size_t i = 0; i < drawCount; i++) {
+        const bool isTranslucent = percent(random) < 10;
+        const render_queue::Key key = isTranslucent
+            ? render_queue::makeTranslucentKey(render_queue::Pass::Translucent, shader(random), material(random), depth(random))
+            : render_queue::makeOpaqueKey(render_queue::Pass::Opaque, shader(random), material(random), depth(random));
+        draws.push_back(render_queue::Entry { key, static_cast<std::uint32_t>(i) });
+    }
+
+    RenderQueue queue;
+    queue.reserve(drawCount);
+    Milliseconds radixTime{};
+    for (int run = 0; run < runs; run++) {
+        queue.clear();
+        for (const auto& draw : draws) {
+            queue.submit(draw.key, draw.item);
+        }
+        const auto start = Clock::now();
+        queue.sort();
+        radixTime += Clock::now() - start;
+    }
+
+    std::vector<render_queue::Entry> sorted;
+    Milliseconds stdTime{};
+    for (int run = 0; run < runs; run++) {
+        sorted = draws;
+        const auto start = Clock::now();
+        std::ranges::stable_sort(sorted, std::less{}, &render_queue::Entry::key);
+        stdTime += Clock::now() - start;
+    }
+
+    const bool agree = std::ranges::equal(queue.getEntries(), sorted, [](const auto& a, const auto& b) {
+        return a.key == b.key && a.item == b.item;
+    });
+    std::size_t stateChanges = 0;
+    for (std::size_t i = 1; i < sorted.size(); i++) {
+        // Shader and material bits of the opaque keys, every other field changes with the depth.
+        constexpr render_queue::Key stateMask = ~((render_queue::Key(1) << (7 + render_queue::defaults::depthBits)) - 1);
+        stateChanges += (sorted[i].key & stateMask) != (sorted[i - 1].key & stateMask) ? 1 : 0;
+    }
+
+    const double radixMilliseconds = radixTime.count() / runs;
+    const double stdMilliseconds = stdTime.count() / runs;
+    std::println("{} draws: radix sort {:.3f} ms ({:.1f} M draws/s), std::stable_sort {:.3f} ms ({:.1f} M draws/s), {:.1f}x",
+        drawCount, radixMilliseconds, static_cast<double>(drawCount) / 1000.0 / radixMilliseconds,
+        stdMilliseconds, static_cast<double>(drawCount) / 1000.0 / stdMilliseconds, stdMilliseconds / radixMilliseconds);
+    std::println("    {} shader/material changes in the sorted queue, {}", stateChanges,
+        agree ? "both sorts agree" : "THE SORTS DISAGREE");
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module tools.texture;
+
+import texture;
+import texture.compression;
+import texture.cache;
+
+/// Compresses the image with every format the CPU encoder supports and prints
+/// the quality (PSNR) and the encoder's throughput. Doesn't open a window, no GPU needed.
+export auto evaluateCompression(const std::string& imagePath) -> int {
+    using texture::compression::Format;
+
+    const texture::Image image = texture::decodeImage(imagePath);
+    std::println("{}: {}x{}, {} channels", imagePath, image.width, image.height, image.channels);
+
+    for (const auto format : { Format::BC1, Format::BC3, Format::BC4, Format::BC5, Format::BC7 }) {
+        const auto evaluation = texture::compression::evaluate(image.getView(), format);
+        std::println("    {}: PSNR {:6.2f} dB, encoded in {:8.2f} ms ({:.1f} MPix/s)",
+            texture::compression::FormatToString(format), evaluation.psnr,
+            evaluation.encodeMilliseconds, evaluation.megapixelsPerSecond);
+    }
+    return 0;
+}
+
+/// Loads the image through the texture cache cold (decode, build the mips and compress them) and then
+/// from the cache, and prints both load times. Doesn't open a window, no GPU needed.
+export auto benchmarkTextureCache(const std::string& imagePath) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    constexpr int hitRuns = 5;
+
+    // Forces the cold path.
+    std::filesystem::remove(imagePath + std::string(texture::cache::fileExtension));
+
+    auto start = Clock::now();
+    const auto cold = texture::cookImage(imagePath, texture::Type::DiffuseMap);
+    const Milliseconds coldTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < hitRuns; i++) {
+        const auto hit = texture::cookImage(imagePath, texture::Type::DiffuseMap);
+    }
+    const Milliseconds hitTime = (Clock::now() - start) / hitRuns;
+
+    std::size_t cookedBytes = 0;
+    for (const auto& level : cold.levels) {
+        cookedBytes += level.pixels.size();
+    }
+    std::println("{}: {}x{}, {} mip levels, {} ({} KiB)", imagePath, cold.levels.front().width, cold.levels.front().height,
+        cold.levels.size(), cold.format.has_value() ? texture::compression::FormatToString(*cold.format) : "uncompressed",
+        cookedBytes / 1024);
+    std::println("    cold decode + mips + compression: {:8.2f} ms", coldTime.count());
+    std::println("    cache hit:                        {:8.2f} ms (average of {}, {:.1f}x faster)",
+        hitTime.count(), hitRuns, coldTime / hitTime);
+    return 0;
+}
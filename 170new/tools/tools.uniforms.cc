@@ -0,0 +1,90 @@
+//
+// Created by phatt on 10/16/26.
+//
+module;
+
+#include "std.h"
+
+export module tools.uniforms;
+
+import shader_program.uniforms;
+
+using namespace uniform::literals;
+
+/// Looks up the uniforms of `drawCount` draws of model_with_light.glsl (the model matrix, the position
+/// bounds, the first draw index and six material samplers per draw) by their strings in an `std::unordered_map`
+/// (what `ShaderProgram` used to do, building the samplers' names every draw) and by their compile time
+/// hashes in a `UniformTable`, and prints how long both take. Fails (returns 1) if they find different
+/// locations. Doesn't open a window, no GPU needed.
+export auto benchmarkUniformLookup(const std::size_t drawCount) -> int {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    // The active uniforms of the program, at made up locations.
+    const std::array<std::string_view, 13> names = {
+        "U_ModelMat4", "U_PositionBoundsCenterVec3", "U_PositionBoundsExtentVec3", "U_FirstDrawIndex",
+        "U_LightColorVec4", "U_LightPositionVec3",
+        "U_Material.DiffuseMap0", "U_Material.DiffuseMap1", "U_Material.DiffuseMap2",
+        "U_Material.SpecularMap0", "U_Material.SpecularMap1", "U_Material.SpecularMap2",
+        "U_Time",
+    };
+    std::unordered_map<std::string, int> stringLocations;
+    UniformTable table;
+    for (std::size_t i = 0; i < names.size(); i++) {
+        stringLocations[std::string(names[i])] = static_cast<int>(i);
+        table.add(names[i], static_cast<int>(i));
+    }
+
+    // As the old `ShaderProgram::getUniformLocation(const std::string&)` did it.
+    const auto findByString = [&stringLocations](const std::string& name) -> int {
+        if (stringLocations.contains(name)) {
+            return stringLocations[name];
+        }
+        return -1;
+    };
+    const auto findByHash = [&table](const UniformName name) -> int {
+        return table.find(name).value_or(-1);
+    };
+
+    std::int64_t stringSum = 0;
+    auto start = Clock::now();
+    for (std::size_t draw = 0; draw < drawCount; draw++) {
+        stringSum += findByString("U_ModelMat4");
+        stringSum += findByString("U_PositionBoundsCenterVec3");
+        stringSum += findByString("U_PositionBoundsExtentVec3");
+        stringSum += findByString("U_FirstDrawIndex");
+        for (const std::string type : { "DiffuseMap", "SpecularMap" }) {
+            for (int number = 0; number < 3; number++) {
+                stringSum += findByString("U_Material." + type + std::to_string(number));
+            }
+        }
+    }
+    const Milliseconds stringTime = Clock::now() - start;
+
+    constexpr std::array materialNames = {
+        "U_Material.DiffuseMap0"_uniform, "U_Material.DiffuseMap1"_uniform, "U_Material.DiffuseMap2"_uniform,
+        "U_Material.SpecularMap0"_uniform, "U_Material.SpecularMap1"_uniform, "U_Material.SpecularMap2"_uniform,
+    };
+    std::int64_t hashSum = 0;
+    start = Clock::now();
+    for (std::size_t draw = 0; draw < drawCount; draw++) {
+        hashSum += findByHash("U_ModelMat4"_uniform);
+        hashSum += findByHash("U_PositionBoundsCenterVec3"_uniform);
+        hashSum += findByHash("U_PositionBoundsExtentVec3"_uniform);
+        hashSum += findByHash("U_FirstDrawIndex"_uniform);
+        for (const UniformName name : materialNames) {
+            hashSum += findByHash(name);
+        }
+    }
+    const Milliseconds hashTime = Clock::now() - start;
+
+    const auto nanosecondsPerLookup = [drawCount](const Milliseconds time) {
+        return time.count() * 1'000'000.0 / static_cast<double>(drawCount * 10);
+    };
+    const bool agree = stringSum == hashSum;
+    std::println("{} draws, 10 uniforms each: strings {:.3f} ms ({:.1f} ns/lookup), hashes {:.3f} ms ({:.1f} ns/lookup), {:.1f}x",
+        drawCount, stringTime.count(), nanosecondsPerLookup(stringTime),
+        hashTime.count(), nanosecondsPerLookup(hashTime), stringTime / hashTime);
+    std::println("    {}", agree ? "both find the same locations" : "THE LOOKUPS DISAGREE");
+    return agree ? 0 : 1;
+}